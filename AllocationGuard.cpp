@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+// <copyright file="AllocationGuard.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the frame path allocation check
+
+#include "stdafx.h"
+#include "AllocationGuard.h"
+
+#ifdef _DEBUG
+
+#include <crtdbg.h>
+#include <strsafe.h>
+
+// State of the calling thread: frames it entered, and how deep it is in guards and exemptions
+static __declspec(thread) unsigned int t_frames = 0;
+static __declspec(thread) int t_guards = 0;
+static __declspec(thread) int t_exemptions = 0;
+
+static volatile LONG g_Violations = 0;
+static _CRT_ALLOC_HOOK g_PreviousHook = NULL;
+
+/// <summary>
+/// CRT allocation hook, sees every heap operation of the process before it happens. It
+/// must not allocate itself
+/// </summary>
+/// <param name="allocType">_HOOK_ALLOC, _HOOK_REALLOC or _HOOK_FREE</param>
+/// <param name="pUserData">block freed, NULL for an allocation</param>
+/// <param name="size">bytes requested</param>
+/// <param name="blockType">_NORMAL_BLOCK, _CRT_BLOCK, ...</param>
+/// <param name="request">allocation number, for _CrtSetBreakAlloc</param>
+/// <param name="pFileName">source file, if known</param>
+/// <param name="line">source line, if known</param>
+/// <returns>TRUE to let the operation go ahead</returns>
+static int __cdecl AllocationHook( int allocType, void * pUserData, size_t size, int blockType, long request, const unsigned char * pFileName, int line )
+{
+	// the CRT's own blocks are its business, e.g. stream buffers of the debug output
+	if ( _HOOK_FREE != allocType && _CRT_BLOCK != blockType &&
+		 t_guards > 0 && 0 == t_exemptions && t_frames > ALLOCATION_GUARD_WARMUP )
+	{
+		LONG count = InterlockedIncrement( &g_Violations );
+		if ( count <= ALLOCATION_GUARD_REPORTS )
+		{
+			char message[128];
+			StringCchPrintfA( message, _countof(message), "Frame path allocated %Iu bytes, allocation %ld\r\n", size, request );
+			OutputDebugStringA( message );
+		}
+
+		if ( IsDebuggerPresent() )
+		{
+			__debugbreak();
+		}
+	}
+
+	if ( NULL != g_PreviousHook )
+	{
+		return g_PreviousHook( allocType, pUserData, size, blockType, request, pFileName, line );
+	}
+	return TRUE;
+}
+
+/// <summary>
+/// Constructor, enters the frame
+/// </summary>
+AllocationGuard::AllocationGuard()
+{
+	if ( 0 == t_guards++ )
+	{
+		++t_frames;
+	}
+}
+
+/// <summary>
+/// Destructor, leaves the frame
+/// </summary>
+AllocationGuard::~AllocationGuard()
+{
+	--t_guards;
+}
+
+/// <summary>
+/// Hook the CRT heap, once at startup before any frame is processed
+/// </summary>
+void AllocationGuard::Install( )
+{
+	g_PreviousHook = _CrtSetAllocHook( AllocationHook );
+}
+
+/// <summary>
+/// Allocations made in steady state frames so far, any thread
+/// </summary>
+/// <returns>number of allocations</returns>
+long AllocationGuard::GetViolations( )
+{
+	return g_Violations;
+}
+
+/// <summary>
+/// Constructor, the calling thread may allocate
+/// </summary>
+AllocationExemption::AllocationExemption()
+{
+	++t_exemptions;
+}
+
+/// <summary>
+/// Destructor, the thread's frame is checked again
+/// </summary>
+AllocationExemption::~AllocationExemption()
+{
+	--t_exemptions;
+}
+
+#endif
@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------------
+// <copyright file="AllocationGuard.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the check that the frame path runs without touching the heap. Each thread marks
+// the frames it processes with an AllocationGuard. In Debug builds a CRT allocation hook
+// catches every malloc and operator new made inside one, once the thread has processed
+// ALLOCATION_GUARD_WARMUP frames: it is counted, reported with its allocation number and
+// breaks into an attached debugger. Setup that is lazy on purpose, such as a trace ring,
+// runs inside an AllocationExemption. Release builds compile all of it away.
+
+#pragma once
+
+// Frames each thread processes before allocating counts, first-use setup happens in these
+#define ALLOCATION_GUARD_WARMUP         300
+
+// Allocations reported in the debug output, the count goes on
+#define ALLOCATION_GUARD_REPORTS        16
+
+/// <summary>
+/// Marks one frame of a thread as steady state, for as long as it is in scope
+/// </summary>
+class AllocationGuard
+{
+public:
+#ifdef _DEBUG
+	/// <summary>
+	/// Constructor, enters the frame
+	/// </summary>
+	AllocationGuard();
+
+	/// <summary>
+	/// Destructor, leaves the frame
+	/// </summary>
+	~AllocationGuard();
+
+	/// <summary>
+	/// Hook the CRT heap, once at startup before any frame is processed
+	/// </summary>
+	static void Install( );
+
+	/// <summary>
+	/// Allocations made in steady state frames so far, any thread
+	/// </summary>
+	/// <returns>number of allocations</returns>
+	static long GetViolations( );
+#else
+	AllocationGuard() {}
+	~AllocationGuard() {}
+	static void Install( ) {}
+	static long GetViolations( ) { return 0; }
+#endif
+
+private:
+	// scoped only
+	AllocationGuard( const AllocationGuard & );
+	AllocationGuard & operator=( const AllocationGuard & );
+};
+
+/// <summary>
+/// Lets the calling thread allocate inside a frame, for as long as it is in scope
+/// </summary>
+class AllocationExemption
+{
+public:
+#ifdef _DEBUG
+	AllocationExemption();
+	~AllocationExemption();
+#else
+	AllocationExemption() {}
+	~AllocationExemption() {}
+#endif
+
+private:
+	// scoped only
+	AllocationExemption( const AllocationExemption & );
+	AllocationExemption & operator=( const AllocationExemption & );
+};
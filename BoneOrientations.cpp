@@ -0,0 +1,256 @@
+//------------------------------------------------------------------------------
+// <copyright file="BoneOrientations.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Rotations of the bones of every user, four users at a time
+
+#include "stdafx.h"
+#include "BoneOrientations.h"
+
+static_assert( NUI_SKELETON_COUNT <= BONE_LANES && 0 == BONE_LANES % 4, "every skeleton has a lane of a whole quaternion4" );
+
+/// <summary>
+/// One bone, stored under its end joint
+/// </summary>
+struct BoneDefinition
+{
+	int     bone;           // NUI_SKELETON_POSITION_INDEX of the end joint
+	int     from;           // the bone runs from this joint,
+	int     to;             // to this one; the root runs up to the spine
+	int     parent;         // bone it hangs from, -1 for the root
+	int     left;           // its x axis runs from this joint,
+	int     right;          // to this one, -1 to turn the parent instead
+};
+
+// Parents before their children
+static const BoneDefinition g_Bones[NUI_SKELETON_POSITION_COUNT] =
+{
+	{ NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_SPINE, -1, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_HIP_RIGHT },
+	{ NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_HIP_RIGHT },
+	{ NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_SHOULDER_RIGHT },
+	{ NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_SHOULDER_RIGHT },
+
+	{ NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_SHOULDER_CENTER, -1, -1 },
+	{ NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_SHOULDER_LEFT, -1, -1 },
+	{ NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, -1, -1 },
+	{ NUI_SKELETON_POSITION_HAND_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, -1, -1 },
+	{ NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_SHOULDER_CENTER, -1, -1 },
+	{ NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_SHOULDER_RIGHT, -1, -1 },
+	{ NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, -1, -1 },
+	{ NUI_SKELETON_POSITION_HAND_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, -1, -1 },
+
+	{ NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_HIP_CENTER, -1, -1 },
+	{ NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_HIP_LEFT, -1, -1 },
+	{ NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, -1, -1 },
+	{ NUI_SKELETON_POSITION_FOOT_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, -1, -1 },
+	{ NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_HIP_CENTER, -1, -1 },
+	{ NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_HIP_RIGHT, -1, -1 },
+	{ NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, -1, -1 },
+	{ NUI_SKELETON_POSITION_FOOT_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, -1, -1 }
+};
+
+/// <summary>
+/// Joint of four lanes
+/// </summary>
+/// <param name="joints">joints of every lane</param>
+/// <param name="joint">NUI_SKELETON_POSITION_INDEX</param>
+/// <param name="lane">first of the four lanes</param>
+/// <returns>the joint of each lane</returns>
+static inline vector4 LoadJoint( const BoneJoints & joints, int joint, int lane )
+{
+	vector4 v;
+	v.x = _mm_loadu_ps( &joints.x[joint][lane] );
+	v.y = _mm_loadu_ps( &joints.y[joint][lane] );
+	v.z = _mm_loadu_ps( &joints.z[joint][lane] );
+	return v;
+}
+
+/// <summary>
+/// a minus its component along a unit vector
+/// </summary>
+static inline vector4 Reject( const vector4 & a, const vector4 & unit )
+{
+	__m128 along = Vector4Dot( a, unit );
+	vector4 v;
+	v.x = _mm_sub_ps( a.x, _mm_mul_ps( along, unit.x ) );
+	v.y = _mm_sub_ps( a.y, _mm_mul_ps( along, unit.y ) );
+	v.z = _mm_sub_ps( a.z, _mm_mul_ps( along, unit.z ) );
+	return v;
+}
+
+/// <summary>
+/// Unit vector along a, or the fallback in the lanes where a is shorter than BONE_MIN_LENGTH
+/// </summary>
+static inline vector4 Normalize( const vector4 & a, const vector4 & fallback )
+{
+	__m128 lengthSquared = Vector4Dot( a, a );
+	__m128 valid = _mm_cmpgt_ps( lengthSquared, _mm_set1_ps( BONE_MIN_LENGTH * BONE_MIN_LENGTH ) );
+	__m128 scale = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( _mm_max_ps( lengthSquared, _mm_set1_ps( BONE_MIN_LENGTH * BONE_MIN_LENGTH ) ) ) );
+
+	vector4 v;
+	v.x = _mm_or_ps( _mm_and_ps( valid, _mm_mul_ps( a.x, scale ) ), _mm_andnot_ps( valid, fallback.x ) );
+	v.y = _mm_or_ps( _mm_and_ps( valid, _mm_mul_ps( a.y, scale ) ), _mm_andnot_ps( valid, fallback.y ) );
+	v.z = _mm_or_ps( _mm_and_ps( valid, _mm_mul_ps( a.z, scale ) ), _mm_andnot_ps( valid, fallback.z ) );
+	return v;
+}
+
+/// <summary>
+/// Constructor, nobody seen yet
+/// </summary>
+BoneOrientations::BoneOrientations()
+{
+	Reset();
+}
+
+/// <summary>
+/// Forget every orientation
+/// </summary>
+void BoneOrientations::Reset( )
+{
+	ZeroMemory( m_trackingId, sizeof(m_trackingId) );
+	ZeroMemory( m_absolute, sizeof(m_absolute) );
+	ZeroMemory( m_hierarchical, sizeof(m_hierarchical) );
+
+	for ( int b = 0; b < NUI_SKELETON_POSITION_COUNT; b++ )
+	{
+		for ( int i = 0; i < BONE_LANES; i++ )
+		{
+			m_absolute[3][b][i] = 1.0f;
+			m_hierarchical[3][b][i] = 1.0f;
+		}
+	}
+}
+
+/// <summary>
+/// Compute every bone of every lane. A lane whose tracking id changed starts over
+/// </summary>
+/// <param name="joints">joints of every lane</param>
+void BoneOrientations::Compute( const BoneJoints & joints )
+{
+	for ( int lane = 0; lane < BONE_LANES; lane += 4 )
+	{
+		for ( int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++ )
+		{
+			const BoneDefinition & bone = g_Bones[i];
+			int b = bone.bone;
+
+			quaternion4 parent = Quaternion4Identity();
+			if ( bone.parent >= 0 )
+			{
+				parent = Quaternion4Load( &m_absolute[0][bone.parent][lane], &m_absolute[1][bone.parent][lane],
+										  &m_absolute[2][bone.parent][lane], &m_absolute[3][bone.parent][lane] );
+			}
+			rotation4 parentAxes = Quaternion4GetMatrix( parent );
+			const vector4 & parentX = parentAxes.x;
+			const vector4 & parentY = parentAxes.y;
+
+			// along the bone, the parent's direction if the joints are on top of each other
+			vector4 from = LoadJoint( joints, bone.from, lane );
+			vector4 to = LoadJoint( joints, bone.to, lane );
+			vector4 along;
+			along.x = _mm_sub_ps( to.x, from.x );
+			along.y = _mm_sub_ps( to.y, from.y );
+			along.z = _mm_sub_ps( to.z, from.z );
+			along = Normalize( along, parentY );
+
+			quaternion4 rotation;
+			if ( bone.left >= 0 )
+			{
+				// x across the hips or the shoulders, square to the bone
+				vector4 left = LoadJoint( joints, bone.left, lane );
+				vector4 right = LoadJoint( joints, bone.right, lane );
+				vector4 across;
+				across.x = _mm_sub_ps( right.x, left.x );
+				across.y = _mm_sub_ps( right.y, left.y );
+				across.z = _mm_sub_ps( right.z, left.z );
+				vector4 fallback = Normalize( Reject( parentX, along ), parentX );
+
+				rotation4 axes;
+				axes.x = Normalize( Reject( across, along ), fallback );
+				axes.y = along;
+				axes.z = Vector4Cross( axes.x, along );
+				rotation = Quaternion4FromMatrix( axes );
+			}
+			else
+			{
+				// the parent turned the shortest way from its y axis onto the bone, the quaternion
+				// half way between no turn and the whole turn; half a turn about the parent's x axis
+				// if the bone points back
+				const __m128 one = _mm_set1_ps( 1.0f );
+				__m128 cosine = Vector4Dot( parentY, along );
+				vector4 axis = Vector4Cross( parentY, along );
+				quaternion4 turn;
+				turn.x = axis.x;
+				turn.y = axis.y;
+				turn.z = axis.z;
+				turn.w = _mm_add_ps( one, cosine );
+
+				quaternion4 halfTurn;
+				halfTurn.x = parentX.x;
+				halfTurn.y = parentX.y;
+				halfTurn.z = parentX.z;
+				halfTurn.w = _mm_setzero_ps();
+
+				__m128 opposite = _mm_cmple_ps( turn.w, _mm_set1_ps( 1e-6f ) );
+				turn = Quaternion4Normalize( Quaternion4Select( opposite, halfTurn, turn ) );
+				rotation = Quaternion4Multiply( turn, parent );
+			}
+
+			// a bone of inferred joints eases toward its new orientation, a new user does not
+			float weight[4];
+			unsigned int bits = ( 1u << bone.from ) | ( 1u << bone.to );
+			for ( int k = 0; k < 4; k++ )
+			{
+				bool restart = joints.trackingId[lane + k] != m_trackingId[lane + k];
+				weight[k] = ( restart || bits == ( joints.trackedMask[lane + k] & bits ) ) ? 1.0f : BONE_INFERRED_WEIGHT;
+			}
+			quaternion4 previous = Quaternion4Load( &m_absolute[0][b][lane], &m_absolute[1][b][lane],
+													&m_absolute[2][b][lane], &m_absolute[3][b][lane] );
+			rotation = Quaternion4Normalize( Quaternion4SlerpFast( previous, rotation, _mm_loadu_ps( weight ) ) );
+
+			quaternion4 hierarchical = ( bone.parent >= 0 ) ? Quaternion4Multiply( Quaternion4Conjugate( parent ), rotation ) : rotation;
+
+			Quaternion4Store( rotation, &m_absolute[0][b][lane], &m_absolute[1][b][lane],
+							  &m_absolute[2][b][lane], &m_absolute[3][b][lane] );
+			Quaternion4Store( hierarchical, &m_hierarchical[0][b][lane], &m_hierarchical[1][b][lane],
+							  &m_hierarchical[2][b][lane], &m_hierarchical[3][b][lane] );
+		}
+	}
+
+	memcpy( m_trackingId, joints.trackingId, sizeof(m_trackingId) );
+}
+
+/// <summary>
+/// Rotation of every bone of a lane relative to its parent bone, the hip center's is
+/// its absolute rotation
+/// </summary>
+/// <param name="user">lane</param>
+/// <param name="pOut">receives x, y, z and w of every bone in NUI_SKELETON_POSITION_INDEX order of the end joint</param>
+void BoneOrientations::GetHierarchical( int user, float * pOut ) const
+{
+	for ( int b = 0; b < NUI_SKELETON_POSITION_COUNT; b++ )
+	{
+		for ( int row = 0; row < 4; row++ )
+		{
+			pOut[4 * b + row] = m_hierarchical[row][b][user];
+		}
+	}
+}
+
+/// <summary>
+/// Rotation of every bone of a lane in the display frame
+/// </summary>
+/// <param name="user">lane</param>
+/// <param name="pOut">receives x, y, z and w of every bone in NUI_SKELETON_POSITION_INDEX order of the end joint</param>
+void BoneOrientations::GetAbsolute( int user, float * pOut ) const
+{
+	for ( int b = 0; b < NUI_SKELETON_POSITION_COUNT; b++ )
+	{
+		for ( int row = 0; row < 4; row++ )
+		{
+			pOut[4 * b + row] = m_absolute[row][b][user];
+		}
+	}
+}
@@ -0,0 +1,85 @@
+//------------------------------------------------------------------------------
+// <copyright file="BoneOrientations.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the rotation of every bone, absolute in the display frame and hierarchical
+// relative to its parent bone, computed from the joints the way
+// NuiSkeletonCalculateBoneOrientations reports them: a bone is named after its end joint,
+// its y axis runs from its start joint to its end joint, and the hip center is the root.
+// The hip center, spine, shoulder center and head take their x axis across the hips or the
+// shoulders; a limb bone is its parent turned the shortest way onto its own direction, so
+// it carries the twist of the torso.
+//
+// Every user is a lane of quaternion4, each bone is computed for all users at once, parents
+// before children, in one pass over the bone table.
+
+#pragma once
+
+#include "NuiApi.h"
+#include "QuaternionBatch.h"
+
+// Lanes, NUI_SKELETON_COUNT rounded up to whole quaternion4
+#define BONE_LANES                      8
+
+// Weight of the new orientation of a bone whose joints are only inferred, the rest
+// stays with the previous one, so occluded limbs do not jump around
+#define BONE_INFERRED_WEIGHT            0.5f
+
+// Bones shorter than this give no direction, inches
+#define BONE_MIN_LENGTH                 0.01f
+
+/// <summary>
+/// Joints the bones are computed from, in the display frame (inches), one lane per user
+/// </summary>
+struct BoneJoints
+{
+	float           x[NUI_SKELETON_POSITION_COUNT][BONE_LANES];
+	float           y[NUI_SKELETON_POSITION_COUNT][BONE_LANES];
+	float           z[NUI_SKELETON_POSITION_COUNT][BONE_LANES];
+	DWORD           trackingId[BONE_LANES];     // 0 for a lane nobody is in
+	unsigned int    trackedMask[BONE_LANES];    // bit j set if joint j is tracked, not only inferred
+};
+
+class BoneOrientations
+{
+public:
+	/// <summary>
+	/// Constructor, nobody seen yet
+	/// </summary>
+	BoneOrientations();
+
+	/// <summary>
+	/// Forget every orientation
+	/// </summary>
+	void Reset( );
+
+	/// <summary>
+	/// Compute every bone of every lane. A lane whose tracking id changed starts over
+	/// </summary>
+	/// <param name="joints">joints of every lane</param>
+	void Compute( const BoneJoints & joints );
+
+	/// <summary>
+	/// Rotation of every bone of a lane relative to its parent bone, the hip center's is
+	/// its absolute rotation
+	/// </summary>
+	/// <param name="user">lane</param>
+	/// <param name="pOut">receives x, y, z and w of every bone in NUI_SKELETON_POSITION_INDEX order of the end joint</param>
+	void GetHierarchical( int user, float * pOut ) const;
+
+	/// <summary>
+	/// Rotation of every bone of a lane in the display frame
+	/// </summary>
+	/// <param name="user">lane</param>
+	/// <param name="pOut">receives x, y, z and w of every bone in NUI_SKELETON_POSITION_INDEX order of the end joint</param>
+	void GetAbsolute( int user, float * pOut ) const;
+
+private:
+	DWORD           m_trackingId[BONE_LANES];   // whose orientations each lane holds
+
+	// Quaternion rows x, y, z and w, bone b of lane i at [row][b][i]
+	float           m_absolute[4][NUI_SKELETON_POSITION_COUNT][BONE_LANES];
+	float           m_hierarchical[4][NUI_SKELETON_POSITION_COUNT][BONE_LANES];
+};
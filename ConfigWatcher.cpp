@@ -0,0 +1,194 @@
+//------------------------------------------------------------------------------
+// <copyright file="ConfigWatcher.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the settings file watcher
+
+#include "stdafx.h"
+#include "ConfigWatcher.h"
+#include <fstream>
+
+/// <summary>
+/// Constructor
+/// </summary>
+ConfigWatcher::ConfigWatcher() :
+	m_hWnd(NULL),
+	m_message(0),
+	m_hChange(INVALID_HANDLE_VALUE),
+	m_hThWatch(NULL),
+	m_hEvWatchStop(NULL)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+ConfigWatcher::~ConfigWatcher()
+{
+	Stop();
+}
+
+/// <summary>
+/// Watch a file in the current directory, on a thread of its own
+/// </summary>
+/// <param name="path">file name</param>
+/// <param name="hWnd">window the settings are posted to</param>
+/// <param name="message">message posted, lParam is a TrackerSettings * the window deletes</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT ConfigWatcher::Start( const char * path, HWND hWnd, UINT message )
+{
+	Stop();
+
+	m_path = path;
+	m_hWnd = hWnd;
+	m_message = message;
+
+	// the directory is watched, editors often replace the file rather than write it
+	m_hChange = FindFirstChangeNotificationA( ".", FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME );
+	if ( INVALID_HANDLE_VALUE == m_hChange )
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+
+	// manual reset, the thread waits on it in more than one place and every wait must see it
+	m_hEvWatchStop = CreateEvent( NULL, TRUE, FALSE, NULL );
+	m_hThWatch = CreateThread( NULL, 0, WatchThread, this, 0, NULL );
+	if ( NULL == m_hThWatch )
+	{
+		HRESULT hr = HRESULT_FROM_WIN32( GetLastError() );
+		Stop();
+		return hr;
+	}
+
+	return S_OK;
+}
+
+/// <summary>
+/// Stop watching
+/// </summary>
+void ConfigWatcher::Stop( )
+{
+	if ( NULL != m_hEvWatchStop )
+	{
+		// Signal the thread
+		SetEvent( m_hEvWatchStop );
+
+		// Wait for thread to stop
+		if ( NULL != m_hThWatch )
+		{
+			WaitForSingleObject( m_hThWatch, INFINITE );
+			CloseHandle( m_hThWatch );
+			m_hThWatch = NULL;
+		}
+		CloseHandle( m_hEvWatchStop );
+		m_hEvWatchStop = NULL;
+	}
+
+	if ( INVALID_HANDLE_VALUE != m_hChange )
+	{
+		FindCloseChangeNotification( m_hChange );
+		m_hChange = INVALID_HANDLE_VALUE;
+	}
+}
+
+/// <summary>
+/// Read and check a settings file. Any thread
+/// </summary>
+/// <param name="path">file name</param>
+/// <param name="settings">receives the settings if the file is valid</param>
+/// <param name="error">receives why it is not</param>
+/// <returns>true if the file was valid and read, false otherwise</returns>
+bool ConfigWatcher::Load( const char * path, TrackerSettings & settings, std::string & error )
+{
+	std::ifstream inFile( path );
+	if ( !inFile.is_open() )
+	{
+		error = std::string( "cannot open " ) + path;
+		return false;
+	}
+
+	return settings.Read( inFile, error );
+}
+
+/// <summary>
+/// Last time the file was written
+/// </summary>
+/// <returns>write time, 0 if there is no such file</returns>
+ULONGLONG ConfigWatcher::GetWriteTime( ) const
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if ( !GetFileAttributesExA( m_path.c_str(), GetFileExInfoStandard, &attributes ) )
+	{
+		return 0;
+	}
+
+	return ( static_cast<ULONGLONG>(attributes.ftLastWriteTime.dwHighDateTime) << 32 ) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+/// <summary>
+/// Thread watching the file, calls class instance thread processor
+/// </summary>
+/// <param name="pParam">instance pointer</param>
+/// <returns>always 0</returns>
+DWORD WINAPI ConfigWatcher::WatchThread( LPVOID pParam )
+{
+	ConfigWatcher *pthis = (ConfigWatcher *)pParam;
+	return pthis->WatchThread( );
+}
+
+/// <summary>
+/// Thread watching the file
+/// </summary>
+/// <returns>always 0</returns>
+DWORD WINAPI ConfigWatcher::WatchThread( )
+{
+	const int numEvents = 2;
+	HANDLE hEvents[numEvents] = { m_hEvWatchStop, m_hChange };
+	ULONGLONG lastWrite = GetWriteTime();
+
+	while ( WAIT_OBJECT_0 != WaitForMultipleObjects( numEvents, hEvents, FALSE, INFINITE ) )
+	{
+		// let the writer finish, every change until it is quiet is the same update
+		DWORD settled;
+		do
+		{
+			FindNextChangeNotification( m_hChange );
+			settled = WaitForMultipleObjects( numEvents, hEvents, FALSE, CONFIG_WATCH_SETTLE );
+		}
+		while ( WAIT_OBJECT_0 + 1 == settled );
+
+		if ( WAIT_OBJECT_0 == settled )
+		{
+			break;
+		}
+
+		// something else in the directory changed
+		ULONGLONG write = GetWriteTime();
+		if ( 0 == write || write == lastWrite )
+		{
+			continue;
+		}
+		lastWrite = write;
+
+		TrackerSettings * pSettings = new TrackerSettings;
+		std::string error;
+		if ( !Load( m_path.c_str(), *pSettings, error ) )
+		{
+			OutputDebugStringA( "Settings not reloaded, " );
+			OutputDebugStringA( error.c_str() );
+			OutputDebugStringA( "\r\n" );
+			delete pSettings;
+			continue;
+		}
+
+		// the window owns it from here, unless it is gone
+		if ( !PostMessageW( m_hWnd, m_message, 0, reinterpret_cast<LPARAM>(pSettings) ) )
+		{
+			delete pSettings;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------
+// <copyright file="ConfigWatcher.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the watcher that reloads kinectInfo.cfg when it is written. The file is read and
+// checked on the watcher's own thread; a valid file is posted to the window as a new
+// TrackerSettings, which the UI thread compares with the applied one. A file that does not
+// pass is reported and left alone, the running settings stay.
+
+#pragma once
+
+#include <string>
+#include "TrackerSettings.h"
+
+// Quiet time (ms) after the last change before the file is read, editors write in steps
+#define CONFIG_WATCH_SETTLE             250
+
+class ConfigWatcher
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	ConfigWatcher();
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~ConfigWatcher();
+
+	/// <summary>
+	/// Watch a file in the current directory, on a thread of its own
+	/// </summary>
+	/// <param name="path">file name</param>
+	/// <param name="hWnd">window the settings are posted to</param>
+	/// <param name="message">message posted, lParam is a TrackerSettings * the window deletes</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Start( const char * path, HWND hWnd, UINT message );
+
+	/// <summary>
+	/// Stop watching
+	/// </summary>
+	void                    Stop( );
+
+	/// <summary>
+	/// Read and check a settings file. Any thread
+	/// </summary>
+	/// <param name="path">file name</param>
+	/// <param name="settings">receives the settings if the file is valid</param>
+	/// <param name="error">receives why it is not</param>
+	/// <returns>true if the file was valid and read, false otherwise</returns>
+	static bool             Load( const char * path, TrackerSettings & settings, std::string & error );
+
+private:
+	// not copyable, owns a thread
+	ConfigWatcher( const ConfigWatcher & );
+	ConfigWatcher & operator=( const ConfigWatcher & );
+
+	/// <summary>
+	/// Thread watching the file, calls class instance thread processor
+	/// </summary>
+	/// <param name="pParam">instance pointer</param>
+	/// <returns>always 0</returns>
+	static DWORD WINAPI     WatchThread( LPVOID pParam );
+
+	/// <summary>
+	/// Thread watching the file
+	/// </summary>
+	/// <returns>always 0</returns>
+	DWORD WINAPI            WatchThread( );
+
+	/// <summary>
+	/// Last time the file was written
+	/// </summary>
+	/// <returns>write time, 0 if there is no such file</returns>
+	ULONGLONG               GetWriteTime( ) const;
+
+	std::string             m_path;
+	HWND                    m_hWnd;
+	UINT                    m_message;
+	HANDLE                  m_hChange;          // FindFirstChangeNotification of the directory
+	HANDLE                  m_hThWatch;
+	HANDLE                  m_hEvWatchStop;
+};
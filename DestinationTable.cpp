@@ -0,0 +1,653 @@
+//------------------------------------------------------------------------------
+// <copyright file="DestinationTable.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the destination table. Writers edit a master copy under a lock and
+// publish it through a triple buffer, the frame path only ever reads the newest copy.
+
+#include "stdafx.h"
+#include "DestinationTable.h"
+
+#pragma comment(lib, "Ws2_32.lib")
+
+/// <summary>
+/// Whether two addresses are the same host and port
+/// </summary>
+/// <param name="a">first address</param>
+/// <param name="b">second address</param>
+/// <returns>true if they match</returns>
+static bool SameAddress( const sockaddr * a, const sockaddr * b )
+{
+	if ( a->sa_family != b->sa_family )
+	{
+		return false;
+	}
+
+	if ( AF_INET == a->sa_family )
+	{
+		const sockaddr_in * a4 = reinterpret_cast<const sockaddr_in *>(a);
+		const sockaddr_in * b4 = reinterpret_cast<const sockaddr_in *>(b);
+		return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+	}
+
+	if ( AF_INET6 == a->sa_family )
+	{
+		const sockaddr_in6 * a6 = reinterpret_cast<const sockaddr_in6 *>(a);
+		const sockaddr_in6 * b6 = reinterpret_cast<const sockaddr_in6 *>(b);
+		return a6->sin6_port == b6->sin6_port && 0 == memcmp( &a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr) );
+	}
+
+	return false;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+DestinationTable::DestinationTable() :
+	m_sendSocket4(INVALID_SOCKET),
+	m_sendSocket6(INVALID_SOCKET)
+{
+	InitializeCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+DestinationTable::~DestinationTable()
+{
+	if ( INVALID_SOCKET != m_sendSocket4 )
+	{
+		closesocket( m_sendSocket4 );
+	}
+	if ( INVALID_SOCKET != m_sendSocket6 )
+	{
+		closesocket( m_sendSocket6 );
+	}
+
+	DeleteCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Resolve the configured destinations once and replace the previous ones. They receive
+/// the eyes stream, like the TargetIP fields always did
+/// </summary>
+/// <param name="ipAddress">host of each destination, blank entries are skipped</param>
+/// <param name="port">UDP port of each destination</param>
+/// <param name="count">number of entries</param>
+/// <returns>number of destinations that resolved</returns>
+int DestinationTable::SetConfigured( const std::string ipAddress[], const std::string port[], int count )
+{
+	// resolve before taking the lock, a name lookup can take a while
+	DestinationList configured;
+	for ( int i = 0; i < count; i++ )
+	{
+		if ( ipAddress[i].empty() || port[i].empty() )
+		{
+			continue;
+		}
+
+		addrinfo hints;
+		addrinfo * pResult = NULL;
+		ZeroMemory( &hints, sizeof(hints) );
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_DGRAM;
+
+		if ( 0 != getaddrinfo( ipAddress[i].c_str(), port[i].c_str(), &hints, &pResult ) )
+		{
+			continue;
+		}
+
+		Destination destination;
+		destination.kind = DESTINATION_CONFIGURED;
+		ZeroMemory( &destination.address, sizeof(destination.address) );
+		memcpy( &destination.address, pResult->ai_addr, pResult->ai_addrlen );
+		destination.addressLength = static_cast<int>(pResult->ai_addrlen);
+		destination.streamMask = SUBSCRIBER_STREAM_BIT(SUBSCRIBER_STREAM_EYES);
+		destination.minInterval = 0;
+		destination.sequenced = false;
+		destination.compact = false;
+		destination.control = INVALID_SOCKET;
+		configured.push_back( destination );
+
+		freeaddrinfo( pResult );
+	}
+
+	EnterCriticalSection( &m_lock );
+
+	// configured destinations that stay keep their counters
+	for ( size_t i = 0; i < configured.size(); i++ )
+	{
+		for ( size_t j = 0; j < m_destinations.size(); j++ )
+		{
+			if ( DESTINATION_CONFIGURED == m_destinations[j].kind &&
+				 SameAddress( (const sockaddr *)&configured[i].address, (const sockaddr *)&m_destinations[j].address ) )
+			{
+				configured[i].counters = m_destinations[j].counters;
+				break;
+			}
+		}
+
+		if ( !configured[i].counters )
+		{
+			configured[i].counters = std::make_shared<DestinationCounters>();
+		}
+	}
+
+	bool retired = RemoveKind( DESTINATION_CONFIGURED );
+	m_destinations.insert( m_destinations.begin(), configured.begin(), configured.end() );
+
+	Publish( retired );
+	LeaveCriticalSection( &m_lock );
+
+	return static_cast<int>(configured.size());
+}
+
+/// <summary>
+/// Replace the multicast group, which receives every stream with sequence numbers
+/// </summary>
+/// <param name="group">IPv4 or IPv6 multicast address, blank to stop multicasting</param>
+/// <param name="port">UDP port receivers bind</param>
+/// <param name="ttl">hops the datagrams may travel, 1 keeps them on the local network</param>
+/// <param name="networkInterface">IPv4 address or IPv6 interface index to send from, blank for the default</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT DestinationTable::SetMulticast( const std::string & group, const std::string & port, int ttl, const std::string & networkInterface )
+{
+	if ( group.empty() )
+	{
+		EnterCriticalSection( &m_lock );
+		if ( RemoveKind( DESTINATION_MULTICAST ) )
+		{
+			Publish( true );
+		}
+		LeaveCriticalSection( &m_lock );
+		return S_OK;
+	}
+
+	addrinfo hints;
+	addrinfo * pResult = NULL;
+	ZeroMemory( &hints, sizeof(hints) );
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = AI_NUMERICHOST;
+
+	if ( 0 != getaddrinfo( group.c_str(), port.c_str(), &hints, &pResult ) )
+	{
+		return E_INVALIDARG;
+	}
+
+	Destination destination;
+	destination.kind = DESTINATION_MULTICAST;
+	ZeroMemory( &destination.address, sizeof(destination.address) );
+	memcpy( &destination.address, pResult->ai_addr, pResult->ai_addrlen );
+	destination.addressLength = static_cast<int>(pResult->ai_addrlen);
+	destination.streamMask = SUBSCRIBER_STREAM_ALL;
+	destination.minInterval = 0;
+	destination.sequenced = true;
+	destination.compact = false;
+	destination.control = INVALID_SOCKET;
+	freeaddrinfo( pResult );
+
+	int family = destination.address.ss_family;
+	bool isMulticast = ( AF_INET == family ) ?
+		IN_MULTICAST( ntohl( reinterpret_cast<const sockaddr_in *>(&destination.address)->sin_addr.s_addr ) ) :
+		IN6_IS_ADDR_MULTICAST( &reinterpret_cast<const sockaddr_in6 *>(&destination.address)->sin6_addr );
+	if ( !isMulticast )
+	{
+		return E_INVALIDARG;
+	}
+
+	SOCKET s = socket( family, SOCK_DGRAM, IPPROTO_UDP );
+	if ( INVALID_SOCKET == s )
+	{
+		return HRESULT_FROM_WIN32( WSAGetLastError() );
+	}
+	destination.socket = std::make_shared<DestinationSocket>( s );
+
+	u_long nonblocking = 1;
+	ioctlsocket( s, FIONBIO, &nonblocking );
+
+	// loop the datagrams back, so receivers on this machine get them as well
+	DWORD loop = 1;
+	DWORD hops = static_cast<DWORD>(ttl);
+	int result;
+
+	if ( AF_INET == family )
+	{
+		result = setsockopt( s, IPPROTO_IP, IP_MULTICAST_TTL, (const char *)&hops, sizeof(hops) );
+		if ( SOCKET_ERROR != result )
+		{
+			result = setsockopt( s, IPPROTO_IP, IP_MULTICAST_LOOP, (const char *)&loop, sizeof(loop) );
+		}
+
+		if ( SOCKET_ERROR != result && !networkInterface.empty() )
+		{
+			hints.ai_family = AF_INET;
+			if ( 0 != getaddrinfo( networkInterface.c_str(), NULL, &hints, &pResult ) )
+			{
+				return E_INVALIDARG;
+			}
+
+			in_addr interfaceAddress = reinterpret_cast<const sockaddr_in *>(pResult->ai_addr)->sin_addr;
+			freeaddrinfo( pResult );
+			result = setsockopt( s, IPPROTO_IP, IP_MULTICAST_IF, (const char *)&interfaceAddress, sizeof(interfaceAddress) );
+		}
+	}
+	else
+	{
+		result = setsockopt( s, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, (const char *)&hops, sizeof(hops) );
+		if ( SOCKET_ERROR != result )
+		{
+			result = setsockopt( s, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, (const char *)&loop, sizeof(loop) );
+		}
+
+		if ( SOCKET_ERROR != result && !networkInterface.empty() )
+		{
+			DWORD interfaceIndex = static_cast<DWORD>( atoi( networkInterface.c_str() ) );
+			result = setsockopt( s, IPPROTO_IPV6, IPV6_MULTICAST_IF, (const char *)&interfaceIndex, sizeof(interfaceIndex) );
+		}
+	}
+
+	if ( SOCKET_ERROR == result )
+	{
+		return HRESULT_FROM_WIN32( WSAGetLastError() );
+	}
+
+	EnterCriticalSection( &m_lock );
+
+	// the same group keeps its counters and sequence numbers, receivers see no gap
+	for ( size_t i = 0; i < m_destinations.size(); i++ )
+	{
+		if ( DESTINATION_MULTICAST == m_destinations[i].kind &&
+			 SameAddress( (const sockaddr *)&destination.address, (const sockaddr *)&m_destinations[i].address ) )
+		{
+			destination.counters = m_destinations[i].counters;
+		}
+	}
+	if ( !destination.counters )
+	{
+		destination.counters = std::make_shared<DestinationCounters>();
+	}
+
+	// the previous socket closes once the frame path no longer sends through it
+	bool retired = RemoveKind( DESTINATION_MULTICAST );
+	m_destinations.push_back( destination );
+
+	Publish( retired );
+	LeaveCriticalSection( &m_lock );
+
+	return S_OK;
+}
+
+/// <summary>
+/// Add streams to a subscribed destination, creating it if needed
+/// </summary>
+/// <param name="control">connection that subscribes</param>
+/// <param name="pAddress">where to send</param>
+/// <param name="addressLength">size of the address</param>
+/// <param name="streamMask">SUBSCRIBER_STREAM_BIT of the streams to add</param>
+/// <param name="maxRate">most packets per second, 0 for every frame</param>
+/// <param name="compact">send the streams with the compact encoding of PoseCodec.h</param>
+void DestinationTable::Subscribe( SOCKET control, const sockaddr * pAddress, int addressLength, unsigned int streamMask, unsigned int maxRate, bool compact )
+{
+	if ( addressLength <= 0 || addressLength > static_cast<int>(sizeof(sockaddr_storage)) )
+	{
+		return;
+	}
+
+	EnterCriticalSection( &m_lock );
+
+	int index = FindSubscribed( pAddress );
+	if ( index < 0 )
+	{
+		Destination destination;
+		destination.kind = DESTINATION_SUBSCRIBED;
+		ZeroMemory( &destination.address, sizeof(destination.address) );
+		memcpy( &destination.address, pAddress, addressLength );
+		destination.addressLength = addressLength;
+		destination.streamMask = 0;
+		destination.control = control;
+		destination.counters = std::make_shared<DestinationCounters>();
+		m_destinations.push_back( destination );
+		index = static_cast<int>(m_destinations.size()) - 1;
+	}
+
+	m_destinations[index].streamMask |= streamMask & SUBSCRIBER_STREAM_ALL;
+	m_destinations[index].minInterval = ( maxRate > 0 ) ? 1000 / maxRate : 0;
+
+	// a compact delta is only decodable with the sequence number of its keyframe
+	m_destinations[index].compact = compact;
+	m_destinations[index].sequenced = compact;
+
+	Publish( false );
+	LeaveCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Remove streams from a destination the same connection subscribed, the destination goes
+/// when it has none left. Another client cannot unsubscribe it by naming its address
+/// </summary>
+/// <param name="control">connection that unsubscribes</param>
+/// <param name="pAddress">where the streams go</param>
+/// <param name="streamMask">SUBSCRIBER_STREAM_BIT of the streams to remove</param>
+void DestinationTable::Unsubscribe( SOCKET control, const sockaddr * pAddress, unsigned int streamMask )
+{
+	EnterCriticalSection( &m_lock );
+
+	int index = FindSubscribed( pAddress );
+	if ( index >= 0 && control == m_destinations[index].control )
+	{
+		m_destinations[index].streamMask &= ~streamMask;
+		bool retired = ( 0 == m_destinations[index].streamMask );
+		if ( retired )
+		{
+			m_destinations.erase( m_destinations.begin() + index );
+		}
+
+		Publish( retired );
+	}
+
+	LeaveCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Remove every destination a connection subscribed
+/// </summary>
+/// <param name="control">connection that closed</param>
+void DestinationTable::DropConnection( SOCKET control )
+{
+	EnterCriticalSection( &m_lock );
+
+	size_t count = m_destinations.size();
+	for ( size_t i = count; i-- > 0; )
+	{
+		if ( DESTINATION_SUBSCRIBED == m_destinations[i].kind && control == m_destinations[i].control )
+		{
+			m_destinations.erase( m_destinations.begin() + i );
+		}
+	}
+
+	if ( count != m_destinations.size() )
+	{
+		Publish( true );
+	}
+
+	LeaveCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Remove every subscribed destination, keeping the configured and multicast ones
+/// </summary>
+void DestinationTable::DropAllConnections( )
+{
+	EnterCriticalSection( &m_lock );
+
+	if ( RemoveKind( DESTINATION_SUBSCRIBED ) )
+	{
+		Publish( true );
+	}
+
+	LeaveCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Copy the destinations and their counters
+/// </summary>
+/// <param name="status">receives one entry per destination</param>
+void DestinationTable::GetStatus( std::vector<DestinationStatus> & status )
+{
+	status.clear();
+
+	EnterCriticalSection( &m_lock );
+
+	for ( size_t i = 0; i < m_destinations.size(); i++ )
+	{
+		const Destination & destination = m_destinations[i];
+		DestinationStatus entry;
+
+		char host[NI_MAXHOST] = { 0 };
+		char service[NI_MAXSERV] = { 0 };
+		getnameinfo( (const sockaddr *)&destination.address, destination.addressLength, host, sizeof(host), service, sizeof(service), NI_NUMERICHOST | NI_NUMERICSERV );
+
+		entry.address = std::string( host ) + ":" + service;
+		entry.kind = destination.kind;
+		entry.streamMask = destination.streamMask;
+		entry.minInterval = destination.minInterval;
+		entry.packets = destination.counters->packets.load( std::memory_order_relaxed );
+		entry.bytes = destination.counters->bytes.load( std::memory_order_relaxed );
+		entry.throttled = destination.counters->throttled.load( std::memory_order_relaxed );
+		entry.errors = destination.counters->errors.load( std::memory_order_relaxed );
+		status.push_back( entry );
+	}
+
+	LeaveCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Streams some destination receives, so the frame path only encodes those. Frame
+/// path only, never blocks, allocates or takes a lock
+/// </summary>
+/// <returns>SUBSCRIBER_STREAM_BIT of every stream at least one destination receives</returns>
+unsigned int DestinationTable::GetStreamMask( )
+{
+	m_published.Update();
+
+	const DestinationList * pList = m_published.Front();
+	if ( NULL == pList )
+	{
+		return 0;
+	}
+
+	unsigned int streamMask = 0;
+	for ( DestinationList::const_iterator it = pList->begin(); it != pList->end(); ++it )
+	{
+		streamMask |= it->streamMask;
+	}
+	return streamMask;
+}
+
+/// <summary>
+/// Send the streams of this frame to every destination. Frame path only, never blocks,
+/// allocates or takes a lock
+/// </summary>
+/// <param name="packets">payload of every stream, indexed by SUBSCRIBER_STREAM_*</param>
+/// <param name="captureTime">host microseconds the sensor captured the frame, 0 if unknown</param>
+/// <param name="sendTime">host microseconds now, on the same clock</param>
+void DestinationTable::Send( const StreamPacket packets[SUBSCRIBER_STREAM_COUNT], long long captureTime, long long sendTime )
+{
+	// pick up the table the writers published last, without waiting for them
+	m_published.Update();
+
+	const DestinationList * pList = m_published.Front();
+	if ( NULL == pList || pList->empty() )
+	{
+		return;
+	}
+
+	unsigned long long now = GetTickCount64();
+
+	// the same for every sequenced datagram of this frame
+	unsigned int wireSendTime = static_cast<unsigned int>( sendTime );
+	unsigned int captureToSend = POSE_PACKET_NO_CAPTURE;
+	if ( 0 != captureTime && sendTime >= captureTime && sendTime - captureTime < POSE_PACKET_NO_CAPTURE )
+	{
+		captureToSend = static_cast<unsigned int>( sendTime - captureTime );
+	}
+
+	// sequenced datagrams are assembled here, behind their header
+	unsigned char datagram[DESTINATION_MAX_DATAGRAM];
+
+	for ( DestinationList::const_iterator it = pList->begin(); it != pList->end(); ++it )
+	{
+		DestinationCounters & counters = *it->counters;
+
+		if ( 0 != it->minInterval && now - counters.lastSendTime < it->minInterval )
+		{
+			counters.throttled.fetch_add( 1, std::memory_order_relaxed );
+			continue;
+		}
+
+		SOCKET s = it->socket ? it->socket->Get() : GetSendSocket( it->address.ss_family );
+		if ( INVALID_SOCKET == s )
+		{
+			counters.errors.fetch_add( 1, std::memory_order_relaxed );
+			continue;
+		}
+
+		bool sent = false;
+		for ( int stream = 0; stream < SUBSCRIBER_STREAM_COUNT; stream++ )
+		{
+			if ( 0 == ( it->streamMask & SUBSCRIBER_STREAM_BIT(stream) ) || 0 == packets[stream].size )
+			{
+				continue;
+			}
+
+			const char * pData = static_cast<const char *>(packets[stream].pData);
+			int size = packets[stream].size;
+
+			// sequence numbers advance even if the send fails, so receivers see the loss
+			if ( it->compact && PoseStreamIsCompactable( stream ) )
+			{
+				int count = size / static_cast<int>(sizeof(float));
+				if ( count > POSE_CODEC_MAX_VALUES )
+				{
+					counters.errors.fetch_add( 1, std::memory_order_relaxed );
+					continue;
+				}
+
+				unsigned int encoding;
+				unsigned int keyframeDistance;
+				size = counters.encoders[stream].Encode( static_cast<const float *>(packets[stream].pData), count,
+														 datagram + POSE_PACKET_HEADER_SIZE, encoding, keyframeDistance );
+
+				PosePacketWriteHeader( datagram, counters.sequence[stream]++, stream, encoding, keyframeDistance );
+				PosePacketWriteTiming( datagram, wireSendTime, captureToSend );
+				pData = reinterpret_cast<const char *>(datagram);
+				size += POSE_PACKET_HEADER_SIZE;
+			}
+			else if ( it->sequenced )
+			{
+				if ( size > DESTINATION_MAX_DATAGRAM - POSE_PACKET_HEADER_SIZE )
+				{
+					counters.errors.fetch_add( 1, std::memory_order_relaxed );
+					continue;
+				}
+
+				PosePacketWriteHeader( datagram, counters.sequence[stream]++, stream );
+				PosePacketWriteTiming( datagram, wireSendTime, captureToSend );
+				memcpy( datagram + POSE_PACKET_HEADER_SIZE, pData, size );
+				pData = reinterpret_cast<const char *>(datagram);
+				size += POSE_PACKET_HEADER_SIZE;
+			}
+
+			if ( SOCKET_ERROR == sendto( s, pData, size, 0, (const sockaddr *)&it->address, it->addressLength ) )
+			{
+				counters.errors.fetch_add( 1, std::memory_order_relaxed );
+			}
+			else
+			{
+				counters.packets.fetch_add( 1, std::memory_order_relaxed );
+				counters.bytes.fetch_add( size, std::memory_order_relaxed );
+				sent = true;
+			}
+		}
+
+		if ( sent )
+		{
+			counters.lastSendTime = now;
+		}
+	}
+}
+
+/// <summary>
+/// Index of the subscribed destination with this address
+/// </summary>
+/// <param name="pAddress">address to look for</param>
+/// <returns>index into m_destinations, -1 if there is none</returns>
+int DestinationTable::FindSubscribed( const sockaddr * pAddress ) const
+{
+	for ( size_t i = 0; i < m_destinations.size(); i++ )
+	{
+		if ( DESTINATION_SUBSCRIBED == m_destinations[i].kind && SameAddress( pAddress, (const sockaddr *)&m_destinations[i].address ) )
+		{
+			return static_cast<int>(i);
+		}
+	}
+
+	return -1;
+}
+
+/// <summary>
+/// Remove every destination of a kind, m_lock must be held
+/// </summary>
+/// <param name="kind">kind to remove</param>
+/// <returns>true if the table changed</returns>
+bool DestinationTable::RemoveKind( DestinationKind kind )
+{
+	size_t count = m_destinations.size();
+
+	for ( size_t i = count; i-- > 0; )
+	{
+		if ( kind == m_destinations[i].kind )
+		{
+			m_destinations.erase( m_destinations.begin() + i );
+		}
+	}
+
+	return count != m_destinations.size();
+}
+
+/// <summary>
+/// Hand the current table to the frame path, m_lock must be held. When destinations were
+/// removed, waits up to DESTINATION_RETIRE_WAIT for the frame path to pick the table up,
+/// then closes their sockets and frees their counters. A frame path that is not running
+/// keeps them until the next Publish
+/// </summary>
+/// <param name="retired">true if destinations were removed since the last Publish</param>
+void DestinationTable::Publish( bool retired )
+{
+	// the buffer is a table the frame path let go of, assigning reuses its storage
+	*m_published.BeginWrite() = m_destinations;
+	m_published.EndWrite();
+
+	// the buffer handed back is an older table, clearing keeps its storage but drops its entries
+	m_published.BeginWrite()->clear();
+
+	// the table the frame path reads comes back once it picks up this one, about a frame
+	DestinationList * pReleased = m_published.Reclaim();
+	ULONGLONG deadline = GetTickCount64() + ( retired ? DESTINATION_RETIRE_WAIT : 0 );
+	while ( NULL == pReleased && GetTickCount64() < deadline )
+	{
+		Sleep( 1 );
+		pReleased = m_published.Reclaim();
+	}
+
+	if ( NULL != pReleased )
+	{
+		pReleased->clear();
+	}
+}
+
+/// <summary>
+/// Socket for an address family, created on first use. Frame path only
+/// </summary>
+/// <param name="family">AF_INET or AF_INET6</param>
+/// <returns>non-blocking UDP socket, INVALID_SOCKET if it could not be created</returns>
+SOCKET DestinationTable::GetSendSocket( int family )
+{
+	SOCKET & s = ( AF_INET6 == family ) ? m_sendSocket6 : m_sendSocket4;
+
+	if ( INVALID_SOCKET == s )
+	{
+		s = socket( family, SOCK_DGRAM, IPPROTO_UDP );
+		if ( INVALID_SOCKET != s )
+		{
+			// a full send buffer drops the packet instead of stalling the frame
+			u_long nonblocking = 1;
+			ioctlsocket( s, FIONBIO, &nonblocking );
+		}
+	}
+
+	return s;
+}
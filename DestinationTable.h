@@ -0,0 +1,244 @@
+//------------------------------------------------------------------------------
+// <copyright file="DestinationTable.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the table of resolved UDP destinations the frame path sends to, unicast or
+// multicast, with the streams, rate limit and counters of each destination
+
+#pragma once
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "TripleBuffer.h"
+#include "PosePacket.h"
+#include "PoseCodec.h"
+
+// Largest datagram, header included, that stays within one Ethernet frame
+#define DESTINATION_MAX_DATAGRAM        1400
+
+// Longest wait (ms) for the frame path to let go of removed destinations, a few frames
+#define DESTINATION_RETIRE_WAIT         100
+
+enum DestinationKind
+{
+	DESTINATION_CONFIGURED = 0,     // TargetIP fields
+	DESTINATION_SUBSCRIBED,         // added through the subscriber server
+	DESTINATION_MULTICAST           // group from kinectInfo.cfg
+};
+
+/// <summary>
+/// Counters of one destination, shared by every published copy of the table
+/// </summary>
+struct DestinationCounters
+{
+	DestinationCounters() : packets(0), bytes(0), throttled(0), errors(0), lastSendTime(0)
+	{
+		for ( int i = 0; i < SUBSCRIBER_STREAM_COUNT; i++ )
+		{
+			sequence[i] = 0;
+		}
+	}
+
+	std::atomic<unsigned long long> packets;        // datagrams handed to the network
+	std::atomic<unsigned long long> bytes;
+	std::atomic<unsigned long long> throttled;      // frames the rate limit skipped
+	std::atomic<unsigned long long> errors;         // failed sends, e.g. a full send buffer
+
+	unsigned long long              lastSendTime;   // ms, frame path only
+	unsigned int                    sequence[SUBSCRIBER_STREAM_COUNT];  // next sequence number, frame path only
+	PoseEncoder                     encoders[SUBSCRIBER_STREAM_COUNT];  // compact destinations, frame path only
+};
+
+/// <summary>
+/// Socket with options of its own, e.g. the multicast TTL. Closed when the frame path
+/// lets go of the last table that sends through it
+/// </summary>
+class DestinationSocket
+{
+public:
+	explicit DestinationSocket( SOCKET s ) : m_socket(s) {}
+	~DestinationSocket() { closesocket( m_socket ); }
+
+	SOCKET                  Get( ) const { return m_socket; }
+
+private:
+	// not copyable, the socket has exactly one owner
+	DestinationSocket( const DestinationSocket & );
+	DestinationSocket & operator=( const DestinationSocket & );
+
+	SOCKET                  m_socket;
+};
+
+struct Destination
+{
+	DestinationKind         kind;
+	sockaddr_storage        address;
+	int                     addressLength;
+	unsigned int            streamMask;     // SUBSCRIBER_STREAM_BIT of every stream it receives
+	unsigned int            minInterval;    // ms between two packets, 0 for every frame
+	bool                    sequenced;      // datagrams start with the PosePacket.h header
+	bool                    compact;        // values are PoseCodec.h keyframes and deltas, needs sequenced
+	SOCKET                  control;        // connection that subscribed it, INVALID_SOCKET otherwise
+	std::shared_ptr<DestinationSocket>   socket;    // NULL to send through the shared unicast sockets
+	std::shared_ptr<DestinationCounters> counters;
+};
+
+/// <summary>
+/// Copy of a destination and its counters, for display
+/// </summary>
+struct DestinationStatus
+{
+	std::string             address;        // "host:port"
+	DestinationKind         kind;
+	unsigned int            streamMask;
+	unsigned int            minInterval;
+	unsigned long long      packets;
+	unsigned long long      bytes;
+	unsigned long long      throttled;
+	unsigned long long      errors;
+};
+
+/// <summary>
+/// Payload of one stream for the current frame
+/// </summary>
+struct StreamPacket
+{
+	const void *            pData;
+	int                     size;           // 0 if the stream has nothing this frame
+};
+
+typedef std::vector<Destination> DestinationList;
+
+class DestinationTable
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	DestinationTable();
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~DestinationTable();
+
+	/// <summary>
+	/// Resolve the configured destinations once and replace the previous ones. They receive
+	/// the eyes stream, like the TargetIP fields always did
+	/// </summary>
+	/// <param name="ipAddress">host of each destination, blank entries are skipped</param>
+	/// <param name="port">UDP port of each destination</param>
+	/// <param name="count">number of entries</param>
+	/// <returns>number of destinations that resolved</returns>
+	int                     SetConfigured( const std::string ipAddress[], const std::string port[], int count );
+
+	/// <summary>
+	/// Replace the multicast group, which receives every stream with sequence numbers
+	/// </summary>
+	/// <param name="group">IPv4 or IPv6 multicast address, blank to stop multicasting</param>
+	/// <param name="port">UDP port receivers bind</param>
+	/// <param name="ttl">hops the datagrams may travel, 1 keeps them on the local network</param>
+	/// <param name="networkInterface">IPv4 address or IPv6 interface index to send from, blank for the default</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 SetMulticast( const std::string & group, const std::string & port, int ttl, const std::string & networkInterface );
+
+	/// <summary>
+	/// Add streams to a subscribed destination, creating it if needed
+	/// </summary>
+	/// <param name="control">connection that subscribes</param>
+	/// <param name="pAddress">where to send</param>
+	/// <param name="addressLength">size of the address</param>
+	/// <param name="streamMask">SUBSCRIBER_STREAM_BIT of the streams to add</param>
+	/// <param name="maxRate">most packets per second, 0 for every frame</param>
+	/// <param name="compact">send the streams with the compact encoding of PoseCodec.h</param>
+	void                    Subscribe( SOCKET control, const sockaddr * pAddress, int addressLength, unsigned int streamMask, unsigned int maxRate, bool compact );
+
+	/// <summary>
+	/// Remove streams from a destination the same connection subscribed, the destination goes
+	/// when it has none left. Another client cannot unsubscribe it by naming its address
+	/// </summary>
+	/// <param name="control">connection that unsubscribes</param>
+	/// <param name="pAddress">where the streams go</param>
+	/// <param name="streamMask">SUBSCRIBER_STREAM_BIT of the streams to remove</param>
+	void                    Unsubscribe( SOCKET control, const sockaddr * pAddress, unsigned int streamMask );
+
+	/// <summary>
+	/// Remove every destination a connection subscribed
+	/// </summary>
+	/// <param name="control">connection that closed</param>
+	void                    DropConnection( SOCKET control );
+
+	/// <summary>
+	/// Remove every subscribed destination, keeping the configured and multicast ones
+	/// </summary>
+	void                    DropAllConnections( );
+
+	/// <summary>
+	/// Copy the destinations and their counters
+	/// </summary>
+	/// <param name="status">receives one entry per destination</param>
+	void                    GetStatus( std::vector<DestinationStatus> & status );
+
+	/// <summary>
+	/// Streams some destination receives, so the frame path only encodes those. Frame
+	/// path only, never blocks, allocates or takes a lock
+	/// </summary>
+	/// <returns>SUBSCRIBER_STREAM_BIT of every stream at least one destination receives</returns>
+	unsigned int            GetStreamMask( );
+
+	/// <summary>
+	/// Send the streams of this frame to every destination. Frame path only, never blocks,
+	/// allocates or takes a lock
+	/// </summary>
+	/// <param name="packets">payload of every stream, indexed by SUBSCRIBER_STREAM_*</param>
+	/// <param name="captureTime">host microseconds the sensor captured the frame, 0 if unknown</param>
+	/// <param name="sendTime">host microseconds now, on the same clock</param>
+	void                    Send( const StreamPacket packets[SUBSCRIBER_STREAM_COUNT], long long captureTime, long long sendTime );
+
+private:
+	/// <summary>
+	/// Index of the subscribed destination with this address
+	/// </summary>
+	/// <param name="pAddress">address to look for</param>
+	/// <returns>index into m_destinations, -1 if there is none</returns>
+	int                     FindSubscribed( const sockaddr * pAddress ) const;
+
+	/// <summary>
+	/// Remove every destination of a kind, m_lock must be held
+	/// </summary>
+	/// <param name="kind">kind to remove</param>
+	/// <returns>true if the table changed</returns>
+	bool                    RemoveKind( DestinationKind kind );
+
+	/// <summary>
+	/// Hand the current table to the frame path, m_lock must be held. When destinations were
+	/// removed, waits up to DESTINATION_RETIRE_WAIT for the frame path to pick the table up,
+	/// then closes their sockets and frees their counters. A frame path that is not running
+	/// keeps them until the next Publish
+	/// </summary>
+	/// <param name="retired">true if destinations were removed since the last Publish</param>
+	void                    Publish( bool retired );
+
+	/// <summary>
+	/// Socket for an address family, created on first use. Frame path only
+	/// </summary>
+	/// <param name="family">AF_INET or AF_INET6</param>
+	/// <returns>non-blocking UDP socket, INVALID_SOCKET if it could not be created</returns>
+	SOCKET                  GetSendSocket( int family );
+
+	// Serializes the writers: the UI thread for the configured and multicast destinations,
+	// the subscriber server for the others. The frame path never takes it
+	CRITICAL_SECTION        m_lock;
+	DestinationList         m_destinations;
+	TripleBuffer<DestinationList> m_published;
+
+	// Owned by the frame path, IPv4 and IPv6
+	SOCKET                  m_sendSocket4;
+	SOCKET                  m_sendSocket6;
+};
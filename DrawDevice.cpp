@@ -14,6 +14,7 @@
 #include <sstream>
 #include <MMSystem.h>
 #include "trackerApp.h"
+#include "PoseStreamEncoders.h"
 #include <string>
 
 using namespace std;
@@ -22,126 +23,13 @@ using namespace std;
 
 extern TrackerApp  g_trackerApp;
 
-const int g_ScreenWidth = 640;
-const int g_ScreenHeight = 480;
-const float BONE_THICKNESS = 3.0;
-const float JOINT_THICKNESS = 2.5;
-
 DWORD lastSkelFoundTime;
 
-float packetData[18];
-
-//---------------------------------------------------------------------------------------
-
-int SendDataUDP(std::string ipAddress, std::string port)
-
-{		int sockfd;
-struct addrinfo hints, *servinfo, *p;
-int rv;
-int numbytes;
-char *ip_addr = NULL;
-memset(&hints, 0, sizeof hints);
-hints.ai_family = AF_INET;
-hints.ai_socktype = SOCK_DGRAM;
-
-
-if ((rv = getaddrinfo(ipAddress.c_str(), port.c_str(), &hints, &servinfo)) != 0) 
-{	fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
-return 1;
-}
-// loop through all the results and make a socket
-for(p = servinfo; p != NULL; p = p->ai_next) 
-{
-	if ((sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol)) == -1) 
-	{
-		perror("talker: socket");
-		continue;
-	}
-	break;
-}
-if (p == NULL) 
-{	fprintf(stderr, "talker: failed to bind socket\n");
-return 2;
-}
-if ((numbytes = sendto(sockfd, reinterpret_cast<const char *>(packetData), sizeof(float)*6, 0, p->ai_addr, p->ai_addrlen)) == -1)
-{	perror("talker: sendto");
-exit(1);
-}
-
-freeaddrinfo(servinfo);
-printf("talker: sent %d bytes to %s\n", numbytes, ip_addr);
-closesocket(sockfd);
-
-return 0;
-}
-
-bool Listen() {
-	for (int i = 0; i < MAX_IPS; i++)
-	{
-		g_trackerApp.m_ipAddress[i] = "";
-		g_trackerApp.m_port[i] = "";
-	}
-
-	WSADATA wsa;
-	SOCKET s, new_socket = 0;
-	struct sockaddr_in server, client;
-	int c;
-
-	printf("\nInitialising Winsock...");
-	if (WSAStartup(MAKEWORD(2,2),&wsa) != 0)
-	{
-		printf("Failed. Error Code : %d",WSAGetLastError());
-		return 1;
-	}
-
-	printf("Initialised.\n");
+// Values of every stream, the last ones encoded are sent again until the active user is back
+static float g_StreamValues[SUBSCRIBER_STREAM_COUNT][SUBSCRIBER_STREAM_MAX_VALUES];
 
-	//Create a socket
-	if((s = socket(AF_INET , SOCK_STREAM , 0 )) == INVALID_SOCKET)
-	{
-		printf("Could not create socket : %d" , WSAGetLastError());
-	}
-	u_long nonblocking = 1;
-	ioctlsocket(s, FIONBIO, &nonblocking);
-	printf("Socket created.\n");
-
-	//Prepare the sockaddr_in structure
-	server.sin_family = AF_INET;
-	server.sin_addr.s_addr = INADDR_ANY;
-	server.sin_port = htons( (g_trackerApp.m_servPort) );
-
-	//Bind
-	if( bind(s ,(struct sockaddr *)&server , sizeof(server)) == SOCKET_ERROR)
-	{
-		printf("Bind failed with error code : %d" , WSAGetLastError());
-	}
-
-	puts("Bind done");
-
-	listen(s, MAX_IPS);
-
-	//Accept and incoming connection
-	puts("Waiting for incoming connections...");
-	int i = 0, prev_socket = new_socket;
-	while (i < MAX_IPS) {
-		stringstream ipBuffer, portBuffer;
-		c = sizeof(struct sockaddr_in);
-		if (g_trackerApp.m_listening == false) break;
-		new_socket = accept(s , (struct sockaddr *)&client, &c);
-		if ((prev_socket != new_socket) && (new_socket != INVALID_SOCKET)) {
-			ipBuffer << (int)client.sin_addr.S_un.S_un_b.s_b1 << "." << (int)client.sin_addr.S_un.S_un_b.s_b2 << "." << (int)client.sin_addr.S_un.S_un_b.s_b3 << "." << (int)client.sin_addr.S_un.S_un_b.s_b4;
-			portBuffer << (int)client.sin_port;
-			g_trackerApp.m_ipAddress[i] = ipBuffer.str();
-			g_trackerApp.m_port[i] = portBuffer.str();
-			prev_socket = new_socket;
-			i++;
-		}
-
-	}
-
-	closesocket(s);
-	closesocket(new_socket);
-}
+static_assert( NUI_SKELETON_COUNT <= EYE_MAX_USERS, "every skeleton has a lane of the eye estimator" );
+static_assert( NUI_SKELETON_COUNT <= BONE_LANES, "every skeleton has a lane of the bone orientations" );
 
 /// <summary>
 /// Constructor
@@ -256,35 +144,14 @@ bool DrawDevice::Initialize( HWND hWnd, ID2D1Factory * pD2DFactory, int sourceWi
 
 D2D1_POINT_2F SkeletonToScreen( Vector4 skeletonPoint, int width, int height )
 {
-	LONG x, y;
-	USHORT depth;
-
-	// calculate the skeleton's position on the screen
-	// NuiTransformSkeletonToDepthImage returns coordinates in NUI_IMAGE_RESOLUTION_320x240 space
-	NuiTransformSkeletonToDepthImage( skeletonPoint, &x, &y, &depth );
-
-	float screenPointX = static_cast<float>(x * width) / g_ScreenWidth;
-	float screenPointY = static_cast<float>(y * height) / g_ScreenHeight;
-
-	return D2D1::Point2F(screenPointX, screenPointY);
-}
-
-void DrawDevice::DrawBone( const NUI_SKELETON_DATA & skel, NUI_SKELETON_POSITION_INDEX bone0, NUI_SKELETON_POSITION_INDEX bone1 )
-{
-	NUI_SKELETON_POSITION_TRACKING_STATE bone0State = skel.eSkeletonPositionTrackingState[bone0];
-	NUI_SKELETON_POSITION_TRACKING_STATE bone1State = skel.eSkeletonPositionTrackingState[bone1];
-
-	if (bone0State == NUI_SKELETON_POSITION_TRACKED || bone1State == NUI_SKELETON_POSITION_TRACKED)
-		m_pRenderTarget->DrawLine( m_Points[bone0], m_Points[bone1], m_pBrush, BONE_THICKNESS );
-
+	return g_trackerApp.m_projector.Project( skeletonPoint, width, height );
 }
 
 
-bool DrawDevice::ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, NUI_SKELETON_FRAME SkeletonFrame, 
-	INuiSensor *m_pNuiSensor, int width, int height, std::string ipAddress[MAX_IPS], std::string port[MAX_IPS])
+bool DrawDevice::ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, const SkeletonBatch & batch, 
+	long long captureTime, const SensorCalibration & calibration, const EyeModel & eyeModel, INuiSensor *m_pNuiSensor, int width, int height)
 {
-	if (g_trackerApp.m_listening == true)
-		Listen();
+	long long renderStart = PipelineMetrics::Now();
 
 	// incorrectly sized image packetData passed in
 	if ( cbImage < ((m_sourceHeight - 1) * m_sourceStride) + (m_sourceWidth * 4) )
@@ -315,12 +182,13 @@ bool DrawDevice::ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, NUI
 	USHORT nearestDepths[2] = { NUI_IMAGE_DEPTH_MAXIMUM, NUI_IMAGE_DEPTH_MAXIMUM };
 
 	// Determine which users to track by seeing who is closest
+	long long start = PipelineMetrics::Now();
 	for ( int i = 0 ; i < NUI_SKELETON_COUNT; i++ )
 	{
-		NUI_SKELETON_TRACKING_STATE trackingState = SkeletonFrame.SkeletonData[i].eTrackingState;
+		NUI_SKELETON_TRACKING_STATE trackingState = batch.trackingState[i];
 
 		// calculate the skeleton's position on the screen
-		NuiTransformSkeletonToDepthImage( SkeletonFrame.SkeletonData[i].Position, &x, &y, &depth );
+		NuiTransformSkeletonToDepthImage( batch.position[i], &x, &y, &depth );
 
 		if ( trackingState == NUI_SKELETON_TRACKED || trackingState == NUI_SKELETON_POSITION_ONLY ) {
 
@@ -331,13 +199,13 @@ bool DrawDevice::ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, NUI
 				g_trackerApp.m_secondaryUser = g_trackerApp.m_activeUser;
 
 				nearestDepths[0] = depth;
-				nearestIDs[0] = SkeletonFrame.SkeletonData[i].dwTrackingID;
+				nearestIDs[0] = batch.trackingId[i];
 				g_trackerApp.m_activeUser = i;
 			}
 			else if ( depth < nearestDepths[1] )
 			{
 				nearestDepths[1] = depth;
-				nearestIDs[1] = SkeletonFrame.SkeletonData[i].dwTrackingID;
+				nearestIDs[1] = batch.trackingId[i];
 				g_trackerApp.m_secondaryUser = i;
 			}
 		}
@@ -345,146 +213,132 @@ bool DrawDevice::ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, NUI
 
 	// apply
 	m_pNuiSensor->NuiSkeletonSetTrackedSkeletons(nearestIDs);
+	g_trackerApp.m_metrics.Record( STAGE_SELECT, start );
+
+	// Get joints of all skeletons in screen space
+	g_trackerApp.m_projector.ProjectBatch( batch, width, height, m_Points );
+
+	// persons other sensors see as well, fused in the display frame
+	const FusedSkeletonFrame * pFusedFrame = g_trackerApp.m_fusion.AcquireLatest();
+	unsigned int streamMask = g_trackerApp.m_destinations.GetStreamMask();
+
+	// joints of every tracked skeleton in the display frame, in inches, and the eyes and bones of all of them at once
+	start = PipelineMetrics::Now();
+	int activeUser = g_trackerApp.m_activeUser;
+	float jointX[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	float jointY[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	float jointZ[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	EyeJoints eyeJoints;
+	BoneJoints boneJoints;
+	ZeroMemory( &eyeJoints, sizeof(eyeJoints) );
+	ZeroMemory( &boneJoints, sizeof(boneJoints) );
 
 	for ( int i = 0 ; i < NUI_SKELETON_COUNT; i++ )
 	{
-		NUI_SKELETON_TRACKING_STATE trackingState = SkeletonFrame.SkeletonData[i].eTrackingState;
-		// Draw tracked skeletons
-		if ( trackingState == NUI_SKELETON_TRACKED )
+		if ( batch.trackingState[i] != NUI_SKELETON_TRACKED )
+			continue;
+
+		// fused if other sensors see the person too, a single sensor's own frame is newer than what went through the fusion
+		const FusedSkeleton * pFused = pFusedFrame ? pFusedFrame->Find( 0, batch.trackingId[i] ) : NULL;
+		if ( pFused && ( pFused->sensorMask & ~1u ) )
 		{
-			// Get joints in screen space
-			for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
-				m_Points[j] = SkeletonToScreen( SkeletonFrame.SkeletonData[i].SkeletonPositions[j], width, height);
-
-			// only send data of active user
-			if (g_trackerApp.m_activeUser == i) {
-				// convert the relevant coordinates to target coordinate system, in inches
-				float angleRad = -(g_trackerApp.m_KinectAngle)*.01745;
-				float head_x = SkeletonFrame.SkeletonData[i].SkeletonPositions[3].x*39.37 + g_trackerApp.m_kinectPosition[0];
-				float head_y = (SkeletonFrame.SkeletonData[i].SkeletonPositions[3].y*cos(angleRad) 
-					- SkeletonFrame.SkeletonData[i].SkeletonPositions[3].z*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[1];
-				float head_z = (SkeletonFrame.SkeletonData[i].SkeletonPositions[3].z*cos(angleRad)
-					+ SkeletonFrame.SkeletonData[i].SkeletonPositions[3].y*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[2];
-				float should_x = SkeletonFrame.SkeletonData[i].SkeletonPositions[2].x*39.37 + g_trackerApp.m_kinectPosition[0];
-				float should_y = (SkeletonFrame.SkeletonData[i].SkeletonPositions[2].y*cos(angleRad) 
-					- SkeletonFrame.SkeletonData[i].SkeletonPositions[2].z*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[1];
-				float should_z = (SkeletonFrame.SkeletonData[i].SkeletonPositions[2].z*cos(angleRad)
-					+ SkeletonFrame.SkeletonData[i].SkeletonPositions[2].y*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[2];
-				float right_elbow_x = SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_ELBOW_RIGHT].x*39.37 + g_trackerApp.m_kinectPosition[0];
-				float right_elbow_y = (SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_ELBOW_RIGHT].y*cos(angleRad) 
-					- SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_ELBOW_RIGHT].z*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[1];
-				float right_elbow_z = (SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_ELBOW_RIGHT].z*cos(angleRad)
-					+ SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_ELBOW_RIGHT].y*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[2];
-				float right_hand_x = SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].x*39.37 + g_trackerApp.m_kinectPosition[0];
-				float right_hand_y = (SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].y*cos(angleRad) 
-					- SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].z*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[1];
-				float right_hand_z = (SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].z*cos(angleRad)
-					+ SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].y*sin(angleRad))*39.37 + g_trackerApp.m_kinectPosition[2];
-
-				float headTilt = abs(atan((should_x - head_x)/(should_y - head_y)));
-
-				// left eye
-				packetData[0] = head_x;
-				packetData[1] = head_y;
-				packetData[2] = head_z;
-
-				// right eye
-				packetData[3] = head_x;
-				packetData[4] = head_y;
-				packetData[5] = head_z;
-
-				// correct eye positions for head tilt
-				if (head_x < should_x) {
-					packetData[0] -= cos(headTilt)*1.25;
-					packetData[1] -= sin(headTilt)*1.25;
-					packetData[3] += cos(headTilt)*1.25;
-					packetData[4] += sin(headTilt)*1.25;
-				}
-				else {
-					packetData[3] += cos(headTilt)*1.25;
-					packetData[4] -= sin(headTilt)*1.25;
-					packetData[0] -= cos(headTilt)*1.25;
-					packetData[1] += sin(headTilt)*1.25;
-				}
-
-				// right elbow
-				packetData[6] = right_elbow_x;
-				packetData[7] = right_elbow_y;
-				packetData[8] = right_elbow_z;
-
-				// right hand
-				packetData[9] = right_hand_x;
-				packetData[10] = right_hand_y;
-				packetData[11] = right_hand_z;
-			}
+			memcpy( jointX[i], pFused->jointX, sizeof(jointX[i]) );
+			memcpy( jointY[i], pFused->jointY, sizeof(jointY[i]) );
+			memcpy( jointZ[i], pFused->jointZ, sizeof(jointZ[i]) );
+		}
+		else
+		{
+			calibration.TransformBatch( batch.GetX( i ), batch.GetY( i ), batch.GetZ( i ), jointX[i], jointY[i], jointZ[i], NUI_SKELETON_POSITION_COUNT );
+		}
 
-			// draw only torso if we are globally in seated mode
-			if (g_trackerApp.m_trackingMode == Seated)
-			{
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT );
-			}
-			// otherwise draw the whole thing
-			else {
-				// Render Torso
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SPINE );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_HIP_CENTER );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT );
-
-				// Left Arm
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT );
-
-				// Right Arm
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT );
-
-				// Left Leg
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT );
-
-				// Right Leg
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT );
-				DrawBone( SkeletonFrame.SkeletonData[i], NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT );
-			}
-			// Draw joints
-			for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+		eyeJoints.trackingId[i] = batch.trackingId[i];
+		const float * rows[3] = { jointX[i], jointY[i], jointZ[i] };
+		for ( int c = 0; c < 3; c++ )
+		{
+			eyeJoints.head[c][i] = rows[c][NUI_SKELETON_POSITION_HEAD];
+			eyeJoints.shoulderCenter[c][i] = rows[c][NUI_SKELETON_POSITION_SHOULDER_CENTER];
+			eyeJoints.shoulderLeft[c][i] = rows[c][NUI_SKELETON_POSITION_SHOULDER_LEFT];
+			eyeJoints.shoulderRight[c][i] = rows[c][NUI_SKELETON_POSITION_SHOULDER_RIGHT];
+		}
+
+		boneJoints.trackingId[i] = batch.trackingId[i];
+		boneJoints.trackedMask[i] = batch.trackedMask[i];
+		for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+		{
+			boneJoints.x[j][i] = jointX[i][j];
+			boneJoints.y[j][i] = jointY[i][j];
+			boneJoints.z[j][i] = jointZ[i][j];
+		}
+	}
+	m_Eyes.Estimate( eyeJoints, eyeModel );
+	m_Bones.Compute( boneJoints );
+
+	// only send data of active user, only the streams some destination receives
+	if ( activeUser >= 0 && activeUser < NUI_SKELETON_COUNT && batch.trackingState[activeUser] == NUI_SKELETON_TRACKED )
+	{
+		float eyes[SUBSCRIBER_STREAM_EYES_VALUES];
+		float bones[SUBSCRIBER_STREAM_BONES_VALUES];
+		m_Eyes.GetEyes( activeUser, eyes );
+		m_Bones.GetHierarchical( activeUser, bones );
+
+		PoseStreamInput input;
+		input.pX = jointX[activeUser];
+		input.pY = jointY[activeUser];
+		input.pZ = jointZ[activeUser];
+		input.pEyes = eyes;
+		input.pBones = bones;
+
+		for ( unsigned int stream = 0; stream < SUBSCRIBER_STREAM_COUNT; stream++ )
+		{
+			if ( streamMask & SUBSCRIBER_STREAM_BIT(stream) )
 			{
-				D2D1_ELLIPSE ellipse = D2D1::Ellipse( m_Points[j], JOINT_THICKNESS, JOINT_THICKNESS );
-				if (SkeletonFrame.SkeletonData[i].eSkeletonPositionTrackingState[j] == NUI_SKELETON_POSITION_INFERRED ||
-					SkeletonFrame.SkeletonData[i].eSkeletonPositionTrackingState[j] == NUI_SKELETON_POSITION_TRACKED )
-					m_pRenderTarget->FillEllipse(ellipse, m_pBrush);
+				PoseStreamGetEncoder( stream )( input, g_StreamValues[stream] );
 			}
 		}
+	}
+	g_trackerApp.m_metrics.Record( STAGE_ENCODE, start );
+
+	// every skeleton of the preview, collected into the preview's lists and drawn in one pass
+	start = PipelineMetrics::Now();
+	bool seated = ( Seated == g_trackerApp.m_trackingMode );
+	m_Preview.Clear();
+	for ( int i = 0 ; i < NUI_SKELETON_COUNT; i++ )
+	{
+		NUI_SKELETON_TRACKING_STATE trackingState = batch.trackingState[i];
+		if ( trackingState == NUI_SKELETON_TRACKED )
+		{
+			m_Preview.AddSkeleton( m_Points[i], batch.trackedMask[i], batch.inferredMask[i], seated );
+		}
 		else if ( trackingState == NUI_SKELETON_POSITION_ONLY )
 		{
-			// draw the center of mass of skeleton
-			D2D1_ELLIPSE ellipse = D2D1::Ellipse( SkeletonToScreen(SkeletonFrame.SkeletonData[i].Position, width, height), JOINT_THICKNESS, JOINT_THICKNESS);
-			m_pRenderTarget->FillEllipse(ellipse, m_pBrush);
+			// the center of mass of the skeleton
+			m_Preview.AddDot( SkeletonToScreen( batch.position[i], width, height ) );
 		}
+	}
+	m_Preview.Draw( m_pRenderTarget, m_pBrush );
+	g_trackerApp.m_metrics.Record( STAGE_OVERLAY, start );
 
+	// send to the configured and the subscribed destinations
+	StreamPacket packets[SUBSCRIBER_STREAM_COUNT];
+	for ( unsigned int stream = 0; stream < SUBSCRIBER_STREAM_COUNT; stream++ )
+	{
+		packets[stream].pData = g_StreamValues[stream];
+		packets[stream].size = sizeof(float) * PoseStreamValueCount( stream );
+	}
 
+	// the capture time is host microseconds, 0 until the sensor clock has a sample
+	start = PipelineMetrics::Now();
+	long long sentAt = g_trackerApp.m_metrics.ToMicroseconds( start );
+	if ( 0 != captureTime )
+	{
+		g_trackerApp.m_metrics.RecordLatency( LATENCY_CAPTURE_TO_SEND, sentAt - captureTime );
 	}
-	// send to each of 6 IPs
-	for (int i = 0; i < MAX_IPS; i++)
-		SendDataUDP(ipAddress[i], port[i]);
+	g_trackerApp.m_destinations.Send(packets, captureTime, sentAt);
+	long long sendTime = g_trackerApp.m_metrics.Record( STAGE_SEND, start ) - start;
 
+	start = PipelineMetrics::Now();
 	hr = m_pRenderTarget->EndDraw();
+	g_trackerApp.m_metrics.Record( STAGE_PRESENT, start );
 
 	// Device lost, need to recreate the render target
 	// We'll dispose it now and retry drawing
@@ -495,6 +349,8 @@ bool DrawDevice::ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, NUI
 		DiscardDirect2DResources();
 	}
 
+	g_trackerApp.m_metrics.Record( STAGE_RENDER, renderStart, sendTime );
+
 	return SUCCEEDED( hr );
 }
 
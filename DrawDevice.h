@@ -12,6 +12,11 @@
 #include "NuiApi.h"
 #include <string>
 #include "TrackerClient.h"
+#include "SensorCalibration.h"
+#include "SkeletonBatch.h"
+#include "EyeEstimator.h"
+#include "BoneOrientations.h"
+#include "SkeletonPreview.h"
 
 class DrawDevice
 {
@@ -46,10 +51,7 @@ public:
 	/// <returns>true if successful, false otherwise</returns>
 	bool Draw( BYTE * pImage, unsigned long cbImage );
 
-	bool ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, NUI_SKELETON_FRAME SkeletonFrame, INuiSensor *m_pNuiSensor, int width, int height,
-		std::string ipAddress[MAX_IPS], std::string port[MAX_IPS]);
-
-	void DrawBone( const NUI_SKELETON_DATA & skel, NUI_SKELETON_POSITION_INDEX bone0, NUI_SKELETON_POSITION_INDEX bone1 );
+	bool ProcessSkeletonFrame( BYTE * pImage, unsigned long cbImage, const SkeletonBatch & batch, long long captureTime, const SensorCalibration & calibration, const EyeModel & eyeModel, INuiSensor *m_pNuiSensor, int width, int height );
 
 	HRESULT EnsureDirect2DResources();
 
@@ -69,8 +71,12 @@ private:
 
 	ID2D1SolidColorBrush * m_pBrush;
 
-	D2D1_POINT_2F m_Points[NUI_SKELETON_POSITION_COUNT];
-	NUI_SKELETON_BONE_ORIENTATION m_boneOrientations[20];
+	D2D1_POINT_2F m_Points[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	// Eyes and bones of every tracked skeleton, one lane per skeleton index
+	EyeEstimator m_Eyes;
+	BoneOrientations m_Bones;
+	// Bones and joints of the preview, rebuilt every frame
+	SkeletonPreview m_Preview;
 
 	/// <summary>
 	/// Ensure necessary Direct2d resources are created
@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+// <copyright file="EyeEstimator.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "EyeEstimator.h"
+#include "QuaternionBatch.h"
+#include <math.h>
+#include <string.h>
+
+/// <summary>
+/// Constructor, nobody seen yet
+/// </summary>
+EyeEstimator::EyeEstimator()
+{
+	Reset();
+}
+
+/// <summary>
+/// Forget every orientation, the next estimate of each user is not filtered
+/// </summary>
+void EyeEstimator::Reset( )
+{
+	memset( m_trackingId, 0, sizeof(m_trackingId) );
+	memset( m_eyes, 0, sizeof(m_eyes) );
+
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		m_orientation[0][i] = 0.0f;
+		m_orientation[1][i] = 0.0f;
+		m_orientation[2][i] = 0.0f;
+		m_orientation[3][i] = 1.0f;
+	}
+}
+
+/// <summary>
+/// Estimate the eyes of every lane. A lane whose tracking id changed starts over
+/// from its new orientation
+/// </summary>
+/// <param name="joints">joints of every lane</param>
+/// <param name="model">eye placement and filtering</param>
+void EyeEstimator::Estimate( const EyeJoints & joints, const EyeModel & model )
+{
+	float qx[EYE_MAX_USERS], qy[EYE_MAX_USERS], qz[EYE_MAX_USERS], qw[EYE_MAX_USERS];
+
+	// head frame of each lane, as a quaternion
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		// up, from the shoulder center to the head
+		float ux = joints.head[0][i] - joints.shoulderCenter[0][i];
+		float uy = joints.head[1][i] - joints.shoulderCenter[1][i];
+		float uz = joints.head[2][i] - joints.shoulderCenter[2][i];
+		float upLength = sqrtf( ux * ux + uy * uy + uz * uz );
+		bool upValid = upLength > EYE_MIN_LENGTH;
+		float upScale = upValid ? 1.0f / ( upValid ? upLength : 1.0f ) : 0.0f;
+		ux = ux * upScale;
+		uy = upValid ? uy * upScale : 1.0f;
+		uz = uz * upScale;
+
+		// right, across the shoulders without what runs along up, the display's x axis if they give none
+		float rx = joints.shoulderRight[0][i] - joints.shoulderLeft[0][i];
+		float ry = joints.shoulderRight[1][i] - joints.shoulderLeft[1][i];
+		float rz = joints.shoulderRight[2][i] - joints.shoulderLeft[2][i];
+		float along = rx * ux + ry * uy + rz * uz;
+		rx -= along * ux;
+		ry -= along * uy;
+		rz -= along * uz;
+		bool acrossValid = rx * rx + ry * ry + rz * rz > EYE_MIN_LENGTH * EYE_MIN_LENGTH;
+		rx = acrossValid ? rx : 1.0f - ux * ux;
+		ry = acrossValid ? ry : -ux * uy;
+		rz = acrossValid ? rz : -ux * uz;
+		float rightLength = sqrtf( rx * rx + ry * ry + rz * rz );
+		float rightScale = ( rightLength > 0.0f ) ? 1.0f / ( ( rightLength > 0.0f ) ? rightLength : 1.0f ) : 0.0f;
+		rx *= rightScale;
+		ry *= rightScale;
+		rz *= rightScale;
+
+		// back, so right, up and back are a right handed frame
+		float bx = ry * uz - rz * uy;
+		float by = rz * ux - rx * uz;
+		float bz = rx * uy - ry * ux;
+
+		// the rotation whose columns are right, up and back; the sign of each of x, y and z
+		// comes from the skew part, so no case of the trace needs a branch
+		float w = 1.0f + rx + uy + bz;
+		float x = 1.0f + rx - uy - bz;
+		float y = 1.0f - rx + uy - bz;
+		float z = 1.0f - rx - uy + bz;
+		w = 0.5f * sqrtf( ( w > 0.0f ) ? w : 0.0f );
+		x = 0.5f * sqrtf( ( x > 0.0f ) ? x : 0.0f );
+		y = 0.5f * sqrtf( ( y > 0.0f ) ? y : 0.0f );
+		z = 0.5f * sqrtf( ( z > 0.0f ) ? z : 0.0f );
+		qx[i] = ( uz - by < 0.0f ) ? -x : x;
+		qy[i] = ( bx - rz < 0.0f ) ? -y : y;
+		qz[i] = ( ry - ux < 0.0f ) ? -z : z;
+		qw[i] = w;
+	}
+
+	// slerp from the previous orientation, all the way for a lane someone else is in now
+	float weight = 1.0f - model.smoothing;
+	float t[EYE_MAX_USERS];
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		t[i] = ( joints.trackingId[i] != m_trackingId[i] ) ? 1.0f : weight;
+	}
+
+	// four lanes at a time, the polynomial slerp takes the short way round without acosf or sinf
+	for ( int i = 0; i < EYE_MAX_USERS; i += 4 )
+	{
+		quaternion4 previous = Quaternion4Load( &m_orientation[0][i], &m_orientation[1][i], &m_orientation[2][i], &m_orientation[3][i] );
+		quaternion4 current = Quaternion4Load( qx + i, qy + i, qz + i, qw + i );
+		quaternion4 filtered = Quaternion4Normalize( Quaternion4SlerpFast( previous, current, _mm_loadu_ps( t + i ) ) );
+		Quaternion4Store( filtered, &m_orientation[0][i], &m_orientation[1][i], &m_orientation[2][i], &m_orientation[3][i] );
+	}
+
+	// eyes placed in the filtered frame
+	float halfIpd = 0.5f * model.ipd;
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		float x = m_orientation[0][i], y = m_orientation[1][i], z = m_orientation[2][i], w = m_orientation[3][i];
+
+		float rx = 1.0f - 2.0f * ( y * y + z * z );
+		float ry = 2.0f * ( x * y + w * z );
+		float rz = 2.0f * ( x * z - w * y );
+		float ux = 2.0f * ( x * y - w * z );
+		float uy = 1.0f - 2.0f * ( x * x + z * z );
+		float uz = 2.0f * ( y * z + w * x );
+		float bx = 2.0f * ( x * z + w * y );
+		float by = 2.0f * ( y * z - w * x );
+		float bz = 1.0f - 2.0f * ( x * x + y * y );
+
+		// the point between the eyes
+		float cx = joints.head[0][i] + model.height * ux - model.forward * bx;
+		float cy = joints.head[1][i] + model.height * uy - model.forward * by;
+		float cz = joints.head[2][i] + model.height * uz - model.forward * bz;
+
+		m_eyes[0][i] = cx - halfIpd * rx;
+		m_eyes[1][i] = cy - halfIpd * ry;
+		m_eyes[2][i] = cz - halfIpd * rz;
+		m_eyes[3][i] = cx + halfIpd * rx;
+		m_eyes[4][i] = cy + halfIpd * ry;
+		m_eyes[5][i] = cz + halfIpd * rz;
+	}
+
+	memcpy( m_trackingId, joints.trackingId, sizeof(m_trackingId) );
+}
+
+/// <summary>
+/// Eyes of a lane from the last estimate
+/// </summary>
+/// <param name="user">lane</param>
+/// <param name="pOut">receives x, y and z of the left eye, then of the right eye (inches)</param>
+void EyeEstimator::GetEyes( int user, float * pOut ) const
+{
+	for ( int i = 0; i < 6; i++ )
+	{
+		pOut[i] = m_eyes[i][user];
+	}
+}
+
+/// <summary>
+/// Filtered head orientation of a lane from the last estimate, a unit quaternion that
+/// turns the display axes into right, up and back of the head
+/// </summary>
+/// <param name="user">lane</param>
+/// <param name="pOut">receives x, y, z and w</param>
+void EyeEstimator::GetOrientation( int user, float * pOut ) const
+{
+	for ( int i = 0; i < 4; i++ )
+	{
+		pOut[i] = m_orientation[i][user];
+	}
+}
@@ -0,0 +1,108 @@
+//------------------------------------------------------------------------------
+// <copyright file="EyeEstimator.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the estimate of where each user's eyes are, for head-coupled perspective. A head
+// frame is built from the head, the shoulder center and both shoulders: up runs from the
+// shoulder center to the head, right runs across the shoulders, so the eyes follow both the
+// roll of the head and the yaw of the body. Its orientation is filtered with a slerp toward
+// every new frame, and the eyes are placed in it as an EyeModel says. Like the merge stage
+// it only depends on the standard library, and on QuaternionBatch.h for the slerp.
+//
+// Every user is a lane of the arrays. Building the frames and placing the eyes take no
+// branches, only selects, which leaves the compiler free to vectorize them across users;
+// the slerp runs four users at a time with Quaternion4SlerpFast. Joints on top of each other
+// give no direction; the frame then falls back to upright and facing the display instead of
+// dividing by zero.
+
+#pragma once
+
+// Lanes, the 6 skeletons of a frame rounded up to whole SSE registers, a multiple of 4
+#define EYE_MAX_USERS                   8
+
+// Defaults of EyeModel, inches. The eyes used to be placed 1.25 inch either side of the head joint
+#define EYE_DEFAULT_IPD                 2.5f
+#define EYE_DEFAULT_HEIGHT              0.0f
+#define EYE_DEFAULT_FORWARD             0.0f
+#define EYE_DEFAULT_SMOOTHING           0.3f
+
+// Bones shorter than this give no direction, inches
+#define EYE_MIN_LENGTH                  0.01f
+
+/// <summary>
+/// Where the eyes are in the head frame, and how much the orientation is filtered
+/// </summary>
+struct EyeModel
+{
+	float   ipd;                // interpupillary distance, inches
+	float   height;             // inches above the head joint, along the neck
+	float   forward;            // inches in front of the head joint, the way the user faces
+	float   smoothing;          // weight of the previous orientation from 0 (none) up to, not including, 1
+
+	/// <summary>
+	/// Constructor, the defaults
+	/// </summary>
+	EyeModel() :
+		ipd(EYE_DEFAULT_IPD),
+		height(EYE_DEFAULT_HEIGHT),
+		forward(EYE_DEFAULT_FORWARD),
+		smoothing(EYE_DEFAULT_SMOOTHING)
+	{
+	}
+};
+
+/// <summary>
+/// Joints the head frame is built from, in the display frame (inches), one lane per user
+/// </summary>
+struct EyeJoints
+{
+	unsigned int    trackingId[EYE_MAX_USERS];      // 0 for a lane nobody is in
+	float           head[3][EYE_MAX_USERS];         // x, y and z rows
+	float           shoulderCenter[3][EYE_MAX_USERS];
+	float           shoulderLeft[3][EYE_MAX_USERS];
+	float           shoulderRight[3][EYE_MAX_USERS];
+};
+
+class EyeEstimator
+{
+public:
+	/// <summary>
+	/// Constructor, nobody seen yet
+	/// </summary>
+	EyeEstimator();
+
+	/// <summary>
+	/// Forget every orientation, the next estimate of each user is not filtered
+	/// </summary>
+	void Reset( );
+
+	/// <summary>
+	/// Estimate the eyes of every lane. A lane whose tracking id changed starts over
+	/// from its new orientation
+	/// </summary>
+	/// <param name="joints">joints of every lane</param>
+	/// <param name="model">eye placement and filtering</param>
+	void Estimate( const EyeJoints & joints, const EyeModel & model );
+
+	/// <summary>
+	/// Eyes of a lane from the last estimate
+	/// </summary>
+	/// <param name="user">lane</param>
+	/// <param name="pOut">receives x, y and z of the left eye, then of the right eye (inches)</param>
+	void GetEyes( int user, float * pOut ) const;
+
+	/// <summary>
+	/// Filtered head orientation of a lane from the last estimate, a unit quaternion that
+	/// turns the display axes into right, up and back of the head
+	/// </summary>
+	/// <param name="user">lane</param>
+	/// <param name="pOut">receives x, y, z and w</param>
+	void GetOrientation( int user, float * pOut ) const;
+
+private:
+	unsigned int    m_trackingId[EYE_MAX_USERS];    // whose orientation each lane holds
+	float           m_orientation[4][EYE_MAX_USERS];
+	float           m_eyes[6][EYE_MAX_USERS];       // left x, y, z, then right x, y, z
+};
@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+// <copyright file="FrameAccounting.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "FrameAccounting.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+FrameAccounting::FrameAccounting()
+{
+	for ( int i = 0; i < FRAME_STREAM_COUNT; i++ )
+	{
+		StreamCounters & counters = m_streams[i];
+		counters.received = 0;
+		counters.skipped = 0;
+		counters.duplicates = 0;
+		for ( int j = 0; j < FRAME_DROP_STAGE_COUNT; j++ )
+		{
+			counters.dropped[j] = 0;
+		}
+		counters.started = false;
+		counters.lastFrameNumber = 0;
+	}
+}
+
+/// <summary>
+/// Count a frame read from the sensor. Only the thread reading the stream
+/// </summary>
+/// <param name="stream">stream it is from</param>
+/// <param name="frameNumber">dwFrameNumber of the frame</param>
+/// <param name="skipped">receives the frames missing before this one</param>
+/// <returns>how the number follows the previous one</returns>
+FrameCheck FrameAccounting::OnFrame( FrameStream stream, unsigned int frameNumber, unsigned int & skipped )
+{
+	StreamCounters & counters = m_streams[stream];
+	counters.received.fetch_add( 1, std::memory_order_relaxed );
+	skipped = 0;
+
+	FrameCheck check;
+	unsigned int gap = frameNumber - counters.lastFrameNumber;
+	if ( !counters.started )
+	{
+		check = FRAME_RESTARTED;
+	}
+	else if ( 0 == gap )
+	{
+		counters.duplicates.fetch_add( 1, std::memory_order_relaxed );
+		check = FRAME_DUPLICATE;
+	}
+	else if ( 1 == gap )
+	{
+		check = FRAME_NEXT;
+	}
+	else if ( gap <= FRAME_RESTART_GAP )
+	{
+		// the unsigned difference also covers the number wrapping around
+		skipped = gap - 1;
+		counters.skipped.fetch_add( skipped, std::memory_order_relaxed );
+		check = FRAME_SKIPPED;
+	}
+	else
+	{
+		// counting backwards, or a gap too long to be frames, e.g. a re-attached sensor
+		check = FRAME_RESTARTED;
+	}
+
+	counters.started = true;
+	counters.lastFrameNumber = frameNumber;
+	return check;
+}
+
+/// <summary>
+/// Copy the counters of a stream. Any thread
+/// </summary>
+/// <param name="stream">stream to copy</param>
+/// <param name="counts">receives the counters</param>
+void FrameAccounting::GetCounts( FrameStream stream, FrameCounts & counts ) const
+{
+	const StreamCounters & counters = m_streams[stream];
+	counts.received = counters.received.load( std::memory_order_relaxed );
+	counts.skipped = counters.skipped.load( std::memory_order_relaxed );
+	counts.duplicates = counters.duplicates.load( std::memory_order_relaxed );
+	for ( int i = 0; i < FRAME_DROP_STAGE_COUNT; i++ )
+	{
+		counts.dropped[i] = counters.dropped[i].load( std::memory_order_relaxed );
+	}
+}
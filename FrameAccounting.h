@@ -0,0 +1,113 @@
+//------------------------------------------------------------------------------
+// <copyright file="FrameAccounting.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the frame accounting of one sensor: per stream, the frames received, the frame
+// numbers the sensor skipped, frames read twice, and the frames the pipeline dropped, by the
+// stage that dropped them. Like the merge stage it only depends on the standard library.
+//
+// The sensor numbers its frames (dwFrameNumber) and the skeleton frame carries the number of
+// the depth frame it was found in, so a gap in the numbers a stream delivers is frames the
+// sensor never handed over, whatever the reason. Only the thread reading a stream calls
+// OnFrame; drops are counted by any thread, and any thread may read the counts.
+
+#pragma once
+
+#include <atomic>
+
+// Frame numbers that may be missing, a minute at 30 frames per second, before the gap is
+// taken as a sensor that restarted counting rather than as skipped frames
+#define FRAME_RESTART_GAP               1800
+
+enum FrameStream
+{
+	FRAME_STREAM_DEPTH = 0,
+	FRAME_STREAM_SKELETON,
+	FRAME_STREAM_COUNT
+};
+
+enum FrameDropStage
+{
+	FRAME_DROP_FETCH = 0,           // Nui*GetNextFrame failed
+	FRAME_DROP_DEPTH,               // the depth frame's buffer was unusable
+	FRAME_DROP_MERGE,               // a newer skeleton frame replaced it before the merge thread ran
+	FRAME_DROP_SEND,                // a newer skeleton frame replaced it before a preview frame sent it
+	FRAME_DROP_RENDER,              // the preview could not draw the depth frame, nothing was sent
+	FRAME_DROP_BUFFER,              // no preview buffer was free
+	FRAME_DROP_STAGE_COUNT
+};
+
+enum FrameCheck
+{
+	FRAME_NEXT = 0,                 // the number after the previous one
+	FRAME_SKIPPED,                  // frames are missing before this one
+	FRAME_DUPLICATE,                // the same frame as the previous one
+	FRAME_RESTARTED                 // first frame, or the sensor started counting again
+};
+
+/// <summary>
+/// Counters of one stream
+/// </summary>
+struct FrameCounts
+{
+	unsigned long long      received;
+	unsigned long long      skipped;
+	unsigned long long      duplicates;
+	unsigned long long      dropped[FRAME_DROP_STAGE_COUNT];
+};
+
+class FrameAccounting
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	FrameAccounting();
+
+	/// <summary>
+	/// Count a frame read from the sensor. Only the thread reading the stream
+	/// </summary>
+	/// <param name="stream">stream it is from</param>
+	/// <param name="frameNumber">dwFrameNumber of the frame</param>
+	/// <param name="skipped">receives the frames missing before this one</param>
+	/// <returns>how the number follows the previous one</returns>
+	FrameCheck              OnFrame( FrameStream stream, unsigned int frameNumber, unsigned int & skipped );
+
+	/// <summary>
+	/// Count frames the pipeline dropped. Any thread, never blocks
+	/// </summary>
+	/// <param name="stream">stream they are from</param>
+	/// <param name="stage">stage that dropped them</param>
+	/// <param name="count">number of frames</param>
+	void                    OnDropped( FrameStream stream, FrameDropStage stage, unsigned int count )
+	{
+		m_streams[stream].dropped[stage].fetch_add( count, std::memory_order_relaxed );
+	}
+
+	/// <summary>
+	/// Copy the counters of a stream. Any thread
+	/// </summary>
+	/// <param name="stream">stream to copy</param>
+	/// <param name="counts">receives the counters</param>
+	void                    GetCounts( FrameStream stream, FrameCounts & counts ) const;
+
+private:
+	// not copyable, the counters are atomic
+	FrameAccounting( const FrameAccounting & );
+	FrameAccounting & operator=( const FrameAccounting & );
+
+	struct StreamCounters
+	{
+		std::atomic<unsigned long long> received;
+		std::atomic<unsigned long long> skipped;
+		std::atomic<unsigned long long> duplicates;
+		std::atomic<unsigned long long> dropped[FRAME_DROP_STAGE_COUNT];
+
+		bool                started;            // reading thread only
+		unsigned int        lastFrameNumber;
+	};
+
+	StreamCounters          m_streams[FRAME_STREAM_COUNT];
+};
@@ -0,0 +1,205 @@
+//------------------------------------------------------------------------------
+// <copyright file="FramePool.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "FramePool.h"
+#include <assert.h>
+#include <new>
+
+// Index that ends the free list
+static const unsigned int g_EndOfList = 0xFFFFFFFF;
+
+/// <summary>
+/// Constructor
+/// </summary>
+FrameBuffer::FrameBuffer() :
+	width(0),
+	height(0),
+	stride(0),
+	frameNumber(0),
+	captureTime(0),
+	m_pPool(NULL),
+	m_pData(NULL),
+	m_index(0)
+{
+	m_references.store( 0 );
+}
+
+/// <summary>
+/// Size of the buffer, whatever the frame in it uses
+/// </summary>
+/// <returns>bytes</returns>
+unsigned int FrameBuffer::GetSize( ) const
+{
+	return m_pPool->GetBufferSize();
+}
+
+/// <summary>
+/// A stage is done with the frame, the last one returns it to the pool. Any thread
+/// </summary>
+void FrameBuffer::Release( )
+{
+	// the release orders this stage's use of the pixels before the next owner's
+	unsigned int previous = m_references.fetch_sub( 1, std::memory_order_acq_rel );
+	assert( previous > 0 );
+	if ( 1 == previous )
+	{
+		m_pPool->Return( this );
+	}
+}
+
+/// <summary>
+/// Constructor, the pool is empty until Initialize
+/// </summary>
+FramePool::FramePool() :
+	m_pMemory(NULL),
+	m_pBuffers(NULL),
+	m_pNext(NULL),
+	m_bufferSize(0),
+	m_count(0)
+{
+	m_head.store( g_EndOfList );
+	m_free.store( 0 );
+}
+
+/// <summary>
+/// Destructor, every handle must be gone
+/// </summary>
+FramePool::~FramePool()
+{
+	Discard();
+}
+
+/// <summary>
+/// Free the buffers
+/// </summary>
+void FramePool::Discard( )
+{
+	assert( m_free.load() == m_count );
+
+	delete [] m_pMemory;
+	delete [] m_pBuffers;
+	delete [] m_pNext;
+	m_pMemory = NULL;
+	m_pBuffers = NULL;
+	m_pNext = NULL;
+	m_bufferSize = 0;
+	m_count = 0;
+	m_head.store( g_EndOfList );
+	m_free.store( 0 );
+}
+
+/// <summary>
+/// Allocate the buffers, e.g. for the resolution of the stream that fills them. Only
+/// while no buffer is acquired
+/// </summary>
+/// <param name="bufferSize">bytes per buffer</param>
+/// <param name="count">number of buffers, frames that can be in flight at once</param>
+/// <returns>true if successful, false if out of memory</returns>
+bool FramePool::Initialize( unsigned int bufferSize, unsigned int count )
+{
+	if ( bufferSize == m_bufferSize && count == m_count )
+	{
+		return true;
+	}
+
+	Discard();
+	if ( 0 == bufferSize || 0 == count )
+	{
+		return true;
+	}
+
+	// whole cache lines per buffer, so no two buffers share one
+	size_t stride = ( static_cast<size_t>(bufferSize) + FRAME_POOL_ALIGNMENT - 1 ) & ~static_cast<size_t>( FRAME_POOL_ALIGNMENT - 1 );
+
+	m_pMemory = new (std::nothrow) unsigned char[stride * count + FRAME_POOL_ALIGNMENT - 1];
+	m_pBuffers = new (std::nothrow) FrameBuffer[count];
+	m_pNext = new (std::nothrow) std::atomic<unsigned int>[count];
+	if ( NULL == m_pMemory || NULL == m_pBuffers || NULL == m_pNext )
+	{
+		delete [] m_pMemory;
+		delete [] m_pBuffers;
+		delete [] m_pNext;
+		m_pMemory = NULL;
+		m_pBuffers = NULL;
+		m_pNext = NULL;
+		return false;
+	}
+
+	size_t misalignment = reinterpret_cast<size_t>(m_pMemory) & ( FRAME_POOL_ALIGNMENT - 1 );
+	unsigned char * pAligned = m_pMemory + ( ( 0 == misalignment ) ? 0 : FRAME_POOL_ALIGNMENT - misalignment );
+
+	// every buffer starts out free, linked in order
+	for ( unsigned int i = 0; i < count; i++ )
+	{
+		m_pBuffers[i].m_pPool = this;
+		m_pBuffers[i].m_pData = pAligned + stride * i;
+		m_pBuffers[i].m_index = i;
+		m_pNext[i].store( ( i + 1 < count ) ? i + 1 : g_EndOfList, std::memory_order_relaxed );
+	}
+
+	m_bufferSize = bufferSize;
+	m_count = count;
+	m_free.store( count );
+	m_head.store( 0, std::memory_order_release );
+	return true;
+}
+
+/// <summary>
+/// Take a free buffer, with one reference. Any thread, never blocks
+/// </summary>
+/// <returns>buffer, NULL if every buffer is in use</returns>
+FrameBuffer * FramePool::Acquire( )
+{
+	unsigned long long head = m_head.load( std::memory_order_acquire );
+	while ( true )
+	{
+		unsigned int index = static_cast<unsigned int>( head & 0xFFFFFFFF );
+		if ( g_EndOfList == index )
+		{
+			return NULL;
+		}
+
+		// the link may be stale if another thread took the buffer meanwhile, then the
+		// change count differs and the exchange fails
+		unsigned int next = m_pNext[index].load( std::memory_order_relaxed );
+		unsigned long long changed = ( ( head >> 32 ) + 1 ) << 32 | next;
+		if ( m_head.compare_exchange_weak( head, changed, std::memory_order_acquire, std::memory_order_acquire ) )
+		{
+			m_free.fetch_sub( 1, std::memory_order_relaxed );
+
+			FrameBuffer * pBuffer = &m_pBuffers[index];
+			pBuffer->m_references.store( 1, std::memory_order_relaxed );
+			pBuffer->width = 0;
+			pBuffer->height = 0;
+			pBuffer->stride = 0;
+			pBuffer->frameNumber = 0;
+			pBuffer->captureTime = 0;
+			return pBuffer;
+		}
+	}
+}
+
+/// <summary>
+/// Put a buffer nobody holds back on the free list
+/// </summary>
+/// <param name="pBuffer">buffer to return</param>
+void FramePool::Return( FrameBuffer * pBuffer )
+{
+	m_free.fetch_add( 1, std::memory_order_relaxed );
+
+	unsigned long long head = m_head.load( std::memory_order_relaxed );
+	while ( true )
+	{
+		m_pNext[pBuffer->m_index].store( static_cast<unsigned int>( head & 0xFFFFFFFF ), std::memory_order_relaxed );
+		unsigned long long changed = ( ( head >> 32 ) + 1 ) << 32 | pBuffer->m_index;
+		if ( m_head.compare_exchange_weak( head, changed, std::memory_order_release, std::memory_order_relaxed ) )
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+// <copyright file="FramePool.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares a fixed pool of cache line aligned frame buffers, shared between the stages of
+// the pipeline by reference count rather than copied. A stage that keeps a frame holds a
+// FrameHandle; the buffer goes back to the pool when the last handle lets go of it, on
+// whichever thread that is. Acquiring and releasing never lock or wait. Like the merge
+// stage it only depends on the standard library.
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Alignment of every buffer, one cache line, enough for any SIMD load
+#define FRAME_POOL_ALIGNMENT            64
+
+class FramePool;
+
+/// <summary>
+/// One buffer of the pool, with what the stages need to know about the frame in it
+/// </summary>
+class FrameBuffer
+{
+public:
+	/// <summary>
+	/// Pixels, FRAME_POOL_ALIGNMENT aligned
+	/// </summary>
+	/// <returns>start of the buffer</returns>
+	unsigned char *         GetData( ) const { return m_pData; }
+
+	/// <summary>
+	/// Size of the buffer, whatever the frame in it uses
+	/// </summary>
+	/// <returns>bytes</returns>
+	unsigned int            GetSize( ) const;
+
+	/// <summary>
+	/// Another stage keeps the frame. Any thread
+	/// </summary>
+	void                    AddRef( )
+	{
+		m_references.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	/// <summary>
+	/// A stage is done with the frame, the last one returns it to the pool. Any thread
+	/// </summary>
+	void                    Release( );
+
+	// Set by the stage that acquired the buffer, before it hands the frame on
+	unsigned int            width;
+	unsigned int            height;
+	unsigned int            stride;         // bytes per row
+	unsigned int            frameNumber;    // dwFrameNumber of the frame converted into it
+	long long               captureTime;    // host microseconds, 0 if unknown
+
+private:
+	friend class FramePool;
+
+	FrameBuffer();
+
+	// not copyable, owned by the pool
+	FrameBuffer( const FrameBuffer & );
+	FrameBuffer & operator=( const FrameBuffer & );
+
+	FramePool *             m_pPool;
+	unsigned char *         m_pData;
+	unsigned int            m_index;
+	std::atomic<unsigned int> m_references;
+};
+
+/// <summary>
+/// Reference to a pooled frame, copies share the frame and the last one releases it
+/// </summary>
+class FrameHandle
+{
+public:
+	FrameHandle() : m_pBuffer(NULL) {}
+
+	/// <summary>
+	/// Take over the reference Acquire returned
+	/// </summary>
+	/// <param name="pBuffer">buffer from FramePool::Acquire, may be NULL</param>
+	explicit FrameHandle( FrameBuffer * pBuffer ) : m_pBuffer(pBuffer) {}
+
+	FrameHandle( const FrameHandle & other ) : m_pBuffer(other.m_pBuffer)
+	{
+		if ( NULL != m_pBuffer )
+		{
+			m_pBuffer->AddRef();
+		}
+	}
+
+	FrameHandle & operator=( const FrameHandle & other )
+	{
+		// take the new reference before letting go of the old one, other may be this handle
+		FrameBuffer * pBuffer = other.m_pBuffer;
+		if ( NULL != pBuffer )
+		{
+			pBuffer->AddRef();
+		}
+		Reset();
+		m_pBuffer = pBuffer;
+		return *this;
+	}
+
+	~FrameHandle()
+	{
+		Reset();
+	}
+
+	/// <summary>
+	/// Let go of the frame
+	/// </summary>
+	void Reset( )
+	{
+		if ( NULL != m_pBuffer )
+		{
+			m_pBuffer->Release();
+			m_pBuffer = NULL;
+		}
+	}
+
+	FrameBuffer * Get() const { return m_pBuffer; }
+	FrameBuffer * operator->() const { return m_pBuffer; }
+	bool IsValid() const { return NULL != m_pBuffer; }
+
+private:
+	FrameBuffer *           m_pBuffer;
+};
+
+class FramePool
+{
+public:
+	/// <summary>
+	/// Constructor, the pool is empty until Initialize
+	/// </summary>
+	FramePool();
+
+	/// <summary>
+	/// Destructor, every handle must be gone
+	/// </summary>
+	~FramePool();
+
+	/// <summary>
+	/// Allocate the buffers, e.g. for the resolution of the stream that fills them. Only
+	/// while no buffer is acquired
+	/// </summary>
+	/// <param name="bufferSize">bytes per buffer</param>
+	/// <param name="count">number of buffers, frames that can be in flight at once</param>
+	/// <returns>true if successful, false if out of memory</returns>
+	bool                    Initialize( unsigned int bufferSize, unsigned int count );
+
+	/// <summary>
+	/// Take a free buffer, with one reference. Any thread, never blocks
+	/// </summary>
+	/// <returns>buffer, NULL if every buffer is in use</returns>
+	FrameBuffer *           Acquire( );
+
+	unsigned int            GetBufferSize( ) const { return m_bufferSize; }
+	unsigned int            GetCount( ) const { return m_count; }
+
+	/// <summary>
+	/// Buffers nobody holds, only a hint while other threads acquire and release
+	/// </summary>
+	/// <returns>number of free buffers</returns>
+	unsigned int            GetFreeCount( ) const
+	{
+		return m_free.load( std::memory_order_relaxed );
+	}
+
+private:
+	friend class FrameBuffer;
+
+	// not copyable, owns the buffers
+	FramePool( const FramePool & );
+	FramePool & operator=( const FramePool & );
+
+	/// <summary>
+	/// Put a buffer nobody holds back on the free list
+	/// </summary>
+	/// <param name="pBuffer">buffer to return</param>
+	void                    Return( FrameBuffer * pBuffer );
+
+	/// <summary>
+	/// Free the buffers
+	/// </summary>
+	void                    Discard( );
+
+	unsigned char *         m_pMemory;      // every buffer, unaligned allocation
+	FrameBuffer *           m_pBuffers;
+	std::atomic<unsigned int> * m_pNext;    // free list link of each buffer
+	unsigned int            m_bufferSize;
+	unsigned int            m_count;
+
+	// Free list head: index of the first free buffer in the low 32 bits, and a count of
+	// the changes in the high 32 bits so a buffer taken and returned in between is noticed
+	std::atomic<unsigned long long> m_head;
+	std::atomic<unsigned int> m_free;
+};
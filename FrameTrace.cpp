@@ -0,0 +1,321 @@
+//------------------------------------------------------------------------------
+// <copyright file="FrameTrace.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the frame tracer
+
+#include "stdafx.h"
+#include "FrameTrace.h"
+#include "AllocationGuard.h"
+#include <strsafe.h>
+#include <stdio.h>
+#include <vector>
+
+/// <summary>
+/// Constructor
+/// </summary>
+FrameTracer::FrameTracer() :
+	m_enabled(0),
+	m_thresholdTicks(0),
+	m_pNames(NULL),
+	m_threadCount(0),
+	m_hThDump(NULL),
+	m_hEvDumpStop(NULL),
+	m_hEvDump(NULL)
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency( &frequency );
+	m_microsecondsPerTick = 1.0e6 / static_cast<double>(frequency.QuadPart);
+
+	LARGE_INTEGER now;
+	QueryPerformanceCounter( &now );
+	m_origin = now.QuadPart;
+
+	m_tlsIndex = TlsAlloc();
+
+	for ( int i = 0; i < TRACE_MAX_THREADS; i++ )
+	{
+		m_threads[i].threadId = 0;
+		m_threads[i].name[0] = '\0';
+		m_threads[i].pEvents = NULL;
+		m_threads[i].written = 0;
+	}
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+FrameTracer::~FrameTracer()
+{
+	if ( NULL != m_hEvDumpStop )
+	{
+		// Signal the thread
+		SetEvent( m_hEvDumpStop );
+
+		// Wait for thread to stop
+		if ( NULL != m_hThDump )
+		{
+			WaitForSingleObject( m_hThDump, INFINITE );
+			CloseHandle( m_hThDump );
+			m_hThDump = NULL;
+		}
+		CloseHandle( m_hEvDumpStop );
+		m_hEvDumpStop = NULL;
+	}
+	if ( NULL != m_hEvDump )
+	{
+		CloseHandle( m_hEvDump );
+		m_hEvDump = NULL;
+	}
+
+	for ( int i = 0; i < TRACE_MAX_THREADS; i++ )
+	{
+		delete [] m_threads[i].pEvents;
+	}
+
+	if ( TLS_OUT_OF_INDEXES != m_tlsIndex )
+	{
+		TlsFree( m_tlsIndex );
+	}
+}
+
+/// <summary>
+/// Start or stop recording. Events recorded so far are kept
+/// </summary>
+/// <param name="enabled">record the stages</param>
+/// <param name="thresholdTicks">a stage taking longer dumps the trace to a file, 0 for never</param>
+/// <param name="pNames">name of every event name index, must outlive the tracer</param>
+void FrameTracer::Enable( bool enabled, long long thresholdTicks, const char * const * pNames )
+{
+	m_pNames = pNames;
+	m_thresholdTicks = thresholdTicks;
+
+	if ( enabled && thresholdTicks > 0 && NULL == m_hThDump )
+	{
+		m_hEvDumpStop = CreateEvent( NULL, FALSE, FALSE, NULL );
+		m_hEvDump = CreateEvent( NULL, FALSE, FALSE, NULL );
+		m_hThDump = CreateThread( NULL, 0, DumpThread, this, 0, NULL );
+	}
+
+	InterlockedExchange( &m_enabled, enabled ? 1 : 0 );
+}
+
+/// <summary>
+/// Slot of the calling thread, claimed the first time
+/// </summary>
+/// <returns>slot, NULL if TRACE_MAX_THREADS threads have one</returns>
+FrameTracer::TraceThread * FrameTracer::GetThread( )
+{
+	TraceThread * pThread = static_cast<TraceThread *>( TlsGetValue( m_tlsIndex ) );
+	if ( NULL != pThread )
+	{
+		return pThread;
+	}
+
+	LONG index = InterlockedIncrement( &m_threadCount ) - 1;
+	if ( index >= TRACE_MAX_THREADS )
+	{
+		return NULL;
+	}
+
+	pThread = &m_threads[index];
+	pThread->threadId = GetCurrentThreadId();
+	TlsSetValue( m_tlsIndex, pThread );
+	return pThread;
+}
+
+/// <summary>
+/// Name the calling thread in dumps
+/// </summary>
+/// <param name="name">name to show, truncated to TRACE_MAX_THREAD_NAME</param>
+void FrameTracer::NameThread( const char * name )
+{
+	TraceThread * pThread = GetThread();
+	if ( NULL != pThread )
+	{
+		StringCchCopyA( pThread->name, _countof(pThread->name), name );
+	}
+}
+
+/// <summary>
+/// Write an event into the calling thread's ring
+/// </summary>
+/// <param name="name">index of the event's name</param>
+/// <param name="start">ticks when it started</param>
+/// <param name="end">ticks when it ended</param>
+/// <param name="kind">TraceEventKind</param>
+void FrameTracer::Append( int name, long long start, long long end, int kind )
+{
+	TraceThread * pThread = GetThread();
+	if ( NULL == pThread )
+	{
+		return;
+	}
+
+	if ( NULL == pThread->pEvents )
+	{
+		// once per thread, whenever tracing is first turned on
+		AllocationExemption exemption;
+		pThread->pEvents = new TraceEvent[TRACE_EVENTS_PER_THREAD];
+	}
+
+	// only this thread writes its ring, the count publishes the event to dumps
+	unsigned long long written = pThread->written.load( std::memory_order_relaxed );
+	TraceEvent & event = pThread->pEvents[written & ( TRACE_EVENTS_PER_THREAD - 1 )];
+	event.start = start;
+	event.end = end;
+	event.name = name;
+	event.kind = kind;
+	pThread->written.store( written + 1, std::memory_order_release );
+
+	if ( m_thresholdTicks > 0 && end - start > m_thresholdTicks )
+	{
+		SetEvent( m_hEvDump );
+	}
+}
+
+/// <summary>
+/// Write every thread's events as Chrome trace_event JSON
+/// </summary>
+/// <param name="json">receives the trace, appended</param>
+void FrameTracer::Format( std::string & json ) const
+{
+	char line[256];
+	bool first = true;
+	std::vector<TraceEvent> events;
+
+	json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	LONG threadCount = m_threadCount;
+	if ( threadCount > TRACE_MAX_THREADS )
+	{
+		threadCount = TRACE_MAX_THREADS;
+	}
+
+	for ( LONG t = 0; t < threadCount; t++ )
+	{
+		const TraceThread & thread = m_threads[t];
+		unsigned long long written = thread.written.load( std::memory_order_acquire );
+		if ( 0 == written )
+		{
+			continue;
+		}
+
+		StringCchPrintfA( line, _countof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+						  first ? "" : ",\n", thread.threadId, ( '\0' != thread.name[0] ) ? thread.name : "thread" );
+		json += line;
+		first = false;
+
+		// copy the ring first, the thread keeps writing into it
+		unsigned long long oldest = ( written > TRACE_EVENTS_PER_THREAD ) ? written - TRACE_EVENTS_PER_THREAD : 0;
+		events.clear();
+		for ( unsigned long long i = oldest; i < written; i++ )
+		{
+			events.push_back( thread.pEvents[i & ( TRACE_EVENTS_PER_THREAD - 1 )] );
+		}
+
+		// events the thread may have overwritten during the copy are left out
+		unsigned long long now = thread.written.load( std::memory_order_acquire );
+		size_t skip = 0;
+		if ( now >= oldest + TRACE_EVENTS_PER_THREAD )
+		{
+			skip = static_cast<size_t>( now - oldest - TRACE_EVENTS_PER_THREAD + 1 );
+		}
+
+		for ( size_t i = skip; i < events.size(); i++ )
+		{
+			const TraceEvent & event = events[i];
+			if ( TRACE_INSTANT == event.kind )
+			{
+				StringCchPrintfA( line, _countof(line), ",\n{\"name\":\"%s\",\"cat\":\"frames\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f}",
+								  m_pNames[event.name], thread.threadId, ( event.start - m_origin ) * m_microsecondsPerTick );
+			}
+			else
+			{
+				StringCchPrintfA( line, _countof(line), ",\n{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,\"ts\":%.3f,\"dur\":%.3f}",
+								  m_pNames[event.name], thread.threadId,
+								  ( event.start - m_origin ) * m_microsecondsPerTick, ( event.end - event.start ) * m_microsecondsPerTick );
+			}
+			json += line;
+		}
+	}
+
+	json += "\n]}\n";
+}
+
+/// <summary>
+/// Write the trace to a file
+/// </summary>
+/// <param name="path">file to create</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT FrameTracer::Dump( const char * path ) const
+{
+	std::string json;
+	Format( json );
+
+	FILE * pFile = NULL;
+	if ( 0 != fopen_s( &pFile, path, "wb" ) || NULL == pFile )
+	{
+		return E_FAIL;
+	}
+
+	size_t written = fwrite( json.c_str(), 1, json.size(), pFile );
+	fclose( pFile );
+
+	return ( json.size() == written ) ? S_OK : E_FAIL;
+}
+
+/// <summary>
+/// Thread writing the dumps slow stages trigger, calls class instance thread processor
+/// </summary>
+/// <param name="pParam">instance pointer</param>
+/// <returns>always 0</returns>
+DWORD WINAPI FrameTracer::DumpThread( LPVOID pParam )
+{
+	FrameTracer *pthis = (FrameTracer *)pParam;
+	return pthis->DumpThread( );
+}
+
+/// <summary>
+/// Thread writing the dumps slow stages trigger
+/// </summary>
+/// <returns>always 0</returns>
+DWORD WINAPI FrameTracer::DumpThread( )
+{
+	const int numEvents = 2;
+	HANDLE hEvents[numEvents] = { m_hEvDumpStop, m_hEvDump };
+	ULONGLONG lastDump = 0;
+
+	while ( WAIT_OBJECT_0 != WaitForMultipleObjects( numEvents, hEvents, FALSE, INFINITE ) )
+	{
+		// keep what happened right after the slow stage too
+		if ( WAIT_OBJECT_0 == WaitForSingleObject( m_hEvDumpStop, TRACE_DUMP_DELAY ) )
+		{
+			break;
+		}
+
+		ULONGLONG now = GetTickCount64();
+		if ( 0 != lastDump && now - lastDump < TRACE_DUMP_INTERVAL )
+		{
+			continue;
+		}
+		lastDump = now;
+
+		SYSTEMTIME time;
+		GetLocalTime( &time );
+
+		char path[MAX_PATH];
+		StringCchPrintfA( path, _countof(path), "trace-%04d%02d%02d-%02d%02d%02d.json",
+						  time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond );
+		if ( SUCCEEDED( Dump( path ) ) )
+		{
+			OutputDebugStringA( "Slow stage, trace written to " );
+			OutputDebugStringA( path );
+			OutputDebugStringA( "\r\n" );
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------
+// <copyright file="FrameTrace.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the frame tracer, a flight recorder of the pipeline stages every thread ran.
+// Each thread writes its own ring of events without locks; a dump converts all rings to
+// the Chrome trace_event JSON format (chrome://tracing or ui.perfetto.dev), every thread
+// on the same QueryPerformanceCounter clock.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#define TRACE_MAX_THREADS               16
+#define TRACE_EVENTS_PER_THREAD         16384       // power of two, about a minute of frames
+#define TRACE_MAX_THREAD_NAME           32
+#define TRACE_DUMP_DELAY                200         // ms recorded after a slow stage before the dump
+#define TRACE_DUMP_INTERVAL             10000       // ms between two dumps slow stages trigger
+
+enum TraceEventKind
+{
+	TRACE_COMPLETE = 0,             // a stage, from start to end
+	TRACE_INSTANT                   // something that happened at start, e.g. a dropped frame
+};
+
+/// <summary>
+/// One stage a thread ran
+/// </summary>
+struct TraceEvent
+{
+	long long               start;          // ticks of QueryPerformanceCounter
+	long long               end;
+	int                     name;           // index into the names the dump is given
+	int                     kind;           // TraceEventKind
+};
+
+class FrameTracer
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	FrameTracer();
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~FrameTracer();
+
+	/// <summary>
+	/// Start or stop recording. Events recorded so far are kept
+	/// </summary>
+	/// <param name="enabled">record the stages</param>
+	/// <param name="thresholdTicks">a stage taking longer dumps the trace to a file, 0 for never</param>
+	/// <param name="pNames">name of every event name index, must outlive the tracer</param>
+	void                    Enable( bool enabled, long long thresholdTicks, const char * const * pNames );
+
+	bool                    IsEnabled( ) const { return 0 != m_enabled; }
+
+	/// <summary>
+	/// Name the calling thread in dumps
+	/// </summary>
+	/// <param name="name">name to show, truncated to TRACE_MAX_THREAD_NAME</param>
+	void                    NameThread( const char * name );
+
+	/// <summary>
+	/// Record a stage the calling thread ran. Never blocks, only allocates the first time
+	/// a thread records
+	/// </summary>
+	/// <param name="name">index of the stage's name</param>
+	/// <param name="start">ticks when it started</param>
+	/// <param name="end">ticks when it ended</param>
+	void                    Add( int name, long long start, long long end )
+	{
+		Append( name, start, end, TRACE_COMPLETE );
+	}
+
+	/// <summary>
+	/// Record something that happened on the calling thread. Never blocks, only allocates
+	/// the first time a thread records
+	/// </summary>
+	/// <param name="name">index of the event's name</param>
+	/// <param name="time">ticks when it happened</param>
+	void                    AddInstant( int name, long long time )
+	{
+		Append( name, time, time, TRACE_INSTANT );
+	}
+
+	/// <summary>
+	/// Write every thread's events as Chrome trace_event JSON
+	/// </summary>
+	/// <param name="json">receives the trace, appended</param>
+	void                    Format( std::string & json ) const;
+
+	/// <summary>
+	/// Write the trace to a file
+	/// </summary>
+	/// <param name="path">file to create</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Dump( const char * path ) const;
+
+private:
+	// not copyable, threads keep pointers into it
+	FrameTracer( const FrameTracer & );
+	FrameTracer & operator=( const FrameTracer & );
+
+	struct TraceThread
+	{
+		DWORD               threadId;
+		char                name[TRACE_MAX_THREAD_NAME];
+		TraceEvent *        pEvents;            // NULL until the thread records
+		std::atomic<unsigned long long> written; // events ever written, the ring holds the last ones
+	};
+
+	/// <summary>
+	/// Slot of the calling thread, claimed the first time
+	/// </summary>
+	/// <returns>slot, NULL if TRACE_MAX_THREADS threads have one</returns>
+	TraceThread *           GetThread( );
+
+	/// <summary>
+	/// Write an event into the calling thread's ring
+	/// </summary>
+	/// <param name="name">index of the event's name</param>
+	/// <param name="start">ticks when it started</param>
+	/// <param name="end">ticks when it ended</param>
+	/// <param name="kind">TraceEventKind</param>
+	void                    Append( int name, long long start, long long end, int kind );
+
+	/// <summary>
+	/// Thread writing the dumps slow stages trigger, calls class instance thread processor
+	/// </summary>
+	/// <param name="pParam">instance pointer</param>
+	/// <returns>always 0</returns>
+	static DWORD WINAPI     DumpThread( LPVOID pParam );
+
+	/// <summary>
+	/// Thread writing the dumps slow stages trigger
+	/// </summary>
+	/// <returns>always 0</returns>
+	DWORD WINAPI            DumpThread( );
+
+	volatile LONG           m_enabled;
+	long long               m_thresholdTicks;
+	const char * const *    m_pNames;
+	long long               m_origin;           // ticks at construction, time 0 of the trace
+	double                  m_microsecondsPerTick;
+
+	DWORD                   m_tlsIndex;         // thread's TraceThread
+	TraceThread             m_threads[TRACE_MAX_THREADS];
+	volatile LONG           m_threadCount;
+
+	HANDLE                  m_hThDump;
+	HANDLE                  m_hEvDumpStop;
+	HANDLE                  m_hEvDump;
+};
@@ -0,0 +1,148 @@
+//------------------------------------------------------------------------------
+// <copyright file="LatencyHistogram.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "LatencyHistogram.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(_BitScanReverse)
+#endif
+
+static const unsigned long long g_MaxValue = ( 1ull << LATENCY_MAX_BITS ) - 1;
+
+/// <summary>
+/// Position of the highest set bit
+/// </summary>
+/// <param name="value">value, not 0</param>
+/// <returns>bit index, 0 for the lowest bit</returns>
+static int HighestBit( unsigned long long value )
+{
+#ifdef _MSC_VER
+	// _BitScanReverse64 is x64 only
+	unsigned long index;
+	unsigned long high = static_cast<unsigned long>( value >> 32 );
+	if ( 0 != high )
+	{
+		_BitScanReverse( &index, high );
+		return static_cast<int>(index) + 32;
+	}
+	_BitScanReverse( &index, static_cast<unsigned long>(value) );
+	return static_cast<int>(index);
+#else
+	return 63 - __builtin_clzll( value );
+#endif
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+LatencyHistogram::LatencyHistogram()
+{
+	for ( int i = 0; i < LATENCY_BUCKET_COUNT; i++ )
+	{
+		m_buckets[i] = 0;
+	}
+	m_count = 0;
+	m_sum = 0;
+	m_max = 0;
+}
+
+/// <summary>
+/// Bucket a value is counted in
+/// </summary>
+/// <param name="nanoseconds">value</param>
+/// <returns>index of the bucket</returns>
+int LatencyHistogram::BucketIndex( unsigned long long nanoseconds )
+{
+	if ( nanoseconds < 2 * LATENCY_SUB_BUCKETS )
+	{
+		return static_cast<int>(nanoseconds);
+	}
+	if ( nanoseconds > g_MaxValue )
+	{
+		nanoseconds = g_MaxValue;
+	}
+
+	// the bits below the highest LATENCY_SUB_BUCKET_BITS + 1 are dropped
+	int shift = HighestBit( nanoseconds ) - LATENCY_SUB_BUCKET_BITS;
+	return shift * LATENCY_SUB_BUCKETS + static_cast<int>( nanoseconds >> shift );
+}
+
+/// <summary>
+/// Largest value a bucket counts
+/// </summary>
+/// <param name="index">index of the bucket</param>
+/// <returns>value, nanoseconds</returns>
+unsigned long long LatencyHistogram::BucketUpperBound( int index )
+{
+	if ( index < 2 * LATENCY_SUB_BUCKETS )
+	{
+		return static_cast<unsigned long long>(index);
+	}
+
+	int shift = index / LATENCY_SUB_BUCKETS - 1;
+	unsigned long long lowest = static_cast<unsigned long long>( index % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS ) << shift;
+	return lowest + ( 1ull << shift ) - 1;
+}
+
+/// <summary>
+/// Count one value
+/// </summary>
+/// <param name="nanoseconds">value to count</param>
+void LatencyHistogram::Record( unsigned long long nanoseconds )
+{
+	m_buckets[BucketIndex( nanoseconds )].fetch_add( 1, std::memory_order_relaxed );
+	m_count.fetch_add( 1, std::memory_order_relaxed );
+	m_sum.fetch_add( nanoseconds, std::memory_order_relaxed );
+
+	// only loops while another thread raises the maximum at the same time
+	unsigned long long max = m_max.load( std::memory_order_relaxed );
+	while ( nanoseconds > max && !m_max.compare_exchange_weak( max, nanoseconds, std::memory_order_relaxed ) )
+	{
+	}
+}
+
+/// <summary>
+/// Summarize the values counted so far. Values recorded meanwhile may or may not be included
+/// </summary>
+/// <param name="snapshot">receives the summary</param>
+void LatencyHistogram::GetSnapshot( LatencySnapshot & snapshot ) const
+{
+	static const double quantiles[3] = { 0.5, 0.99, 0.999 };
+	unsigned long long * results[3] = { &snapshot.p50, &snapshot.p99, &snapshot.p999 };
+
+	// count what the buckets hold rather than m_count, the two may be a few values apart
+	unsigned long long counts[LATENCY_BUCKET_COUNT];
+	unsigned long long total = 0;
+	for ( int i = 0; i < LATENCY_BUCKET_COUNT; i++ )
+	{
+		counts[i] = m_buckets[i].load( std::memory_order_relaxed );
+		total += counts[i];
+	}
+
+	snapshot.count = m_count.load( std::memory_order_relaxed );
+	snapshot.sum = m_sum.load( std::memory_order_relaxed );
+	snapshot.max = m_max.load( std::memory_order_relaxed );
+
+	int q = 0;
+	unsigned long long seen = 0;
+	for ( int i = 0; i < LATENCY_BUCKET_COUNT && q < 3; i++ )
+	{
+		seen += counts[i];
+		while ( q < 3 && 0 != total && static_cast<double>(seen) >= quantiles[q] * static_cast<double>(total) )
+		{
+			// the bucket's upper bound, but never above what was actually recorded
+			unsigned long long bound = BucketUpperBound( i );
+			*results[q++] = ( bound < snapshot.max ) ? bound : snapshot.max;
+		}
+	}
+	while ( q < 3 )
+	{
+		*results[q++] = 0;
+	}
+}
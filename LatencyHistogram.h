@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------------
+// <copyright file="LatencyHistogram.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares a lock-free latency histogram with logarithmic buckets. Like the merge stage it
+// only depends on the standard library.
+//
+// Each power of two is split into LATENCY_SUB_BUCKETS buckets, so a percentile is off by at
+// most 1/16 of its value, from nanoseconds to minutes, in a few kilobytes. Recording is a
+// couple of relaxed atomic increments and never blocks; any number of threads may record
+// while another one reads.
+
+#pragma once
+
+#include <atomic>
+
+#define LATENCY_SUB_BUCKET_BITS         4
+#define LATENCY_SUB_BUCKETS             (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_BITS                40          // about 18 minutes in nanoseconds, longer values are clamped
+#define LATENCY_BUCKET_COUNT            ((LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+/// <summary>
+/// Summary of a histogram, nanoseconds
+/// </summary>
+struct LatencySnapshot
+{
+	unsigned long long  count;
+	unsigned long long  sum;
+	unsigned long long  max;
+	unsigned long long  p50;
+	unsigned long long  p99;
+	unsigned long long  p999;
+};
+
+class LatencyHistogram
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	LatencyHistogram();
+
+	/// <summary>
+	/// Count one value
+	/// </summary>
+	/// <param name="nanoseconds">value to count</param>
+	void                Record( unsigned long long nanoseconds );
+
+	/// <summary>
+	/// Summarize the values counted so far. Values recorded meanwhile may or may not be included
+	/// </summary>
+	/// <param name="snapshot">receives the summary</param>
+	void                GetSnapshot( LatencySnapshot & snapshot ) const;
+
+	/// <summary>
+	/// Bucket a value is counted in
+	/// </summary>
+	/// <param name="nanoseconds">value</param>
+	/// <returns>index of the bucket</returns>
+	static int          BucketIndex( unsigned long long nanoseconds );
+
+	/// <summary>
+	/// Largest value a bucket counts
+	/// </summary>
+	/// <param name="index">index of the bucket</param>
+	/// <returns>value, nanoseconds</returns>
+	static unsigned long long BucketUpperBound( int index );
+
+private:
+	// not copyable, the counters are atomic
+	LatencyHistogram( const LatencyHistogram & );
+	LatencyHistogram & operator=( const LatencyHistogram & );
+
+	std::atomic<unsigned long long> m_buckets[LATENCY_BUCKET_COUNT];
+	std::atomic<unsigned long long> m_count;
+	std::atomic<unsigned long long> m_sum;
+	std::atomic<unsigned long long> m_max;
+};
@@ -25,9 +25,20 @@ static const float g_InferredBoneThickness = 1.0f;
 
 const int g_BytesPerPixel = 4;
 
+// Preview frames held at once. Only the primary sensor's thread converts frames, and the
+// preview copies each into its bitmap before the next; a stage that keeps frames past
+// Nui_GotDepthAlert, holding a FrameHandle, needs a buffer for each frame it keeps
+static const unsigned int g_DepthFrameBuffers = 1;
+
 const int g_ScreenWidth = 320;
 const int g_ScreenHeight = 240;
 
+// skeleton frames older than this (ms) are left out of the merge, so unplugged sensors drop out
+static const long long g_MergeMaxAge = 500;
+
+// wake local consumers blocked on the shared pose ring, one system call per fused frame
+static const bool g_SharedPoseNotify = true;
+
 
 enum _SV_TRACKED_SKELETONS
 {
@@ -54,7 +65,11 @@ enum _SV_RANGE
 /// </summary>
 void TrackerApp::Nui_Zero()
 {
-	SafeRelease( m_pNuiSensor );
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		delete m_pSensors[i];
+		m_pSensors[i] = NULL;
+	}
 
 	m_pRenderTarget = NULL;
 	m_pBrushJointTracked = NULL;
@@ -63,18 +78,22 @@ void TrackerApp::Nui_Zero()
 	m_pBrushBoneInferred = NULL;
 	ZeroMemory(m_Points,sizeof(m_Points));
 
-	m_hNextDepthFrameEvent = NULL;
-	m_hNextColorFrameEvent = NULL;
-	m_hNextSkeletonEvent = NULL;
-	m_pDepthStreamHandle = NULL;
-	m_pVideoStreamHandle = NULL;
-	m_hThNuiProcess = NULL;
-	m_hEvNuiProcessStop = NULL;
+	m_hThMerge = NULL;
+	m_hEvMergeStop = NULL;
+	m_hEvMergeWake = NULL;
+	m_mergeSignalTime = 0;
+	ZeroMemory(&m_mergedFrame,sizeof(m_mergedFrame));
+	ZeroMemory(m_sensorPosition,sizeof(m_sensorPosition));
+	ZeroMemory(m_sensorAngle,sizeof(m_sensorAngle));
+	m_multicastTtl = 1;
+	m_metricsPort = 0;
+	m_echoPort = 0;
+	m_traceEnabled = false;
+	m_traceThreshold = 0;
+	m_settingsLoaded = false;
+	ZeroMemory(m_mergedSubmitCount,sizeof(m_mergedSubmitCount));
 	m_LastSkeletonFoundTime = 0;
 	m_bScreenBlanked = false;
-	m_DepthFramesTotal = 0;
-	m_LastDepthFPStime = 0;
-	m_LastDepthFramesTotal = 0;
 	m_pDrawDepth = NULL;
 	m_pDrawColor = NULL;
 	m_TrackedSkeletons = 0;
@@ -91,7 +110,8 @@ void TrackerApp::Nui_Zero()
 	m_activeUser = -1;
 	m_secondaryUser = -1;
 
-	m_listening = false;
+	m_pointCloudPlayer = POINT_CLOUD_ALL_PLAYERS;
+	m_pointCloudVoxelSize = 0.0f;
 }
 
 /// <summary>
@@ -117,86 +137,84 @@ void CALLBACK TrackerApp::Nui_StatusProc( HRESULT hrStatus, const OLECHAR* insta
 	// Update UI
 	PostMessageW( m_hWnd, WM_USER_UPDATE_COMBO, 0, 0 );
 
-	if( SUCCEEDED(hrStatus) )
+	// sensors this process already runs recover on their own thread, nothing is torn down here
+	bool running = false;
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
 	{
-		if ( S_OK == hrStatus )
+		if ( m_pSensors[i] && m_pSensors[i]->IsInstance(instanceName) && m_pSensors[i]->IsOpen() )
 		{
-			if ( m_instanceId && 0 == wcscmp(instanceName, m_instanceId) )
-			{
-				Nui_Init(m_instanceId);
-			}
-			else if ( !m_pNuiSensor )
-			{
-				Nui_Init();
-			}
+			m_pSensors[i]->OnStatusChanged( hrStatus );
+			running = true;
 		}
 	}
-	else
+
+	// new sensors are opened on the UI thread, where errors can be shown
+	if ( !running && S_OK == hrStatus )
 	{
-		if ( m_instanceId && 0 == wcscmp(instanceName, m_instanceId) )
-		{
-			Nui_UnInit();
-			Nui_Zero();
-		}
+		PostMessageW( m_hWnd, WM_USER_SENSOR_ADDED, 0, 0 );
 	}
 }
 
 /// <summary>
-/// Initialize Kinect by instance name
+/// Processors the acquisition thread of a sensor may run on. Processor 0 is left to the
+/// UI and merge threads, the sensors are spread over the others
 /// </summary>
-/// <param name="instanceName">instance name of Kinect to initialize</param>
-/// <returns>S_OK if successful, otherwise an error code</returns>
-HRESULT TrackerApp::Nui_Init( OLECHAR *instanceName )
+/// <param name="sensorIndex">index of the sensor context</param>
+/// <returns>affinity mask, 0 to leave the thread unpinned</returns>
+static DWORD_PTR SensorAffinity( int sensorIndex )
 {
-	// Generic creation failure
-	if ( NULL == instanceName )
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+
+	DWORD processors = info.dwNumberOfProcessors;
+	if ( processors > sizeof(DWORD_PTR) * 8 )
 	{
-		MessageBoxResource( IDS_ERROR_NUICREATE, MB_OK | MB_ICONHAND );
-		return E_FAIL;
+		processors = sizeof(DWORD_PTR) * 8;
 	}
-
-	HRESULT hr = NuiCreateSensorById( instanceName, &m_pNuiSensor );
-
-	// Generic creation failure
-	if ( FAILED(hr) )
+	if ( processors < 2 )
 	{
-		MessageBoxResource( IDS_ERROR_NUICREATE, MB_OK | MB_ICONHAND );
-		return hr;
+		return 0;
 	}
 
-	SysFreeString(m_instanceId);
-
-	m_instanceId = m_pNuiSensor->NuiDeviceConnectionId();
-
-	return Nui_Init();
+	return (DWORD_PTR)1 << ( 1 + sensorIndex % (processors - 1) );
 }
 
 /// <summary>
-/// Initialize Kinect
+/// Copy a fused frame into the shared pose ring, in place
 /// </summary>
-/// <returns>S_OK if successful, otherwise an error code</returns>
-HRESULT TrackerApp::Nui_Init( )
+/// <param name="fused">frame the fusion just published</param>
+/// <param name="out">frame of the ring being written, its frameNumber is already set</param>
+static void CopySharedPoses( const FusedSkeletonFrame & fused, SharedPoseFrame & out )
 {
-	HRESULT  hr;
-	bool     result;
+	out.timestamp = fused.timestamp;
+	out.skeletonCount = ( fused.skeletonCount < SHARED_POSE_MAX_SKELETONS ) ? fused.skeletonCount : SHARED_POSE_MAX_SKELETONS;
+	out.reserved = 0;
 
-	if ( !m_pNuiSensor )
+	for ( int i = 0; i < out.skeletonCount; i++ )
 	{
-		hr = NuiCreateSensorByIndex(0, &m_pNuiSensor);
+		const FusedSkeleton & skeleton = fused.skeletons[i];
+		SharedPoseSkeleton & shared = out.skeletons[i];
 
-		if ( FAILED(hr) )
+		shared.globalId = skeleton.globalId;
+		shared.trackingState = skeleton.trackingState;
+		shared.sensorMask = skeleton.sensorMask;
+		for ( int j = 0; j < SHARED_POSE_JOINT_COUNT; j++ )
 		{
-			return hr;
+			shared.jointState[j] = skeleton.jointState[j];
+			shared.joints[j][0] = skeleton.jointX[j];
+			shared.joints[j][1] = skeleton.jointY[j];
+			shared.joints[j][2] = skeleton.jointZ[j];
 		}
-
-		SysFreeString(m_instanceId);
-
-		m_instanceId = m_pNuiSensor->NuiDeviceConnectionId();
 	}
+}
 
-	m_hNextDepthFrameEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
-	m_hNextColorFrameEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
-	m_hNextSkeletonEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+/// <summary>
+/// Initialize every connected Kinect
+/// </summary>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT TrackerApp::Nui_Init( )
+{
+	bool     result;
 
 	// reset the tracked skeletons, range, and tracking mode
 	SendDlgItemMessage(m_hWnd, IDC_TRACKEDSKELETONS, CB_SETCURSEL, 0, 0);
@@ -205,111 +223,151 @@ HRESULT TrackerApp::Nui_Init( )
 
 	EnsureDirect2DResources();
 
-	m_pDrawDepth = new DrawDevice( );
-	result = m_pDrawDepth->Initialize( GetDlgItem( m_hWnd, IDC_DEPTHVIEWER ), m_pD2DFactory, 320, 240, 320 * 4 );
-	if ( !result )
+	// the preview and its buffers take the size of the depth stream the sensors open
+	DWORD depthWidth, depthHeight;
+	NuiImageResolutionToSize( SENSOR_DEPTH_RESOLUTION, depthWidth, depthHeight );
+	if ( !m_depthFrames.Initialize( depthWidth * depthHeight * g_BytesPerPixel, g_DepthFrameBuffers ) )
 	{
-		MessageBoxResource( IDS_ERROR_DRAWDEVICE, MB_OK | MB_ICONHAND );
-		return E_FAIL;
+		return E_OUTOFMEMORY;
 	}
-	
 
-	DWORD nuiFlags = NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX | NUI_INITIALIZE_FLAG_USES_SKELETON |  NUI_INITIALIZE_FLAG_USES_COLOR | NUI_INITIALIZE_FLAG_USES_AUDIO;
+	if ( NULL == m_pDrawDepth )
+	{
+		m_pDrawDepth = new DrawDevice( );
+		result = m_pDrawDepth->Initialize( GetDlgItem( m_hWnd, IDC_DEPTHVIEWER ), m_pD2DFactory, depthWidth, depthHeight, depthWidth * g_BytesPerPixel );
+		if ( !result )
+		{
+			MessageBoxResource( IDS_ERROR_DRAWDEVICE, MB_OK | MB_ICONHAND );
+			return E_FAIL;
+		}
+	}
 
-	hr = m_pNuiSensor->NuiInitialize(nuiFlags);
-	if ( E_NUI_SKELETAL_ENGINE_BUSY == hr )
+	// Start the merge thread before the sensors, so no frame is left waiting
+	if ( NULL == m_hThMerge )
 	{
-		nuiFlags = NUI_INITIALIZE_FLAG_USES_DEPTH |  NUI_INITIALIZE_FLAG_USES_COLOR;
-		hr = m_pNuiSensor->NuiInitialize( nuiFlags) ;
+		// local consumers are optional, the tracker runs without the shared memory
+		m_sharedPoses.Open( g_SharedPoseNotify );
+
+		m_hEvMergeStop = CreateEvent( NULL, FALSE, FALSE, NULL );
+		m_hEvMergeWake = CreateEvent( NULL, FALSE, FALSE, NULL );
+		m_hThMerge = CreateThread( NULL, 0, Nui_MergeThread, this, 0, NULL );
 	}
 
-	if ( FAILED( hr ) )
+	return Nui_AttachSensors();
+}
+
+/// <summary>
+/// Open and start every connected Kinect that has no running context yet
+/// </summary>
+/// <returns>S_OK if the primary sensor is running, otherwise an error code</returns>
+HRESULT TrackerApp::Nui_AttachSensors( )
+{
+	HRESULT hr;
+
+	// Open every sensor that no context owns yet
+	int sensorCount = 0;
+	NuiGetSensorCount( &sensorCount );
+
+	for ( int i = 0; i < sensorCount; i++ )
 	{
-		if ( E_NUI_DEVICE_IN_USE == hr )
+		INuiSensor * pNuiSensor = NULL;
+		if ( FAILED( NuiCreateSensorByIndex( i, &pNuiSensor ) ) )
 		{
-			MessageBoxResource( IDS_ERROR_IN_USE, MB_OK | MB_ICONHAND );
+			continue;
 		}
-		else
+
+		BSTR instanceId = pNuiSensor->NuiDeviceConnectionId();
+		SafeRelease( pNuiSensor );
+
+		int index = -1;
+		bool owned = false;
+		for ( int j = 0; j < MERGE_MAX_SENSORS; j++ )
 		{
-			MessageBoxResource( IDS_ERROR_NUIINIT, MB_OK | MB_ICONHAND );
+			if ( m_pSensors[j] && m_pSensors[j]->IsInstance(instanceId) )
+			{
+				owned = m_pSensors[j]->IsOpen();
+				index = j;
+				break;
+			}
+			if ( index < 0 && ( NULL == m_pSensors[j] || !m_pSensors[j]->IsOpen() ) )
+			{
+				index = j;
+			}
 		}
-		return hr;
+
+		if ( !owned && index >= 0 )
+		{
+			if ( NULL == m_pSensors[index] )
+			{
+				m_pSensors[index] = new SensorContext( this, index );
+			}
+
+			// a sensor that was created but failed to initialize is still started,
+			// its recovery keeps retrying, e.g. until another process releases it
+			hr = m_pSensors[index]->Open( instanceId, m_SkeletonTrackingFlags, m_DepthStreamFlags );
+			if ( FAILED(hr) && 0 == index )
+			{
+				MessageBoxResource( m_pSensors[index]->m_lastErrorId, MB_OK | MB_ICONHAND );
+			}
+		}
+
+		SysFreeString( instanceId );
 	}
 
+	// the threads read the configuration from their first frame on
+	PublishConfig();
 
-	if ( HasSkeletalEngine( m_pNuiSensor ) )
+	// Start the Nui processing thread of every sensor that is not running yet
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
 	{
-		hr = m_pNuiSensor->NuiSkeletonTrackingEnable( m_hNextSkeletonEvent, m_SkeletonTrackingFlags );
-		if( FAILED( hr ) )
+		if ( m_pSensors[i] && m_pSensors[i]->IsOpen() )
 		{
-			MessageBoxResource( IDS_ERROR_SKELETONTRACKING, MB_OK | MB_ICONHAND );
-			return hr;
+			m_pSensors[i]->Start( SensorAffinity(i) );
 		}
 	}
 
-
-	hr = m_pNuiSensor->NuiImageStreamOpen(
-		HasSkeletalEngine(m_pNuiSensor) ? NUI_IMAGE_TYPE_DEPTH_AND_PLAYER_INDEX : NUI_IMAGE_TYPE_DEPTH,
-		NUI_IMAGE_RESOLUTION_320x240,
-		m_DepthStreamFlags,
-		2,
-		m_hNextDepthFrameEvent,
-		&m_pDepthStreamHandle );
-
-	if ( FAILED( hr ) )
+	if ( NULL == m_pSensors[0] || !m_pSensors[0]->IsOpen() )
 	{
-		MessageBoxResource(IDS_ERROR_DEPTHSTREAM, MB_OK | MB_ICONHAND);
-		return hr;
+		return E_FAIL;
 	}
 
-	// Start the Nui processing thread
-	m_hEvNuiProcessStop = CreateEvent( NULL, FALSE, FALSE, NULL );
-	m_hThNuiProcess = CreateThread( NULL, 0, Nui_ProcessThread, this, 0, NULL );
-
-	return hr;
+	return S_OK;
 }
 
 /// <summary>
-/// Uninitialize Kinect
+/// Uninitialize all Kinects
 /// </summary>
 void TrackerApp::Nui_UnInit( )
 {
-	// Stop the Nui processing thread
-	if ( NULL != m_hEvNuiProcessStop )
+	// Stop the sensors first, they feed the merge thread
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		delete m_pSensors[i];
+		m_pSensors[i] = NULL;
+	}
+
+	// Stop the merge thread
+	if ( NULL != m_hEvMergeStop )
 	{
 		// Signal the thread
-		SetEvent(m_hEvNuiProcessStop);
+		SetEvent(m_hEvMergeStop);
 
 		// Wait for thread to stop
-		if ( NULL != m_hThNuiProcess )
+		if ( NULL != m_hThMerge )
 		{
-			WaitForSingleObject( m_hThNuiProcess, INFINITE );
-			CloseHandle( m_hThNuiProcess );
+			WaitForSingleObject( m_hThMerge, INFINITE );
+			CloseHandle( m_hThMerge );
+			m_hThMerge = NULL;
 		}
-		CloseHandle( m_hEvNuiProcessStop );
-	}
-
-	if ( m_pNuiSensor )
-	{
-		m_pNuiSensor->NuiShutdown( );
-	}
-	if ( m_hNextSkeletonEvent && ( m_hNextSkeletonEvent != INVALID_HANDLE_VALUE ) )
-	{
-		CloseHandle( m_hNextSkeletonEvent );
-		m_hNextSkeletonEvent = NULL;
+		CloseHandle( m_hEvMergeStop );
+		m_hEvMergeStop = NULL;
 	}
-	if ( m_hNextDepthFrameEvent && ( m_hNextDepthFrameEvent != INVALID_HANDLE_VALUE ) )
+	m_sharedPoses.Close();
+	if ( NULL != m_hEvMergeWake )
 	{
-		CloseHandle( m_hNextDepthFrameEvent );
-		m_hNextDepthFrameEvent = NULL;
+		CloseHandle( m_hEvMergeWake );
+		m_hEvMergeWake = NULL;
 	}
-	if ( m_hNextColorFrameEvent && ( m_hNextColorFrameEvent != INVALID_HANDLE_VALUE ) )
-	{
-		CloseHandle( m_hNextColorFrameEvent );
-		m_hNextColorFrameEvent = NULL;
-	}
-
-	SafeRelease( m_pNuiSensor );
 
 	// clean up Direct2D graphics
 	delete m_pDrawDepth;
@@ -322,124 +380,259 @@ void TrackerApp::Nui_UnInit( )
 }
 
 /// <summary>
-/// Thread to handle Kinect processing, calls class instance thread processor
+/// Thread that merges the skeleton frames of all sensors, calls class instance thread processor
 /// </summary>
 /// <param name="pParam">instance pointer</param>
 /// <returns>always 0</returns>
-DWORD WINAPI TrackerApp::Nui_ProcessThread( LPVOID pParam )
+DWORD WINAPI TrackerApp::Nui_MergeThread( LPVOID pParam )
 {
 	TrackerApp *pthis = (TrackerApp *)pParam;
-	return pthis->Nui_ProcessThread( );
+	return pthis->Nui_MergeThread( );
 }
 
 /// <summary>
-/// Thread to handle Kinect processing
+/// Thread that merges the skeleton frames of all sensors
 /// </summary>
 /// <returns>always 0</returns>
-DWORD WINAPI TrackerApp::Nui_ProcessThread( )
+DWORD WINAPI TrackerApp::Nui_MergeThread( )
 {
-	const int numEvents = 4;
-	HANDLE hEvents[numEvents] = { m_hEvNuiProcessStop, m_hNextDepthFrameEvent, m_hNextColorFrameEvent, m_hNextSkeletonEvent };
-	int    nEventIdx;
-	DWORD  t;
-
-	m_LastDepthFPStime = timeGetTime( );
+	const int numEvents = 2;
+	HANDLE hEvents[numEvents] = { m_hEvMergeStop, m_hEvMergeWake };
 
 	// Blank the skeleton display on startup
 	m_LastSkeletonFoundTime = 0;
 
-	// Main thread loop
-	bool continueProcessing = true;
-	while ( continueProcessing )
-	{
-		// Wait for any of the events to be signalled
-		nEventIdx = WaitForMultipleObjects( numEvents, hEvents, FALSE, 1000 );
+	m_metrics.NameThread( "merge" );
 
-		// Timed out, continue
-		if ( nEventIdx == WAIT_TIMEOUT )
-		{
-			continue;
-		}
+	while ( true )
+	{
+		// the sensors wake this thread whenever they publish a skeleton frame
+		DWORD nEventIdx = WaitForMultipleObjects( numEvents, hEvents, FALSE, 1000 );
 
-		// stop event was signalled 
+		// stop event was signalled
 		if ( WAIT_OBJECT_0 == nEventIdx )
 		{
-			continueProcessing = false;
 			break;
 		}
 
-		// Wait for each object individually with a 0 timeout to make sure to
-		// process all signalled objects if multiple objects were signalled
-		// this loop iteration
-
-		// In situations where perfect correspondance between color/depth/skeleton
-		// is essential, a priority queue should be used to service the item
-		// which has been updated the longest ago
+		AllocationGuard guard;
+		long long start = PipelineMetrics::Now();
+		LONGLONG signalTime = InterlockedExchange64( &m_mergeSignalTime, 0 );
+		if ( 0 != signalTime )
+		{
+			start = m_metrics.Record( STAGE_WAKE, signalTime );
+		}
 
-		if ( WAIT_OBJECT_0 == WaitForSingleObject( m_hNextDepthFrameEvent, 0 ) )
+		long long now = static_cast<long long>(GetTickCount64());
+		if ( m_merger.Merge( m_mergedFrame, now, g_MergeMaxAge ) > 0 )
 		{
-			//only increment frame count if a frame was successfully drawn
-			if ( Nui_GotDepthAlert() )
+			Nui_CountMergeDrops( m_mergedFrame );
+
+			const FusedSkeletonFrame & fused = m_fusion.Fuse( m_mergedFrame, now );
+			if ( m_sharedPoses.IsOpen() )
 			{
-				++m_DepthFramesTotal;
+				CopySharedPoses( fused, *m_sharedPoses.BeginWrite() );
+				m_sharedPoses.EndWrite();
 			}
+			m_metrics.Record( STAGE_FUSE, start );
 		}
+	}
 
+	return 0;
+}
 
+/// <summary>
+/// Count the skeleton frames newer ones replaced before the merge thread read them
+/// </summary>
+/// <param name="merged">frames the merge just collected</param>
+void TrackerApp::Nui_CountMergeDrops( const MergedSkeletonFrame & merged )
+{
+	for ( int i = 0; i < merged.frameCount; i++ )
+	{
+		const SensorSkeletonFrame & frame = *merged.frames[i];
+		if ( 0 == ( merged.freshMask & ( 1u << frame.sensorIndex ) ) )
+		{
+			continue;
+		}
 
-		// Once per second, display the depth FPS
-		t = timeGetTime( );
-		if ( (t - m_LastDepthFPStime) > 1000 )
+		// frames too old to merge are not collected either, the next fresh one counts them
+		unsigned int & last = m_mergedSubmitCount[frame.sensorIndex];
+		if ( 0 != last && frame.submitCount - last > 1 )
 		{
-			int fps = ((m_DepthFramesTotal - m_LastDepthFramesTotal) * 1000 + 500) / (t - m_LastDepthFPStime);
-			PostMessageW( m_hWnd, WM_USER_UPDATE_FPS, IDC_FPS, fps );
-			m_LastDepthFramesTotal = m_DepthFramesTotal;
-			m_LastDepthFPStime = t;
+			m_metrics.OnFrameDropped( frame.sensorIndex, FRAME_STREAM_SKELETON, FRAME_DROP_MERGE, frame.submitCount - last - 1 );
 		}
+		last = frame.submitCount;
+	}
+}
 
+/// <summary>
+/// Handle new skeleton data, hands it to the merge stage
+/// </summary>
+/// <param name="sensor">sensor the frame is from</param>
+/// <returns>true if a frame was processed, false otherwise</returns>
+bool TrackerApp::Nui_GotSkeletonAlert( SensorContext & sensor )
+{
+	NUI_SKELETON_FRAME skeletonFrame;
+	bool superseded = sensor.m_SkeletonFramePending;
+	long long start = PipelineMetrics::Now();
 
+	HRESULT hr = sensor.m_pNuiSensor->NuiSkeletonGetNextFrame( 0, &skeletonFrame );
+	if ( FAILED( hr ) )
+	{
+		m_metrics.OnFrameDropped( sensor.m_index, FRAME_STREAM_SKELETON, FRAME_DROP_FETCH );
+		return false;
 	}
+	m_metrics.OnFrame( sensor.m_index, FRAME_STREAM_SKELETON, skeletonFrame.dwFrameNumber );
 
-	return 0;
+	// only the primary sensor's frames are sent, by the depth frame that previews them
+	if ( 0 == sensor.m_index )
+	{
+		if ( superseded )
+		{
+			m_metrics.OnFrameDropped( sensor.m_index, FRAME_STREAM_SKELETON, FRAME_DROP_SEND );
+		}
+		sensor.m_SkeletonFramePending = true;
+	}
+	sensor.m_SkeletonCaptureTime = sensor.m_clock.Update( skeletonFrame.liTimeStamp.QuadPart, m_metrics.ToMicroseconds( start ) );
+	start = m_metrics.Record( STAGE_FETCH, start );
+
+	// one snapshot for the whole frame, the UI may publish a new one meanwhile
+	TrackerConfigSnapshot config( m_config, sensor.m_index );
+	const SensorCalibration & calibration = config->calibration[sensor.m_index];
+
+	// smooth out the skeleton data
+	sensor.m_pNuiSensor->NuiTransformSmooth( &skeletonFrame, &config->smoothParams );
+	start = m_metrics.Record( STAGE_SMOOTH, start );
+
+	// every later stage reads the rows, the SDK's frame is done with
+	SkeletonBatch & batch = sensor.m_SkeletonBatch;
+	batch.Load( skeletonFrame );
+
+	// convert to the display frame once, on this sensor's own thread
+	SensorSkeletonFrame * pOut = m_merger.BeginSubmit( sensor.m_index );
+	pOut->sensorIndex = sensor.m_index;
+	pOut->frameNumber = batch.frameNumber;
+	pOut->submitCount = ++sensor.m_SkeletonSubmitCount;
+	pOut->timestamp = batch.timestamp;
+	pOut->arrivalTime = static_cast<long long>(GetTickCount64());
+	pOut->sensorPosition[0] = calibration.m_position[0];
+	pOut->sensorPosition[1] = calibration.m_position[1];
+	pOut->sensorPosition[2] = calibration.m_position[2];
+	pOut->skeletonCount = 0;
+
+	for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+	{
+		if ( NUI_SKELETON_NOT_TRACKED == batch.trackingState[i] )
+		{
+			continue;
+		}
+
+		SensorSkeleton & out = pOut->skeletons[pOut->skeletonCount++];
+		out.trackingId = batch.trackingId[i];
+		out.trackingState = batch.trackingState[i];
+		calibration.Transform( batch.position[i], out.position );
+		calibration.TransformBatch( batch.GetX( i ), batch.GetY( i ), batch.GetZ( i ), out.jointX, out.jointY, out.jointZ, MERGE_JOINT_COUNT );
+
+		for ( int j = 0; j < MERGE_JOINT_COUNT; j++ )
+		{
+			out.jointState[j] = batch.GetJointState( i, j );
+		}
+	}
+
+	m_merger.EndSubmit( sensor.m_index );
+	start = m_metrics.Record( STAGE_TRANSFORM, start );
+
+	// the first unanswered wake is timed, later ones are answered by the same pass
+	InterlockedCompareExchange64( &m_mergeSignalTime, start, 0 );
+	SetEvent( m_hEvMergeWake );
+
+	return true;
 }
 
 /// <summary>
 /// Handle new depth data
 /// </summary>
+/// <param name="sensor">sensor the frame is from</param>
 /// <returns>true if a frame was processed, false otherwise</returns>
-bool TrackerApp::Nui_GotDepthAlert( )
+bool TrackerApp::Nui_GotDepthAlert( SensorContext & sensor )
 {
 	NUI_IMAGE_FRAME imageFrame;
 	bool processedFrame = true;
+	long long start = PipelineMetrics::Now();
 
-	HRESULT hr = m_pNuiSensor->NuiImageStreamGetNextFrame(
-		m_pDepthStreamHandle,
+	HRESULT hr = sensor.m_pNuiSensor->NuiImageStreamGetNextFrame(
+		sensor.m_pDepthStreamHandle,
 		0,
 		&imageFrame );
 
 	if ( FAILED( hr ) )
 	{
+		m_metrics.OnFrameDropped( sensor.m_index, FRAME_STREAM_DEPTH, FRAME_DROP_FETCH );
 		return false;
 	}
+	m_metrics.OnFrame( sensor.m_index, FRAME_STREAM_DEPTH, imageFrame.dwFrameNumber );
+
+	// the sensor is streaming, whether or not the preview manages to draw the frame
+	sensor.m_recovery.OnFrame( static_cast<long long>(GetTickCount64()) );
+
+	// the depth frames are on the same sensor clock, twice the samples
+	long long captureTime = sensor.m_clock.Update( imageFrame.liTimeStamp.QuadPart, m_metrics.ToMicroseconds( start ) );
+	start = m_metrics.Record( STAGE_FETCH, start );
+
+	// only the primary sensor is previewed, the others only need their skeletons and clouds
+	if ( 0 != sensor.m_index )
+	{
+		TrackerConfigSnapshot config( m_config, sensor.m_index );
+		if ( config->pointCloudEnabled )
+		{
+			DWORD frameWidth, frameHeight;
+			NuiImageResolutionToSize( imageFrame.eResolution, frameWidth, frameHeight );
+
+			NUI_LOCKED_RECT LockedRect;
+			imageFrame.pFrameTexture->LockRect( 0, &LockedRect, NULL, 0 );
+			if ( 0 != LockedRect.Pitch )
+			{
+				Nui_ProcessPointCloud( sensor, *config, (const USHORT *)LockedRect.pBits, frameWidth, frameHeight,
+									   imageFrame.dwFrameNumber, captureTime );
+				m_metrics.Record( STAGE_DEPTH, start );
+			}
+			imageFrame.pFrameTexture->UnlockRect( 0 );
+		}
+
+		sensor.m_pNuiSensor->NuiImageStreamReleaseFrame( sensor.m_pDepthStreamHandle, &imageFrame );
+		return true;
+	}
 
 	INuiFrameTexture * pTexture = imageFrame.pFrameTexture;
 	NUI_LOCKED_RECT LockedRect;
 	pTexture->LockRect( 0, &LockedRect, NULL, 0 );
-	if ( 0 != LockedRect.Pitch )
-	{
-		DWORD frameWidth, frameHeight;
 
-		NuiImageResolutionToSize( imageFrame.eResolution, frameWidth, frameHeight );
+	DWORD frameWidth, frameHeight;
+	NuiImageResolutionToSize( imageFrame.eResolution, frameWidth, frameHeight );
+
+	// a pooled buffer for the converted frame, released when this function returns: the
+	// preview copies it into its bitmap, and no stage keeps it beyond that
+	FrameHandle frame( m_depthFrames.Acquire() );
+	if ( !frame.IsValid() || frameWidth * frameHeight * g_BytesPerPixel > frame->GetSize() )
+	{
+		m_metrics.OnFrameDropped( sensor.m_index, FRAME_STREAM_DEPTH, FRAME_DROP_BUFFER );
+		processedFrame = false;
+	}
+	else if ( 0 != LockedRect.Pitch )
+	{
+		frame->width = frameWidth;
+		frame->height = frameHeight;
+		frame->stride = frameWidth * g_BytesPerPixel;
+		frame->frameNumber = imageFrame.dwFrameNumber;
+		frame->captureTime = captureTime;
 
 		// draw the bits to the bitmap
-		BYTE * rgbrun = m_depthRGBX;
+		BYTE * rgbrun = frame->GetData();
 		const USHORT * pBufferRun = (const USHORT *)LockedRect.pBits;
 
 		// end pixel is start + width*height - 1
 		const USHORT * pBufferEnd = pBufferRun + (frameWidth * frameHeight);
 
-		assert( frameWidth * frameHeight * g_BytesPerPixel <= ARRAYSIZE(m_depthRGBX) );
-
 		while ( pBufferRun < pBufferEnd )
 		{
 			USHORT depth     = *pBufferRun;
@@ -477,33 +670,78 @@ bool TrackerApp::Nui_GotDepthAlert( )
 			++pBufferRun;
 		}
 
-		NUI_SKELETON_FRAME SkeletonFrame;
-		hr = m_pNuiSensor->NuiSkeletonGetNextFrame( 0, &SkeletonFrame );
+		// one snapshot for the whole frame, the UI may publish a new one meanwhile
+		TrackerConfigSnapshot config( m_config, sensor.m_index );
 
-		// smooth out the skeleton data
-		HRESULT hr = m_pNuiSensor->NuiTransformSmooth(&SkeletonFrame,&m_smoothParams);
+		Nui_ProcessPointCloud( sensor, *config, (const USHORT *)LockedRect.pBits, frameWidth, frameHeight,
+							   imageFrame.dwFrameNumber, captureTime );
+		m_metrics.Record( STAGE_DEPTH, start );
 
-		RECT rct;
-		GetClientRect( GetDlgItem( m_hWnd, IDC_DEPTHVIEWER ), &rct);
-		int width = rct.right;
-		int height = rct.bottom;
-
-		m_pDrawDepth->ProcessSkeletonFrame( m_depthRGBX, frameWidth * frameHeight * g_BytesPerPixel, SkeletonFrame, m_pNuiSensor, 640, 480, m_ipAddress, m_port);
+		// skeletons are drawn on top of the depth bitmap, in its pixel space,
+		// using the latest frame Nui_GotSkeletonAlert smoothed on this thread
+		if ( m_pDrawDepth->ProcessSkeletonFrame( frame->GetData(), frameWidth * frameHeight * g_BytesPerPixel, sensor.m_SkeletonBatch, sensor.m_SkeletonCaptureTime,
+												 config->calibration[sensor.m_index], config->eyeModel, sensor.m_pNuiSensor, frameWidth, frameHeight ) )
+		{
+			sensor.m_SkeletonFramePending = false;
+		}
+		else
+		{
+			m_metrics.OnFrameDropped( sensor.m_index, FRAME_STREAM_DEPTH, FRAME_DROP_RENDER );
+		}
 	}
 
 	else
 	{
+		m_metrics.OnFrameDropped( sensor.m_index, FRAME_STREAM_DEPTH, FRAME_DROP_DEPTH );
 		processedFrame = false;
 		OutputDebugString( L"Buffer length of received texture is bogus\r\n" );
 	}
 
 	pTexture->UnlockRect( 0 );
 
-	m_pNuiSensor->NuiImageStreamReleaseFrame( m_pDepthStreamHandle, &imageFrame );
+	sensor.m_pNuiSensor->NuiImageStreamReleaseFrame( sensor.m_pDepthStreamHandle, &imageFrame );
 
 	return processedFrame;
 }
 
+/// <summary>
+/// Convert a depth frame to the sensor's point cloud and record it, while a recording
+/// is configured. Sensor thread only
+/// </summary>
+/// <param name="sensor">sensor the frame is from</param>
+/// <param name="config">snapshot the frame is processed with</param>
+/// <param name="pDepth">packed depth pixels of the frame</param>
+/// <param name="width">width (in pixels) of the frame</param>
+/// <param name="height">height (in pixels) of the frame</param>
+/// <param name="frameNumber">depth frame number</param>
+/// <param name="captureTime">capture time of the frame, host microseconds</param>
+void TrackerApp::Nui_ProcessPointCloud( SensorContext & sensor, const TrackerConfig & config, const USHORT * pDepth,
+										DWORD width, DWORD height, DWORD frameNumber, long long captureTime )
+{
+	// a recording that failed is off before the UI thread publishes it
+	if ( !config.pointCloudEnabled || !m_pointCloudRecorder.IsOpen() )
+	{
+		return;
+	}
+
+	// the cloud takes the size of the frames the sensor delivers
+	PointCloud & cloud = sensor.m_pointCloud;
+	if ( width != cloud.GetWidth() || height != cloud.GetHeight() )
+	{
+		// once per sensor, whenever recording is first turned on
+		AllocationExemption exemption;
+		if ( FAILED( cloud.Initialize( width, height ) ) )
+		{
+			return;
+		}
+	}
+
+	cloud.SetPlayerFilter( config.pointCloudPlayer );
+	cloud.SetVoxelSize( config.pointCloudVoxelSize );
+	cloud.Process( pDepth, config.calibration[sensor.m_index] );
+	m_pointCloudRecorder.Write( sensor.m_index, frameNumber, captureTime, cloud );
+}
+
 
 
 
@@ -517,17 +755,7 @@ bool TrackerApp::Nui_GotDepthAlert( )
 /// <returns>point in screen-space</returns>
 D2D1_POINT_2F TrackerApp::SkeletonToScreen( Vector4 skeletonPoint, int width, int height )
 {
-	LONG x, y;
-	USHORT depth;
-
-	// calculate the skeleton's position on the screen
-	// NuiTransformSkeletonToDepthImage returns coordinates in NUI_IMAGE_RESOLUTION_320x240 space
-	NuiTransformSkeletonToDepthImage( skeletonPoint, &x, &y, &depth );
-
-	float screenPointX = static_cast<float>(x * width) / g_ScreenWidth;
-	float screenPointY = static_cast<float>(y * height) / g_ScreenHeight;
-
-	return D2D1::Point2F(screenPointX, screenPointY);
+	return m_projector.Project( skeletonPoint, width, height );
 }
 
 
@@ -586,20 +814,17 @@ void TrackerApp::UpdateSkeletonTrackingFlag( DWORD flag, bool value )
 		newFlags &= ~flag;
 	}
 
-	if (NULL != m_pNuiSensor && newFlags != m_SkeletonTrackingFlags)
+	if (NULL != m_pSensors[0] && m_pSensors[0]->IsOpen() && newFlags != m_SkeletonTrackingFlags)
 	{
-		if ( !HasSkeletalEngine(m_pNuiSensor) )
-		{
-			MessageBoxResource(IDS_ERROR_SKELETONTRACKING, MB_OK | MB_ICONHAND);
-		}
-
 		m_SkeletonTrackingFlags = newFlags;
 
-		HRESULT hr = m_pNuiSensor->NuiSkeletonTrackingEnable( m_hNextSkeletonEvent, m_SkeletonTrackingFlags );
-
-		if ( FAILED( hr ) )
+		// the processing threads apply them, the primary posts WM_USER_SENSOR_ERROR if it fails
+		for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
 		{
-			MessageBoxResource(IDS_ERROR_SKELETONTRACKING, MB_OK | MB_ICONHAND);
+			if ( NULL != m_pSensors[i] )
+			{
+				m_pSensors[i]->SetSkeletonTrackingFlags( m_SkeletonTrackingFlags );
+			}
 		}
 	}
 }
@@ -622,10 +847,16 @@ void TrackerApp::UpdateDepthStreamFlag( DWORD flag, bool value )
 		newFlags &= ~flag;
 	}
 
-	if (NULL != m_pNuiSensor && newFlags != m_DepthStreamFlags)
+	if (NULL != m_pSensors[0] && m_pSensors[0]->IsOpen() && newFlags != m_DepthStreamFlags)
 	{
 		m_DepthStreamFlags = newFlags;
-		m_pNuiSensor->NuiImageStreamSetImageFrameFlags( m_pDepthStreamHandle, m_DepthStreamFlags );
+		for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+		{
+			if ( NULL != m_pSensors[i] )
+			{
+				m_pSensors[i]->SetDepthStreamFlags( m_DepthStreamFlags );
+			}
+		}
 	}
 }
 
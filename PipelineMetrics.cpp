@@ -0,0 +1,566 @@
+//------------------------------------------------------------------------------
+// <copyright file="PipelineMetrics.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the pipeline metrics. An HTTP request to the port, e.g.
+// "curl http://localhost:9100/metrics", is answered with every histogram, a request for
+// /trace with the trace, and the connection is closed.
+//
+// Receivers measuring the latency echo the header of every sequenced datagram (PosePacket.h).
+// The header holds the send time and how long after the capture that was, both on this
+// machine's clock, so an echo gives the round trip; half of it is taken as the one-way
+// network time, which holds for the symmetric paths of a local network.
+
+#include "stdafx.h"
+#include "PipelineMetrics.h"
+#include "PosePacket.h"
+#include <strsafe.h>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+// Frame events of a stream in the trace: skipped, duplicate, then one per FrameDropStage
+static const int g_FrameEventCount = 2 + FRAME_DROP_STAGE_COUNT;
+
+// Names of the trace events, the PipelineStage values first, which also name the stage label,
+// then g_FrameEventCount frame events per FrameStream
+static const char * const g_EventNames[STAGE_COUNT + FRAME_STREAM_COUNT * g_FrameEventCount] =
+{
+	"wake", "fetch", "depth", "smooth", "transform", "fuse", "select", "encode", "overlay", "send", "render", "present",
+	"depth skipped", "depth duplicate", "depth dropped: fetch", "depth dropped: depth", "depth dropped: merge", "depth dropped: send", "depth dropped: render", "depth dropped: buffer",
+	"skeleton skipped", "skeleton duplicate", "skeleton dropped: fetch", "skeleton dropped: depth", "skeleton dropped: merge", "skeleton dropped: send", "skeleton dropped: render", "skeleton dropped: buffer"
+};
+
+// Names of the FrameStream and FrameDropStage values in the stream and stage labels
+static const char * const g_FrameStreamNames[FRAME_STREAM_COUNT] = { "depth", "skeleton" };
+static const char * const g_FrameDropStageNames[FRAME_DROP_STAGE_COUNT] = { "fetch", "depth", "merge", "send", "render", "buffer" };
+
+// Names of the PipelineLatency values in the path label
+static const char * const g_LatencyNames[LATENCY_COUNT] = { "capture_to_send", "capture_to_receive", "round_trip" };
+
+// Echoes of datagrams sent longer ago (microseconds) are stale or not echoes at all
+static const unsigned int g_MaxRoundTrip = 10000000;
+
+// Longest wait (ms) for a connection or a request, so stop requests are still seen
+static const int g_MetricsPollInterval = 100;
+
+// Records timed to measure what one costs
+static const int g_OverheadSamples = 10000;
+
+static const char g_ResponseHeader[] = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n";
+static const char g_TraceResponseHeader[] = "HTTP/1.0 200 OK\r\nContent-Type: application/json\r\nConnection: close\r\n\r\n";
+static const char g_TraceRequest[] = "GET /trace";
+
+/// <summary>
+/// Constructor
+/// </summary>
+PipelineMetrics::PipelineMetrics() :
+	m_overhead(0),
+	m_listenSocket(INVALID_SOCKET),
+	m_echoSocket(INVALID_SOCKET),
+	m_hThServer(NULL),
+	m_hEvServerStop(NULL)
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency( &frequency );
+	m_nanosecondsPerTick = 1.0e9 / static_cast<double>(frequency.QuadPart);
+
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		m_recoveries[i] = 0;
+		m_lastRecoveryMs[i] = 0;
+		m_maxRecoveryMs[i] = 0;
+	}
+
+	MeasureOverhead();
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+PipelineMetrics::~PipelineMetrics()
+{
+	Stop();
+}
+
+/// <summary>
+/// Time Record itself takes, so readers know what the instrumentation costs
+/// </summary>
+void PipelineMetrics::MeasureOverhead( )
+{
+	LatencyHistogram scratch;
+
+	long long start = Now();
+	long long previous = start;
+	for ( int i = 0; i < g_OverheadSamples; i++ )
+	{
+		long long now = Now();
+		scratch.Record( static_cast<unsigned long long>( ( now - previous ) * m_nanosecondsPerTick ) );
+		previous = now;
+	}
+
+	m_overhead = static_cast<unsigned long long>( ( Now() - start ) * m_nanosecondsPerTick / g_OverheadSamples );
+}
+
+/// <summary>
+/// Start or stop tracing the stages, see FrameTrace.h
+/// </summary>
+/// <param name="enabled">trace the stages</param>
+/// <param name="thresholdMs">a stage taking longer writes the trace to a file, 0 for never</param>
+void PipelineMetrics::EnableTracing( bool enabled, unsigned int thresholdMs )
+{
+	m_tracer.Enable( enabled, static_cast<long long>( thresholdMs * 1.0e6 / m_nanosecondsPerTick ), g_EventNames );
+}
+
+/// <summary>
+/// Count a frame read from a sensor, and trace a gap or a duplicate. Only the thread
+/// reading the stream
+/// </summary>
+/// <param name="sensor">index of the sensor</param>
+/// <param name="stream">stream it is from</param>
+/// <param name="frameNumber">dwFrameNumber of the frame</param>
+/// <returns>how the number follows the previous one</returns>
+FrameCheck PipelineMetrics::OnFrame( int sensor, FrameStream stream, unsigned int frameNumber )
+{
+	unsigned int skipped;
+	FrameCheck check = m_frames[sensor].OnFrame( stream, frameNumber, skipped );
+
+	if ( m_tracer.IsEnabled() && ( FRAME_SKIPPED == check || FRAME_DUPLICATE == check ) )
+	{
+		int event = ( FRAME_SKIPPED == check ) ? 0 : 1;
+		m_tracer.AddInstant( STAGE_COUNT + stream * g_FrameEventCount + event, Now() );
+	}
+	return check;
+}
+
+/// <summary>
+/// Count and trace frames the pipeline dropped. Any thread, never blocks
+/// </summary>
+/// <param name="sensor">index of the sensor</param>
+/// <param name="stream">stream they are from</param>
+/// <param name="stage">stage that dropped them</param>
+/// <param name="count">number of frames</param>
+void PipelineMetrics::OnFrameDropped( int sensor, FrameStream stream, FrameDropStage stage, unsigned int count )
+{
+	m_frames[sensor].OnDropped( stream, stage, count );
+
+	if ( m_tracer.IsEnabled() )
+	{
+		m_tracer.AddInstant( STAGE_COUNT + stream * g_FrameEventCount + 2 + stage, Now() );
+	}
+}
+
+/// <summary>
+/// Count a lost sensor coming back. Only the sensor's processing thread
+/// </summary>
+/// <param name="sensor">index of the sensor</param>
+/// <param name="milliseconds">time from losing the sensor until it streamed again</param>
+void PipelineMetrics::OnSensorRecovered( int sensor, long long milliseconds )
+{
+	// a single writer, so the maximum needs no compare exchange
+	m_lastRecoveryMs[sensor] = milliseconds;
+	if ( milliseconds > m_maxRecoveryMs[sensor] )
+	{
+		m_maxRecoveryMs[sensor] = milliseconds;
+	}
+	m_recoveries[sensor]++;
+}
+
+/// <summary>
+/// Serve the metrics over HTTP on the loopback interface, on a thread of its own, and
+/// optionally take the echoes of receivers measuring the latency
+/// </summary>
+/// <param name="port">TCP port</param>
+/// <param name="echoPort">UDP port receivers send the echoes to, on every interface, 0 for none</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT PipelineMetrics::Start( unsigned short port, unsigned short echoPort )
+{
+	Stop();
+
+	m_listenSocket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	if ( INVALID_SOCKET == m_listenSocket )
+	{
+		return HRESULT_FROM_WIN32( WSAGetLastError() );
+	}
+
+	// scraped from this machine only, e.g. by a local Prometheus agent
+	sockaddr_in server;
+	ZeroMemory( &server, sizeof(server) );
+	server.sin_family = AF_INET;
+	server.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	server.sin_port = htons( port );
+
+	if ( SOCKET_ERROR == bind( m_listenSocket, (sockaddr *)&server, sizeof(server) ) ||
+		 SOCKET_ERROR == listen( m_listenSocket, SOMAXCONN ) )
+	{
+		HRESULT hr = HRESULT_FROM_WIN32( WSAGetLastError() );
+		closesocket( m_listenSocket );
+		m_listenSocket = INVALID_SOCKET;
+		return hr;
+	}
+
+	// receivers on other machines echo too, so this one takes every interface
+	if ( 0 != echoPort )
+	{
+		m_echoSocket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+		server.sin_addr.s_addr = htonl( INADDR_ANY );
+		server.sin_port = htons( echoPort );
+
+		u_long nonBlocking = 1;
+		if ( INVALID_SOCKET == m_echoSocket ||
+			 SOCKET_ERROR == ioctlsocket( m_echoSocket, FIONBIO, &nonBlocking ) ||
+			 SOCKET_ERROR == bind( m_echoSocket, (sockaddr *)&server, sizeof(server) ) )
+		{
+			HRESULT hr = HRESULT_FROM_WIN32( WSAGetLastError() );
+			Stop();
+			return hr;
+		}
+	}
+
+	m_hEvServerStop = CreateEvent( NULL, FALSE, FALSE, NULL );
+	m_hThServer = CreateThread( NULL, 0, ServerThread, this, 0, NULL );
+	if ( NULL == m_hThServer )
+	{
+		HRESULT hr = HRESULT_FROM_WIN32( GetLastError() );
+		Stop();
+		return hr;
+	}
+
+	return S_OK;
+}
+
+/// <summary>
+/// Stop serving and taking echoes, the histograms keep counting
+/// </summary>
+void PipelineMetrics::Stop( )
+{
+	if ( NULL != m_hEvServerStop )
+	{
+		// Signal the thread
+		SetEvent( m_hEvServerStop );
+
+		// Wait for thread to stop
+		if ( NULL != m_hThServer )
+		{
+			WaitForSingleObject( m_hThServer, INFINITE );
+			CloseHandle( m_hThServer );
+			m_hThServer = NULL;
+		}
+		CloseHandle( m_hEvServerStop );
+		m_hEvServerStop = NULL;
+	}
+
+	if ( INVALID_SOCKET != m_listenSocket )
+	{
+		closesocket( m_listenSocket );
+		m_listenSocket = INVALID_SOCKET;
+	}
+
+	if ( INVALID_SOCKET != m_echoSocket )
+	{
+		closesocket( m_echoSocket );
+		m_echoSocket = INVALID_SOCKET;
+	}
+}
+
+/// <summary>
+/// Thread serving the endpoint, calls class instance thread processor
+/// </summary>
+/// <param name="pParam">instance pointer</param>
+/// <returns>always 0</returns>
+DWORD WINAPI PipelineMetrics::ServerThread( LPVOID pParam )
+{
+	PipelineMetrics *pthis = (PipelineMetrics *)pParam;
+	return pthis->ServerThread( );
+}
+
+/// <summary>
+/// Thread serving the endpoint
+/// </summary>
+/// <returns>always 0</returns>
+DWORD WINAPI PipelineMetrics::ServerThread( )
+{
+	while ( WAIT_OBJECT_0 != WaitForSingleObject( m_hEvServerStop, 0 ) )
+	{
+		WSAPOLLFD fds[2];
+		fds[0].fd = m_listenSocket;
+		fds[0].events = POLLRDNORM;
+		fds[0].revents = 0;
+		fds[1].fd = m_echoSocket;
+		fds[1].events = POLLRDNORM;
+		fds[1].revents = 0;
+
+		int ready = WSAPoll( fds, ( INVALID_SOCKET != m_echoSocket ) ? 2 : 1, g_MetricsPollInterval );
+		if ( SOCKET_ERROR == ready )
+		{
+			// do not spin on a persistent error, the wait resets the stop event when it sees it
+			if ( WAIT_OBJECT_0 == WaitForSingleObject( m_hEvServerStop, g_MetricsPollInterval ) )
+			{
+				break;
+			}
+			continue;
+		}
+
+		// an error is read like an echo, so it is cleared rather than reported again at once
+		if ( 0 != fds[1].revents )
+		{
+			ReceiveEchoes();
+		}
+
+		if ( 0 == fds[0].revents )
+		{
+			continue;
+		}
+
+		SOCKET s = accept( m_listenSocket, NULL, NULL );
+		if ( INVALID_SOCKET != s )
+		{
+			Serve( s );
+			closesocket( s );
+		}
+	}
+
+	return 0;
+}
+
+/// <summary>
+/// Answer one HTTP request with the metrics, or with the trace for /trace
+/// </summary>
+/// <param name="s">accepted connection</param>
+void PipelineMetrics::Serve( SOCKET s )
+{
+	// scrapes are rare, a client that does not send its request in time gets nothing
+	DWORD timeout = g_MetricsPollInterval;
+	setsockopt( s, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout) );
+	setsockopt( s, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout) );
+
+	// only the path matters, every other path gets the metrics
+	char request[1024];
+	int received = recv( s, request, sizeof(request), 0 );
+	if ( received <= 0 )
+	{
+		return;
+	}
+
+	std::string response;
+	if ( received >= static_cast<int>(sizeof(g_TraceRequest)) - 1 && 0 == memcmp( request, g_TraceRequest, sizeof(g_TraceRequest) - 1 ) )
+	{
+		response = g_TraceResponseHeader;
+		m_tracer.Format( response );
+	}
+	else
+	{
+		response = g_ResponseHeader;
+		Format( response );
+	}
+
+	const char * pData = response.c_str();
+	int remaining = static_cast<int>(response.size());
+	while ( remaining > 0 )
+	{
+		int sent = send( s, pData, remaining, 0 );
+		if ( SOCKET_ERROR == sent )
+		{
+			return;
+		}
+		pData += sent;
+		remaining -= sent;
+	}
+
+	shutdown( s, SD_SEND );
+}
+
+/// <summary>
+/// Count the latency of every echo waiting on the echo socket
+/// </summary>
+void PipelineMetrics::ReceiveEchoes( )
+{
+	unsigned char echo[POSE_ECHO_SIZE + 1];
+
+	while ( true )
+	{
+		int received = recv( m_echoSocket, (char *)echo, sizeof(echo), 0 );
+		if ( SOCKET_ERROR == received )
+		{
+			// WSAEWOULDBLOCK once every echo is read, anything else waits for the next poll
+			return;
+		}
+
+		// time it came back first, the clock is what is measured
+		unsigned int now = static_cast<unsigned int>( ToMicroseconds( Now() ) );
+		if ( POSE_ECHO_SIZE != received )
+		{
+			continue;
+		}
+
+		unsigned int sendTime;
+		unsigned int captureToSend;
+		PosePacketReadTiming( echo, sendTime, captureToSend );
+
+		// the send time wraps every 71 minutes, the difference of two does not
+		unsigned int roundTrip = now - sendTime;
+		unsigned int holdTime = PoseEchoReadHoldTime( echo );
+		if ( roundTrip > g_MaxRoundTrip || holdTime > roundTrip )
+		{
+			continue;
+		}
+		roundTrip -= holdTime;
+
+		RecordLatency( LATENCY_ROUND_TRIP, roundTrip );
+		if ( POSE_PACKET_NO_CAPTURE != captureToSend )
+		{
+			RecordLatency( LATENCY_CAPTURE_TO_RECEIVE, static_cast<long long>(captureToSend) + roundTrip / 2 );
+		}
+	}
+}
+
+/// <summary>
+/// Write every histogram in the Prometheus text format
+/// </summary>
+/// <param name="text">receives the metrics, appended</param>
+void PipelineMetrics::Format( std::string & text ) const
+{
+	static const char * quantileNames[3] = { "0.5", "0.99", "0.999" };
+
+	char line[256];
+	LatencySnapshot snapshots[STAGE_COUNT];
+	for ( int i = 0; i < STAGE_COUNT; i++ )
+	{
+		m_stages[i].GetSnapshot( snapshots[i] );
+	}
+
+	text += "# HELP kinect_tracker_stage_latency_seconds Time each pipeline stage took.\n";
+	text += "# TYPE kinect_tracker_stage_latency_seconds summary\n";
+	for ( int i = 0; i < STAGE_COUNT; i++ )
+	{
+		const LatencySnapshot & snapshot = snapshots[i];
+		unsigned long long quantiles[3] = { snapshot.p50, snapshot.p99, snapshot.p999 };
+
+		for ( int q = 0; q < 3; q++ )
+		{
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_stage_latency_seconds{stage=\"%s\",quantile=\"%s\"} %.9f\n",
+							  g_EventNames[i], quantileNames[q], quantiles[q] * 1.0e-9 );
+			text += line;
+		}
+		StringCchPrintfA( line, _countof(line), "kinect_tracker_stage_latency_seconds_sum{stage=\"%s\"} %.9f\n", g_EventNames[i], snapshot.sum * 1.0e-9 );
+		text += line;
+		StringCchPrintfA( line, _countof(line), "kinect_tracker_stage_latency_seconds_count{stage=\"%s\"} %I64u\n", g_EventNames[i], snapshot.count );
+		text += line;
+	}
+
+	text += "# HELP kinect_tracker_stage_latency_max_seconds Longest time each pipeline stage took.\n";
+	text += "# TYPE kinect_tracker_stage_latency_max_seconds gauge\n";
+	for ( int i = 0; i < STAGE_COUNT; i++ )
+	{
+		StringCchPrintfA( line, _countof(line), "kinect_tracker_stage_latency_max_seconds{stage=\"%s\"} %.9f\n", g_EventNames[i], snapshots[i].max * 1.0e-9 );
+		text += line;
+	}
+
+	LatencySnapshot latencies[LATENCY_COUNT];
+	for ( int i = 0; i < LATENCY_COUNT; i++ )
+	{
+		m_latencies[i].GetSnapshot( latencies[i] );
+	}
+
+	text += "# HELP kinect_tracker_latency_seconds Time from the sensor capturing a frame to the network and to the receivers.\n";
+	text += "# TYPE kinect_tracker_latency_seconds summary\n";
+	for ( int i = 0; i < LATENCY_COUNT; i++ )
+	{
+		const LatencySnapshot & snapshot = latencies[i];
+		unsigned long long quantiles[3] = { snapshot.p50, snapshot.p99, snapshot.p999 };
+
+		for ( int q = 0; q < 3; q++ )
+		{
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_latency_seconds{path=\"%s\",quantile=\"%s\"} %.9f\n",
+							  g_LatencyNames[i], quantileNames[q], quantiles[q] * 1.0e-9 );
+			text += line;
+		}
+		StringCchPrintfA( line, _countof(line), "kinect_tracker_latency_seconds_sum{path=\"%s\"} %.9f\n", g_LatencyNames[i], snapshot.sum * 1.0e-9 );
+		text += line;
+		StringCchPrintfA( line, _countof(line), "kinect_tracker_latency_seconds_count{path=\"%s\"} %I64u\n", g_LatencyNames[i], snapshot.count );
+		text += line;
+	}
+
+	text += "# HELP kinect_tracker_latency_max_seconds Longest time from the sensor capturing a frame to the network and to the receivers.\n";
+	text += "# TYPE kinect_tracker_latency_max_seconds gauge\n";
+	for ( int i = 0; i < LATENCY_COUNT; i++ )
+	{
+		StringCchPrintfA( line, _countof(line), "kinect_tracker_latency_max_seconds{path=\"%s\"} %.9f\n", g_LatencyNames[i], latencies[i].max * 1.0e-9 );
+		text += line;
+	}
+
+	// sensors that never delivered a frame are left out
+	FrameCounts frames[MERGE_MAX_SENSORS][FRAME_STREAM_COUNT];
+	bool active[MERGE_MAX_SENSORS];
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		active[i] = false;
+		for ( int s = 0; s < FRAME_STREAM_COUNT; s++ )
+		{
+			m_frames[i].GetCounts( static_cast<FrameStream>(s), frames[i][s] );
+			active[i] = active[i] || 0 != frames[i][s].received || 0 != frames[i][s].dropped[FRAME_DROP_FETCH];
+		}
+		active[i] = active[i] || 0 != m_recoveries[i];
+	}
+
+	text += "# HELP kinect_tracker_frames_total Frames each sensor stream delivered, frame numbers it skipped and frames read twice.\n";
+	text += "# TYPE kinect_tracker_frames_total counter\n";
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		for ( int s = 0; active[i] && s < FRAME_STREAM_COUNT; s++ )
+		{
+			const FrameCounts & counts = frames[i][s];
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_frames_total{sensor=\"%d\",stream=\"%s\",kind=\"received\"} %I64u\n", i, g_FrameStreamNames[s], counts.received );
+			text += line;
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_frames_total{sensor=\"%d\",stream=\"%s\",kind=\"skipped\"} %I64u\n", i, g_FrameStreamNames[s], counts.skipped );
+			text += line;
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_frames_total{sensor=\"%d\",stream=\"%s\",kind=\"duplicate\"} %I64u\n", i, g_FrameStreamNames[s], counts.duplicates );
+			text += line;
+		}
+	}
+
+	text += "# HELP kinect_tracker_frames_dropped_total Frames the pipeline dropped, by the stage that dropped them.\n";
+	text += "# TYPE kinect_tracker_frames_dropped_total counter\n";
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		for ( int s = 0; active[i] && s < FRAME_STREAM_COUNT; s++ )
+		{
+			for ( int d = 0; d < FRAME_DROP_STAGE_COUNT; d++ )
+			{
+				StringCchPrintfA( line, _countof(line), "kinect_tracker_frames_dropped_total{sensor=\"%d\",stream=\"%s\",stage=\"%s\"} %I64u\n",
+								  i, g_FrameStreamNames[s], g_FrameDropStageNames[d], frames[i][s].dropped[d] );
+				text += line;
+			}
+		}
+	}
+
+	text += "# HELP kinect_tracker_sensor_recoveries_total Times a lost sensor came back and streamed again.\n";
+	text += "# TYPE kinect_tracker_sensor_recoveries_total counter\n";
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		if ( active[i] )
+		{
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_sensor_recoveries_total{sensor=\"%d\"} %I64u\n", i, m_recoveries[i].load() );
+			text += line;
+		}
+	}
+
+	text += "# HELP kinect_tracker_sensor_recovery_seconds Time from losing a sensor until it streamed again, of the last recovery and the longest.\n";
+	text += "# TYPE kinect_tracker_sensor_recovery_seconds gauge\n";
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		if ( active[i] )
+		{
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_sensor_recovery_seconds{sensor=\"%d\",kind=\"last\"} %.3f\n", i, m_lastRecoveryMs[i] * 1.0e-3 );
+			text += line;
+			StringCchPrintfA( line, _countof(line), "kinect_tracker_sensor_recovery_seconds{sensor=\"%d\",kind=\"max\"} %.3f\n", i, m_maxRecoveryMs[i] * 1.0e-3 );
+			text += line;
+		}
+	}
+
+	text += "# HELP kinect_tracker_instrumentation_overhead_seconds Time one stage measurement costs.\n";
+	text += "# TYPE kinect_tracker_instrumentation_overhead_seconds gauge\n";
+	StringCchPrintfA( line, _countof(line), "kinect_tracker_instrumentation_overhead_seconds %.9f\n", m_overhead * 1.0e-9 );
+	text += line;
+}
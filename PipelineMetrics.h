@@ -0,0 +1,222 @@
+//------------------------------------------------------------------------------
+// <copyright file="PipelineMetrics.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the latency histograms of the pipeline stages and of the sensor to receiver
+// path, the frame accounting of every sensor, the optional trace of the stages and frame
+// drops, and the local HTTP endpoint that serves them
+
+#pragma once
+
+#include <winsock2.h>
+#include <string>
+#include <atomic>
+#include "LatencyHistogram.h"
+#include "FrameTrace.h"
+#include "FrameAccounting.h"
+#include "SkeletonMerge.h"
+
+enum PipelineStage
+{
+	STAGE_WAKE = 0,         // a sensor signalled a frame until the merge thread ran
+	STAGE_FETCH,            // NuiSkeletonGetNextFrame and NuiImageStreamGetNextFrame
+	STAGE_DEPTH,            // depth frame to preview bitmap and point cloud
+	STAGE_SMOOTH,           // NuiTransformSmooth
+	STAGE_TRANSFORM,        // skeleton to the display frame
+	STAGE_FUSE,             // merge and fusion of every sensor's skeletons
+	STAGE_SELECT,           // choosing the users the sensor tracks
+	STAGE_ENCODE,           // tracked joints to the display frame, eyes and bones, active user's stream values
+	STAGE_OVERLAY,          // skeletons of the preview into its lists, drawn
+	STAGE_SEND,             // every destination
+	STAGE_RENDER,           // preview drawing, select, encode and present included, send excluded
+	STAGE_PRESENT,          // EndDraw
+	STAGE_COUNT
+};
+
+enum PipelineLatency
+{
+	LATENCY_CAPTURE_TO_SEND = 0,    // sensor capture until the frame is handed to the network
+	LATENCY_CAPTURE_TO_RECEIVE,     // sensor capture until a receiver had it, from the echoes
+	LATENCY_ROUND_TRIP,             // send until the echo was back, receiver hold time excluded
+	LATENCY_COUNT
+};
+
+class PipelineMetrics
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	PipelineMetrics();
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~PipelineMetrics();
+
+	/// <summary>
+	/// Current time of the high-resolution clock
+	/// </summary>
+	/// <returns>ticks, see Record</returns>
+	static long long        Now( )
+	{
+		LARGE_INTEGER now;
+		QueryPerformanceCounter( &now );
+		return now.QuadPart;
+	}
+
+	/// <summary>
+	/// Count the time a stage took, and trace it if tracing is on. Any thread, never blocks
+	/// </summary>
+	/// <param name="stage">stage that ended</param>
+	/// <param name="start">Now when the stage started</param>
+	/// <param name="excluded">ticks of nested stages counted on their own, left out of the histogram</param>
+	/// <returns>Now, the start of whatever comes next</returns>
+	long long               Record( PipelineStage stage, long long start, long long excluded = 0 )
+	{
+		long long now = Now();
+		long long ticks = now - start - excluded;
+		m_stages[stage].Record( ( ticks > 0 ) ? static_cast<unsigned long long>( ticks * m_nanosecondsPerTick ) : 0 );
+
+		if ( m_tracer.IsEnabled() )
+		{
+			m_tracer.Add( stage, start, now );
+		}
+		return now;
+	}
+
+	/// <summary>
+	/// Count an end-to-end latency. Any thread, never blocks
+	/// </summary>
+	/// <param name="latency">path measured</param>
+	/// <param name="microseconds">time it took</param>
+	void                    RecordLatency( PipelineLatency latency, long long microseconds )
+	{
+		m_latencies[latency].Record( ( microseconds > 0 ) ? static_cast<unsigned long long>(microseconds) * 1000 : 0 );
+	}
+
+	/// <summary>
+	/// Count a frame read from a sensor, and trace a gap or a duplicate. Only the thread
+	/// reading the stream
+	/// </summary>
+	/// <param name="sensor">index of the sensor</param>
+	/// <param name="stream">stream it is from</param>
+	/// <param name="frameNumber">dwFrameNumber of the frame</param>
+	/// <returns>how the number follows the previous one</returns>
+	FrameCheck              OnFrame( int sensor, FrameStream stream, unsigned int frameNumber );
+
+	/// <summary>
+	/// Count and trace frames the pipeline dropped. Any thread, never blocks
+	/// </summary>
+	/// <param name="sensor">index of the sensor</param>
+	/// <param name="stream">stream they are from</param>
+	/// <param name="stage">stage that dropped them</param>
+	/// <param name="count">number of frames</param>
+	void                    OnFrameDropped( int sensor, FrameStream stream, FrameDropStage stage, unsigned int count = 1 );
+
+	/// <summary>
+	/// Count a lost sensor coming back. Only the sensor's processing thread
+	/// </summary>
+	/// <param name="sensor">index of the sensor</param>
+	/// <param name="milliseconds">time from losing the sensor until it streamed again</param>
+	void                    OnSensorRecovered( int sensor, long long milliseconds );
+
+	/// <summary>
+	/// Host clock the sensor timestamps are mapped onto and the datagrams carry
+	/// </summary>
+	/// <param name="ticks">ticks of Now</param>
+	/// <returns>microseconds</returns>
+	long long               ToMicroseconds( long long ticks ) const
+	{
+		return static_cast<long long>( ticks * m_nanosecondsPerTick / 1000.0 );
+	}
+
+	/// <summary>
+	/// Start or stop tracing the stages, see FrameTrace.h
+	/// </summary>
+	/// <param name="enabled">trace the stages</param>
+	/// <param name="thresholdMs">a stage taking longer writes the trace to a file, 0 for never</param>
+	void                    EnableTracing( bool enabled, unsigned int thresholdMs );
+
+	/// <summary>
+	/// Name the calling thread in traces
+	/// </summary>
+	/// <param name="name">name to show</param>
+	void                    NameThread( const char * name )
+	{
+		m_tracer.NameThread( name );
+	}
+
+	/// <summary>
+	/// Serve the metrics over HTTP on the loopback interface, on a thread of its own, and
+	/// optionally take the echoes of receivers measuring the latency
+	/// </summary>
+	/// <param name="port">TCP port</param>
+	/// <param name="echoPort">UDP port receivers send the echoes to, on every interface, 0 for none</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Start( unsigned short port, unsigned short echoPort );
+
+	/// <summary>
+	/// Stop serving and taking echoes, the histograms keep counting
+	/// </summary>
+	void                    Stop( );
+
+	/// <summary>
+	/// Write every histogram in the Prometheus text format
+	/// </summary>
+	/// <param name="text">receives the metrics, appended</param>
+	void                    Format( std::string & text ) const;
+
+private:
+	// not copyable, the histograms are atomic
+	PipelineMetrics( const PipelineMetrics & );
+	PipelineMetrics & operator=( const PipelineMetrics & );
+
+	/// <summary>
+	/// Thread serving the endpoint, calls class instance thread processor
+	/// </summary>
+	/// <param name="pParam">instance pointer</param>
+	/// <returns>always 0</returns>
+	static DWORD WINAPI     ServerThread( LPVOID pParam );
+
+	/// <summary>
+	/// Thread serving the endpoint
+	/// </summary>
+	/// <returns>always 0</returns>
+	DWORD WINAPI            ServerThread( );
+
+	/// <summary>
+	/// Answer one HTTP request with the metrics, or with the trace for /trace
+	/// </summary>
+	/// <param name="s">accepted connection</param>
+	void                    Serve( SOCKET s );
+
+	/// <summary>
+	/// Count the latency of every echo waiting on the echo socket
+	/// </summary>
+	void                    ReceiveEchoes( );
+
+	/// <summary>
+	/// Time Record itself takes, so readers know what the instrumentation costs
+	/// </summary>
+	void                    MeasureOverhead( );
+
+	LatencyHistogram        m_stages[STAGE_COUNT];
+	LatencyHistogram        m_latencies[LATENCY_COUNT];
+	FrameAccounting         m_frames[MERGE_MAX_SENSORS];
+
+	// Recoveries of every sensor, written by its processing thread and read by Format
+	std::atomic<unsigned long long> m_recoveries[MERGE_MAX_SENSORS];
+	std::atomic<long long>  m_lastRecoveryMs[MERGE_MAX_SENSORS];
+	std::atomic<long long>  m_maxRecoveryMs[MERGE_MAX_SENSORS];
+	FrameTracer             m_tracer;
+	double                  m_nanosecondsPerTick;
+	unsigned long long      m_overhead;         // ns per Record, measured once
+
+	SOCKET                  m_listenSocket;
+	SOCKET                  m_echoSocket;
+	HANDLE                  m_hThServer;
+	HANDLE                  m_hEvServerStop;
+};
@@ -0,0 +1,353 @@
+//------------------------------------------------------------------------------
+// <copyright file="PointCloud.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Depth to point cloud conversion. Instead of calling NuiTransformDepthImageToSkeleton
+// per pixel, the camera model is reduced to one factor per column and one per row,
+// so a skeleton space point is (rayX[u] * z, rayY[v] * z, z), evaluated 4 pixels at a time.
+
+#include "stdafx.h"
+#include "PointCloud.h"
+#include <emmintrin.h>
+#include <assert.h>
+
+// alignment of all SIMD buffers, one cache line
+static const size_t g_BufferAlignment = 64;
+
+/// <summary>
+/// Constructor
+/// </summary>
+PointCloud::PointCloud() :
+	m_width(0),
+	m_height(0),
+	m_pRayX(NULL),
+	m_pRayY(NULL),
+	m_pPoints(NULL),
+	m_capacity(0),
+	m_count(0),
+	m_playerFilter(POINT_CLOUD_ALL_PIXELS),
+	m_voxelSize(0.0f),
+	m_pVoxelSlots(NULL),
+	m_voxelMask(0),
+	m_voxelStamp(0),
+	m_pVoxelSums(NULL),
+	m_pVoxelCounts(NULL)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+PointCloud::~PointCloud()
+{
+	Discard();
+}
+
+/// <summary>
+/// Free all buffers
+/// </summary>
+void PointCloud::Discard( )
+{
+	_aligned_free( m_pRayX );
+	_aligned_free( m_pRayY );
+	_aligned_free( m_pPoints );
+	_aligned_free( m_pVoxelSlots );
+	_aligned_free( m_pVoxelSums );
+	_aligned_free( m_pVoxelCounts );
+
+	m_pRayX = NULL;
+	m_pRayY = NULL;
+	m_pPoints = NULL;
+	m_pVoxelSlots = NULL;
+	m_pVoxelSums = NULL;
+	m_pVoxelCounts = NULL;
+	m_capacity = 0;
+	m_count = 0;
+}
+
+/// <summary>
+/// Build the ray table and allocate buffers for the given depth resolution
+/// </summary>
+/// <param name="width">width (in pixels) of the depth frames, a multiple of 4</param>
+/// <param name="height">height (in pixels) of the depth frames</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT PointCloud::Initialize( UINT width, UINT height )
+{
+	if ( 0 == width || 0 == height || 0 != (width & 3) )
+	{
+		return E_INVALIDARG;
+	}
+
+	if ( width == m_width && height == m_height && NULL != m_pPoints )
+	{
+		return S_OK;
+	}
+
+	Discard();
+
+	m_width = width;
+	m_height = height;
+	m_capacity = width * height;
+
+	// every point may start a voxel, the hash table has two slots per pixel so it is at
+	// most half full and probes stay short
+	UINT slots = 1;
+	while ( slots < 2 * m_capacity )
+	{
+		slots <<= 1;
+	}
+	m_voxelMask = slots - 1;
+	m_voxelStamp = 0;
+
+	m_pRayX = static_cast<float *>( _aligned_malloc( width * sizeof(float), g_BufferAlignment ) );
+	m_pRayY = static_cast<float *>( _aligned_malloc( height * sizeof(float), g_BufferAlignment ) );
+	m_pPoints = static_cast<float *>( _aligned_malloc( 3 * m_capacity * sizeof(float), g_BufferAlignment ) );
+	m_pVoxelSlots = static_cast<VoxelSlot *>( _aligned_malloc( slots * sizeof(VoxelSlot), g_BufferAlignment ) );
+	m_pVoxelSums = static_cast<float *>( _aligned_malloc( 3 * m_capacity * sizeof(float), g_BufferAlignment ) );
+	m_pVoxelCounts = static_cast<UINT *>( _aligned_malloc( m_capacity * sizeof(UINT), g_BufferAlignment ) );
+
+	if ( !m_pRayX || !m_pRayY || !m_pPoints || !m_pVoxelSlots || !m_pVoxelSums || !m_pVoxelCounts )
+	{
+		Discard();
+		m_width = 0;
+		m_height = 0;
+		return E_OUTOFMEMORY;
+	}
+
+	ZeroMemory( m_pVoxelSlots, slots * sizeof(VoxelSlot) );
+
+	// Same camera model as NuiTransformDepthImageToSkeleton, which is defined in 320x240 units
+	const float scaleX = (320.0f / width) * NUI_CAMERA_DEPTH_IMAGE_TO_SKELETON_MULTIPLIER_320x240;
+	const float scaleY = (240.0f / height) * NUI_CAMERA_DEPTH_IMAGE_TO_SKELETON_MULTIPLIER_320x240;
+
+	for ( UINT u = 0; u < width; u++ )
+	{
+		m_pRayX[u] = (u - width / 2.0f) * scaleX;
+	}
+
+	for ( UINT v = 0; v < height; v++ )
+	{
+		m_pRayY[v] = -(v - height / 2.0f) * scaleY;
+	}
+
+	return S_OK;
+}
+
+/// <summary>
+/// Select which pixels are kept based on their player index
+/// </summary>
+/// <param name="player">POINT_CLOUD_ALL_PIXELS, POINT_CLOUD_ALL_PLAYERS or a player index</param>
+void PointCloud::SetPlayerFilter( int player )
+{
+	m_playerFilter = player;
+}
+
+/// <summary>
+/// Set the edge length of the voxel grid used to downsample the cloud
+/// </summary>
+/// <param name="voxelSize">voxel edge in inches, 0 disables downsampling</param>
+void PointCloud::SetVoxelSize( float voxelSize )
+{
+	m_voxelSize = voxelSize > 0.0f ? voxelSize : 0.0f;
+}
+
+/// <summary>
+/// Convert a depth frame with player indices into display space points
+/// </summary>
+/// <param name="pDepth">packed depth pixels of the size given to Initialize</param>
+/// <param name="calibration">sensor to display transform</param>
+/// <returns>number of points in the cloud</returns>
+UINT PointCloud::Process( const USHORT * pDepth, const SensorCalibration & calibration )
+{
+	m_count = 0;
+
+	if ( NULL == m_pPoints || NULL == pDepth )
+	{
+		return 0;
+	}
+
+	float * pX = m_pPoints;
+	float * pY = m_pPoints + m_capacity;
+	float * pZ = m_pPoints + 2 * m_capacity;
+
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i playerMask = _mm_set1_epi32( NUI_IMAGE_PLAYER_INDEX_MASK );
+	const __m128i player = _mm_set1_epi32( m_playerFilter );
+	const __m128 millimetersToMeters = _mm_set1_ps( 0.001f );
+
+	UINT count = 0;
+
+	for ( UINT v = 0; v < m_height; v++ )
+	{
+		const USHORT * pRow = pDepth + v * m_width;
+		const __m128 rayY = _mm_set1_ps( m_pRayY[v] );
+
+		for ( UINT u = 0; u < m_width; u += 4 )
+		{
+			// widen 4 packed pixels to 32 bits and split depth from player index
+			__m128i packed = _mm_unpacklo_epi16( _mm_loadl_epi64( reinterpret_cast<const __m128i *>(pRow + u) ), zero );
+			__m128i depth = _mm_srli_epi32( packed, NUI_IMAGE_PLAYER_INDEX_SHIFT );
+			__m128i valid = _mm_cmpgt_epi32( depth, zero );
+
+			if ( POINT_CLOUD_ALL_PLAYERS == m_playerFilter )
+			{
+				valid = _mm_and_si128( valid, _mm_cmpgt_epi32( _mm_and_si128( packed, playerMask ), zero ) );
+			}
+			else if ( m_playerFilter > 0 )
+			{
+				valid = _mm_and_si128( valid, _mm_cmpeq_epi32( _mm_and_si128( packed, playerMask ), player ) );
+			}
+
+			int mask = _mm_movemask_ps( _mm_castsi128_ps( valid ) );
+			if ( 0 == mask )
+			{
+				continue;
+			}
+
+			__m128 z = _mm_mul_ps( _mm_cvtepi32_ps( depth ), millimetersToMeters );
+			__m128 x = _mm_mul_ps( _mm_load_ps( m_pRayX + u ), z );
+			__m128 y = _mm_mul_ps( rayY, z );
+
+			if ( 0xF == mask )
+			{
+				_mm_storeu_ps( pX + count, x );
+				_mm_storeu_ps( pY + count, y );
+				_mm_storeu_ps( pZ + count, z );
+				count += 4;
+			}
+			else
+			{
+				// partially valid group, append the surviving lanes one by one
+				__declspec(align(16)) float laneX[4], laneY[4], laneZ[4];
+				_mm_store_ps( laneX, x );
+				_mm_store_ps( laneY, y );
+				_mm_store_ps( laneZ, z );
+
+				for ( int lane = 0; lane < 4; lane++ )
+				{
+					if ( mask & (1 << lane) )
+					{
+						pX[count] = laneX[lane];
+						pY[count] = laneY[lane];
+						pZ[count] = laneZ[lane];
+						++count;
+					}
+				}
+			}
+		}
+	}
+
+	assert( count <= m_capacity );
+
+	// same transform the joints go through, so points and skeletons line up
+	calibration.TransformBatch( pX, pY, pZ, pX, pY, pZ, count );
+	m_count = count;
+
+	if ( m_voxelSize > 0.0f )
+	{
+		Downsample();
+	}
+
+	Pack();
+
+	return m_count;
+}
+
+/// <summary>
+/// Replace the points with the centroid of each occupied voxel
+/// </summary>
+void PointCloud::Downsample( )
+{
+	float * pX = m_pPoints;
+	float * pY = m_pPoints + m_capacity;
+	float * pZ = m_pPoints + 2 * m_capacity;
+
+	float * pSumX = m_pVoxelSums;
+	float * pSumY = m_pVoxelSums + m_capacity;
+	float * pSumZ = m_pVoxelSums + 2 * m_capacity;
+
+	// a new stamp invalidates every slot without touching the table
+	if ( 0 == ++m_voxelStamp )
+	{
+		ZeroMemory( m_pVoxelSlots, (m_voxelMask + 1) * sizeof(VoxelSlot) );
+		m_voxelStamp = 1;
+	}
+
+	const float invVoxelSize = 1.0f / m_voxelSize;
+	UINT voxels = 0;
+
+	for ( UINT i = 0; i < m_count; i++ )
+	{
+		float fx = pX[i] * invVoxelSize;
+		float fy = pY[i] * invVoxelSize;
+		float fz = pZ[i] * invVoxelSize;
+
+		// floor without a library call
+		int ix = static_cast<int>(fx); ix -= (fx < ix);
+		int iy = static_cast<int>(fy); iy -= (fy < iy);
+		int iz = static_cast<int>(fz); iz -= (fz < iz);
+
+		// 21 bits per axis covers +/- 1M voxels
+		ULONGLONG key = (static_cast<ULONGLONG>(ix & 0x1FFFFF) << 42) |
+			(static_cast<ULONGLONG>(iy & 0x1FFFFF) << 21) |
+			static_cast<ULONGLONG>(iz & 0x1FFFFF);
+
+		UINT slot = static_cast<UINT>((key * 0x9E3779B97F4A7C15ULL) >> 32) & m_voxelMask;
+
+		for ( ;; )
+		{
+			VoxelSlot & entry = m_pVoxelSlots[slot];
+
+			if ( entry.stamp != m_voxelStamp )
+			{
+				// there are never more voxels than points, so every point is kept
+				entry.key = key;
+				entry.stamp = m_voxelStamp;
+				entry.index = voxels;
+				pSumX[voxels] = pX[i];
+				pSumY[voxels] = pY[i];
+				pSumZ[voxels] = pZ[i];
+				m_pVoxelCounts[voxels] = 1;
+				++voxels;
+				break;
+			}
+
+			if ( entry.key == key )
+			{
+				pSumX[entry.index] += pX[i];
+				pSumY[entry.index] += pY[i];
+				pSumZ[entry.index] += pZ[i];
+				++m_pVoxelCounts[entry.index];
+				break;
+			}
+
+			slot = (slot + 1) & m_voxelMask;
+		}
+	}
+
+	for ( UINT v = 0; v < voxels; v++ )
+	{
+		float inv = 1.0f / m_pVoxelCounts[v];
+		pX[v] = pSumX[v] * inv;
+		pY[v] = pSumY[v] * inv;
+		pZ[v] = pSumZ[v] * inv;
+	}
+
+	m_count = voxels;
+}
+
+/// <summary>
+/// Move the y and z arrays down so the used points are contiguous
+/// </summary>
+void PointCloud::Pack( )
+{
+	if ( m_count == m_capacity )
+	{
+		return;
+	}
+
+	memmove( m_pPoints + m_count, m_pPoints + m_capacity, m_count * sizeof(float) );
+	memmove( m_pPoints + 2 * m_count, m_pPoints + 2 * m_capacity, m_count * sizeof(float) );
+}
@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+// <copyright file="PointCloud.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Converts depth frames into display space point clouds
+
+#pragma once
+
+#include "NuiApi.h"
+#include "SensorCalibration.h"
+
+// player filters for PointCloud::SetPlayerFilter, 1 through NUI_SKELETON_COUNT keep a single player
+#define POINT_CLOUD_ALL_PIXELS          -1
+#define POINT_CLOUD_ALL_PLAYERS         0
+
+class PointCloud
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	PointCloud();
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~PointCloud();
+
+	/// <summary>
+	/// Build the ray table and allocate buffers for the given depth resolution
+	/// </summary>
+	/// <param name="width">width (in pixels) of the depth frames, a multiple of 4</param>
+	/// <param name="height">height (in pixels) of the depth frames</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT Initialize( UINT width, UINT height );
+
+	/// <summary>
+	/// Select which pixels are kept based on their player index
+	/// </summary>
+	/// <param name="player">POINT_CLOUD_ALL_PIXELS, POINT_CLOUD_ALL_PLAYERS or a player index</param>
+	void SetPlayerFilter( int player );
+
+	/// <summary>
+	/// Set the edge length of the voxel grid used to downsample the cloud
+	/// </summary>
+	/// <param name="voxelSize">voxel edge in inches, 0 disables downsampling</param>
+	void SetVoxelSize( float voxelSize );
+
+	/// <summary>
+	/// Convert a depth frame with player indices into display space points
+	/// </summary>
+	/// <param name="pDepth">packed depth pixels of the size given to Initialize</param>
+	/// <param name="calibration">sensor to display transform</param>
+	/// <returns>number of points in the cloud</returns>
+	UINT Process( const USHORT * pDepth, const SensorCalibration & calibration );
+
+	/// <summary>
+	/// Contiguous point buffer: count x values, then count y values, then count z values
+	/// </summary>
+	const float * GetBuffer() const { return m_pPoints; }
+
+	/// <summary>
+	/// Number of points in the last processed cloud
+	/// </summary>
+	UINT GetCount() const { return m_count; }
+
+	/// <summary>
+	/// Size in bytes of the used part of the point buffer
+	/// </summary>
+	UINT GetBufferSize() const { return m_count * 3 * sizeof(float); }
+
+	/// <summary>
+	/// Width (in pixels) of the depth frames the cloud was initialized for, 0 before Initialize
+	/// </summary>
+	UINT GetWidth() const { return m_width; }
+
+	/// <summary>
+	/// Height (in pixels) of the depth frames the cloud was initialized for, 0 before Initialize
+	/// </summary>
+	UINT GetHeight() const { return m_height; }
+
+private:
+	struct VoxelSlot
+	{
+		ULONGLONG key;
+		UINT      stamp;
+		UINT      index;
+	};
+
+	UINT                     m_width;
+	UINT                     m_height;
+
+	// Per column and per row factors that turn a depth in meters into skeleton x and y
+	float *                  m_pRayX;
+	float *                  m_pRayY;
+
+	// SoA points with m_capacity entries per axis
+	float *                  m_pPoints;
+	UINT                     m_capacity;
+	UINT                     m_count;
+
+	int                      m_playerFilter;
+	float                    m_voxelSize;
+
+	// Hash grid, slots are valid only when their stamp matches the current frame
+	VoxelSlot *              m_pVoxelSlots;
+	UINT                     m_voxelMask;
+	UINT                     m_voxelStamp;
+	float *                  m_pVoxelSums;
+	UINT *                   m_pVoxelCounts;
+
+	/// <summary>
+	/// Replace the points with the centroid of each occupied voxel
+	/// </summary>
+	void Downsample( );
+
+	/// <summary>
+	/// Move the y and z arrays down so the used points are contiguous
+	/// </summary>
+	void Pack( );
+
+	/// <summary>
+	/// Free all buffers
+	/// </summary>
+	void Discard( );
+};
@@ -0,0 +1,262 @@
+//------------------------------------------------------------------------------
+// <copyright file="PointCloudRecorder.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Point cloud recording. The sensor threads copy each cloud with its header into a pooled
+// buffer and queue it, the writer thread appends the queued records to the file in order.
+
+#include "stdafx.h"
+#include "PointCloudRecorder.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+PointCloudRecorder::PointCloudRecorder() :
+	m_queueHead(0),
+	m_queueCount(0),
+	m_recording(0),
+	m_dropped(0),
+	m_pFile(NULL),
+	m_hWnd(NULL),
+	m_message(0),
+	m_hThWriter(NULL),
+	m_hEvWrite(NULL),
+	m_hEvWriterStop(NULL)
+{
+	InitializeCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Destructor, closes the file
+/// </summary>
+PointCloudRecorder::~PointCloudRecorder()
+{
+	Close();
+	DeleteCriticalSection( &m_lock );
+}
+
+/// <summary>
+/// Start recording to a new file, replacing a file being recorded. Only the UI thread
+/// </summary>
+/// <param name="path">file to create, an existing one is overwritten</param>
+/// <param name="hWnd">window told when writing fails, NULL for none</param>
+/// <param name="message">message posted to it, once the recorder closed the file</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT PointCloudRecorder::Open( const char * path, HWND hWnd, UINT message )
+{
+	Close();
+
+	// allocated once, the sensor threads only acquire buffers while recording
+	if ( 0 == m_pool.GetCount() &&
+		 !m_pool.Initialize( sizeof(PointCloudRecord) + 3 * POINT_CLOUD_RECORDER_MAX_POINTS * sizeof(float), POINT_CLOUD_RECORDER_BUFFERS ) )
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	if ( 0 != fopen_s( &m_pFile, path, "wb" ) || NULL == m_pFile )
+	{
+		m_pFile = NULL;
+		return E_FAIL;
+	}
+
+	m_hWnd = hWnd;
+	m_message = message;
+	InterlockedExchange( &m_dropped, 0 );
+
+	m_hEvWriterStop = CreateEvent( NULL, FALSE, FALSE, NULL );
+	m_hEvWrite = CreateEvent( NULL, FALSE, FALSE, NULL );
+	if ( NULL != m_hEvWriterStop && NULL != m_hEvWrite )
+	{
+		m_hThWriter = CreateThread( NULL, 0, WriterThread, this, 0, NULL );
+	}
+	if ( NULL == m_hThWriter )
+	{
+		Close();
+		return E_FAIL;
+	}
+
+	EnterCriticalSection( &m_lock );
+	m_recording = 1;
+	LeaveCriticalSection( &m_lock );
+	return S_OK;
+}
+
+/// <summary>
+/// Stop recording, after writing every queued cloud. Only the UI thread
+/// </summary>
+void PointCloudRecorder::Close( )
+{
+	// no cloud is queued after this, the writer thread writes what is
+	EnterCriticalSection( &m_lock );
+	m_recording = 0;
+	LeaveCriticalSection( &m_lock );
+
+	if ( NULL != m_hThWriter )
+	{
+		SetEvent( m_hEvWriterStop );
+		WaitForSingleObject( m_hThWriter, INFINITE );
+		CloseHandle( m_hThWriter );
+		m_hThWriter = NULL;
+	}
+
+	if ( NULL != m_hEvWrite )
+	{
+		CloseHandle( m_hEvWrite );
+		m_hEvWrite = NULL;
+	}
+
+	if ( NULL != m_hEvWriterStop )
+	{
+		CloseHandle( m_hEvWriterStop );
+		m_hEvWriterStop = NULL;
+	}
+
+	// the writer thread already closed the file if writing failed
+	if ( NULL != m_pFile )
+	{
+		fclose( m_pFile );
+		m_pFile = NULL;
+	}
+}
+
+/// <summary>
+/// Queue the last cloud a sensor processed for writing. Safe to call from every sensor
+/// thread, never blocks on the file
+/// </summary>
+/// <param name="sensorIndex">sensor the cloud is from</param>
+/// <param name="frameNumber">depth frame number of the cloud</param>
+/// <param name="captureTime">capture time of the frame, host microseconds</param>
+/// <param name="cloud">cloud to record</param>
+/// <returns>S_OK if queued, S_FALSE if not recording, E_PENDING if no buffer was free</returns>
+HRESULT PointCloudRecorder::Write( int sensorIndex, DWORD frameNumber, long long captureTime, const PointCloud & cloud )
+{
+	if ( !IsOpen() )
+	{
+		return S_FALSE;
+	}
+
+	if ( cloud.GetCount() > POINT_CLOUD_RECORDER_MAX_POINTS )
+	{
+		return E_INVALIDARG;
+	}
+
+	FrameBuffer * pBuffer = m_pool.Acquire();
+	if ( NULL == pBuffer )
+	{
+		InterlockedIncrement( &m_dropped );
+		return E_PENDING;
+	}
+
+	// the copy is the only cost to the sensor thread
+	PointCloudRecord * pRecord = reinterpret_cast<PointCloudRecord *>( pBuffer->GetData() );
+	pRecord->magic = POINT_CLOUD_RECORD_MAGIC;
+	pRecord->sensorIndex = static_cast<UINT>(sensorIndex);
+	pRecord->frameNumber = frameNumber;
+	pRecord->count = cloud.GetCount();
+	pRecord->captureTime = captureTime;
+	memcpy( pRecord + 1, cloud.GetBuffer(), cloud.GetBufferSize() );
+	pBuffer->frameNumber = frameNumber;
+	pBuffer->captureTime = captureTime;
+
+	// the pool has as many buffers as the queue has entries, so a buffer always fits
+	bool queued = false;
+	EnterCriticalSection( &m_lock );
+	if ( 0 != m_recording )
+	{
+		m_queue[( m_queueHead + m_queueCount ) % POINT_CLOUD_RECORDER_BUFFERS] = pBuffer;
+		m_queueCount++;
+		queued = true;
+	}
+	LeaveCriticalSection( &m_lock );
+
+	if ( !queued )
+	{
+		pBuffer->Release();
+		return S_FALSE;
+	}
+
+	SetEvent( m_hEvWrite );
+	return S_OK;
+}
+
+/// <summary>
+/// Take the oldest queued cloud
+/// </summary>
+/// <returns>buffer, with the queue's reference, NULL if none is queued</returns>
+FrameBuffer * PointCloudRecorder::Dequeue( )
+{
+	FrameBuffer * pBuffer = NULL;
+	EnterCriticalSection( &m_lock );
+	if ( m_queueCount > 0 )
+	{
+		pBuffer = m_queue[m_queueHead];
+		m_queueHead = ( m_queueHead + 1 ) % POINT_CLOUD_RECORDER_BUFFERS;
+		m_queueCount--;
+	}
+	LeaveCriticalSection( &m_lock );
+	return pBuffer;
+}
+
+/// <summary>
+/// Thread writing the queued clouds, calls class instance thread processor
+/// </summary>
+/// <param name="pParam">instance pointer</param>
+/// <returns>always 0</returns>
+DWORD WINAPI PointCloudRecorder::WriterThread( LPVOID pParam )
+{
+	PointCloudRecorder * pThis = static_cast<PointCloudRecorder *>(pParam);
+	return pThis->WriterThread();
+}
+
+/// <summary>
+/// Thread writing the queued clouds
+/// </summary>
+/// <returns>always 0</returns>
+DWORD WINAPI PointCloudRecorder::WriterThread( )
+{
+	HANDLE hEvents[2] = { m_hEvWriterStop, m_hEvWrite };
+	bool failed = false;
+
+	while ( !failed )
+	{
+		DWORD signalled = WaitForMultipleObjects( 2, hEvents, FALSE, INFINITE );
+
+		// on stop as well, Close stopped the queue first so this writes the last clouds
+		for ( FrameBuffer * pBuffer = Dequeue(); NULL != pBuffer; pBuffer = Dequeue() )
+		{
+			const PointCloudRecord * pRecord = reinterpret_cast<const PointCloudRecord *>( pBuffer->GetData() );
+			size_t size = sizeof(PointCloudRecord) + 3 * pRecord->count * sizeof(float);
+			failed = failed || 1 != fwrite( pRecord, size, 1, m_pFile );
+			pBuffer->Release();
+		}
+
+		if ( WAIT_OBJECT_0 == signalled )
+		{
+			break;
+		}
+	}
+
+	if ( failed )
+	{
+		// e.g. a full disk, the file ends with a partial record. Clouds queued meanwhile
+		// were released above unwritten
+		EnterCriticalSection( &m_lock );
+		m_recording = 0;
+		LeaveCriticalSection( &m_lock );
+		for ( FrameBuffer * pBuffer = Dequeue(); NULL != pBuffer; pBuffer = Dequeue() )
+		{
+			pBuffer->Release();
+		}
+
+		fclose( m_pFile );
+		m_pFile = NULL;
+		OutputDebugStringA( "Point cloud recording failed, the file was closed\r\n" );
+		if ( NULL != m_hWnd )
+		{
+			PostMessageW( m_hWnd, m_message, 0, 0 );
+		}
+	}
+	return 0;
+}
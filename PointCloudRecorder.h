@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+// <copyright file="PointCloudRecorder.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the recorder of point clouds. Every processed depth frame of any sensor appends
+// one record to the file, little endian:
+//	PointCloudRecord                        the header below
+//	count x, count y, count z               floats, display frame in inches
+// which is the header followed by PointCloud::GetBuffer as it is.
+//
+// The sensor threads only copy their cloud into a pooled buffer and queue it, a writer
+// thread of the recorder's own does the file I/O. When every buffer waits for the disk
+// the cloud is dropped and counted, the sensor thread never waits.
+
+#pragma once
+
+#include "PointCloud.h"
+#include "FramePool.h"
+#include <stdio.h>
+
+// First field of every record, "PCL1" as bytes
+#define POINT_CLOUD_RECORD_MAGIC        0x314C4350
+
+// Clouds queued for the writer at most, of all sensors together
+#define POINT_CLOUD_RECORDER_BUFFERS    8
+
+// Points a buffer holds, a whole 640x480 depth frame
+#define POINT_CLOUD_RECORDER_MAX_POINTS ( 640 * 480 )
+
+/// <summary>
+/// Header of one recorded cloud
+/// </summary>
+struct PointCloudRecord
+{
+	UINT                    magic;          // POINT_CLOUD_RECORD_MAGIC
+	UINT                    sensorIndex;
+	UINT                    frameNumber;    // the sensor's depth frame number
+	UINT                    count;          // points that follow
+	LONGLONG                captureTime;    // host microseconds
+};
+
+class PointCloudRecorder
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	PointCloudRecorder();
+
+	/// <summary>
+	/// Destructor, closes the file
+	/// </summary>
+	~PointCloudRecorder();
+
+	/// <summary>
+	/// Start recording to a new file, replacing a file being recorded. Only the UI thread
+	/// </summary>
+	/// <param name="path">file to create, an existing one is overwritten</param>
+	/// <param name="hWnd">window told when writing fails, NULL for none</param>
+	/// <param name="message">message posted to it, once the recorder closed the file</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Open( const char * path, HWND hWnd, UINT message );
+
+	/// <summary>
+	/// Stop recording, after writing every queued cloud. Only the UI thread
+	/// </summary>
+	void                    Close( );
+
+	/// <summary>
+	/// Whether clouds are being recorded, false as well once writing failed
+	/// </summary>
+	bool                    IsOpen( ) const { return 0 != m_recording; }
+
+	/// <summary>
+	/// Clouds dropped since Open because every buffer was waiting for the disk
+	/// </summary>
+	UINT                    GetDroppedCount( ) const { return static_cast<UINT>(m_dropped); }
+
+	/// <summary>
+	/// Queue the last cloud a sensor processed for writing. Safe to call from every sensor
+	/// thread, never blocks on the file
+	/// </summary>
+	/// <param name="sensorIndex">sensor the cloud is from</param>
+	/// <param name="frameNumber">depth frame number of the cloud</param>
+	/// <param name="captureTime">capture time of the frame, host microseconds</param>
+	/// <param name="cloud">cloud to record</param>
+	/// <returns>S_OK if queued, S_FALSE if not recording, E_PENDING if no buffer was free</returns>
+	HRESULT                 Write( int sensorIndex, DWORD frameNumber, long long captureTime, const PointCloud & cloud );
+
+private:
+	// not copyable, owns a thread
+	PointCloudRecorder( const PointCloudRecorder & );
+	PointCloudRecorder & operator=( const PointCloudRecorder & );
+
+	/// <summary>
+	/// Thread writing the queued clouds, calls class instance thread processor
+	/// </summary>
+	/// <param name="pParam">instance pointer</param>
+	/// <returns>always 0</returns>
+	static DWORD WINAPI     WriterThread( LPVOID pParam );
+
+	/// <summary>
+	/// Thread writing the queued clouds
+	/// </summary>
+	/// <returns>always 0</returns>
+	DWORD WINAPI            WriterThread( );
+
+	/// <summary>
+	/// Take the oldest queued cloud
+	/// </summary>
+	/// <returns>buffer, with the queue's reference, NULL if none is queued</returns>
+	FrameBuffer *           Dequeue( );
+
+	// Buffers of the queued clouds, allocated by the first Open
+	FramePool               m_pool;
+
+	// Guards the queue and m_recording, held for a few instructions, never for I/O
+	CRITICAL_SECTION        m_lock;
+	FrameBuffer *           m_queue[POINT_CLOUD_RECORDER_BUFFERS];
+	UINT                    m_queueHead;
+	UINT                    m_queueCount;
+	volatile LONG           m_recording;
+	volatile LONG           m_dropped;
+
+	// Only the writer thread uses the file while it runs
+	FILE *                  m_pFile;
+	HWND                    m_hWnd;
+	UINT                    m_message;
+
+	HANDLE                  m_hThWriter;
+	HANDLE                  m_hEvWrite;
+	HANDLE                  m_hEvWriterStop;
+};
@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseCodec.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Compact encoding of the pose values, for receivers on slow or congested links. Header
+// only and shared with receivers, like PosePacket.h.
+//
+// Values are rounded to whole millimetres. A keyframe holds them as 16-bit integers, the
+// frames after it only hold each value's difference to the keyframe in 8 bits, so a delta
+// does not depend on the frames before it: a lost delta costs nothing but itself, a lost
+// keyframe costs the frames up to the next one. A new keyframe is sent every
+// POSE_CODEC_KEYFRAME_INTERVAL frames, and as soon as a value moves too far for 8 bits.
+//
+// The loops have no branches in them, so the compiler can vectorize them.
+
+#pragma once
+
+#include <math.h>
+#include <string.h>
+#include "PosePacket.h"
+
+#define POSE_CODEC_MAX_VALUES           SUBSCRIBER_STREAM_SKELETON_VALUES   // largest stream of inches
+#define POSE_CODEC_KEYFRAME_INTERVAL    10          // frames, a third of a second at 30 frames per second
+#define POSE_CODEC_UNITS_PER_INCH       25.4f       // values are inches, the codec counts millimetres
+
+/// <summary>
+/// Bytes the encoded values take behind the header
+/// </summary>
+/// <param name="encoding">POSE_ENCODING_*</param>
+/// <param name="count">number of values</param>
+/// <returns>payload size</returns>
+inline int PoseCodecPayloadSize( unsigned int encoding, int count )
+{
+	switch ( encoding )
+	{
+	case POSE_ENCODING_KEYFRAME:
+		return count * 2;
+	case POSE_ENCODING_DELTA:
+		return count;
+	default:
+		return count * static_cast<int>(sizeof(float));
+	}
+}
+
+class PoseEncoder
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	PoseEncoder()
+	{
+		Reset();
+	}
+
+	/// <summary>
+	/// Start over, the next frame is a keyframe
+	/// </summary>
+	void Reset( )
+	{
+		memset( m_keyframe, 0, sizeof(m_keyframe) );
+		m_count = 0;
+		m_distance = POSE_CODEC_KEYFRAME_INTERVAL;
+	}
+
+	/// <summary>
+	/// Encode the values of the next frame, each frame gets the next sequence number
+	/// </summary>
+	/// <param name="pValues">values in inches</param>
+	/// <param name="count">number of values, at most POSE_CODEC_MAX_VALUES</param>
+	/// <param name="pOut">receives the payload, PoseCodecPayloadSize bytes</param>
+	/// <param name="encoding">receives the POSE_ENCODING_* for the header</param>
+	/// <param name="keyframeDistance">receives the keyframe distance for the header</param>
+	/// <returns>bytes written</returns>
+	int Encode( const float * pValues, int count, unsigned char * pOut, unsigned int & encoding, unsigned int & keyframeDistance )
+	{
+		short quantized[POSE_CODEC_MAX_VALUES];
+		int delta[POSE_CODEC_MAX_VALUES];
+		int outOfRange = 0;
+
+		for ( int i = 0; i < count; i++ )
+		{
+			float millimetres = floorf( pValues[i] * POSE_CODEC_UNITS_PER_INCH + 0.5f );
+			millimetres = ( millimetres < -32768.0f ) ? -32768.0f : millimetres;
+			millimetres = ( millimetres > 32767.0f ) ? 32767.0f : millimetres;
+			quantized[i] = static_cast<short>(millimetres);
+
+			// a difference fits in 8 bits if adding 128 leaves it within 0 to 255
+			delta[i] = quantized[i] - m_keyframe[i];
+			outOfRange |= ( delta[i] + 128 ) & ~0xFF;
+		}
+
+		if ( count != m_count || m_distance + 1 >= POSE_CODEC_KEYFRAME_INTERVAL || 0 != outOfRange )
+		{
+			for ( int i = 0; i < count; i++ )
+			{
+				m_keyframe[i] = quantized[i];
+				pOut[2 * i] = static_cast<unsigned char>( static_cast<unsigned short>(quantized[i]) >> 8 );
+				pOut[2 * i + 1] = static_cast<unsigned char>( quantized[i] );
+			}
+			m_count = count;
+			m_distance = 0;
+
+			encoding = POSE_ENCODING_KEYFRAME;
+			keyframeDistance = 0;
+			return count * 2;
+		}
+
+		for ( int i = 0; i < count; i++ )
+		{
+			pOut[i] = static_cast<unsigned char>( delta[i] );
+		}
+		m_distance++;
+
+		encoding = POSE_ENCODING_DELTA;
+		keyframeDistance = m_distance;
+		return count;
+	}
+
+private:
+	short               m_keyframe[POSE_CODEC_MAX_VALUES];
+	int                 m_count;        // values in the keyframe, 0 before the first
+	unsigned int        m_distance;     // frames since the keyframe
+};
+
+class PoseDecoder
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	PoseDecoder()
+	{
+		Reset();
+	}
+
+	/// <summary>
+	/// Forget the keyframe
+	/// </summary>
+	void Reset( )
+	{
+		memset( m_keyframe, 0, sizeof(m_keyframe) );
+		m_count = 0;
+		m_keyframeSequence = 0;
+	}
+
+	/// <summary>
+	/// Decode the payload of a compact datagram
+	/// </summary>
+	/// <param name="sequence">sequence number from the header</param>
+	/// <param name="encoding">POSE_ENCODING_KEYFRAME or POSE_ENCODING_DELTA</param>
+	/// <param name="keyframeDistance">keyframe distance from the header</param>
+	/// <param name="pPayload">bytes behind the header</param>
+	/// <param name="size">number of bytes</param>
+	/// <param name="pValues">receives the values in inches, POSE_CODEC_MAX_VALUES at most</param>
+	/// <returns>number of values, 0 for a delta whose keyframe was lost</returns>
+	int Decode( unsigned int sequence, unsigned int encoding, unsigned int keyframeDistance, const unsigned char * pPayload, int size, float * pValues )
+	{
+		static const float inchesPerUnit = 1.0f / POSE_CODEC_UNITS_PER_INCH;
+
+		if ( POSE_ENCODING_KEYFRAME == encoding )
+		{
+			int count = size / 2;
+			if ( count > POSE_CODEC_MAX_VALUES )
+			{
+				return 0;
+			}
+
+			short quantized[POSE_CODEC_MAX_VALUES];
+			for ( int i = 0; i < count; i++ )
+			{
+				quantized[i] = static_cast<short>( ( pPayload[2 * i] << 8 ) | pPayload[2 * i + 1] );
+				pValues[i] = quantized[i] * inchesPerUnit;
+			}
+
+			// a keyframe the network held back must not replace a newer one
+			if ( 0 == m_count || static_cast<int>( sequence - m_keyframeSequence ) > 0 )
+			{
+				memcpy( m_keyframe, quantized, count * sizeof(short) );
+				m_count = count;
+				m_keyframeSequence = sequence;
+			}
+			return count;
+		}
+
+		if ( POSE_ENCODING_DELTA != encoding || size != m_count || 0 == m_count || sequence - keyframeDistance != m_keyframeSequence )
+		{
+			return 0;
+		}
+
+		for ( int i = 0; i < size; i++ )
+		{
+			pValues[i] = ( m_keyframe[i] + static_cast<signed char>(pPayload[i]) ) * inchesPerUnit;
+		}
+		return size;
+	}
+
+private:
+	short               m_keyframe[POSE_CODEC_MAX_VALUES];
+	int                 m_count;                // values in the keyframe, 0 before the first
+	unsigned int        m_keyframeSequence;
+};
@@ -0,0 +1,179 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseEcho.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Echo receiver, a console tool to measure the latency from the sensor to a receiver. It
+// receives the sequenced datagrams like any receiver would and sends the header of each one
+// straight back to the tracker's echo port, which turns them into the capture_to_receive
+// and round_trip latencies of its metrics. Run it on the machine whose latency matters, the
+// tracker's own or another one:
+//	PoseEcho <port> <echo port> [multicast group]
+// Not part of TrackerApp, it builds on its own on Windows or Linux:
+//	cl /EHsc PoseEcho.cpp ws2_32.lib
+//	g++ -O2 -o PoseEcho PoseEcho.cpp
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+typedef int SOCKET;
+#define INVALID_SOCKET  (-1)
+#define closesocket     close
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "PosePacket.h"
+
+// Seconds between two status lines
+static const int g_StatusInterval = 5;
+
+/// <summary>
+/// Monotonic clock the hold time is measured on
+/// </summary>
+/// <returns>microseconds</returns>
+static long long NowMicroseconds( )
+{
+#ifdef _WIN32
+	LARGE_INTEGER now;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter( &now );
+	QueryPerformanceFrequency( &frequency );
+	return static_cast<long long>( now.QuadPart * 1.0e6 / static_cast<double>(frequency.QuadPart) );
+#else
+	timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return static_cast<long long>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+/// <summary>
+/// Entry point
+/// </summary>
+/// <param name="argc">number of arguments</param>
+/// <param name="argv">port, echo port and optional IPv4 multicast group</param>
+/// <returns>0 if successful, 1 otherwise</returns>
+int main( int argc, char * argv[] )
+{
+	if ( argc < 3 )
+	{
+		fprintf( stderr, "usage: PoseEcho <port> <echo port> [multicast group]\n" );
+		return 1;
+	}
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	WSAStartup( MAKEWORD(2, 2), &wsaData );
+#endif
+
+	SOCKET s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( INVALID_SOCKET == s )
+	{
+		fprintf( stderr, "socket failed\n" );
+		return 1;
+	}
+
+	// several receivers may share a multicast port on one machine
+	int reuse = 1;
+	setsockopt( s, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse) );
+
+	sockaddr_in local;
+	memset( &local, 0, sizeof(local) );
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl( INADDR_ANY );
+	local.sin_port = htons( static_cast<unsigned short>( atoi( argv[1] ) ) );
+	if ( 0 != bind( s, (sockaddr *)&local, sizeof(local) ) )
+	{
+		fprintf( stderr, "cannot bind port %s\n", argv[1] );
+		closesocket( s );
+		return 1;
+	}
+
+	if ( argc > 3 )
+	{
+		ip_mreq membership;
+		memset( &membership, 0, sizeof(membership) );
+		inet_pton( AF_INET, argv[3], &membership.imr_multiaddr );
+		membership.imr_interface.s_addr = htonl( INADDR_ANY );
+		if ( 0 != setsockopt( s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&membership, sizeof(membership) ) )
+		{
+			fprintf( stderr, "cannot join %s\n", argv[3] );
+			closesocket( s );
+			return 1;
+		}
+	}
+
+	unsigned short echoPort = htons( static_cast<unsigned short>( atoi( argv[2] ) ) );
+
+	unsigned long long received = 0;
+	unsigned long long echoed = 0;
+	unsigned long long lost = 0;
+	unsigned int nextSequence[SUBSCRIBER_STREAM_COUNT] = { 0 };
+	bool started[SUBSCRIBER_STREAM_COUNT] = { false };
+	long long lastStatus = NowMicroseconds();
+
+	unsigned char datagram[1500];
+	unsigned char echo[POSE_ECHO_SIZE];
+
+	while ( true )
+	{
+		sockaddr_in from;
+		socklen_t fromLength = sizeof(from);
+		int size = recvfrom( s, (char *)datagram, sizeof(datagram), 0, (sockaddr *)&from, &fromLength );
+		long long arrival = NowMicroseconds();
+
+		// datagrams without the header are 24 or 48 bytes and carry no send time
+		if ( size <= POSE_PACKET_HEADER_SIZE || 24 == size || 48 == size )
+		{
+			continue;
+		}
+		received++;
+
+		unsigned int sequence;
+		unsigned int stream;
+		PosePacketReadHeader( datagram, sequence, stream );
+		if ( stream < SUBSCRIBER_STREAM_COUNT )
+		{
+			if ( started[stream] && sequence > nextSequence[stream] )
+			{
+				lost += sequence - nextSequence[stream];
+			}
+			started[stream] = true;
+			nextSequence[stream] = sequence + 1;
+		}
+
+		// back to the machine it came from, on the echo port
+		from.sin_port = echoPort;
+		PoseEchoWrite( echo, datagram, static_cast<unsigned int>( NowMicroseconds() - arrival ) );
+		if ( static_cast<int>(sizeof(echo)) == sendto( s, (const char *)echo, sizeof(echo), 0, (const sockaddr *)&from, sizeof(from) ) )
+		{
+			echoed++;
+		}
+
+		if ( arrival - lastStatus >= g_StatusInterval * 1000000LL )
+		{
+			unsigned int sendTime;
+			unsigned int captureToSend;
+			PosePacketReadTiming( datagram, sendTime, captureToSend );
+
+			printf( "received %llu, echoed %llu, lost %llu", received, echoed, lost );
+			if ( POSE_PACKET_NO_CAPTURE != captureToSend )
+			{
+				printf( ", capture to send %.1f ms", captureToSend / 1000.0 );
+			}
+			printf( "\n" );
+			fflush( stdout );
+			lastStatus = arrival;
+		}
+	}
+}
@@ -0,0 +1,187 @@
+//------------------------------------------------------------------------------
+// <copyright file="PosePacket.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Layout of the pose datagrams, shared with receivers. Only depends on the C library,
+// so a receiver can include it on any platform.
+
+#pragma once
+
+// Streams a destination can receive
+#define SUBSCRIBER_STREAM_EYES          0   // "eyes": left and right eye of the active user
+#define SUBSCRIBER_STREAM_USER          1   // "user": eyes, right elbow and right hand of the active user
+#define SUBSCRIBER_STREAM_UPPER         2   // "upper": head, shoulder center, spine, shoulders, elbows, wrists and hands
+#define SUBSCRIBER_STREAM_SKELETON      3   // "skeleton": all 20 joints in NUI_SKELETON_POSITION_INDEX order
+#define SUBSCRIBER_STREAM_BONES         4   // "bones": rotation of all 20 bones relative to their parent bone
+#define SUBSCRIBER_STREAM_COUNT         5
+
+// Floats of each stream, x, y and z in inches per eye or joint, x, y, z and w per bone
+#define SUBSCRIBER_STREAM_EYES_VALUES       6
+#define SUBSCRIBER_STREAM_USER_VALUES       12
+#define SUBSCRIBER_STREAM_UPPER_VALUES      33
+#define SUBSCRIBER_STREAM_SKELETON_VALUES   60
+#define SUBSCRIBER_STREAM_BONES_VALUES      80
+#define SUBSCRIBER_STREAM_MAX_VALUES        SUBSCRIBER_STREAM_BONES_VALUES
+
+#define SUBSCRIBER_STREAM_BIT(stream)   ( 1u << (stream) )
+#define SUBSCRIBER_STREAM_ALL           ( ( 1u << SUBSCRIBER_STREAM_COUNT ) - 1 )
+
+// Sequenced datagrams (multicast and compact) start with this header, big endian:
+//   bytes 0-3  sequence number, counted per stream, a gap means lost datagrams
+//   bytes 4-5  stream, SUBSCRIBER_STREAM_*
+//   byte  6    encoding of what follows, POSE_ENCODING_*
+//   byte  7    delta only: how many sequence numbers back its keyframe is, otherwise 0
+//   bytes 8-11 send time, microseconds of the tracker's clock, the low 32 bits
+//   bytes 12-15 microseconds from the sensor capturing the frame to the send time,
+//              POSE_PACKET_NO_CAPTURE if the tracker does not know the capture time
+#define POSE_PACKET_HEADER_SIZE         16
+#define POSE_PACKET_NO_CAPTURE          0xFFFFFFFFu
+
+// A receiver that measures the latency sends the header of every sequenced datagram back
+// to the tracker's echo port, followed by, big endian:
+//   bytes 16-19 microseconds the receiver held the datagram before echoing it
+#define POSE_ECHO_SIZE                  ( POSE_PACKET_HEADER_SIZE + 4 )
+
+// Encodings of the values behind the header, see PoseCodec.h for the compact ones
+#define POSE_ENCODING_FLOAT             0   // the same floats a datagram without header holds
+#define POSE_ENCODING_KEYFRAME          1   // 16-bit millimetres per value
+#define POSE_ENCODING_DELTA             2   // 8-bit millimetres per value, added to the keyframe
+
+/// <summary>
+/// Number of values a stream holds
+/// </summary>
+/// <param name="stream">SUBSCRIBER_STREAM_*</param>
+/// <returns>number of floats, 0 for an unknown stream</returns>
+inline int PoseStreamValueCount( unsigned int stream )
+{
+	static const int valueCounts[SUBSCRIBER_STREAM_COUNT] =
+	{
+		SUBSCRIBER_STREAM_EYES_VALUES,
+		SUBSCRIBER_STREAM_USER_VALUES,
+		SUBSCRIBER_STREAM_UPPER_VALUES,
+		SUBSCRIBER_STREAM_SKELETON_VALUES,
+		SUBSCRIBER_STREAM_BONES_VALUES
+	};
+
+	return ( stream < SUBSCRIBER_STREAM_COUNT ) ? valueCounts[stream] : 0;
+}
+
+/// <summary>
+/// Whether the values of a stream are inches, which the compact encodings take. The
+/// others are always sent as floats
+/// </summary>
+/// <param name="stream">SUBSCRIBER_STREAM_*</param>
+/// <returns>true for a stream of positions</returns>
+inline bool PoseStreamIsCompactable( unsigned int stream )
+{
+	return stream < SUBSCRIBER_STREAM_BONES;
+}
+
+/// <summary>
+/// Write a sequenced datagram header
+/// </summary>
+/// <param name="pHeader">POSE_PACKET_HEADER_SIZE bytes to write</param>
+/// <param name="sequence">sequence number of the datagram in its stream</param>
+/// <param name="stream">SUBSCRIBER_STREAM_*</param>
+/// <param name="encoding">POSE_ENCODING_* of the values that follow</param>
+/// <param name="keyframeDistance">sequence numbers back to the keyframe of a delta</param>
+inline void PosePacketWriteHeader( unsigned char * pHeader, unsigned int sequence, unsigned int stream,
+								   unsigned int encoding = POSE_ENCODING_FLOAT, unsigned int keyframeDistance = 0 )
+{
+	pHeader[0] = static_cast<unsigned char>( sequence >> 24 );
+	pHeader[1] = static_cast<unsigned char>( sequence >> 16 );
+	pHeader[2] = static_cast<unsigned char>( sequence >> 8 );
+	pHeader[3] = static_cast<unsigned char>( sequence );
+	pHeader[4] = static_cast<unsigned char>( stream >> 8 );
+	pHeader[5] = static_cast<unsigned char>( stream );
+	pHeader[6] = static_cast<unsigned char>( encoding );
+	pHeader[7] = static_cast<unsigned char>( keyframeDistance );
+}
+
+/// <summary>
+/// Write the timing of a sequenced datagram into its header
+/// </summary>
+/// <param name="pHeader">POSE_PACKET_HEADER_SIZE bytes to write</param>
+/// <param name="sendTime">microseconds of the tracker's clock when the datagram is sent</param>
+/// <param name="captureToSend">microseconds since the capture, POSE_PACKET_NO_CAPTURE if unknown</param>
+inline void PosePacketWriteTiming( unsigned char * pHeader, unsigned int sendTime, unsigned int captureToSend )
+{
+	pHeader[8] = static_cast<unsigned char>( sendTime >> 24 );
+	pHeader[9] = static_cast<unsigned char>( sendTime >> 16 );
+	pHeader[10] = static_cast<unsigned char>( sendTime >> 8 );
+	pHeader[11] = static_cast<unsigned char>( sendTime );
+	pHeader[12] = static_cast<unsigned char>( captureToSend >> 24 );
+	pHeader[13] = static_cast<unsigned char>( captureToSend >> 16 );
+	pHeader[14] = static_cast<unsigned char>( captureToSend >> 8 );
+	pHeader[15] = static_cast<unsigned char>( captureToSend );
+}
+
+/// <summary>
+/// Read a sequenced datagram header
+/// </summary>
+/// <param name="pHeader">POSE_PACKET_HEADER_SIZE bytes received</param>
+/// <param name="sequence">receives the sequence number</param>
+/// <param name="stream">receives the stream</param>
+inline void PosePacketReadHeader( const unsigned char * pHeader, unsigned int & sequence, unsigned int & stream )
+{
+	sequence = ( static_cast<unsigned int>(pHeader[0]) << 24 ) | ( static_cast<unsigned int>(pHeader[1]) << 16 ) |
+			   ( static_cast<unsigned int>(pHeader[2]) << 8 ) | static_cast<unsigned int>(pHeader[3]);
+	stream = ( static_cast<unsigned int>(pHeader[4]) << 8 ) | static_cast<unsigned int>(pHeader[5]);
+}
+
+/// <summary>
+/// Read how the values behind a sequenced datagram header are encoded
+/// </summary>
+/// <param name="pHeader">POSE_PACKET_HEADER_SIZE bytes received</param>
+/// <param name="encoding">receives the POSE_ENCODING_*</param>
+/// <param name="keyframeDistance">receives the sequence numbers back to the keyframe of a delta</param>
+inline void PosePacketReadEncoding( const unsigned char * pHeader, unsigned int & encoding, unsigned int & keyframeDistance )
+{
+	encoding = pHeader[6];
+	keyframeDistance = pHeader[7];
+}
+
+/// <summary>
+/// Read the timing of a sequenced datagram
+/// </summary>
+/// <param name="pHeader">POSE_PACKET_HEADER_SIZE bytes received</param>
+/// <param name="sendTime">receives the microseconds of the tracker's clock it was sent at, low 32 bits</param>
+/// <param name="captureToSend">receives the microseconds since the capture, POSE_PACKET_NO_CAPTURE if unknown</param>
+inline void PosePacketReadTiming( const unsigned char * pHeader, unsigned int & sendTime, unsigned int & captureToSend )
+{
+	sendTime = ( static_cast<unsigned int>(pHeader[8]) << 24 ) | ( static_cast<unsigned int>(pHeader[9]) << 16 ) |
+			   ( static_cast<unsigned int>(pHeader[10]) << 8 ) | static_cast<unsigned int>(pHeader[11]);
+	captureToSend = ( static_cast<unsigned int>(pHeader[12]) << 24 ) | ( static_cast<unsigned int>(pHeader[13]) << 16 ) |
+					( static_cast<unsigned int>(pHeader[14]) << 8 ) | static_cast<unsigned int>(pHeader[15]);
+}
+
+/// <summary>
+/// Write the echo of a sequenced datagram
+/// </summary>
+/// <param name="pEcho">POSE_ECHO_SIZE bytes to write</param>
+/// <param name="pHeader">POSE_PACKET_HEADER_SIZE bytes of the datagram received</param>
+/// <param name="holdTime">microseconds from receiving the datagram to sending the echo</param>
+inline void PoseEchoWrite( unsigned char * pEcho, const unsigned char * pHeader, unsigned int holdTime )
+{
+	for ( int i = 0; i < POSE_PACKET_HEADER_SIZE; i++ )
+	{
+		pEcho[i] = pHeader[i];
+	}
+	pEcho[POSE_PACKET_HEADER_SIZE] = static_cast<unsigned char>( holdTime >> 24 );
+	pEcho[POSE_PACKET_HEADER_SIZE + 1] = static_cast<unsigned char>( holdTime >> 16 );
+	pEcho[POSE_PACKET_HEADER_SIZE + 2] = static_cast<unsigned char>( holdTime >> 8 );
+	pEcho[POSE_PACKET_HEADER_SIZE + 3] = static_cast<unsigned char>( holdTime );
+}
+
+/// <summary>
+/// Read the hold time of an echo, the rest is read like a datagram header
+/// </summary>
+/// <param name="pEcho">POSE_ECHO_SIZE bytes received</param>
+/// <returns>microseconds the receiver held the datagram</returns>
+inline unsigned int PoseEchoReadHoldTime( const unsigned char * pEcho )
+{
+	return ( static_cast<unsigned int>(pEcho[POSE_PACKET_HEADER_SIZE]) << 24 ) | ( static_cast<unsigned int>(pEcho[POSE_PACKET_HEADER_SIZE + 1]) << 16 ) |
+		   ( static_cast<unsigned int>(pEcho[POSE_PACKET_HEADER_SIZE + 2]) << 8 ) | static_cast<unsigned int>(pEcho[POSE_PACKET_HEADER_SIZE + 3]);
+}
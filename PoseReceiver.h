@@ -0,0 +1,487 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseReceiver.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Receiver side of the pose datagrams. Header only, like PosePacket.h, and it never
+// allocates: the application receives the datagrams its own way and hands them in, then
+// asks for the pose at whatever time it renders. Compact datagrams are decoded with
+// PoseCodec.h.
+//
+// Sequenced datagrams carry their send time and how long before it the frame was captured,
+// on the tracker's clock. The receiver places such a frame at its capture time plus a clock
+// offset that follows the fastest arrivals, which removes the network jitter and keeps the
+// frames as far apart as the sensor captured them, whatever rate limit or encoding the
+// stream has. A frame without a sequence number is placed at its arrival time. Frames are
+// kept in sequence order, a few of them, and a pose is interpolated between the two around
+// the time asked for, or extrapolated a little past the newest one.
+
+#pragma once
+
+#include <string.h>
+#include "PosePacket.h"
+#include "PoseCodec.h"
+
+#define POSE_RECEIVER_MAX_FLOATS        SUBSCRIBER_STREAM_MAX_VALUES
+#define POSE_RECEIVER_DEPTH             16          // frames kept, half a second at 30 frames per second
+#define POSE_RECEIVER_MAX_EXTRAPOLATION 100.0       // ms past the newest frame a pose is predicted
+#define POSE_RECEIVER_RESYNC            1000        // sequence jump taken as a restarted tracker
+#define POSE_RECEIVER_OFFSET_CREEP      0.01        // ms per ms the clock offset may rise, covers a slower sender
+
+/// <summary>
+/// One decoded datagram
+/// </summary>
+struct PoseDatagram
+{
+	bool          sequenced;                      // had the PosePacket.h header
+	unsigned int  sequence;                       // 0 unless sequenced
+	unsigned int  stream;                         // SUBSCRIBER_STREAM_*
+	unsigned int  encoding;                       // POSE_ENCODING_*
+	unsigned int  keyframeDistance;
+	unsigned int  sendTime;                       // tracker microseconds, low 32 bits, 0 unless sequenced
+	unsigned int  captureToSend;                  // microseconds, POSE_PACKET_NO_CAPTURE if unknown
+	int           floatCount;                     // 0 until a compact payload is decoded
+	float         values[POSE_RECEIVER_MAX_FLOATS];
+	const unsigned char * pPayload;               // compact only, points into the datagram
+	int           payloadSize;
+};
+
+/// <summary>
+/// Decode a datagram of any stream, with or without the sequence header. The values of
+/// a compact datagram are left to a PoseDecoder
+/// </summary>
+/// <param name="pData">datagram as received</param>
+/// <param name="size">bytes received</param>
+/// <param name="datagram">receives the decoded datagram</param>
+/// <returns>false if the size matches no stream</returns>
+inline bool PoseDatagramDecode( const void * pData, int size, PoseDatagram & datagram )
+{
+	const unsigned char * pBytes = static_cast<const unsigned char *>(pData);
+
+	// a datagram without header is 24, 48, 132, 240 or 320 bytes, no sequenced one is
+	unsigned int plainStream = SUBSCRIBER_STREAM_COUNT;
+	for ( unsigned int stream = 0; stream < SUBSCRIBER_STREAM_COUNT; stream++ )
+	{
+		if ( PoseCodecPayloadSize( POSE_ENCODING_FLOAT, PoseStreamValueCount( stream ) ) == size )
+		{
+			plainStream = stream;
+		}
+	}
+
+	if ( plainStream < SUBSCRIBER_STREAM_COUNT )
+	{
+		datagram.sequenced = false;
+		datagram.sequence = 0;
+		datagram.stream = plainStream;
+		datagram.encoding = POSE_ENCODING_FLOAT;
+		datagram.keyframeDistance = 0;
+		datagram.sendTime = 0;
+		datagram.captureToSend = POSE_PACKET_NO_CAPTURE;
+	}
+	else if ( size > POSE_PACKET_HEADER_SIZE )
+	{
+		datagram.sequenced = true;
+		PosePacketReadHeader( pBytes, datagram.sequence, datagram.stream );
+		PosePacketReadEncoding( pBytes, datagram.encoding, datagram.keyframeDistance );
+		PosePacketReadTiming( pBytes, datagram.sendTime, datagram.captureToSend );
+		pBytes += POSE_PACKET_HEADER_SIZE;
+		size -= POSE_PACKET_HEADER_SIZE;
+
+		if ( datagram.stream >= SUBSCRIBER_STREAM_COUNT ||
+			 PoseCodecPayloadSize( datagram.encoding, PoseStreamValueCount( datagram.stream ) ) != size )
+		{
+			return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	datagram.pPayload = pBytes;
+	datagram.payloadSize = size;
+
+	if ( POSE_ENCODING_FLOAT != datagram.encoding )
+	{
+		datagram.floatCount = 0;
+		return true;
+	}
+
+	// the floats are in the tracker's byte order, which is the receiver's on x86 and ARM
+	datagram.floatCount = size / static_cast<int>(sizeof(float));
+	memcpy( datagram.values, pBytes, size );
+	return true;
+}
+
+/// <summary>
+/// How GetPose came by the pose
+/// </summary>
+enum PoseSampleResult
+{
+	POSE_NONE = 0,          // no frame received yet
+	POSE_INTERPOLATED,      // between two received frames
+	POSE_EXTRAPOLATED,      // predicted past the newest frame
+	POSE_HELD               // a received frame as it is, there was nothing to blend it with
+};
+
+/// <summary>
+/// What the receiver has seen of the stream
+/// </summary>
+struct PoseReceiverStats
+{
+	unsigned long long  received;       // datagrams of the stream
+	unsigned long long  lost;           // sequence numbers that never arrived, or could not be decoded
+	unsigned long long  reordered;      // arrived after a later one, still in time
+	unsigned long long  late;           // arrived too late to be kept, so still counted lost
+	unsigned long long  duplicates;
+	unsigned long long  resyncs;        // restarts of the sequence numbers
+	unsigned long long  undecodable;    // compact deltas whose keyframe was lost
+};
+
+class PoseReceiver
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="stream">SUBSCRIBER_STREAM_* to receive, datagrams of other streams are ignored</param>
+	explicit PoseReceiver( unsigned int stream = SUBSCRIBER_STREAM_EYES ) :
+		m_stream(stream)
+	{
+		Reset();
+	}
+
+	/// <summary>
+	/// Forget every frame and counter
+	/// </summary>
+	void Reset( )
+	{
+		memset( &m_stats, 0, sizeof(m_stats) );
+		m_decoder.Reset();
+		Restart();
+	}
+
+	/// <summary>
+	/// Hand in a received datagram
+	/// </summary>
+	/// <param name="pData">datagram as received</param>
+	/// <param name="size">bytes received</param>
+	/// <param name="arrivalTime">receiver clock when it arrived, ms</param>
+	/// <returns>true if the frame was kept</returns>
+	bool Receive( const void * pData, int size, double arrivalTime )
+	{
+		PoseDatagram datagram;
+		if ( !PoseDatagramDecode( pData, size, datagram ) || m_stream != datagram.stream )
+		{
+			return false;
+		}
+
+		if ( POSE_ENCODING_FLOAT != datagram.encoding )
+		{
+			datagram.floatCount = m_decoder.Decode( datagram.sequence, datagram.encoding, datagram.keyframeDistance,
+													datagram.pPayload, datagram.payloadSize, datagram.values );
+			if ( 0 == datagram.floatCount )
+			{
+				m_stats.undecodable++;
+				return false;
+			}
+		}
+
+		return Receive( datagram, arrivalTime );
+	}
+
+	/// <summary>
+	/// Hand in a decoded datagram, with its values
+	/// </summary>
+	/// <param name="datagram">datagram of this receiver's stream</param>
+	/// <param name="arrivalTime">receiver clock when it arrived, ms</param>
+	/// <returns>true if the frame was kept</returns>
+	bool Receive( const PoseDatagram & datagram, double arrivalTime )
+	{
+		m_stats.received++;
+
+		// the frame's place in the stream
+		long long index;
+		if ( !datagram.sequenced )
+		{
+			index = m_newestIndex + 1;
+			m_sequenced = false;
+		}
+		else if ( !m_started )
+		{
+			index = 0;
+			m_sequenced = true;
+		}
+		else
+		{
+			int delta = static_cast<int>( datagram.sequence - m_newestSequence );
+			if ( !m_sequenced || delta > POSE_RECEIVER_RESYNC || delta < -POSE_RECEIVER_RESYNC )
+			{
+				m_stats.resyncs++;
+				Restart();
+				m_sequenced = true;
+				index = 0;
+			}
+			else
+			{
+				index = m_newestIndex + delta;
+			}
+		}
+
+		if ( m_started && index <= m_newestIndex )
+		{
+			// older than the newest frame: a duplicate, or one the network reordered
+			if ( Find( index ) >= 0 )
+			{
+				m_stats.duplicates++;
+				return false;
+			}
+
+			if ( 0 == m_count || index < m_entries[0].index )
+			{
+				m_stats.late++;
+				return false;
+			}
+
+			// it was counted lost when the gap opened, and is not any more now it is kept
+			if ( m_stats.lost > 0 )
+			{
+				m_stats.lost--;
+			}
+			m_stats.reordered++;
+		}
+		else
+		{
+			if ( m_started )
+			{
+				m_stats.lost += static_cast<unsigned long long>( index - m_newestIndex - 1 );
+			}
+			m_newestIndex = index;
+			m_newestSequence = datagram.sequence;
+			m_started = true;
+		}
+
+		if ( !m_sequenced )
+		{
+			Insert( index, arrivalTime, datagram );
+			return true;
+		}
+
+		// follow the fastest arrival, and let the offset rise slowly for a slower sender clock
+		double captureTime = CaptureTime( datagram );
+		double offset = arrivalTime - captureTime;
+		if ( 0 == m_count )
+		{
+			m_offset = offset;
+			m_offsetTime = arrivalTime;
+		}
+		else
+		{
+			double crept = m_offset;
+			if ( arrivalTime > m_offsetTime )
+			{
+				crept += ( arrivalTime - m_offsetTime ) * POSE_RECEIVER_OFFSET_CREEP;
+				m_offsetTime = arrivalTime;
+			}
+			m_offset = ( offset < crept ) ? offset : crept;
+		}
+
+		Insert( index, captureTime, datagram );
+		return true;
+	}
+
+	/// <summary>
+	/// Pose at a time on the receiver clock. Asking for a time about a frame period in the
+	/// past interpolates between received frames, asking for the present extrapolates
+	/// </summary>
+	/// <param name="time">receiver clock, ms</param>
+	/// <param name="pValues">receives GetFloatCount floats</param>
+	/// <returns>how the pose was found, POSE_NONE leaves pValues untouched</returns>
+	PoseSampleResult GetPose( double time, float * pValues ) const
+	{
+		if ( 0 == m_count )
+		{
+			return POSE_NONE;
+		}
+
+		const Entry & oldest = m_entries[0];
+		if ( 1 == m_count || time <= EntryTime( oldest ) )
+		{
+			const Entry & held = ( time <= EntryTime( oldest ) ) ? oldest : m_entries[m_count - 1];
+			memcpy( pValues, held.values, m_floatCount * sizeof(float) );
+			return POSE_HELD;
+		}
+
+		for ( int i = 1; i < m_count; i++ )
+		{
+			const Entry & later = m_entries[i];
+			if ( time <= EntryTime( later ) )
+			{
+				Blend( m_entries[i - 1], later, time, pValues );
+				return POSE_INTERPOLATED;
+			}
+		}
+
+		// past the newest frame, carry the last motion forward for a little while
+		const Entry & newest = m_entries[m_count - 1];
+		double limit = EntryTime( newest ) + POSE_RECEIVER_MAX_EXTRAPOLATION;
+		Blend( m_entries[m_count - 2], newest, ( time < limit ) ? time : limit, pValues );
+		return POSE_EXTRAPOLATED;
+	}
+
+	/// <summary>
+	/// Receiver clock time of the newest frame
+	/// </summary>
+	/// <returns>ms, 0 if no frame was received</returns>
+	double GetNewestTime( ) const
+	{
+		return ( 0 == m_count ) ? 0.0 : EntryTime( m_entries[m_count - 1] );
+	}
+
+	int GetFloatCount( ) const { return m_floatCount; }
+
+	int GetBufferedCount( ) const { return m_count; }
+
+	const PoseReceiverStats & GetStats( ) const { return m_stats; }
+
+private:
+	struct Entry
+	{
+		long long       index;          // place in the stream, sequence numbers unwrapped
+		double          time;           // ms, capture time on the tracker clock if sequenced, else arrival time
+		float           values[POSE_RECEIVER_MAX_FLOATS];
+	};
+
+	/// <summary>
+	/// Drop the frames, keep the counters, e.g. when the tracker restarted
+	/// </summary>
+	void Restart( )
+	{
+		m_count = 0;
+		m_floatCount = 0;
+		m_started = false;
+		m_sequenced = false;
+		m_newestIndex = -1;
+		m_newestSequence = 0;
+		m_newestCapture = 0;
+		m_newestCaptureTime = 0;
+		m_offset = 0.0;
+		m_offsetTime = 0.0;
+	}
+
+	/// <summary>
+	/// Capture time of a sequenced frame on the tracker clock, its 32 bits of microseconds
+	/// unwrapped against the newest frame
+	/// </summary>
+	/// <returns>ms</returns>
+	double CaptureTime( const PoseDatagram & datagram )
+	{
+		// a frame of unknown capture time was at least captured before it was sent
+		unsigned int capture = datagram.sendTime;
+		if ( POSE_PACKET_NO_CAPTURE != datagram.captureToSend )
+		{
+			capture -= datagram.captureToSend;
+		}
+
+		long long time = static_cast<long long>(capture);
+		if ( 0 != m_count )
+		{
+			time = m_newestCaptureTime + static_cast<int>( capture - m_newestCapture );
+		}
+		if ( 0 == m_count || time > m_newestCaptureTime )
+		{
+			m_newestCapture = capture;
+			m_newestCaptureTime = time;
+		}
+
+		return static_cast<double>(time) / 1000.0;
+	}
+
+	/// <summary>
+	/// Receiver clock time of a buffered frame
+	/// </summary>
+	double EntryTime( const Entry & entry ) const
+	{
+		return m_sequenced ? m_offset + entry.time : entry.time;
+	}
+
+	/// <summary>
+	/// Position of a buffered frame
+	/// </summary>
+	/// <returns>index into m_entries, -1 if it is not buffered</returns>
+	int Find( long long index ) const
+	{
+		for ( int i = 0; i < m_count; i++ )
+		{
+			if ( m_entries[i].index == index )
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	/// <summary>
+	/// Keep a frame in sequence order, dropping the oldest when the buffer is full
+	/// </summary>
+	void Insert( long long index, double time, const PoseDatagram & datagram )
+	{
+		if ( POSE_RECEIVER_DEPTH == m_count )
+		{
+			memmove( &m_entries[0], &m_entries[1], ( m_count - 1 ) * sizeof(Entry) );
+			m_count--;
+		}
+
+		int position = m_count;
+		while ( position > 0 && m_entries[position - 1].index > index )
+		{
+			position--;
+		}
+		memmove( &m_entries[position + 1], &m_entries[position], ( m_count - position ) * sizeof(Entry) );
+		m_count++;
+
+		Entry & entry = m_entries[position];
+		entry.index = index;
+		entry.time = time;
+		memcpy( entry.values, datagram.values, datagram.floatCount * sizeof(float) );
+		m_floatCount = datagram.floatCount;
+	}
+
+	/// <summary>
+	/// Blend two frames linearly, past the later one when time is
+	/// </summary>
+	void Blend( const Entry & earlier, const Entry & later, double time, float * pValues ) const
+	{
+		double start = EntryTime( earlier );
+		double span = EntryTime( later ) - start;
+		float weight = ( span > 0.0 ) ? static_cast<float>( ( time - start ) / span ) : 1.0f;
+
+		for ( int i = 0; i < m_floatCount; i++ )
+		{
+			pValues[i] = earlier.values[i] + ( later.values[i] - earlier.values[i] ) * weight;
+		}
+	}
+
+	unsigned int        m_stream;
+	PoseDecoder         m_decoder;
+
+	Entry               m_entries[POSE_RECEIVER_DEPTH];     // oldest first
+	int                 m_count;
+	int                 m_floatCount;
+
+	bool                m_started;
+	bool                m_sequenced;
+	long long           m_newestIndex;
+	unsigned int        m_newestSequence;
+
+	// tracker clock of the newest capture, as sent and unwrapped to microseconds, sequenced frames only
+	unsigned int        m_newestCapture;
+	long long           m_newestCaptureTime;
+
+	// receiver clock minus tracker clock, sequenced frames only
+	double              m_offset;
+	double              m_offsetTime;
+
+	PoseReceiverStats   m_stats;
+};
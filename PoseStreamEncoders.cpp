@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseStreamEncoders.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Joints of every stream, and the table of their encoders
+
+#include "stdafx.h"
+#include "PoseStreamEncoders.h"
+
+// "user": the eyes, then the right arm
+typedef PoseJoint< NUI_SKELETON_POSITION_ELBOW_RIGHT,
+		PoseJoint< NUI_SKELETON_POSITION_HAND_RIGHT > > UserJoints;
+
+// "upper": head, spine and both arms
+typedef PoseJoint< NUI_SKELETON_POSITION_HEAD,
+		PoseJoint< NUI_SKELETON_POSITION_SHOULDER_CENTER,
+		PoseJoint< NUI_SKELETON_POSITION_SPINE,
+		PoseJoint< NUI_SKELETON_POSITION_SHOULDER_LEFT,
+		PoseJoint< NUI_SKELETON_POSITION_ELBOW_LEFT,
+		PoseJoint< NUI_SKELETON_POSITION_WRIST_LEFT,
+		PoseJoint< NUI_SKELETON_POSITION_HAND_LEFT,
+		PoseJoint< NUI_SKELETON_POSITION_SHOULDER_RIGHT,
+		PoseJoint< NUI_SKELETON_POSITION_ELBOW_RIGHT,
+		PoseJoint< NUI_SKELETON_POSITION_WRIST_RIGHT,
+		PoseJoint< NUI_SKELETON_POSITION_HAND_RIGHT > > > > > > > > > > > UpperJoints;
+
+// "skeleton": every joint in NUI_SKELETON_POSITION_INDEX order
+typedef PoseJointRange< 0, NUI_SKELETON_POSITION_COUNT > SkeletonJoints;
+
+static_assert( SUBSCRIBER_STREAM_EYES_VALUES + 3 * UserJoints::count == SUBSCRIBER_STREAM_USER_VALUES, "user stream size" );
+static_assert( 3 * UpperJoints::count == SUBSCRIBER_STREAM_UPPER_VALUES, "upper stream size" );
+static_assert( 3 * SkeletonJoints::count == SUBSCRIBER_STREAM_SKELETON_VALUES, "skeleton stream size" );
+static_assert( 4 * NUI_SKELETON_POSITION_COUNT == SUBSCRIBER_STREAM_BONES_VALUES, "bones stream size" );
+
+/// <summary>
+/// Left and right eye, as the EyeEstimator placed them
+/// </summary>
+/// <param name="input">joints, eyes and bones of the active user</param>
+/// <param name="pOut">receives SUBSCRIBER_STREAM_EYES_VALUES values</param>
+static void EncodeEyes( const PoseStreamInput & input, float * pOut )
+{
+	for ( int i = 0; i < SUBSCRIBER_STREAM_EYES_VALUES; i++ )
+	{
+		pOut[i] = input.pEyes[i];
+	}
+}
+
+/// <summary>
+/// Rotation of every bone relative to its parent bone
+/// </summary>
+/// <param name="input">joints, eyes and bones of the active user</param>
+/// <param name="pOut">receives SUBSCRIBER_STREAM_BONES_VALUES values</param>
+static void EncodeBones( const PoseStreamInput & input, float * pOut )
+{
+	for ( int i = 0; i < SUBSCRIBER_STREAM_BONES_VALUES; i++ )
+	{
+		pOut[i] = input.pBones[i];
+	}
+}
+
+/// <summary>
+/// A stream of joints only
+/// </summary>
+template< class Joints >
+static void EncodeJoints( const PoseStreamInput & input, float * pOut )
+{
+	Joints::Pack( input.pX, input.pY, input.pZ, pOut );
+}
+
+/// <summary>
+/// A stream of the eyes followed by joints
+/// </summary>
+template< class Joints >
+static void EncodeEyesAnd( const PoseStreamInput & input, float * pOut )
+{
+	EncodeEyes( input, pOut );
+	Joints::Pack( input.pX, input.pY, input.pZ, pOut + SUBSCRIBER_STREAM_EYES_VALUES );
+}
+
+// Indexed by SUBSCRIBER_STREAM_*
+static const PoseStreamEncoder g_StreamEncoders[SUBSCRIBER_STREAM_COUNT] =
+{
+	EncodeEyes,
+	EncodeEyesAnd< UserJoints >,
+	EncodeJoints< UpperJoints >,
+	EncodeJoints< SkeletonJoints >,
+	EncodeBones
+};
+
+/// <summary>
+/// Encoder of a stream, SUBSCRIBER_STREAM_*
+/// </summary>
+/// <param name="stream">SUBSCRIBER_STREAM_*</param>
+/// <returns>encoder, NULL for an unknown stream</returns>
+PoseStreamEncoder PoseStreamGetEncoder( unsigned int stream )
+{
+	return ( stream < SUBSCRIBER_STREAM_COUNT ) ? g_StreamEncoders[stream] : NULL;
+}
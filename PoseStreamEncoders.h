@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseStreamEncoders.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the encoders that fill the values of each stream from the active user's
+// joints, eyes and bones. The joints of a stream are a list fixed at compile time; PoseJoint expands it
+// into one copy per joint, so an encoder runs straight through without a loop or a branch
+// on the joint index. The encoders are looked up by stream in a table, and the frame path
+// only runs those of the streams some destination receives.
+
+#pragma once
+
+#include "NuiApi.h"
+#include "PosePacket.h"
+
+/// <summary>
+/// What the streams of the active user are encoded from
+/// </summary>
+struct PoseStreamInput
+{
+	const float *   pX;             // x of every joint in the display frame (inches), NUI_SKELETON_POSITION_COUNT
+	const float *   pY;             // y of every joint
+	const float *   pZ;             // z of every joint
+	const float *   pEyes;          // left then right eye from the EyeEstimator, x, y and z each (inches)
+	const float *   pBones;         // hierarchical rotation of every bone from BoneOrientations, x, y, z and w each
+};
+
+/// <summary>
+/// Fills the values of one stream
+/// </summary>
+/// <param name="input">joints, eyes and bones of the active user</param>
+/// <param name="pOut">receives PoseStreamValueCount values</param>
+typedef void (*PoseStreamEncoder)( const PoseStreamInput & input, float * pOut );
+
+/// <summary>
+/// End of a joint list
+/// </summary>
+struct PoseJointEnd
+{
+	enum { count = 0 };
+
+	static void Pack( const float *, const float *, const float *, float * )
+	{
+	}
+};
+
+/// <summary>
+/// A joint followed by the rest of the list, packed as x, y, z each
+/// </summary>
+template< int Joint, class Next = PoseJointEnd >
+struct PoseJoint
+{
+	enum { count = 1 + Next::count };
+
+	static void Pack( const float * pX, const float * pY, const float * pZ, float * pOut )
+	{
+		pOut[0] = pX[Joint];
+		pOut[1] = pY[Joint];
+		pOut[2] = pZ[Joint];
+		Next::Pack( pX, pY, pZ, pOut + 3 );
+	}
+};
+
+/// <summary>
+/// Count joints in index order from First, packed as x, y, z each
+/// </summary>
+template< int First, int Count >
+struct PoseJointRange
+{
+	enum { count = Count };
+
+	static void Pack( const float * pX, const float * pY, const float * pZ, float * pOut )
+	{
+		pOut[0] = pX[First];
+		pOut[1] = pY[First];
+		pOut[2] = pZ[First];
+		PoseJointRange< First + 1, Count - 1 >::Pack( pX, pY, pZ, pOut + 3 );
+	}
+};
+
+template< int First >
+struct PoseJointRange< First, 0 > : public PoseJointEnd
+{
+};
+
+/// <summary>
+/// Encoder of a stream, SUBSCRIBER_STREAM_*
+/// </summary>
+/// <param name="stream">SUBSCRIBER_STREAM_*</param>
+/// <returns>encoder, NULL for an unknown stream</returns>
+PoseStreamEncoder PoseStreamGetEncoder( unsigned int stream );
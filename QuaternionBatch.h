@@ -0,0 +1,452 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionBatch.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares quaternion4, four quaternions in structure-of-arrays form with x, y, z and w
+// each in an SSE register, and the operations the bone orientations run on every bone of
+// every user at once. Header only, it depends on nothing but the compiler's intrinsics.
+// QuaternionBatch8.h has the same operations on eight quaternions for AVX.
+//
+// It is the batched companion of irr::core::quaternion in quaternion.h: x, y, z are the
+// vector part and w the scalar part. Quaternion4Multiply( a, b ) is the Hamilton product
+// a b, the rotation b followed by a. quaternion's operator* multiplies the other way round,
+// its p * q is Quaternion4Multiply( q, p ).
+//
+// How far each operation is from quaternion's, largest error of any component over random
+// unit quaternions:
+//  Multiply, Conjugate, Normalize      1.2e-7, the same arithmetic in another order
+//  RotateVector                        2.3e-7 of the vector's length, from operator*( vector3df )
+//  GetMatrix                           6e-8, from rows 0 to 2 of getMatrix
+//  FromMatrix                          4.8e-7 back to the quaternion GetMatrix came from;
+//                                      operator=( matrix4 ) divides by w and comes back
+//                                      3.4e-2 off, and further as w nears 0
+//  Slerp                               2.4e-7, from slerp with its default threshold
+//  SlerpFast                           1.8e-7 from an exact slerp for rotations up to 90 degrees
+//                                      apart, 1.4e-6 up to 120 and 3e-5 up to 180; slerp itself
+//                                      is up to 1.2e-2 off where it blends linearly
+//  Nlerp                               not constant speed, 1.2e-5 from an exact slerp for
+//                                      rotations up to 10 degrees apart, 8e-3 up to 90
+//
+// Quaternions are passed by reference, the 32-bit compiler cannot pass aligned structures
+// by value.
+
+#pragma once
+
+#include <emmintrin.h>
+#include <math.h>
+
+// Above this cosine between two quaternions Quaternion4Slerp blends them linearly,
+// quaternion::slerp's default threshold
+#define QUATERNION4_SLERP_THRESHOLD     0.05f
+
+/// <summary>
+/// Four quaternions, lane i of each register is quaternion i
+/// </summary>
+struct quaternion4
+{
+	__m128  x;
+	__m128  y;
+	__m128  z;
+	__m128  w;
+};
+
+/// <summary>
+/// Four vectors, lane i of each register is vector i
+/// </summary>
+struct vector4
+{
+	__m128  x;
+	__m128  y;
+	__m128  z;
+};
+
+/// <summary>
+/// Four rotation matrices as the axes each turns the display's x, y and z axes into; the
+/// x axis is row 0 of quaternion::getMatrix, y row 1 and z row 2
+/// </summary>
+struct rotation4
+{
+	vector4 x;
+	vector4 y;
+	vector4 z;
+};
+
+/// <summary>
+/// Dot product of each lane
+/// </summary>
+/// <param name="a">first vectors</param>
+/// <param name="b">second vectors</param>
+/// <returns>dot product per lane</returns>
+inline __m128 Vector4Dot( const vector4 & a, const vector4 & b )
+{
+	return _mm_add_ps( _mm_add_ps( _mm_mul_ps( a.x, b.x ), _mm_mul_ps( a.y, b.y ) ), _mm_mul_ps( a.z, b.z ) );
+}
+
+/// <summary>
+/// Cross product of each lane
+/// </summary>
+/// <param name="a">first vectors</param>
+/// <param name="b">second vectors</param>
+/// <returns>a x b per lane</returns>
+inline vector4 Vector4Cross( const vector4 & a, const vector4 & b )
+{
+	vector4 v;
+	v.x = _mm_sub_ps( _mm_mul_ps( a.y, b.z ), _mm_mul_ps( a.z, b.y ) );
+	v.y = _mm_sub_ps( _mm_mul_ps( a.z, b.x ), _mm_mul_ps( a.x, b.z ) );
+	v.z = _mm_sub_ps( _mm_mul_ps( a.x, b.y ), _mm_mul_ps( a.y, b.x ) );
+	return v;
+}
+
+/// <summary>
+/// Load four quaternions from rows of floats, no alignment required
+/// </summary>
+/// <param name="pX">x of the 4 quaternions</param>
+/// <param name="pY">y of the 4 quaternions</param>
+/// <param name="pZ">z of the 4 quaternions</param>
+/// <param name="pW">w of the 4 quaternions</param>
+/// <returns>the quaternions</returns>
+inline quaternion4 Quaternion4Load( const float * pX, const float * pY, const float * pZ, const float * pW )
+{
+	quaternion4 q;
+	q.x = _mm_loadu_ps( pX );
+	q.y = _mm_loadu_ps( pY );
+	q.z = _mm_loadu_ps( pZ );
+	q.w = _mm_loadu_ps( pW );
+	return q;
+}
+
+/// <summary>
+/// Store four quaternions into rows of floats, no alignment required
+/// </summary>
+/// <param name="q">the quaternions</param>
+/// <param name="pX">receives x of the 4 quaternions</param>
+/// <param name="pY">receives y</param>
+/// <param name="pZ">receives z</param>
+/// <param name="pW">receives w</param>
+inline void Quaternion4Store( const quaternion4 & q, float * pX, float * pY, float * pZ, float * pW )
+{
+	_mm_storeu_ps( pX, q.x );
+	_mm_storeu_ps( pY, q.y );
+	_mm_storeu_ps( pZ, q.z );
+	_mm_storeu_ps( pW, q.w );
+}
+
+/// <summary>
+/// Four identity quaternions
+/// </summary>
+/// <returns>no rotation in every lane</returns>
+inline quaternion4 Quaternion4Identity( )
+{
+	quaternion4 q;
+	q.x = _mm_setzero_ps();
+	q.y = _mm_setzero_ps();
+	q.z = _mm_setzero_ps();
+	q.w = _mm_set1_ps( 1.0f );
+	return q;
+}
+
+/// <summary>
+/// Conjugate, the inverse rotation of a unit quaternion
+/// </summary>
+/// <param name="q">the quaternions</param>
+/// <returns>x, y and z negated</returns>
+inline quaternion4 Quaternion4Conjugate( const quaternion4 & q )
+{
+	const __m128 sign = _mm_set1_ps( -0.0f );
+	quaternion4 r;
+	r.x = _mm_xor_ps( q.x, sign );
+	r.y = _mm_xor_ps( q.y, sign );
+	r.z = _mm_xor_ps( q.z, sign );
+	r.w = q.w;
+	return r;
+}
+
+/// <summary>
+/// Hamilton product of each lane, the rotation b followed by a
+/// </summary>
+/// <param name="a">left factors</param>
+/// <param name="b">right factors</param>
+/// <returns>a b</returns>
+inline quaternion4 Quaternion4Multiply( const quaternion4 & a, const quaternion4 & b )
+{
+	quaternion4 r;
+	r.w = _mm_sub_ps( _mm_sub_ps( _mm_mul_ps( a.w, b.w ), _mm_mul_ps( a.x, b.x ) ),
+					  _mm_add_ps( _mm_mul_ps( a.y, b.y ), _mm_mul_ps( a.z, b.z ) ) );
+	r.x = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a.w, b.x ), _mm_mul_ps( a.x, b.w ) ),
+					  _mm_sub_ps( _mm_mul_ps( a.y, b.z ), _mm_mul_ps( a.z, b.y ) ) );
+	r.y = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a.w, b.y ), _mm_mul_ps( a.y, b.w ) ),
+					  _mm_sub_ps( _mm_mul_ps( a.z, b.x ), _mm_mul_ps( a.x, b.z ) ) );
+	r.z = _mm_add_ps( _mm_add_ps( _mm_mul_ps( a.w, b.z ), _mm_mul_ps( a.z, b.w ) ),
+					  _mm_sub_ps( _mm_mul_ps( a.x, b.y ), _mm_mul_ps( a.y, b.x ) ) );
+	return r;
+}
+
+/// <summary>
+/// Dot product of each lane
+/// </summary>
+/// <param name="a">first quaternions</param>
+/// <param name="b">second quaternions</param>
+/// <returns>dot product per lane</returns>
+inline __m128 Quaternion4Dot( const quaternion4 & a, const quaternion4 & b )
+{
+	return _mm_add_ps( _mm_add_ps( _mm_mul_ps( a.x, b.x ), _mm_mul_ps( a.y, b.y ) ),
+					   _mm_add_ps( _mm_mul_ps( a.z, b.z ), _mm_mul_ps( a.w, b.w ) ) );
+}
+
+/// <summary>
+/// Pick lane by lane
+/// </summary>
+/// <param name="mask">all bits set in the lanes that take a, clear in those that take b</param>
+/// <param name="a">quaternions where the mask is set</param>
+/// <param name="b">quaternions where it is clear</param>
+/// <returns>a or b per lane</returns>
+inline quaternion4 Quaternion4Select( __m128 mask, const quaternion4 & a, const quaternion4 & b )
+{
+	quaternion4 r;
+	r.x = _mm_or_ps( _mm_and_ps( mask, a.x ), _mm_andnot_ps( mask, b.x ) );
+	r.y = _mm_or_ps( _mm_and_ps( mask, a.y ), _mm_andnot_ps( mask, b.y ) );
+	r.z = _mm_or_ps( _mm_and_ps( mask, a.z ), _mm_andnot_ps( mask, b.z ) );
+	r.w = _mm_or_ps( _mm_and_ps( mask, a.w ), _mm_andnot_ps( mask, b.w ) );
+	return r;
+}
+
+/// <summary>
+/// Scale each lane to unit length. A lane of length 0 becomes the identity, where
+/// quaternion::normalize would divide by zero
+/// </summary>
+/// <param name="q">the quaternions</param>
+/// <returns>unit quaternions</returns>
+inline quaternion4 Quaternion4Normalize( const quaternion4 & q )
+{
+	__m128 lengthSquared = Quaternion4Dot( q, q );
+	__m128 valid = _mm_cmpgt_ps( lengthSquared, _mm_setzero_ps() );
+	__m128 scale = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_sqrt_ps( lengthSquared ) );
+
+	quaternion4 r;
+	r.x = _mm_mul_ps( q.x, scale );
+	r.y = _mm_mul_ps( q.y, scale );
+	r.z = _mm_mul_ps( q.z, scale );
+	r.w = _mm_mul_ps( q.w, scale );
+	return Quaternion4Select( valid, r, Quaternion4Identity() );
+}
+
+/// <summary>
+/// Spherical interpolation of each lane the short way round, linear where the two are
+/// closer than QUATERNION4_SLERP_THRESHOLD. The result is not normalized, like quaternion::slerp
+/// </summary>
+/// <param name="a">quaternions at time 0</param>
+/// <param name="b">quaternions at time 1</param>
+/// <param name="t">time of each lane, from 0 to 1</param>
+/// <returns>the interpolated quaternions</returns>
+inline quaternion4 Quaternion4Slerp( const quaternion4 & a, const quaternion4 & b, __m128 t )
+{
+	// a and -a are the same rotation, the one nearer b is taken
+	__m128 cosine = Quaternion4Dot( a, b );
+	__m128 flip = _mm_and_ps( cosine, _mm_set1_ps( -0.0f ) );
+	cosine = _mm_xor_ps( cosine, flip );
+
+	// the angle takes acosf and sinf, lane by lane
+	float c[4], time[4], w0[4], w1[4];
+	_mm_storeu_ps( c, cosine );
+	_mm_storeu_ps( time, t );
+	for ( int i = 0; i < 4; i++ )
+	{
+		if ( c[i] <= 1.0f - QUATERNION4_SLERP_THRESHOLD )
+		{
+			float angle = acosf( c[i] );
+			float inverseSine = 1.0f / sinf( angle );
+			w0[i] = sinf( angle * ( 1.0f - time[i] ) ) * inverseSine;
+			w1[i] = sinf( angle * time[i] ) * inverseSine;
+		}
+		else
+		{
+			w0[i] = 1.0f - time[i];
+			w1[i] = time[i];
+		}
+	}
+
+	__m128 scaleA = _mm_xor_ps( _mm_loadu_ps( w0 ), flip );
+	__m128 scaleB = _mm_loadu_ps( w1 );
+
+	quaternion4 r;
+	r.x = _mm_add_ps( _mm_mul_ps( a.x, scaleA ), _mm_mul_ps( b.x, scaleB ) );
+	r.y = _mm_add_ps( _mm_mul_ps( a.y, scaleA ), _mm_mul_ps( b.y, scaleB ) );
+	r.z = _mm_add_ps( _mm_mul_ps( a.z, scaleA ), _mm_mul_ps( b.z, scaleB ) );
+	r.w = _mm_add_ps( _mm_mul_ps( a.w, scaleA ), _mm_mul_ps( b.w, scaleB ) );
+	return r;
+}
+
+/// <summary>
+/// Rotate a vector by each lane, quaternion's operator*( vector3df )
+/// </summary>
+/// <param name="q">unit quaternions</param>
+/// <param name="v">vectors</param>
+/// <returns>v turned by q, per lane</returns>
+inline vector4 Quaternion4RotateVector( const quaternion4 & q, const vector4 & v )
+{
+	vector4 axis;
+	axis.x = q.x;
+	axis.y = q.y;
+	axis.z = q.z;
+	vector4 uv = Vector4Cross( axis, v );
+	vector4 uuv = Vector4Cross( axis, uv );
+
+	__m128 w2 = _mm_add_ps( q.w, q.w );
+	vector4 r;
+	r.x = _mm_add_ps( v.x, _mm_add_ps( _mm_mul_ps( uv.x, w2 ), _mm_add_ps( uuv.x, uuv.x ) ) );
+	r.y = _mm_add_ps( v.y, _mm_add_ps( _mm_mul_ps( uv.y, w2 ), _mm_add_ps( uuv.y, uuv.y ) ) );
+	r.z = _mm_add_ps( v.z, _mm_add_ps( _mm_mul_ps( uv.z, w2 ), _mm_add_ps( uuv.z, uuv.z ) ) );
+	return r;
+}
+
+/// <summary>
+/// Rotation matrix of each lane, quaternion::getMatrix without the translation
+/// </summary>
+/// <param name="q">unit quaternions</param>
+/// <returns>the axes the display's axes are turned into</returns>
+inline rotation4 Quaternion4GetMatrix( const quaternion4 & q )
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+	__m128 x2 = _mm_add_ps( q.x, q.x ), y2 = _mm_add_ps( q.y, q.y ), z2 = _mm_add_ps( q.z, q.z );
+	__m128 xx = _mm_mul_ps( q.x, x2 ), yy = _mm_mul_ps( q.y, y2 ), zz = _mm_mul_ps( q.z, z2 );
+	__m128 xy = _mm_mul_ps( q.x, y2 ), xz = _mm_mul_ps( q.x, z2 ), yz = _mm_mul_ps( q.y, z2 );
+	__m128 wx = _mm_mul_ps( q.w, x2 ), wy = _mm_mul_ps( q.w, y2 ), wz = _mm_mul_ps( q.w, z2 );
+
+	rotation4 m;
+	m.x.x = _mm_sub_ps( one, _mm_add_ps( yy, zz ) );
+	m.x.y = _mm_add_ps( xy, wz );
+	m.x.z = _mm_sub_ps( xz, wy );
+	m.y.x = _mm_sub_ps( xy, wz );
+	m.y.y = _mm_sub_ps( one, _mm_add_ps( xx, zz ) );
+	m.y.z = _mm_add_ps( yz, wx );
+	m.z.x = _mm_add_ps( xz, wy );
+	m.z.y = _mm_sub_ps( yz, wx );
+	m.z.z = _mm_sub_ps( one, _mm_add_ps( xx, yy ) );
+	return m;
+}
+
+/// <summary>
+/// Unit quaternion of each lane's rotation matrix, quaternion's operator=( matrix4 ) with
+/// the largest component picked by masks instead of branches; it may come out negated,
+/// the same rotation
+/// </summary>
+/// <param name="m">orthonormal right handed axes</param>
+/// <returns>the rotation that turns the display's axes into them</returns>
+inline quaternion4 Quaternion4FromMatrix( const rotation4 & m )
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+
+	// four times the square of w, x, y and z
+	__m128 ww = _mm_add_ps( _mm_add_ps( one, m.x.x ), _mm_add_ps( m.y.y, m.z.z ) );
+	__m128 xx = _mm_sub_ps( _mm_add_ps( one, m.x.x ), _mm_add_ps( m.y.y, m.z.z ) );
+	__m128 yy = _mm_sub_ps( _mm_add_ps( one, m.y.y ), _mm_add_ps( m.x.x, m.z.z ) );
+	__m128 zz = _mm_sub_ps( _mm_add_ps( one, m.z.z ), _mm_add_ps( m.x.x, m.y.y ) );
+
+	// four times each product of two of them, from the other elements
+	__m128 wx = _mm_sub_ps( m.y.z, m.z.y );
+	__m128 wy = _mm_sub_ps( m.z.x, m.x.z );
+	__m128 wz = _mm_sub_ps( m.x.y, m.y.x );
+	__m128 xy = _mm_add_ps( m.x.y, m.y.x );
+	__m128 xz = _mm_add_ps( m.x.z, m.z.x );
+	__m128 yz = _mm_add_ps( m.y.z, m.z.y );
+
+	// the largest component times each of the four is the quaternion scaled, with nothing
+	// cancelling out
+	quaternion4 byW, byX, byY, byZ;
+	byW.x = wx; byW.y = wy; byW.z = wz; byW.w = ww;
+	byX.x = xx; byX.y = xy; byX.z = xz; byX.w = wx;
+	byY.x = xy; byY.y = yy; byY.z = yz; byY.w = wy;
+	byZ.x = xz; byZ.y = yz; byZ.z = zz; byZ.w = wz;
+
+	__m128 largestW = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( ww, xx ), _mm_cmpge_ps( ww, yy ) ), _mm_cmpge_ps( ww, zz ) );
+	__m128 largestX = _mm_and_ps( _mm_cmpge_ps( xx, yy ), _mm_cmpge_ps( xx, zz ) );
+	__m128 largestY = _mm_cmpge_ps( yy, zz );
+
+	quaternion4 q = Quaternion4Select( largestY, byY, byZ );
+	q = Quaternion4Select( largestX, byX, q );
+	q = Quaternion4Select( largestW, byW, q );
+	return Quaternion4Normalize( q );
+}
+
+/// <summary>
+/// Normalized linear interpolation of each lane the short way round. Cheaper than a slerp
+/// but not at constant speed, the middle of a wide turn is reached early
+/// </summary>
+/// <param name="a">quaternions at time 0</param>
+/// <param name="b">quaternions at time 1</param>
+/// <param name="t">time of each lane, from 0 to 1</param>
+/// <returns>unit quaternions</returns>
+inline quaternion4 Quaternion4Nlerp( const quaternion4 & a, const quaternion4 & b, __m128 t )
+{
+	__m128 flip = _mm_and_ps( Quaternion4Dot( a, b ), _mm_set1_ps( -0.0f ) );
+	__m128 scaleA = _mm_xor_ps( _mm_sub_ps( _mm_set1_ps( 1.0f ), t ), flip );
+
+	quaternion4 r;
+	r.x = _mm_add_ps( _mm_mul_ps( a.x, scaleA ), _mm_mul_ps( b.x, t ) );
+	r.y = _mm_add_ps( _mm_mul_ps( a.y, scaleA ), _mm_mul_ps( b.y, t ) );
+	r.z = _mm_add_ps( _mm_mul_ps( a.z, scaleA ), _mm_mul_ps( b.z, t ) );
+	r.w = _mm_add_ps( _mm_mul_ps( a.w, scaleA ), _mm_mul_ps( b.w, t ) );
+	return Quaternion4Normalize( r );
+}
+
+/// <summary>
+/// sin( ( 1 - t ) angle ) / sin( angle ) and sin( t angle ) / sin( angle ) of each lane
+/// without a sine: the 8 term series in t and the cosine of Eberly's "A Fast and Accurate
+/// Algorithm for Computing SLERP", its last term scaled for the terms left out. Both are
+/// summed in one loop, each term waits on the one before it
+/// </summary>
+/// <param name="t">time of each lane, from 0 to 1</param>
+/// <param name="cosineLessOne">cosine of the angle, from 0 to 1, less 1</param>
+/// <param name="weightFrom">receives the weight of the quaternion the slerp starts from</param>
+/// <param name="weightTo">receives the weight of the quaternion it moves toward</param>
+inline void Quaternion4SlerpWeights( __m128 t, __m128 cosineLessOne, __m128 & weightFrom, __m128 & weightTo )
+{
+	static const float u[8] = { 1.0f / 3, 1.0f / 10, 1.0f / 21, 1.0f / 36, 1.0f / 55, 1.0f / 78, 1.0f / 105, 1.85298109f / 136 };
+	static const float v[8] = { 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15, 1.85298109f * 8 / 17 };
+
+	const __m128 one = _mm_set1_ps( 1.0f );
+	__m128 s = _mm_sub_ps( one, t );
+	__m128 ss = _mm_mul_ps( s, s );
+	__m128 tt = _mm_mul_ps( t, t );
+	__m128 seriesFrom = one;
+	__m128 seriesTo = one;
+	for ( int i = 7; i >= 0; i-- )
+	{
+		__m128 ui = _mm_set1_ps( u[i] );
+		__m128 vi = _mm_set1_ps( v[i] );
+		__m128 termFrom = _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( ui, ss ), vi ), cosineLessOne );
+		__m128 termTo = _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( ui, tt ), vi ), cosineLessOne );
+		seriesFrom = _mm_add_ps( one, _mm_mul_ps( termFrom, seriesFrom ) );
+		seriesTo = _mm_add_ps( one, _mm_mul_ps( termTo, seriesTo ) );
+	}
+	weightFrom = _mm_mul_ps( s, seriesFrom );
+	weightTo = _mm_mul_ps( t, seriesTo );
+}
+
+/// <summary>
+/// Spherical interpolation of each lane the short way round from a polynomial, no acosf or
+/// sinf and no linear blend near the ends. The result is not normalized
+/// </summary>
+/// <param name="a">quaternions at time 0</param>
+/// <param name="b">quaternions at time 1</param>
+/// <param name="t">time of each lane, from 0 to 1</param>
+/// <returns>the interpolated quaternions</returns>
+inline quaternion4 Quaternion4SlerpFast( const quaternion4 & a, const quaternion4 & b, __m128 t )
+{
+	__m128 cosine = Quaternion4Dot( a, b );
+	__m128 flip = _mm_and_ps( cosine, _mm_set1_ps( -0.0f ) );
+	__m128 cosineLessOne = _mm_sub_ps( _mm_xor_ps( cosine, flip ), _mm_set1_ps( 1.0f ) );
+
+	__m128 scaleA, scaleB;
+	Quaternion4SlerpWeights( t, cosineLessOne, scaleA, scaleB );
+	scaleA = _mm_xor_ps( scaleA, flip );
+
+	quaternion4 r;
+	r.x = _mm_add_ps( _mm_mul_ps( a.x, scaleA ), _mm_mul_ps( b.x, scaleB ) );
+	r.y = _mm_add_ps( _mm_mul_ps( a.y, scaleA ), _mm_mul_ps( b.y, scaleB ) );
+	r.z = _mm_add_ps( _mm_mul_ps( a.z, scaleA ), _mm_mul_ps( b.z, scaleB ) );
+	r.w = _mm_add_ps( _mm_mul_ps( a.w, scaleA ), _mm_mul_ps( b.w, scaleB ) );
+	return r;
+}
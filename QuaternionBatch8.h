@@ -0,0 +1,408 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionBatch8.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares quaternion8, eight quaternions with x, y, z and w each in an AVX register, and the
+// operations of QuaternionBatch.h on them, lane for lane the same arithmetic and the same
+// errors. Header only, it depends on nothing but the compiler's intrinsics.
+//
+// AVX is not on every machine the tracker runs on. Only call these where
+// QuaternionBatchHasAvx() is true, and only from a translation unit compiled for AVX
+// (/arch:AVX), so the SSE code around them is not penalized for mixing the two encodings.
+
+#pragma once
+
+#include <immintrin.h>
+#include "QuaternionBatch.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// Whether the processor has AVX and the operating system saves its registers
+/// </summary>
+/// <returns>true if quaternion8 can be used</returns>
+inline bool QuaternionBatchHasAvx( )
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid( info, 1 );
+	const int osxsaveAndAvx = ( 1 << 27 ) | ( 1 << 28 );
+	if ( osxsaveAndAvx != ( info[2] & osxsaveAndAvx ) )
+	{
+		return false;
+	}
+
+	// the SSE and AVX state are both enabled in XCR0
+	return 6 == ( _xgetbv( 0 ) & 6 );
+#else
+	return 0 != __builtin_cpu_supports( "avx" );
+#endif
+}
+
+/// <summary>
+/// Eight quaternions, lane i of each register is quaternion i
+/// </summary>
+struct quaternion8
+{
+	__m256  x;
+	__m256  y;
+	__m256  z;
+	__m256  w;
+};
+
+/// <summary>
+/// Eight vectors, lane i of each register is vector i
+/// </summary>
+struct vector8
+{
+	__m256  x;
+	__m256  y;
+	__m256  z;
+};
+
+/// <summary>
+/// Eight rotation matrices as the axes each turns the display's x, y and z axes into; the
+/// x axis is row 0 of quaternion::getMatrix, y row 1 and z row 2
+/// </summary>
+struct rotation8
+{
+	vector8 x;
+	vector8 y;
+	vector8 z;
+};
+
+/// <summary>
+/// Dot product of each lane
+/// </summary>
+/// <param name="a">first vectors</param>
+/// <param name="b">second vectors</param>
+/// <returns>dot product per lane</returns>
+inline __m256 Vector8Dot( const vector8 & a, const vector8 & b )
+{
+	return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( a.x, b.x ), _mm256_mul_ps( a.y, b.y ) ), _mm256_mul_ps( a.z, b.z ) );
+}
+
+/// <summary>
+/// Cross product of each lane
+/// </summary>
+/// <param name="a">first vectors</param>
+/// <param name="b">second vectors</param>
+/// <returns>a x b per lane</returns>
+inline vector8 Vector8Cross( const vector8 & a, const vector8 & b )
+{
+	vector8 v;
+	v.x = _mm256_sub_ps( _mm256_mul_ps( a.y, b.z ), _mm256_mul_ps( a.z, b.y ) );
+	v.y = _mm256_sub_ps( _mm256_mul_ps( a.z, b.x ), _mm256_mul_ps( a.x, b.z ) );
+	v.z = _mm256_sub_ps( _mm256_mul_ps( a.x, b.y ), _mm256_mul_ps( a.y, b.x ) );
+	return v;
+}
+
+/// <summary>
+/// Load eight quaternions from rows of floats, no alignment required
+/// </summary>
+/// <param name="pX">x of the 8 quaternions</param>
+/// <param name="pY">y of the 8 quaternions</param>
+/// <param name="pZ">z of the 8 quaternions</param>
+/// <param name="pW">w of the 8 quaternions</param>
+/// <returns>the quaternions</returns>
+inline quaternion8 Quaternion8Load( const float * pX, const float * pY, const float * pZ, const float * pW )
+{
+	quaternion8 q;
+	q.x = _mm256_loadu_ps( pX );
+	q.y = _mm256_loadu_ps( pY );
+	q.z = _mm256_loadu_ps( pZ );
+	q.w = _mm256_loadu_ps( pW );
+	return q;
+}
+
+/// <summary>
+/// Store eight quaternions into rows of floats, no alignment required
+/// </summary>
+/// <param name="q">the quaternions</param>
+/// <param name="pX">receives x of the 8 quaternions</param>
+/// <param name="pY">receives y</param>
+/// <param name="pZ">receives z</param>
+/// <param name="pW">receives w</param>
+inline void Quaternion8Store( const quaternion8 & q, float * pX, float * pY, float * pZ, float * pW )
+{
+	_mm256_storeu_ps( pX, q.x );
+	_mm256_storeu_ps( pY, q.y );
+	_mm256_storeu_ps( pZ, q.z );
+	_mm256_storeu_ps( pW, q.w );
+}
+
+/// <summary>
+/// Eight identity quaternions
+/// </summary>
+/// <returns>no rotation in every lane</returns>
+inline quaternion8 Quaternion8Identity( )
+{
+	quaternion8 q;
+	q.x = _mm256_setzero_ps();
+	q.y = _mm256_setzero_ps();
+	q.z = _mm256_setzero_ps();
+	q.w = _mm256_set1_ps( 1.0f );
+	return q;
+}
+
+/// <summary>
+/// Conjugate, the inverse rotation of a unit quaternion
+/// </summary>
+/// <param name="q">the quaternions</param>
+/// <returns>x, y and z negated</returns>
+inline quaternion8 Quaternion8Conjugate( const quaternion8 & q )
+{
+	const __m256 sign = _mm256_set1_ps( -0.0f );
+	quaternion8 r;
+	r.x = _mm256_xor_ps( q.x, sign );
+	r.y = _mm256_xor_ps( q.y, sign );
+	r.z = _mm256_xor_ps( q.z, sign );
+	r.w = q.w;
+	return r;
+}
+
+/// <summary>
+/// Hamilton product of each lane, the rotation b followed by a
+/// </summary>
+/// <param name="a">left factors</param>
+/// <param name="b">right factors</param>
+/// <returns>a b</returns>
+inline quaternion8 Quaternion8Multiply( const quaternion8 & a, const quaternion8 & b )
+{
+	quaternion8 r;
+	r.w = _mm256_sub_ps( _mm256_sub_ps( _mm256_mul_ps( a.w, b.w ), _mm256_mul_ps( a.x, b.x ) ),
+					  _mm256_add_ps( _mm256_mul_ps( a.y, b.y ), _mm256_mul_ps( a.z, b.z ) ) );
+	r.x = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( a.w, b.x ), _mm256_mul_ps( a.x, b.w ) ),
+					  _mm256_sub_ps( _mm256_mul_ps( a.y, b.z ), _mm256_mul_ps( a.z, b.y ) ) );
+	r.y = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( a.w, b.y ), _mm256_mul_ps( a.y, b.w ) ),
+					  _mm256_sub_ps( _mm256_mul_ps( a.z, b.x ), _mm256_mul_ps( a.x, b.z ) ) );
+	r.z = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( a.w, b.z ), _mm256_mul_ps( a.z, b.w ) ),
+					  _mm256_sub_ps( _mm256_mul_ps( a.x, b.y ), _mm256_mul_ps( a.y, b.x ) ) );
+	return r;
+}
+
+/// <summary>
+/// Dot product of each lane
+/// </summary>
+/// <param name="a">first quaternions</param>
+/// <param name="b">second quaternions</param>
+/// <returns>dot product per lane</returns>
+inline __m256 Quaternion8Dot( const quaternion8 & a, const quaternion8 & b )
+{
+	return _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( a.x, b.x ), _mm256_mul_ps( a.y, b.y ) ),
+					   _mm256_add_ps( _mm256_mul_ps( a.z, b.z ), _mm256_mul_ps( a.w, b.w ) ) );
+}
+
+/// <summary>
+/// Pick lane by lane
+/// </summary>
+/// <param name="mask">all bits set in the lanes that take a, clear in those that take b</param>
+/// <param name="a">quaternions where the mask is set</param>
+/// <param name="b">quaternions where it is clear</param>
+/// <returns>a or b per lane</returns>
+inline quaternion8 Quaternion8Select( __m256 mask, const quaternion8 & a, const quaternion8 & b )
+{
+	quaternion8 r;
+	r.x = _mm256_or_ps( _mm256_and_ps( mask, a.x ), _mm256_andnot_ps( mask, b.x ) );
+	r.y = _mm256_or_ps( _mm256_and_ps( mask, a.y ), _mm256_andnot_ps( mask, b.y ) );
+	r.z = _mm256_or_ps( _mm256_and_ps( mask, a.z ), _mm256_andnot_ps( mask, b.z ) );
+	r.w = _mm256_or_ps( _mm256_and_ps( mask, a.w ), _mm256_andnot_ps( mask, b.w ) );
+	return r;
+}
+
+/// <summary>
+/// Scale each lane to unit length. A lane of length 0 becomes the identity, where
+/// quaternion::normalize would divide by zero
+/// </summary>
+/// <param name="q">the quaternions</param>
+/// <returns>unit quaternions</returns>
+inline quaternion8 Quaternion8Normalize( const quaternion8 & q )
+{
+	__m256 lengthSquared = Quaternion8Dot( q, q );
+	__m256 valid = _mm256_cmp_ps( lengthSquared, _mm256_setzero_ps(), _CMP_GT_OQ );
+	__m256 scale = _mm256_div_ps( _mm256_set1_ps( 1.0f ), _mm256_sqrt_ps( lengthSquared ) );
+
+	quaternion8 r;
+	r.x = _mm256_mul_ps( q.x, scale );
+	r.y = _mm256_mul_ps( q.y, scale );
+	r.z = _mm256_mul_ps( q.z, scale );
+	r.w = _mm256_mul_ps( q.w, scale );
+	return Quaternion8Select( valid, r, Quaternion8Identity() );
+}
+
+/// <summary>
+/// Rotate a vector by each lane, quaternion's operator*( vector3df )
+/// </summary>
+/// <param name="q">unit quaternions</param>
+/// <param name="v">vectors</param>
+/// <returns>v turned by q, per lane</returns>
+inline vector8 Quaternion8RotateVector( const quaternion8 & q, const vector8 & v )
+{
+	vector8 axis;
+	axis.x = q.x;
+	axis.y = q.y;
+	axis.z = q.z;
+	vector8 uv = Vector8Cross( axis, v );
+	vector8 uuv = Vector8Cross( axis, uv );
+
+	__m256 w2 = _mm256_add_ps( q.w, q.w );
+	vector8 r;
+	r.x = _mm256_add_ps( v.x, _mm256_add_ps( _mm256_mul_ps( uv.x, w2 ), _mm256_add_ps( uuv.x, uuv.x ) ) );
+	r.y = _mm256_add_ps( v.y, _mm256_add_ps( _mm256_mul_ps( uv.y, w2 ), _mm256_add_ps( uuv.y, uuv.y ) ) );
+	r.z = _mm256_add_ps( v.z, _mm256_add_ps( _mm256_mul_ps( uv.z, w2 ), _mm256_add_ps( uuv.z, uuv.z ) ) );
+	return r;
+}
+
+/// <summary>
+/// Rotation matrix of each lane, quaternion::getMatrix without the translation
+/// </summary>
+/// <param name="q">unit quaternions</param>
+/// <returns>the axes the display's axes are turned into</returns>
+inline rotation8 Quaternion8GetMatrix( const quaternion8 & q )
+{
+	const __m256 one = _mm256_set1_ps( 1.0f );
+	__m256 x2 = _mm256_add_ps( q.x, q.x ), y2 = _mm256_add_ps( q.y, q.y ), z2 = _mm256_add_ps( q.z, q.z );
+	__m256 xx = _mm256_mul_ps( q.x, x2 ), yy = _mm256_mul_ps( q.y, y2 ), zz = _mm256_mul_ps( q.z, z2 );
+	__m256 xy = _mm256_mul_ps( q.x, y2 ), xz = _mm256_mul_ps( q.x, z2 ), yz = _mm256_mul_ps( q.y, z2 );
+	__m256 wx = _mm256_mul_ps( q.w, x2 ), wy = _mm256_mul_ps( q.w, y2 ), wz = _mm256_mul_ps( q.w, z2 );
+
+	rotation8 m;
+	m.x.x = _mm256_sub_ps( one, _mm256_add_ps( yy, zz ) );
+	m.x.y = _mm256_add_ps( xy, wz );
+	m.x.z = _mm256_sub_ps( xz, wy );
+	m.y.x = _mm256_sub_ps( xy, wz );
+	m.y.y = _mm256_sub_ps( one, _mm256_add_ps( xx, zz ) );
+	m.y.z = _mm256_add_ps( yz, wx );
+	m.z.x = _mm256_add_ps( xz, wy );
+	m.z.y = _mm256_sub_ps( yz, wx );
+	m.z.z = _mm256_sub_ps( one, _mm256_add_ps( xx, yy ) );
+	return m;
+}
+
+/// <summary>
+/// Unit quaternion of each lane's rotation matrix, quaternion's operator=( matrix4 ) with
+/// the largest component picked by masks instead of branches; it may come out negated,
+/// the same rotation
+/// </summary>
+/// <param name="m">orthonormal right handed axes</param>
+/// <returns>the rotation that turns the display's axes into them</returns>
+inline quaternion8 Quaternion8FromMatrix( const rotation8 & m )
+{
+	const __m256 one = _mm256_set1_ps( 1.0f );
+
+	// four times the square of w, x, y and z
+	__m256 ww = _mm256_add_ps( _mm256_add_ps( one, m.x.x ), _mm256_add_ps( m.y.y, m.z.z ) );
+	__m256 xx = _mm256_sub_ps( _mm256_add_ps( one, m.x.x ), _mm256_add_ps( m.y.y, m.z.z ) );
+	__m256 yy = _mm256_sub_ps( _mm256_add_ps( one, m.y.y ), _mm256_add_ps( m.x.x, m.z.z ) );
+	__m256 zz = _mm256_sub_ps( _mm256_add_ps( one, m.z.z ), _mm256_add_ps( m.x.x, m.y.y ) );
+
+	// four times each product of two of them, from the other elements
+	__m256 wx = _mm256_sub_ps( m.y.z, m.z.y );
+	__m256 wy = _mm256_sub_ps( m.z.x, m.x.z );
+	__m256 wz = _mm256_sub_ps( m.x.y, m.y.x );
+	__m256 xy = _mm256_add_ps( m.x.y, m.y.x );
+	__m256 xz = _mm256_add_ps( m.x.z, m.z.x );
+	__m256 yz = _mm256_add_ps( m.y.z, m.z.y );
+
+	// the largest component times each of the four is the quaternion scaled, with nothing
+	// cancelling out
+	quaternion8 byW, byX, byY, byZ;
+	byW.x = wx; byW.y = wy; byW.z = wz; byW.w = ww;
+	byX.x = xx; byX.y = xy; byX.z = xz; byX.w = wx;
+	byY.x = xy; byY.y = yy; byY.z = yz; byY.w = wy;
+	byZ.x = xz; byZ.y = yz; byZ.z = zz; byZ.w = wz;
+
+	__m256 largestW = _mm256_and_ps( _mm256_and_ps( _mm256_cmp_ps( ww, xx, _CMP_GE_OQ ), _mm256_cmp_ps( ww, yy, _CMP_GE_OQ ) ), _mm256_cmp_ps( ww, zz, _CMP_GE_OQ ) );
+	__m256 largestX = _mm256_and_ps( _mm256_cmp_ps( xx, yy, _CMP_GE_OQ ), _mm256_cmp_ps( xx, zz, _CMP_GE_OQ ) );
+	__m256 largestY = _mm256_cmp_ps( yy, zz, _CMP_GE_OQ );
+
+	quaternion8 q = Quaternion8Select( largestY, byY, byZ );
+	q = Quaternion8Select( largestX, byX, q );
+	q = Quaternion8Select( largestW, byW, q );
+	return Quaternion8Normalize( q );
+}
+
+/// <summary>
+/// Normalized linear interpolation of each lane the short way round. Cheaper than a slerp
+/// but not at constant speed, the middle of a wide turn is reached early
+/// </summary>
+/// <param name="a">quaternions at time 0</param>
+/// <param name="b">quaternions at time 1</param>
+/// <param name="t">time of each lane, from 0 to 1</param>
+/// <returns>unit quaternions</returns>
+inline quaternion8 Quaternion8Nlerp( const quaternion8 & a, const quaternion8 & b, __m256 t )
+{
+	__m256 flip = _mm256_and_ps( Quaternion8Dot( a, b ), _mm256_set1_ps( -0.0f ) );
+	__m256 scaleA = _mm256_xor_ps( _mm256_sub_ps( _mm256_set1_ps( 1.0f ), t ), flip );
+
+	quaternion8 r;
+	r.x = _mm256_add_ps( _mm256_mul_ps( a.x, scaleA ), _mm256_mul_ps( b.x, t ) );
+	r.y = _mm256_add_ps( _mm256_mul_ps( a.y, scaleA ), _mm256_mul_ps( b.y, t ) );
+	r.z = _mm256_add_ps( _mm256_mul_ps( a.z, scaleA ), _mm256_mul_ps( b.z, t ) );
+	r.w = _mm256_add_ps( _mm256_mul_ps( a.w, scaleA ), _mm256_mul_ps( b.w, t ) );
+	return Quaternion8Normalize( r );
+}
+
+/// <summary>
+/// sin( ( 1 - t ) angle ) / sin( angle ) and sin( t angle ) / sin( angle ) of each lane
+/// without a sine: the 8 term series in t and the cosine of Eberly's "A Fast and Accurate
+/// Algorithm for Computing SLERP", its last term scaled for the terms left out. Both are
+/// summed in one loop, each term waits on the one before it
+/// </summary>
+/// <param name="t">time of each lane, from 0 to 1</param>
+/// <param name="cosineLessOne">cosine of the angle, from 0 to 1, less 1</param>
+/// <param name="weightFrom">receives the weight of the quaternion the slerp starts from</param>
+/// <param name="weightTo">receives the weight of the quaternion it moves toward</param>
+inline void Quaternion8SlerpWeights( __m256 t, __m256 cosineLessOne, __m256 & weightFrom, __m256 & weightTo )
+{
+	static const float u[8] = { 1.0f / 3, 1.0f / 10, 1.0f / 21, 1.0f / 36, 1.0f / 55, 1.0f / 78, 1.0f / 105, 1.85298109f / 136 };
+	static const float v[8] = { 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15, 1.85298109f * 8 / 17 };
+
+	const __m256 one = _mm256_set1_ps( 1.0f );
+	__m256 s = _mm256_sub_ps( one, t );
+	__m256 ss = _mm256_mul_ps( s, s );
+	__m256 tt = _mm256_mul_ps( t, t );
+	__m256 seriesFrom = one;
+	__m256 seriesTo = one;
+	for ( int i = 7; i >= 0; i-- )
+	{
+		__m256 ui = _mm256_set1_ps( u[i] );
+		__m256 vi = _mm256_set1_ps( v[i] );
+		__m256 termFrom = _mm256_mul_ps( _mm256_sub_ps( _mm256_mul_ps( ui, ss ), vi ), cosineLessOne );
+		__m256 termTo = _mm256_mul_ps( _mm256_sub_ps( _mm256_mul_ps( ui, tt ), vi ), cosineLessOne );
+		seriesFrom = _mm256_add_ps( one, _mm256_mul_ps( termFrom, seriesFrom ) );
+		seriesTo = _mm256_add_ps( one, _mm256_mul_ps( termTo, seriesTo ) );
+	}
+	weightFrom = _mm256_mul_ps( s, seriesFrom );
+	weightTo = _mm256_mul_ps( t, seriesTo );
+}
+
+/// <summary>
+/// Spherical interpolation of each lane the short way round from a polynomial, no acosf or
+/// sinf and no linear blend near the ends. The result is not normalized
+/// </summary>
+/// <param name="a">quaternions at time 0</param>
+/// <param name="b">quaternions at time 1</param>
+/// <param name="t">time of each lane, from 0 to 1</param>
+/// <returns>the interpolated quaternions</returns>
+inline quaternion8 Quaternion8SlerpFast( const quaternion8 & a, const quaternion8 & b, __m256 t )
+{
+	__m256 cosine = Quaternion8Dot( a, b );
+	__m256 flip = _mm256_and_ps( cosine, _mm256_set1_ps( -0.0f ) );
+	__m256 cosineLessOne = _mm256_sub_ps( _mm256_xor_ps( cosine, flip ), _mm256_set1_ps( 1.0f ) );
+
+	__m256 scaleA, scaleB;
+	Quaternion8SlerpWeights( t, cosineLessOne, scaleA, scaleB );
+	scaleA = _mm256_xor_ps( scaleA, flip );
+
+	quaternion8 r;
+	r.x = _mm256_add_ps( _mm256_mul_ps( a.x, scaleA ), _mm256_mul_ps( b.x, scaleB ) );
+	r.y = _mm256_add_ps( _mm256_mul_ps( a.y, scaleA ), _mm256_mul_ps( b.y, scaleB ) );
+	r.z = _mm256_add_ps( _mm256_mul_ps( a.z, scaleA ), _mm256_mul_ps( b.z, scaleB ) );
+	r.w = _mm256_add_ps( _mm256_mul_ps( a.w, scaleA ), _mm256_mul_ps( b.w, scaleB ) );
+	return r;
+}
@@ -0,0 +1,176 @@
+//------------------------------------------------------------------------------
+// <copyright file="RcuPointer.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Pointer to an immutable value that one writer thread replaces while a fixed set of reader
+// threads keep using the value they loaded, read-copy-update style. Readers never wait or
+// take a lock: a reader announces the value it uses in its own slot, and the writer only
+// deletes a replaced value once no slot announces it any more. Only depends on the standard
+// library, like TripleBuffer.h.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+template <class T, int Readers>
+class RcuPointer
+{
+public:
+	/// <summary>
+	/// Constructor, readers see NULL until the first Publish
+	/// </summary>
+	RcuPointer() : m_current(NULL)
+	{
+		for ( int i = 0; i < Readers; i++ )
+		{
+			m_slots[i].store( NULL );
+		}
+	}
+
+	/// <summary>
+	/// Destructor, no reader may hold a value any more
+	/// </summary>
+	~RcuPointer()
+	{
+		delete m_current.load();
+		for ( size_t i = 0; i < m_retired.size(); i++ )
+		{
+			delete m_retired[i];
+		}
+	}
+
+	/// <summary>
+	/// Load the current value and keep it alive until Release. Reader only, never waits
+	/// </summary>
+	/// <param name="reader">slot of the calling thread, 0 to Readers - 1, one thread per slot</param>
+	/// <returns>current value, NULL before the first Publish</returns>
+	const T * Acquire( int reader )
+	{
+		// the value may be replaced between loading and announcing it, so check it is still current
+		T * pValue = m_current.load( std::memory_order_acquire );
+		while ( true )
+		{
+			m_slots[reader].store( pValue, std::memory_order_seq_cst );
+			T * pCurrent = m_current.load( std::memory_order_seq_cst );
+			if ( pCurrent == pValue )
+			{
+				return pValue;
+			}
+			pValue = pCurrent;
+		}
+	}
+
+	/// <summary>
+	/// Done with the value Acquire returned. Reader only
+	/// </summary>
+	/// <param name="reader">slot of the calling thread</param>
+	void Release( int reader )
+	{
+		m_slots[reader].store( NULL, std::memory_order_release );
+	}
+
+	/// <summary>
+	/// Replace the value. The replaced one is deleted once no reader holds it. Writer only
+	/// </summary>
+	/// <param name="pValue">new value, allocated with new, owned by the pointer from now on</param>
+	void Publish( T * pValue )
+	{
+		T * pPrevious = m_current.exchange( pValue, std::memory_order_seq_cst );
+		if ( NULL != pPrevious )
+		{
+			m_retired.push_back( pPrevious );
+		}
+		Reclaim();
+	}
+
+	/// <summary>
+	/// Current value. Writer only, it is the only thread that replaces it
+	/// </summary>
+	/// <returns>current value, NULL before the first Publish</returns>
+	const T * Get() const
+	{
+		return m_current.load( std::memory_order_relaxed );
+	}
+
+	/// <summary>
+	/// Delete the replaced values no reader holds. Writer only, Publish calls it
+	/// </summary>
+	/// <returns>number of values still held by a reader</returns>
+	size_t Reclaim()
+	{
+		size_t kept = 0;
+		for ( size_t i = 0; i < m_retired.size(); i++ )
+		{
+			bool held = false;
+			for ( int r = 0; r < Readers && !held; r++ )
+			{
+				held = ( m_slots[r].load( std::memory_order_seq_cst ) == m_retired[i] );
+			}
+
+			if ( held )
+			{
+				m_retired[kept++] = m_retired[i];
+			}
+			else
+			{
+				delete m_retired[i];
+			}
+		}
+		m_retired.resize( kept );
+		return kept;
+	}
+
+private:
+	// not copyable, readers hold pointers into it
+	RcuPointer( const RcuPointer & );
+	RcuPointer & operator=( const RcuPointer & );
+
+	std::atomic<T *>        m_current;
+	std::atomic<const T *>  m_slots[Readers];   // value each reader uses, NULL for none
+	std::vector<T *>        m_retired;          // replaced values, writer only
+};
+
+/// <summary>
+/// Value of an RcuPointer held for the lifetime of a scope, e.g. one frame
+/// </summary>
+template <class T, int Readers>
+class RcuSnapshot
+{
+public:
+	/// <summary>
+	/// Constructor, acquires the current value
+	/// </summary>
+	/// <param name="pointer">pointer to read</param>
+	/// <param name="reader">slot of the calling thread</param>
+	RcuSnapshot( RcuPointer<T, Readers> & pointer, int reader ) :
+		m_pointer(pointer),
+		m_reader(reader),
+		m_pValue(pointer.Acquire( reader ))
+	{
+	}
+
+	/// <summary>
+	/// Destructor, releases the value
+	/// </summary>
+	~RcuSnapshot()
+	{
+		m_pointer.Release( m_reader );
+	}
+
+	const T * Get() const { return m_pValue; }
+	const T & operator*() const { return *m_pValue; }
+	const T * operator->() const { return m_pValue; }
+
+private:
+	// not copyable, the slot is released exactly once
+	RcuSnapshot( const RcuSnapshot & );
+	RcuSnapshot & operator=( const RcuSnapshot & );
+
+	RcuPointer<T, Readers> & m_pointer;
+	int                     m_reader;
+	const T *               m_pValue;
+};
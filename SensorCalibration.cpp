@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorCalibration.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+#include "stdafx.h"
+#include "SensorCalibration.h"
+#include <math.h>
+#include <emmintrin.h>
+
+/// <summary>
+/// Constructor
+/// </summary>
+SensorCalibration::SensorCalibration()
+{
+	const float origin[3] = { 0.0f, 0.0f, 0.0f };
+	Set( origin, 0.0f );
+}
+
+/// <summary>
+/// Set the sensor pose relative to the display
+/// </summary>
+/// <param name="position">(x, y, z) position of the sensor in inches</param>
+/// <param name="angleDegrees">elevation angle of the sensor in degrees</param>
+void SensorCalibration::Set( const float position[3], float angleDegrees )
+{
+	// the sensor tilts up for positive angles, so rotate the points back down
+	float angleRad = -angleDegrees * .01745f;
+
+	m_cosScaled = cosf( angleRad ) * g_MetersToInches;
+	m_sinScaled = sinf( angleRad ) * g_MetersToInches;
+
+	m_position[0] = position[0];
+	m_position[1] = position[1];
+	m_position[2] = position[2];
+}
+
+/// <summary>
+/// Transforms a single skeleton space point into the display frame
+/// </summary>
+/// <param name="skeletonPoint">point in skeleton space (meters)</param>
+/// <param name="out">(x, y, z) in the display frame (inches)</param>
+void SensorCalibration::Transform( const Vector4 & skeletonPoint, float out[3] ) const
+{
+	out[0] = skeletonPoint.x * g_MetersToInches + m_position[0];
+	out[1] = skeletonPoint.y * m_cosScaled - skeletonPoint.z * m_sinScaled + m_position[1];
+	out[2] = skeletonPoint.z * m_cosScaled + skeletonPoint.y * m_sinScaled + m_position[2];
+}
+
+/// <summary>
+/// Transforms arrays of skeleton space coordinates into the display frame.
+/// Input and output arrays may alias
+/// </summary>
+/// <param name="pX">x coordinates in skeleton space</param>
+/// <param name="pY">y coordinates in skeleton space</param>
+/// <param name="pZ">z coordinates in skeleton space</param>
+/// <param name="pOutX">x coordinates in the display frame</param>
+/// <param name="pOutY">y coordinates in the display frame</param>
+/// <param name="pOutZ">z coordinates in the display frame</param>
+/// <param name="count">number of points</param>
+void SensorCalibration::TransformBatch( const float * pX, const float * pY, const float * pZ,
+	float * pOutX, float * pOutY, float * pOutZ, UINT count ) const
+{
+	const __m128 scale = _mm_set1_ps( g_MetersToInches );
+	const __m128 cosScaled = _mm_set1_ps( m_cosScaled );
+	const __m128 sinScaled = _mm_set1_ps( m_sinScaled );
+	const __m128 posX = _mm_set1_ps( m_position[0] );
+	const __m128 posY = _mm_set1_ps( m_position[1] );
+	const __m128 posZ = _mm_set1_ps( m_position[2] );
+
+	UINT i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128 x = _mm_loadu_ps( pX + i );
+		__m128 y = _mm_loadu_ps( pY + i );
+		__m128 z = _mm_loadu_ps( pZ + i );
+
+		_mm_storeu_ps( pOutX + i, _mm_add_ps( _mm_mul_ps( x, scale ), posX ) );
+		_mm_storeu_ps( pOutY + i, _mm_add_ps( _mm_sub_ps( _mm_mul_ps( y, cosScaled ), _mm_mul_ps( z, sinScaled ) ), posY ) );
+		_mm_storeu_ps( pOutZ + i, _mm_add_ps( _mm_add_ps( _mm_mul_ps( z, cosScaled ), _mm_mul_ps( y, sinScaled ) ), posZ ) );
+	}
+
+	for ( ; i < count; i++ )
+	{
+		float x = pX[i], y = pY[i], z = pZ[i];
+		pOutX[i] = x * g_MetersToInches + m_position[0];
+		pOutY[i] = y * m_cosScaled - z * m_sinScaled + m_position[1];
+		pOutZ[i] = z * m_cosScaled + y * m_sinScaled + m_position[2];
+	}
+}
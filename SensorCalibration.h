@@ -0,0 +1,56 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorCalibration.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the sensor-to-display transform shared by joints and point clouds
+
+#pragma once
+
+#include "NuiApi.h"
+
+// skeleton space is in meters, the display frame is in inches
+const float g_MetersToInches = 39.37f;
+
+class SensorCalibration
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	SensorCalibration();
+
+	/// <summary>
+	/// Set the sensor pose relative to the display
+	/// </summary>
+	/// <param name="position">(x, y, z) position of the sensor in inches</param>
+	/// <param name="angleDegrees">elevation angle of the sensor in degrees</param>
+	void Set( const float position[3], float angleDegrees );
+
+	/// <summary>
+	/// Transforms a single skeleton space point into the display frame
+	/// </summary>
+	/// <param name="skeletonPoint">point in skeleton space (meters)</param>
+	/// <param name="out">(x, y, z) in the display frame (inches)</param>
+	void Transform( const Vector4 & skeletonPoint, float out[3] ) const;
+
+	/// <summary>
+	/// Transforms arrays of skeleton space coordinates into the display frame.
+	/// Input and output arrays may alias
+	/// </summary>
+	/// <param name="pX">x coordinates in skeleton space</param>
+	/// <param name="pY">y coordinates in skeleton space</param>
+	/// <param name="pZ">z coordinates in skeleton space</param>
+	/// <param name="pOutX">x coordinates in the display frame</param>
+	/// <param name="pOutY">y coordinates in the display frame</param>
+	/// <param name="pOutZ">z coordinates in the display frame</param>
+	/// <param name="count">number of points</param>
+	void TransformBatch( const float * pX, const float * pY, const float * pZ,
+		float * pOutX, float * pOutY, float * pOutZ, UINT count ) const;
+
+	// Rotation and translation, premultiplied by the meters to inches scale
+	float m_cosScaled;
+	float m_sinScaled;
+	float m_position[3];
+};
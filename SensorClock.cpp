@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorClock.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "SensorClock.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+SensorClock::SensorClock()
+{
+	Reset();
+}
+
+/// <summary>
+/// Forget every sample, e.g. when the sensor was replaced
+/// </summary>
+void SensorClock::Reset( )
+{
+	m_count = 0;
+	m_next = 0;
+	m_offset = 0;
+	m_lastSensorTime = 0;
+}
+
+/// <summary>
+/// Add the sample of a frame that just arrived
+/// </summary>
+/// <param name="sensorTime">timestamp of the frame, sensor milliseconds</param>
+/// <param name="hostTime">arrival of the frame, host microseconds</param>
+/// <returns>capture time of the frame, host microseconds</returns>
+long long SensorClock::Update( long long sensorTime, long long hostTime )
+{
+	// a sensor that was re-attached counts from 0 again, the old samples no longer apply
+	if ( m_count > 0 && sensorTime < m_lastSensorTime - SENSOR_CLOCK_RESTART )
+	{
+		Reset();
+	}
+	m_lastSensorTime = sensorTime;
+
+	m_samples[m_next] = hostTime - sensorTime * 1000;
+	m_next = ( m_next + 1 ) % SENSOR_CLOCK_WINDOW;
+	if ( m_count < SENSOR_CLOCK_WINDOW )
+	{
+		m_count++;
+	}
+
+	// the window is small, scanning it is cheaper than keeping a sorted one
+	m_offset = m_samples[0];
+	for ( int i = 1; i < m_count; i++ )
+	{
+		if ( m_samples[i] < m_offset )
+		{
+			m_offset = m_samples[i];
+		}
+	}
+
+	return sensorTime * 1000 + m_offset;
+}
+
+/// <summary>
+/// Capture time of a frame on the host clock
+/// </summary>
+/// <param name="sensorTime">timestamp of the frame, sensor milliseconds</param>
+/// <returns>host microseconds, 0 before the first sample</returns>
+long long SensorClock::ToHost( long long sensorTime ) const
+{
+	if ( 0 == m_count )
+	{
+		return 0;
+	}
+	return sensorTime * 1000 + m_offset;
+}
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorClock.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the mapping of a sensor's frame timestamps onto the host clock. Only depends on
+// the standard library, like the merge stage.
+//
+// A frame's liTimeStamp counts milliseconds on the sensor's own clock. Every frame that
+// arrives gives one sample of host time minus sensor time; the smallest sample of the last
+// few seconds is the frame that waited least between capture and arrival, so the offset
+// follows the minimum and the USB and driver jitter drops out. The fixed part of that wait,
+// exposure to the first byte on the host, cannot be seen from here and is not included.
+
+#pragma once
+
+#define SENSOR_CLOCK_WINDOW             64          // samples the offset is the minimum of, two seconds of frames
+#define SENSOR_CLOCK_RESTART            1000        // ms the sensor clock may go back before it counts as restarted
+
+class SensorClock
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	SensorClock();
+
+	/// <summary>
+	/// Forget every sample, e.g. when the sensor was replaced
+	/// </summary>
+	void                    Reset( );
+
+	/// <summary>
+	/// Add the sample of a frame that just arrived
+	/// </summary>
+	/// <param name="sensorTime">timestamp of the frame, sensor milliseconds</param>
+	/// <param name="hostTime">arrival of the frame, host microseconds</param>
+	/// <returns>capture time of the frame, host microseconds</returns>
+	long long               Update( long long sensorTime, long long hostTime );
+
+	/// <summary>
+	/// Capture time of a frame on the host clock
+	/// </summary>
+	/// <param name="sensorTime">timestamp of the frame, sensor milliseconds</param>
+	/// <returns>host microseconds, 0 before the first sample</returns>
+	long long               ToHost( long long sensorTime ) const;
+
+	bool                    IsSynchronized( ) const { return m_count > 0; }
+
+	/// <summary>
+	/// Host microseconds at sensor time 0
+	/// </summary>
+	long long               GetOffset( ) const { return m_offset; }
+
+private:
+	long long               m_samples[SENSOR_CLOCK_WINDOW];     // host minus sensor time, microseconds
+	int                     m_count;
+	int                     m_next;
+	long long               m_offset;
+	long long               m_lastSensorTime;
+};
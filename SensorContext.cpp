@@ -0,0 +1,492 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorContext.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the per sensor acquisition thread
+
+#include "stdafx.h"
+#include "SensorContext.h"
+#include "trackerApp.h"
+#include "resource.h"
+#include <mmsystem.h>
+#include <strsafe.h>
+
+/// <summary>
+/// Constructor
+/// </summary>
+/// <param name="pApp">application that handles the frames</param>
+/// <param name="index">index of this context, sensor 0 drives the preview</param>
+SensorContext::SensorContext( TrackerApp * pApp, int index ) :
+	m_index(index),
+	m_pApp(pApp),
+	m_lastErrorId(0),
+	m_pNuiSensor(NULL),
+	m_instanceId(NULL),
+	m_recovery(this),
+	m_hNextDepthFrameEvent(NULL),
+	m_hNextSkeletonEvent(NULL),
+	m_pDepthStreamHandle(NULL),
+	m_SkeletonTrackingFlags(0),
+	m_DepthStreamFlags(0),
+	m_SkeletonCaptureTime(0),
+	m_SkeletonFramePending(false),
+	m_SkeletonSubmitCount(0),
+	m_DepthFramesTotal(0),
+	m_LastDepthFPStime(0),
+	m_LastDepthFramesTotal(0),
+	m_hThNuiProcess(NULL),
+	m_hEvNuiProcessStop(NULL),
+	m_hEvStatus(NULL),
+	m_pendingStatus(SENSOR_STATUS_NONE),
+	m_pendingFlags(0),
+	m_requestedSkeletonTrackingFlags(0),
+	m_requestedDepthStreamFlags(0)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+SensorContext::~SensorContext()
+{
+	Close();
+	SysFreeString( m_instanceId );
+}
+
+/// <summary>
+/// Create the sensor by instance name, initialize it and open its streams
+/// </summary>
+/// <param name="instanceName">instance name of Kinect to open</param>
+/// <param name="skeletonTrackingFlags">flags for NuiSkeletonTrackingEnable</param>
+/// <param name="depthStreamFlags">flags for the depth stream</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT SensorContext::Open( const OLECHAR * instanceName, DWORD skeletonTrackingFlags, DWORD depthStreamFlags )
+{
+	Close();
+
+	m_lastErrorId = IDS_ERROR_NUICREATE;
+
+	if ( NULL == instanceName )
+	{
+		return E_FAIL;
+	}
+
+	m_SkeletonTrackingFlags = skeletonTrackingFlags;
+	m_DepthStreamFlags = depthStreamFlags;
+	InterlockedExchange( &m_pendingFlags, 0 );
+
+	// the events outlive the sensor, so a recovered sensor signals the same thread
+	m_hNextDepthFrameEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+	m_hNextSkeletonEvent = CreateEvent( NULL, TRUE, FALSE, NULL );
+	m_hEvStatus = CreateEvent( NULL, FALSE, FALSE, NULL );
+
+	HRESULT hr = NuiCreateSensorById( instanceName, &m_pNuiSensor );
+	if ( FAILED(hr) )
+	{
+		return hr;
+	}
+
+	SysFreeString( m_instanceId );
+	m_instanceId = m_pNuiSensor->NuiDeviceConnectionId();
+
+	return Initialize( );
+}
+
+/// <summary>
+/// Initialize the created sensor and open its streams
+/// </summary>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT SensorContext::Initialize( )
+{
+	HRESULT hr;
+
+	m_SkeletonBatch.Clear();
+
+	DWORD nuiFlags = NUI_INITIALIZE_FLAG_USES_DEPTH_AND_PLAYER_INDEX | NUI_INITIALIZE_FLAG_USES_SKELETON |  NUI_INITIALIZE_FLAG_USES_COLOR | NUI_INITIALIZE_FLAG_USES_AUDIO;
+
+	hr = m_pNuiSensor->NuiInitialize(nuiFlags);
+	if ( E_NUI_SKELETAL_ENGINE_BUSY == hr )
+	{
+		// the skeletal engine is taken, e.g. by another sensor in this process
+		nuiFlags = NUI_INITIALIZE_FLAG_USES_DEPTH |  NUI_INITIALIZE_FLAG_USES_COLOR;
+		hr = m_pNuiSensor->NuiInitialize( nuiFlags) ;
+	}
+
+	if ( FAILED( hr ) )
+	{
+		m_lastErrorId = ( E_NUI_DEVICE_IN_USE == hr ) ? IDS_ERROR_IN_USE : IDS_ERROR_NUIINIT;
+		return hr;
+	}
+
+	if ( HasSkeletalEngine( m_pNuiSensor ) )
+	{
+		hr = m_pNuiSensor->NuiSkeletonTrackingEnable( m_hNextSkeletonEvent, m_SkeletonTrackingFlags );
+		if( FAILED( hr ) )
+		{
+			m_lastErrorId = IDS_ERROR_SKELETONTRACKING;
+			return hr;
+		}
+	}
+
+	hr = m_pNuiSensor->NuiImageStreamOpen(
+		HasSkeletalEngine(m_pNuiSensor) ? NUI_IMAGE_TYPE_DEPTH_AND_PLAYER_INDEX : NUI_IMAGE_TYPE_DEPTH,
+		SENSOR_DEPTH_RESOLUTION,
+		m_DepthStreamFlags,
+		2,
+		m_hNextDepthFrameEvent,
+		&m_pDepthStreamHandle );
+
+	if ( FAILED( hr ) )
+	{
+		m_lastErrorId = IDS_ERROR_DEPTHSTREAM;
+		return hr;
+	}
+
+	m_lastErrorId = 0;
+	return hr;
+}
+
+/// <summary>
+/// Create the sensor again by instance name and reopen its streams, keeping the
+/// events, thread and everything downstream
+/// </summary>
+/// <returns>true if the sensor is streaming again</returns>
+bool SensorContext::Attach( )
+{
+	if ( NULL == m_instanceId )
+	{
+		return false;
+	}
+
+	Detach();
+
+	if ( FAILED( NuiCreateSensorById( m_instanceId, &m_pNuiSensor ) ) )
+	{
+		return false;
+	}
+
+	return SUCCEEDED( Initialize() );
+}
+
+/// <summary>
+/// Shut down and release the sensor, keeping the events, thread and everything downstream
+/// </summary>
+void SensorContext::Detach( )
+{
+	if ( m_pNuiSensor )
+	{
+		m_pNuiSensor->NuiShutdown( );
+	}
+	SafeRelease( m_pNuiSensor );
+
+	m_pDepthStreamHandle = NULL;
+
+	// nothing signals these until the sensor is back
+	if ( m_hNextSkeletonEvent )
+	{
+		ResetEvent( m_hNextSkeletonEvent );
+	}
+	if ( m_hNextDepthFrameEvent )
+	{
+		ResetEvent( m_hNextDepthFrameEvent );
+	}
+}
+
+/// <summary>
+/// Report a device status change. Safe to call from the SDK status callback,
+/// the processing thread does the actual work
+/// </summary>
+/// <param name="hrStatus">status of the device</param>
+void SensorContext::OnStatusChanged( HRESULT hrStatus )
+{
+	if ( S_OK == hrStatus )
+	{
+		InterlockedExchange( &m_pendingStatus, SENSOR_STATUS_CONNECTED );
+	}
+	else if ( FAILED(hrStatus) )
+	{
+		InterlockedExchange( &m_pendingStatus, SENSOR_STATUS_DISCONNECTED );
+	}
+	else
+	{
+		// e.g. S_NUI_INITIALIZING, wait for the device to be ready
+		return;
+	}
+
+	if ( NULL != m_hEvStatus )
+	{
+		SetEvent( m_hEvStatus );
+	}
+}
+
+/// <summary>
+/// Start the processing thread
+/// </summary>
+/// <param name="affinityMask">processors the thread may run on, 0 for any</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT SensorContext::Start( DWORD_PTR affinityMask )
+{
+	if ( NULL == m_pNuiSensor || NULL != m_hThNuiProcess )
+	{
+		return E_UNEXPECTED;
+	}
+
+	// from here on only the processing thread touches the recovery
+	m_recovery.OnAttached( static_cast<long long>(GetTickCount64()) );
+
+	m_hEvNuiProcessStop = CreateEvent( NULL, FALSE, FALSE, NULL );
+	m_hThNuiProcess = CreateThread( NULL, 0, Nui_ProcessThread, this, CREATE_SUSPENDED, NULL );
+	if ( NULL == m_hThNuiProcess )
+	{
+		return HRESULT_FROM_WIN32( GetLastError() );
+	}
+
+	// keep sensors on separate cores so they do not contend for the same cache
+	if ( 0 != affinityMask )
+	{
+		SetThreadAffinityMask( m_hThNuiProcess, affinityMask );
+	}
+
+	ResumeThread( m_hThNuiProcess );
+
+	return S_OK;
+}
+
+/// <summary>
+/// Stop the processing thread, shut down the sensor and close all events
+/// </summary>
+void SensorContext::Close( )
+{
+	// Stop the Nui processing thread
+	if ( NULL != m_hEvNuiProcessStop )
+	{
+		// Signal the thread
+		SetEvent(m_hEvNuiProcessStop);
+
+		// Wait for thread to stop
+		if ( NULL != m_hThNuiProcess )
+		{
+			WaitForSingleObject( m_hThNuiProcess, INFINITE );
+			CloseHandle( m_hThNuiProcess );
+			m_hThNuiProcess = NULL;
+		}
+		CloseHandle( m_hEvNuiProcessStop );
+		m_hEvNuiProcessStop = NULL;
+	}
+
+	Detach();
+
+	if ( m_hNextSkeletonEvent && ( m_hNextSkeletonEvent != INVALID_HANDLE_VALUE ) )
+	{
+		CloseHandle( m_hNextSkeletonEvent );
+		m_hNextSkeletonEvent = NULL;
+	}
+	if ( m_hNextDepthFrameEvent && ( m_hNextDepthFrameEvent != INVALID_HANDLE_VALUE ) )
+	{
+		CloseHandle( m_hNextDepthFrameEvent );
+		m_hNextDepthFrameEvent = NULL;
+	}
+	if ( m_hEvStatus )
+	{
+		CloseHandle( m_hEvStatus );
+		m_hEvStatus = NULL;
+	}
+}
+
+/// <summary>
+/// Whether this context belongs to the given instance. Stays true after Close, so a
+/// sensor that is plugged back in returns to the same context
+/// </summary>
+/// <param name="instanceName">instance name of a Kinect</param>
+bool SensorContext::IsInstance( const OLECHAR * instanceName ) const
+{
+	return NULL != instanceName && NULL != m_instanceId && 0 == wcscmp( instanceName, m_instanceId );
+}
+
+/// <summary>
+/// Request new skeleton tracking flags. The processing thread applies them between two
+/// frames, the sensor is only ever touched on that thread. A failure of the preview
+/// sensor is posted to the window as WM_USER_SENSOR_ERROR
+/// </summary>
+/// <param name="flags">flags for NuiSkeletonTrackingEnable</param>
+void SensorContext::SetSkeletonTrackingFlags( DWORD flags )
+{
+	// the value is in place before the flag says there is one
+	InterlockedExchange( &m_requestedSkeletonTrackingFlags, static_cast<LONG>(flags) );
+	InterlockedOr( &m_pendingFlags, SENSOR_FLAGS_SKELETON );
+
+	if ( NULL != m_hEvStatus )
+	{
+		SetEvent( m_hEvStatus );
+	}
+}
+
+/// <summary>
+/// Request new depth stream flags. The processing thread applies them between two frames
+/// </summary>
+/// <param name="flags">flags for NuiImageStreamSetImageFrameFlags</param>
+void SensorContext::SetDepthStreamFlags( DWORD flags )
+{
+	InterlockedExchange( &m_requestedDepthStreamFlags, static_cast<LONG>(flags) );
+	InterlockedOr( &m_pendingFlags, SENSOR_FLAGS_DEPTH );
+
+	if ( NULL != m_hEvStatus )
+	{
+		SetEvent( m_hEvStatus );
+	}
+}
+
+/// <summary>
+/// Apply the flags the UI thread requested to the sensor. Processing thread only
+/// </summary>
+void SensorContext::ApplyRequestedFlags( )
+{
+	LONG pending = InterlockedExchange( &m_pendingFlags, 0 );
+
+	// a sensor that is being recovered picks the flags up when it is attached
+	if ( pending & SENSOR_FLAGS_SKELETON )
+	{
+		m_SkeletonTrackingFlags = static_cast<DWORD>( InterlockedCompareExchange( &m_requestedSkeletonTrackingFlags, 0, 0 ) );
+
+		HRESULT hr = S_OK;
+		if ( NULL != m_pNuiSensor )
+		{
+			hr = HasSkeletalEngine( m_pNuiSensor ) ?
+				m_pNuiSensor->NuiSkeletonTrackingEnable( m_hNextSkeletonEvent, m_SkeletonTrackingFlags ) : E_FAIL;
+		}
+
+		// only the primary reports, the others may run without the skeletal engine
+		if ( 0 == m_index && FAILED( hr ) )
+		{
+			PostMessageW( m_pApp->m_hWnd, WM_USER_SENSOR_ERROR, IDS_ERROR_SKELETONTRACKING, 0 );
+		}
+	}
+
+	if ( pending & SENSOR_FLAGS_DEPTH )
+	{
+		m_DepthStreamFlags = static_cast<DWORD>( InterlockedCompareExchange( &m_requestedDepthStreamFlags, 0, 0 ) );
+
+		if ( NULL != m_pNuiSensor )
+		{
+			m_pNuiSensor->NuiImageStreamSetImageFrameFlags( m_pDepthStreamHandle, m_DepthStreamFlags );
+		}
+	}
+}
+
+/// <summary>
+/// Thread to handle Kinect processing, calls class instance thread processor
+/// </summary>
+/// <param name="pParam">instance pointer</param>
+/// <returns>always 0</returns>
+DWORD WINAPI SensorContext::Nui_ProcessThread( LPVOID pParam )
+{
+	SensorContext *pthis = (SensorContext *)pParam;
+	return pthis->Nui_ProcessThread( );
+}
+
+/// <summary>
+/// Thread to handle Kinect processing
+/// </summary>
+/// <returns>always 0</returns>
+DWORD WINAPI SensorContext::Nui_ProcessThread( )
+{
+	const int numEvents = 4;
+	HANDLE hEvents[numEvents] = { m_hEvNuiProcessStop, m_hEvStatus, m_hNextDepthFrameEvent, m_hNextSkeletonEvent };
+	int    nEventIdx;
+	DWORD  t;
+
+	m_LastDepthFPStime = timeGetTime( );
+
+	char threadName[TRACE_MAX_THREAD_NAME];
+	StringCchPrintfA( threadName, _countof(threadName), "Kinect %d", m_index );
+	m_pApp->m_metrics.NameThread( threadName );
+
+	// Main thread loop
+	bool continueProcessing = true;
+	while ( continueProcessing )
+	{
+		// Retry a lost sensor when its backoff expired, and wait no longer than that
+		int recoveries = m_recovery.GetRecoveryCount();
+		DWORD timeout = static_cast<DWORD>( m_recovery.Poll( static_cast<long long>(GetTickCount64()) ) );
+
+		if ( m_recovery.GetRecoveryCount() != recoveries )
+		{
+			m_pApp->m_metrics.OnSensorRecovered( m_index, m_recovery.GetLastRecoveryTime() );
+
+			WCHAR message[128];
+			StringCchPrintfW( message, _countof(message), L"Kinect %d recovered in %I64d ms\r\n", m_index, m_recovery.GetLastRecoveryTime() );
+			OutputDebugString( message );
+		}
+
+		// Wait for any of the events to be signalled
+		nEventIdx = WaitForMultipleObjects( numEvents, hEvents, FALSE, timeout );
+
+		// Timed out, continue
+		if ( nEventIdx == WAIT_TIMEOUT )
+		{
+			continue;
+		}
+
+		// stop event was signalled
+		if ( WAIT_OBJECT_0 == nEventIdx )
+		{
+			continueProcessing = false;
+			break;
+		}
+
+		// Status changes only detach and attach the sensor, the events and this thread stay
+		LONG status = InterlockedExchange( &m_pendingStatus, SENSOR_STATUS_NONE );
+		if ( SENSOR_STATUS_DISCONNECTED == status )
+		{
+			m_recovery.OnDisconnected( static_cast<long long>(GetTickCount64()) );
+		}
+		else if ( SENSOR_STATUS_CONNECTED == status )
+		{
+			m_recovery.OnConnected( static_cast<long long>(GetTickCount64()) );
+		}
+
+		// flags the UI asked for, on this thread since recovery may replace the sensor
+		ApplyRequestedFlags();
+
+		// Wait for each object individually with a 0 timeout to make sure to
+		// process all signalled objects if multiple objects were signalled
+		// this loop iteration
+
+		// attaching a sensor above allocates, the frames below must not
+		{
+			AllocationGuard guard;
+
+			// skeletons first, so the depth frame is drawn with the newest skeletons
+			if ( NULL != m_pNuiSensor && WAIT_OBJECT_0 == WaitForSingleObject( m_hNextSkeletonEvent, 0 ) )
+			{
+				m_pApp->Nui_GotSkeletonAlert( *this );
+			}
+
+			if ( NULL != m_pNuiSensor && WAIT_OBJECT_0 == WaitForSingleObject( m_hNextDepthFrameEvent, 0 ) )
+			{
+				//only increment frame count if a frame was successfully drawn
+				if ( m_pApp->Nui_GotDepthAlert( *this ) )
+				{
+					++m_DepthFramesTotal;
+				}
+			}
+		}
+
+		// Once per second, display the depth FPS of the preview sensor
+		t = timeGetTime( );
+		if ( (t - m_LastDepthFPStime) > 1000 )
+		{
+			int fps = ((m_DepthFramesTotal - m_LastDepthFramesTotal) * 1000 + 500) / (t - m_LastDepthFPStime);
+			if ( 0 == m_index )
+			{
+				PostMessageW( m_pApp->m_hWnd, WM_USER_UPDATE_FPS, IDC_FPS, fps );
+			}
+			m_LastDepthFramesTotal = m_DepthFramesTotal;
+			m_LastDepthFPStime = t;
+		}
+	}
+
+	return 0;
+}
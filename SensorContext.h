@@ -0,0 +1,214 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorContext.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the per sensor state: streams, events and processing thread
+
+#pragma once
+
+#include "NuiApi.h"
+#include "SensorRecovery.h"
+#include "SensorClock.h"
+#include "SkeletonBatch.h"
+#include "PointCloud.h"
+#include <malloc.h>
+#include <new>
+
+// Status changes the SDK callback hands to the processing thread
+#define SENSOR_STATUS_NONE              0
+#define SENSOR_STATUS_CONNECTED         1
+#define SENSOR_STATUS_DISCONNECTED      2
+
+// Flags the UI thread left for the processing thread to apply
+#define SENSOR_FLAGS_SKELETON           1
+#define SENSOR_FLAGS_DEPTH              2
+
+// Resolution of the depth stream every sensor opens
+#define SENSOR_DEPTH_RESOLUTION         NUI_IMAGE_RESOLUTION_320x240
+
+class TrackerApp;
+
+class SensorContext : public SensorLink
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="pApp">application that handles the frames</param>
+	/// <param name="index">index of this context, sensor 0 drives the preview</param>
+	SensorContext( TrackerApp * pApp, int index );
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~SensorContext();
+
+	/// <summary>
+	/// Allocate a context with the alignment of its skeleton batch, which plain new
+	/// does not give on 32 bit Windows
+	/// </summary>
+	/// <param name="size">bytes</param>
+	/// <returns>memory for the context</returns>
+	static void *           operator new( size_t size )
+	{
+		void * p = _aligned_malloc( size, SKELETON_BATCH_ALIGNMENT );
+		if ( NULL == p )
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+
+	static void             operator delete( void * p )
+	{
+		_aligned_free( p );
+	}
+
+	/// <summary>
+	/// Create the sensor by instance name, initialize it and open its streams
+	/// </summary>
+	/// <param name="instanceName">instance name of Kinect to open</param>
+	/// <param name="skeletonTrackingFlags">flags for NuiSkeletonTrackingEnable</param>
+	/// <param name="depthStreamFlags">flags for the depth stream</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Open( const OLECHAR * instanceName, DWORD skeletonTrackingFlags, DWORD depthStreamFlags );
+
+	/// <summary>
+	/// Start the processing thread
+	/// </summary>
+	/// <param name="affinityMask">processors the thread may run on, 0 for any</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Start( DWORD_PTR affinityMask );
+
+	/// <summary>
+	/// Stop the processing thread, shut down the sensor and close all events
+	/// </summary>
+	void                    Close( );
+
+	/// <summary>
+	/// Whether this context has a sensor, or its thread is recovering one
+	/// </summary>
+	bool                    IsOpen( ) const { return NULL != m_pNuiSensor || NULL != m_hThNuiProcess; }
+
+	/// <summary>
+	/// Report a device status change. Safe to call from the SDK status callback,
+	/// the processing thread does the actual work
+	/// </summary>
+	/// <param name="hrStatus">status of the device</param>
+	void                    OnStatusChanged( HRESULT hrStatus );
+
+	/// <summary>
+	/// Whether this context belongs to the given instance. Stays true after Close, so a
+	/// sensor that is plugged back in returns to the same context
+	/// </summary>
+	/// <param name="instanceName">instance name of a Kinect</param>
+	bool                    IsInstance( const OLECHAR * instanceName ) const;
+
+	/// <summary>
+	/// Request new skeleton tracking flags. The processing thread applies them between two
+	/// frames, the sensor is only ever touched on that thread. A failure of the preview
+	/// sensor is posted to the window as WM_USER_SENSOR_ERROR
+	/// </summary>
+	/// <param name="flags">flags for NuiSkeletonTrackingEnable</param>
+	void                    SetSkeletonTrackingFlags( DWORD flags );
+
+	/// <summary>
+	/// Request new depth stream flags. The processing thread applies them between two frames
+	/// </summary>
+	/// <param name="flags">flags for NuiImageStreamSetImageFrameFlags</param>
+	void                    SetDepthStreamFlags( DWORD flags );
+
+	int                     m_index;
+	TrackerApp *            m_pApp;
+
+	// string resource describing the step that made Open fail
+	UINT                    m_lastErrorId;
+
+	// Kinect sensor of this context
+	INuiSensor *            m_pNuiSensor;
+	BSTR                    m_instanceId;
+
+	// Re-attaches the sensor when it is lost, owned by the processing thread
+	SensorRecovery          m_recovery;
+
+	HANDLE                  m_hNextDepthFrameEvent;
+	HANDLE                  m_hNextSkeletonEvent;
+	HANDLE                  m_pDepthStreamHandle;
+
+	// Flags the streams are open with, owned by the processing thread once it runs
+	DWORD                   m_SkeletonTrackingFlags;
+	DWORD                   m_DepthStreamFlags;
+
+	// Latest smoothed skeleton frame, owned by the processing thread
+	SkeletonBatch           m_SkeletonBatch;
+
+	// Sensor timestamps on the host clock, and the capture time of m_SkeletonBatch in
+	// host microseconds. Owned by the processing thread
+	SensorClock             m_clock;
+	long long               m_SkeletonCaptureTime;
+
+	// m_SkeletonBatch was not sent yet, and skeleton frames handed to the merge stage.
+	// Owned by the processing thread
+	bool                    m_SkeletonFramePending;
+	unsigned int            m_SkeletonSubmitCount;
+
+	// Depth frames as points, sized from the first frame converted. Owned by the
+	// processing thread
+	PointCloud              m_pointCloud;
+
+	// Statistics
+	int                     m_DepthFramesTotal;
+	DWORD                   m_LastDepthFPStime;
+	int                     m_LastDepthFramesTotal;
+
+	/// <summary>
+	/// Create the sensor again by instance name and reopen its streams, keeping the
+	/// events, thread and everything downstream
+	/// </summary>
+	/// <returns>true if the sensor is streaming again</returns>
+	virtual bool            Attach( );
+
+	/// <summary>
+	/// Shut down and release the sensor, keeping the events, thread and everything downstream
+	/// </summary>
+	virtual void            Detach( );
+
+private:
+	HANDLE                  m_hThNuiProcess;
+	HANDLE                  m_hEvNuiProcessStop;
+	HANDLE                  m_hEvStatus;
+
+	// SENSOR_STATUS_* the status callback left for the processing thread
+	volatile LONG           m_pendingStatus;
+
+	// SENSOR_FLAGS_* the UI thread left for the processing thread, and their values
+	volatile LONG           m_pendingFlags;
+	volatile LONG           m_requestedSkeletonTrackingFlags;
+	volatile LONG           m_requestedDepthStreamFlags;
+
+	/// <summary>
+	/// Apply the flags the UI thread requested to the sensor. Processing thread only
+	/// </summary>
+	void                    ApplyRequestedFlags( );
+
+	/// <summary>
+	/// Initialize the created sensor and open its streams
+	/// </summary>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Initialize( );
+
+	/// <summary>
+	/// Thread to handle Kinect processing, calls class instance thread processor
+	/// </summary>
+	/// <param name="pParam">instance pointer</param>
+	/// <returns>always 0</returns>
+	static DWORD WINAPI     Nui_ProcessThread( LPVOID pParam );
+
+	/// <summary>
+	/// Thread to handle Kinect processing
+	/// </summary>
+	/// <returns>always 0</returns>
+	DWORD WINAPI            Nui_ProcessThread( );
+};
@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorRecovery.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "SensorRecovery.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+/// <param name="pLink">sensor to recover, must outlive the recovery</param>
+SensorRecovery::SensorRecovery( SensorLink * pLink ) :
+	m_pLink(pLink),
+	m_state(RECOVERY_LOST),
+	m_lostTime(0),
+	m_lastFrameTime(0),
+	m_nextAttempt(0),
+	m_backoff(RECOVERY_INITIAL_BACKOFF),
+	m_lastRecoveryTime(0),
+	m_maxRecoveryTime(0),
+	m_recoveryCount(0),
+	m_failedAttemptCount(0)
+{
+}
+
+/// <summary>
+/// The sensor was attached outside of the recovery, e.g. on startup
+/// </summary>
+/// <param name="now">current time, milliseconds</param>
+void SensorRecovery::OnAttached( long long now )
+{
+	m_state = RECOVERY_STREAMING;
+	m_lastFrameTime = now;
+	m_backoff = RECOVERY_INITIAL_BACKOFF;
+}
+
+/// <summary>
+/// The sensor delivered a frame
+/// </summary>
+/// <param name="now">current time, milliseconds</param>
+void SensorRecovery::OnFrame( long long now )
+{
+	m_lastFrameTime = now;
+}
+
+/// <summary>
+/// The sensor was unplugged or failed. Detaches it and starts retrying with backoff
+/// </summary>
+/// <param name="now">current time, milliseconds</param>
+void SensorRecovery::OnDisconnected( long long now )
+{
+	if ( RECOVERY_LOST == m_state )
+	{
+		return;
+	}
+
+	m_pLink->Detach();
+
+	m_state = RECOVERY_LOST;
+	m_lostTime = now;
+	m_backoff = RECOVERY_INITIAL_BACKOFF;
+	m_nextAttempt = now + m_backoff;
+}
+
+/// <summary>
+/// The sensor was plugged back in. The next Poll attempts to attach right away
+/// </summary>
+/// <param name="now">current time, milliseconds</param>
+void SensorRecovery::OnConnected( long long now )
+{
+	if ( RECOVERY_LOST != m_state )
+	{
+		return;
+	}
+
+	m_backoff = RECOVERY_INITIAL_BACKOFF;
+	m_nextAttempt = now;
+}
+
+/// <summary>
+/// Attempt to attach when the backoff expired, and detect stalled streams
+/// </summary>
+/// <param name="now">current time, milliseconds</param>
+/// <returns>milliseconds until Poll should run again</returns>
+long long SensorRecovery::Poll( long long now )
+{
+	if ( RECOVERY_STREAMING == m_state )
+	{
+		// a sensor can stop delivering without a status change, e.g. after a USB hiccup
+		if ( now - m_lastFrameTime > RECOVERY_STALL_TIMEOUT )
+		{
+			OnDisconnected( now );
+		}
+		else
+		{
+			return RECOVERY_MAX_POLL_INTERVAL;
+		}
+	}
+
+	if ( now < m_nextAttempt )
+	{
+		long long wait = m_nextAttempt - now;
+		return wait < RECOVERY_MAX_POLL_INTERVAL ? wait : RECOVERY_MAX_POLL_INTERVAL;
+	}
+
+	if ( m_pLink->Attach() )
+	{
+		m_state = RECOVERY_STREAMING;
+		m_lastFrameTime = now;
+		m_lastRecoveryTime = now - m_lostTime;
+		if ( m_lastRecoveryTime > m_maxRecoveryTime )
+		{
+			m_maxRecoveryTime = m_lastRecoveryTime;
+		}
+		++m_recoveryCount;
+		m_backoff = RECOVERY_INITIAL_BACKOFF;
+		return RECOVERY_MAX_POLL_INTERVAL;
+	}
+
+	// leave nothing half attached, and wait twice as long next time
+	m_pLink->Detach();
+	++m_failedAttemptCount;
+	m_nextAttempt = now + m_backoff;
+	m_backoff = m_backoff * 2 < RECOVERY_MAX_BACKOFF ? m_backoff * 2 : RECOVERY_MAX_BACKOFF;
+
+	long long wait = m_nextAttempt - now;
+	return wait < RECOVERY_MAX_POLL_INTERVAL ? wait : RECOVERY_MAX_POLL_INTERVAL;
+}
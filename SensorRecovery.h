@@ -0,0 +1,112 @@
+//------------------------------------------------------------------------------
+// <copyright file="SensorRecovery.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the state machine that re-attaches a lost sensor without tearing down the
+// pipeline around it. Only depends on the standard library, so FakeSensor can script it.
+
+#pragma once
+
+// Initial and largest wait (ms) between two attach attempts
+#define RECOVERY_INITIAL_BACKOFF        250
+#define RECOVERY_MAX_BACKOFF            8000
+
+// A streaming sensor that delivered nothing for this long (ms) is treated as lost
+#define RECOVERY_STALL_TIMEOUT          3000
+
+// Longest wait (ms) Poll asks for, so stop requests are still seen
+#define RECOVERY_MAX_POLL_INTERVAL      1000
+
+/// <summary>
+/// What the recovery attaches and detaches: the sensor and its streams, nothing else
+/// </summary>
+class SensorLink
+{
+public:
+	virtual ~SensorLink() {}
+
+	/// <summary>
+	/// Create the sensor and open its streams
+	/// </summary>
+	/// <returns>true if the sensor is streaming again</returns>
+	virtual bool Attach() = 0;
+
+	/// <summary>
+	/// Shut down the sensor and release it, keeping everything the streams feed
+	/// </summary>
+	virtual void Detach() = 0;
+};
+
+enum RecoveryState
+{
+	RECOVERY_STREAMING = 0,     // attached and delivering frames
+	RECOVERY_LOST               // detached, waiting for the next attempt
+};
+
+class SensorRecovery
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="pLink">sensor to recover, must outlive the recovery</param>
+	SensorRecovery( SensorLink * pLink );
+
+	/// <summary>
+	/// The sensor was attached outside of the recovery, e.g. on startup
+	/// </summary>
+	/// <param name="now">current time, milliseconds</param>
+	void                OnAttached( long long now );
+
+	/// <summary>
+	/// The sensor delivered a frame
+	/// </summary>
+	/// <param name="now">current time, milliseconds</param>
+	void                OnFrame( long long now );
+
+	/// <summary>
+	/// The sensor was unplugged or failed. Detaches it and starts retrying with backoff
+	/// </summary>
+	/// <param name="now">current time, milliseconds</param>
+	void                OnDisconnected( long long now );
+
+	/// <summary>
+	/// The sensor was plugged back in. The next Poll attempts to attach right away
+	/// </summary>
+	/// <param name="now">current time, milliseconds</param>
+	void                OnConnected( long long now );
+
+	/// <summary>
+	/// Attempt to attach when the backoff expired, and detect stalled streams
+	/// </summary>
+	/// <param name="now">current time, milliseconds</param>
+	/// <returns>milliseconds until Poll should run again</returns>
+	long long           Poll( long long now );
+
+	RecoveryState       GetState() const { return m_state; }
+
+	/// <summary>
+	/// Time (ms) from losing the sensor until it streamed again, for the last and the slowest recovery
+	/// </summary>
+	long long           GetLastRecoveryTime() const { return m_lastRecoveryTime; }
+	long long           GetMaxRecoveryTime() const { return m_maxRecoveryTime; }
+
+	int                 GetRecoveryCount() const { return m_recoveryCount; }
+	int                 GetFailedAttemptCount() const { return m_failedAttemptCount; }
+
+private:
+	SensorLink *        m_pLink;
+	RecoveryState       m_state;
+
+	long long           m_lostTime;
+	long long           m_lastFrameTime;
+	long long           m_nextAttempt;
+	long long           m_backoff;
+
+	long long           m_lastRecoveryTime;
+	long long           m_maxRecoveryTime;
+	int                 m_recoveryCount;
+	int                 m_failedAttemptCount;
+};
@@ -0,0 +1,505 @@
+//------------------------------------------------------------------------------
+// <copyright file="SharedPoseRing.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Shared-memory ring of the newest fused pose frames, for consumers on the tracker's own
+// machine. Header only, so a consumer includes this file and nothing else: a file mapping
+// on Windows, POSIX shared memory elsewhere.
+//
+// Every slot is guarded by a seqlock. The writer makes the slot's sequence odd, writes
+// the frame in place and makes it even again. A reader looks at the newest slot in place
+// and afterwards checks the sequence did not move, so reading takes no copy and no
+// system call. The ring keeps SHARED_POSE_SLOTS frames, a reader has that many frame
+// periods before the slot it reads is reused.
+//
+// Waiting for the next frame is optional: two named manual-reset events that alternate
+// between even and odd frames on Windows, a futex on the frame counter on Linux.
+
+#pragma once
+
+#include <atomic>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#define SHARED_POSE_MAGIC               0x50534B54  // "TKSP"
+#define SHARED_POSE_VERSION             1
+
+#define SHARED_POSE_SLOTS               8           // power of two, the frame counter wraps onto it
+#define SHARED_POSE_MAX_SKELETONS       24          // every sensor's skeletons, fused
+#define SHARED_POSE_JOINT_COUNT         20          // NUI_SKELETON_POSITION_COUNT
+
+// Names of the shared memory and, on Windows, of the notification events
+#ifdef _WIN32
+#define SHARED_POSE_NAME                "Local\\KinectTrackerPoses"
+#define SHARED_POSE_EVENT_EVEN          "Local\\KinectTrackerPosesEven"
+#define SHARED_POSE_EVENT_ODD           "Local\\KinectTrackerPosesOdd"
+#else
+#define SHARED_POSE_NAME                "/KinectTrackerPoses"
+#endif
+
+struct SharedPoseSkeleton
+{
+	unsigned int        globalId;                   // same person, same ID, across sensors and frames
+	int                 trackingState;              // NUI_SKELETON_TRACKING_STATE
+	unsigned int        sensorMask;                 // bit per sensor that saw the person
+	int                 jointState[SHARED_POSE_JOINT_COUNT];    // NUI_SKELETON_POSITION_TRACKING_STATE
+	float               joints[SHARED_POSE_JOINT_COUNT][3];     // display frame, inches
+};
+
+struct SharedPoseFrame
+{
+	unsigned long long  frameNumber;                // 1 for the first frame the writer published
+	long long           timestamp;                  // writer's clock, milliseconds
+	int                 skeletonCount;
+	int                 reserved;
+	SharedPoseSkeleton  skeletons[SHARED_POSE_MAX_SKELETONS];
+};
+
+struct SharedPoseSlot
+{
+	volatile unsigned int sequence;                 // odd while the writer is in the slot
+	unsigned int        reserved[15];               // keeps the frame off the sequence's cache line
+	SharedPoseFrame     frame;
+};
+
+struct SharedPoseHeader
+{
+	unsigned int        magic;
+	unsigned int        version;
+	unsigned int        slotCount;
+	unsigned int        slotSize;
+	volatile unsigned int latest;                   // low bits of the newest frameNumber, 0 before the first
+	unsigned int        reserved[11];
+	SharedPoseSlot      slots[SHARED_POSE_SLOTS];
+};
+
+class SharedPoseWriter
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	SharedPoseWriter() : m_pHeader(NULL), m_pSlot(NULL), m_frameNumber(0), m_notify(false)
+	{
+#ifdef _WIN32
+		m_hMapping = NULL;
+		m_hEvents[0] = NULL;
+		m_hEvents[1] = NULL;
+#else
+		m_fd = -1;
+#endif
+	}
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~SharedPoseWriter()
+	{
+		Close();
+	}
+
+	/// <summary>
+	/// Create the shared memory, and the notification if asked for
+	/// </summary>
+	/// <param name="notify">wake waiting readers on every frame, costs a system call per frame</param>
+	/// <returns>true if successful</returns>
+	bool Open( bool notify )
+	{
+		Close();
+
+		m_notify = notify;
+
+#ifdef _WIN32
+		m_hMapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedPoseHeader), SHARED_POSE_NAME );
+		if ( NULL == m_hMapping )
+		{
+			return false;
+		}
+
+		m_pHeader = static_cast<SharedPoseHeader *>( MapViewOfFile( m_hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedPoseHeader) ) );
+
+		if ( m_notify )
+		{
+			m_hEvents[0] = CreateEventA( NULL, TRUE, FALSE, SHARED_POSE_EVENT_EVEN );
+			m_hEvents[1] = CreateEventA( NULL, TRUE, FALSE, SHARED_POSE_EVENT_ODD );
+		}
+#else
+		m_fd = shm_open( SHARED_POSE_NAME, O_CREAT | O_RDWR, 0644 );
+		if ( m_fd < 0 || 0 != ftruncate( m_fd, sizeof(SharedPoseHeader) ) )
+		{
+			Close();
+			return false;
+		}
+
+		void * pView = mmap( NULL, sizeof(SharedPoseHeader), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0 );
+		m_pHeader = ( MAP_FAILED == pView ) ? NULL : static_cast<SharedPoseHeader *>(pView);
+#endif
+
+		if ( NULL == m_pHeader )
+		{
+			Close();
+			return false;
+		}
+
+		// readers only trust the ring once the magic is there
+		m_pHeader->magic = 0;
+		std::atomic_thread_fence( std::memory_order_release );
+
+		m_pHeader->version = SHARED_POSE_VERSION;
+		m_pHeader->slotCount = SHARED_POSE_SLOTS;
+		m_pHeader->slotSize = sizeof(SharedPoseSlot);
+		m_pHeader->latest = 0;
+		for ( int i = 0; i < SHARED_POSE_SLOTS; i++ )
+		{
+			m_pHeader->slots[i].sequence = 0;
+		}
+		m_frameNumber = 0;
+
+		std::atomic_thread_fence( std::memory_order_release );
+		m_pHeader->magic = SHARED_POSE_MAGIC;
+
+		return true;
+	}
+
+	/// <summary>
+	/// Unmap the shared memory. Readers keep their mapping until they close it
+	/// </summary>
+	void Close( )
+	{
+#ifdef _WIN32
+		if ( NULL != m_pHeader )
+		{
+			UnmapViewOfFile( m_pHeader );
+		}
+		for ( int i = 0; i < 2; i++ )
+		{
+			if ( NULL != m_hEvents[i] )
+			{
+				CloseHandle( m_hEvents[i] );
+				m_hEvents[i] = NULL;
+			}
+		}
+		if ( NULL != m_hMapping )
+		{
+			CloseHandle( m_hMapping );
+			m_hMapping = NULL;
+		}
+#else
+		if ( NULL != m_pHeader )
+		{
+			munmap( m_pHeader, sizeof(SharedPoseHeader) );
+		}
+		if ( m_fd >= 0 )
+		{
+			close( m_fd );
+			m_fd = -1;
+			shm_unlink( SHARED_POSE_NAME );
+		}
+#endif
+		m_pHeader = NULL;
+		m_pSlot = NULL;
+	}
+
+	bool IsOpen( ) const { return NULL != m_pHeader; }
+
+	/// <summary>
+	/// Start writing the next frame, in place in the ring
+	/// </summary>
+	/// <returns>frame to fill in, its frameNumber is already set</returns>
+	SharedPoseFrame * BeginWrite( )
+	{
+		++m_frameNumber;
+		m_pSlot = &m_pHeader->slots[m_frameNumber % SHARED_POSE_SLOTS];
+
+		// odd: readers that are in this slot will see it changed
+		m_pSlot->sequence = m_pSlot->sequence + 1;
+		std::atomic_thread_fence( std::memory_order_release );
+
+		m_pSlot->frame.frameNumber = m_frameNumber;
+		return &m_pSlot->frame;
+	}
+
+	/// <summary>
+	/// Publish the frame written since BeginWrite, and wake waiting readers if asked for
+	/// </summary>
+	void EndWrite( )
+	{
+		std::atomic_thread_fence( std::memory_order_release );
+		m_pSlot->sequence = m_pSlot->sequence + 1;
+
+		std::atomic_thread_fence( std::memory_order_release );
+		m_pHeader->latest = static_cast<unsigned int>(m_frameNumber);
+
+		if ( m_notify )
+		{
+#ifdef _WIN32
+			// readers of the frame after this one wait on the other event, re-arm it first
+			unsigned int parity = static_cast<unsigned int>( m_frameNumber & 1 );
+			ResetEvent( m_hEvents[parity ^ 1] );
+			SetEvent( m_hEvents[parity] );
+#elif defined(__linux__)
+			syscall( SYS_futex, &m_pHeader->latest, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+#endif
+		}
+	}
+
+private:
+	// not copyable, the mapping has exactly one owner
+	SharedPoseWriter( const SharedPoseWriter & );
+	SharedPoseWriter & operator=( const SharedPoseWriter & );
+
+	SharedPoseHeader *      m_pHeader;
+	SharedPoseSlot *        m_pSlot;
+	unsigned long long      m_frameNumber;
+	bool                    m_notify;
+
+#ifdef _WIN32
+	HANDLE                  m_hMapping;
+	HANDLE                  m_hEvents[2];
+#else
+	int                     m_fd;
+#endif
+};
+
+class SharedPoseReader
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	SharedPoseReader() : m_pHeader(NULL), m_pSlot(NULL), m_sequence(0)
+	{
+#ifdef _WIN32
+		m_hMapping = NULL;
+		m_hEvents[0] = NULL;
+		m_hEvents[1] = NULL;
+#endif
+	}
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~SharedPoseReader()
+	{
+		Close();
+	}
+
+	/// <summary>
+	/// Map the tracker's shared memory, read only
+	/// </summary>
+	/// <returns>true if the tracker is running and the layout matches</returns>
+	bool Open( )
+	{
+		Close();
+
+#ifdef _WIN32
+		m_hMapping = OpenFileMappingA( FILE_MAP_READ, FALSE, SHARED_POSE_NAME );
+		if ( NULL == m_hMapping )
+		{
+			return false;
+		}
+		m_pHeader = static_cast<const SharedPoseHeader *>( MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, sizeof(SharedPoseHeader) ) );
+
+		// missing when the tracker does not notify, Wait then only sleeps
+		m_hEvents[0] = OpenEventA( SYNCHRONIZE, FALSE, SHARED_POSE_EVENT_EVEN );
+		m_hEvents[1] = OpenEventA( SYNCHRONIZE, FALSE, SHARED_POSE_EVENT_ODD );
+#else
+		int fd = shm_open( SHARED_POSE_NAME, O_RDONLY, 0 );
+		if ( fd < 0 )
+		{
+			return false;
+		}
+
+		struct stat info;
+		void * pView = MAP_FAILED;
+		if ( 0 == fstat( fd, &info ) && info.st_size >= static_cast<off_t>(sizeof(SharedPoseHeader)) )
+		{
+			pView = mmap( NULL, sizeof(SharedPoseHeader), PROT_READ, MAP_SHARED, fd, 0 );
+		}
+		close( fd );
+		m_pHeader = ( MAP_FAILED == pView ) ? NULL : static_cast<const SharedPoseHeader *>(pView);
+#endif
+
+		if ( NULL == m_pHeader || SHARED_POSE_MAGIC != m_pHeader->magic || SHARED_POSE_VERSION != m_pHeader->version ||
+			 SHARED_POSE_SLOTS != m_pHeader->slotCount || sizeof(SharedPoseSlot) != m_pHeader->slotSize )
+		{
+			Close();
+			return false;
+		}
+
+		std::atomic_thread_fence( std::memory_order_acquire );
+		return true;
+	}
+
+	/// <summary>
+	/// Unmap the shared memory
+	/// </summary>
+	void Close( )
+	{
+#ifdef _WIN32
+		if ( NULL != m_pHeader )
+		{
+			UnmapViewOfFile( m_pHeader );
+		}
+		for ( int i = 0; i < 2; i++ )
+		{
+			if ( NULL != m_hEvents[i] )
+			{
+				CloseHandle( m_hEvents[i] );
+				m_hEvents[i] = NULL;
+			}
+		}
+		if ( NULL != m_hMapping )
+		{
+			CloseHandle( m_hMapping );
+			m_hMapping = NULL;
+		}
+#else
+		if ( NULL != m_pHeader )
+		{
+			munmap( const_cast<SharedPoseHeader *>(m_pHeader), sizeof(SharedPoseHeader) );
+		}
+#endif
+		m_pHeader = NULL;
+		m_pSlot = NULL;
+	}
+
+	bool IsOpen( ) const { return NULL != m_pHeader; }
+
+	/// <summary>
+	/// Low bits of the newest frame number, 0 before the first frame. Never blocks
+	/// </summary>
+	unsigned int GetLatest( ) const
+	{
+		return m_pHeader->latest;
+	}
+
+	/// <summary>
+	/// Start reading the newest frame in place. Use it, then call EndRead to learn
+	/// whether the writer overwrote it meanwhile
+	/// </summary>
+	/// <returns>newest frame, NULL if there is none yet or the writer is in its slot</returns>
+	const SharedPoseFrame * BeginRead( )
+	{
+		unsigned int latest = m_pHeader->latest;
+		if ( 0 == latest )
+		{
+			return NULL;
+		}
+		std::atomic_thread_fence( std::memory_order_acquire );
+
+		m_pSlot = &m_pHeader->slots[latest % SHARED_POSE_SLOTS];
+		m_sequence = m_pSlot->sequence;
+		std::atomic_thread_fence( std::memory_order_acquire );
+
+		if ( 0 != ( m_sequence & 1 ) )
+		{
+			return NULL;
+		}
+
+		return &m_pSlot->frame;
+	}
+
+	/// <summary>
+	/// Finish reading the frame BeginRead returned
+	/// </summary>
+	/// <returns>true if everything read since BeginRead is consistent, false to read again</returns>
+	bool EndRead( ) const
+	{
+		std::atomic_thread_fence( std::memory_order_acquire );
+		return NULL != m_pSlot && m_pSlot->sequence == m_sequence;
+	}
+
+	/// <summary>
+	/// Copy the newest frame, retrying while the writer overwrites it
+	/// </summary>
+	/// <param name="frame">receives the frame</param>
+	/// <returns>false if there is no frame yet</returns>
+	bool ReadLatest( SharedPoseFrame & frame )
+	{
+		for ( ;; )
+		{
+			const SharedPoseFrame * pFrame = BeginRead();
+			if ( NULL == pFrame )
+			{
+				if ( 0 == m_pHeader->latest )
+				{
+					return false;
+				}
+				continue;
+			}
+
+			memcpy( &frame, pFrame, sizeof(frame) );
+			if ( EndRead() )
+			{
+				return true;
+			}
+		}
+	}
+
+	/// <summary>
+	/// Wait until a frame newer than the given one is published
+	/// </summary>
+	/// <param name="latest">GetLatest value the caller has seen</param>
+	/// <param name="timeoutMs">longest wait, milliseconds</param>
+	/// <returns>true if a newer frame is there</returns>
+	bool Wait( unsigned int latest, unsigned int timeoutMs ) const
+	{
+		if ( m_pHeader->latest != latest )
+		{
+			return true;
+		}
+
+#ifdef _WIN32
+		// the writer re-armed this event before publishing the frame we have seen
+		HANDLE hEvent = m_hEvents[( latest + 1 ) & 1];
+		if ( NULL != hEvent )
+		{
+			WaitForSingleObject( hEvent, timeoutMs );
+		}
+		else
+		{
+			Sleep( 1 );
+		}
+#elif defined(__linux__)
+		struct timespec timeout;
+		timeout.tv_sec = timeoutMs / 1000;
+		timeout.tv_nsec = ( timeoutMs % 1000 ) * 1000000L;
+		syscall( SYS_futex, &m_pHeader->latest, FUTEX_WAIT, latest, &timeout, NULL, 0 );
+#else
+		usleep( 1000 );
+#endif
+
+		return m_pHeader->latest != latest;
+	}
+
+private:
+	// not copyable, the mapping has exactly one owner
+	SharedPoseReader( const SharedPoseReader & );
+	SharedPoseReader & operator=( const SharedPoseReader & );
+
+	const SharedPoseHeader *    m_pHeader;
+	const SharedPoseSlot *      m_pSlot;
+	unsigned int                m_sequence;
+
+#ifdef _WIN32
+	HANDLE                      m_hMapping;
+	HANDLE                      m_hEvents[2];
+#endif
+};
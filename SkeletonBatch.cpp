@@ -0,0 +1,85 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonBatch.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Conversion of skeleton frames into rows of coordinates
+
+#include "stdafx.h"
+#include "SkeletonBatch.h"
+#include <xmmintrin.h>
+
+// groups of 4 joints never straddle two skeletons, so every skeleton's row stays aligned
+static_assert( 0 == NUI_SKELETON_POSITION_COUNT % 4, "joints are converted 4 at a time" );
+static_assert( NUI_SKELETON_POSITION_COUNT <= 32, "joint states are bits of an unsigned int" );
+
+/// <summary>
+/// Constructor, no skeletons
+/// </summary>
+SkeletonBatch::SkeletonBatch()
+{
+	Clear();
+}
+
+/// <summary>
+/// Forget every skeleton
+/// </summary>
+void SkeletonBatch::Clear( )
+{
+	ZeroMemory( this, sizeof(*this) );
+}
+
+/// <summary>
+/// Convert a frame. Skeletons that are not tracked keep their previous joints
+/// </summary>
+/// <param name="frame">frame from NuiSkeletonGetNextFrame</param>
+void SkeletonBatch::Load( const NUI_SKELETON_FRAME & frame )
+{
+	frameNumber = frame.dwFrameNumber;
+	timestamp = frame.liTimeStamp.QuadPart;
+
+	for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+	{
+		const NUI_SKELETON_DATA & skeleton = frame.SkeletonData[i];
+		trackingState[i] = skeleton.eTrackingState;
+		trackingId[i] = skeleton.dwTrackingID;
+		position[i] = skeleton.Position;
+		trackedMask[i] = 0;
+		inferredMask[i] = 0;
+
+		// no stage reads the joints of a skeleton nobody tracks
+		if ( NUI_SKELETON_NOT_TRACKED == skeleton.eTrackingState )
+		{
+			continue;
+		}
+
+		const Vector4 * pJoints = skeleton.SkeletonPositions;
+		int row = i * NUI_SKELETON_POSITION_COUNT;
+		for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j += 4 )
+		{
+			// 4 joints in, x/y/z rows out, w dropped
+			__m128 jx = _mm_loadu_ps( &pJoints[j].x );
+			__m128 jy = _mm_loadu_ps( &pJoints[j + 1].x );
+			__m128 jz = _mm_loadu_ps( &pJoints[j + 2].x );
+			__m128 jw = _mm_loadu_ps( &pJoints[j + 3].x );
+			_MM_TRANSPOSE4_PS( jx, jy, jz, jw );
+
+			_mm_store_ps( x + row + j, jx );
+			_mm_store_ps( y + row + j, jy );
+			_mm_store_ps( z + row + j, jz );
+		}
+
+		for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+		{
+			if ( NUI_SKELETON_POSITION_TRACKED == skeleton.eSkeletonPositionTrackingState[j] )
+			{
+				trackedMask[i] |= 1u << j;
+			}
+			else if ( NUI_SKELETON_POSITION_INFERRED == skeleton.eSkeletonPositionTrackingState[j] )
+			{
+				inferredMask[i] |= 1u << j;
+			}
+		}
+	}
+}
@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonBatch.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the structure-of-arrays form of a skeleton frame. The sensor thread converts
+// each smoothed NUI_SKELETON_FRAME once, right after fetching it; the stages after it read
+// rows of x, y and z with aligned SSE loads instead of picking them out of Vector4s whose
+// w is never used, and test joint states as bits.
+
+#pragma once
+
+#include "NuiApi.h"
+
+// Joints of a whole frame, one row per coordinate
+#define SKELETON_BATCH_JOINTS           ( NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT )
+
+// Alignment of the rows, and of every skeleton in them
+#define SKELETON_BATCH_ALIGNMENT        16
+
+class __declspec(align(SKELETON_BATCH_ALIGNMENT)) SkeletonBatch
+{
+public:
+	/// <summary>
+	/// Constructor, no skeletons
+	/// </summary>
+	SkeletonBatch();
+
+	/// <summary>
+	/// Forget every skeleton
+	/// </summary>
+	void Clear( );
+
+	/// <summary>
+	/// Convert a frame. Skeletons that are not tracked keep their previous joints
+	/// </summary>
+	/// <param name="frame">frame from NuiSkeletonGetNextFrame</param>
+	void Load( const NUI_SKELETON_FRAME & frame );
+
+	/// <summary>
+	/// Joints of one skeleton, each row aligned and NUI_SKELETON_POSITION_COUNT long
+	/// </summary>
+	/// <param name="skeleton">index in the frame</param>
+	const float * GetX( int skeleton ) const { return x + skeleton * NUI_SKELETON_POSITION_COUNT; }
+	const float * GetY( int skeleton ) const { return y + skeleton * NUI_SKELETON_POSITION_COUNT; }
+	const float * GetZ( int skeleton ) const { return z + skeleton * NUI_SKELETON_POSITION_COUNT; }
+
+	/// <summary>
+	/// Tracking state of a joint
+	/// </summary>
+	/// <param name="skeleton">index in the frame</param>
+	/// <param name="joint">NUI_SKELETON_POSITION_INDEX</param>
+	/// <returns>NUI_SKELETON_POSITION_TRACKING_STATE</returns>
+	NUI_SKELETON_POSITION_TRACKING_STATE GetJointState( int skeleton, int joint ) const
+	{
+		unsigned int bit = 1u << joint;
+		return ( trackedMask[skeleton] & bit ) ? NUI_SKELETON_POSITION_TRACKED :
+			   ( inferredMask[skeleton] & bit ) ? NUI_SKELETON_POSITION_INFERRED : NUI_SKELETON_POSITION_NOT_TRACKED;
+	}
+
+	// Joints in skeleton space (meters), joint j of skeleton i at [i * NUI_SKELETON_POSITION_COUNT + j]
+	float                   x[SKELETON_BATCH_JOINTS];
+	float                   y[SKELETON_BATCH_JOINTS];
+	float                   z[SKELETON_BATCH_JOINTS];
+
+	// Bit j is set if joint j is NUI_SKELETON_POSITION_TRACKED, or NUI_SKELETON_POSITION_INFERRED
+	unsigned int            trackedMask[NUI_SKELETON_COUNT];
+	unsigned int            inferredMask[NUI_SKELETON_COUNT];
+
+	NUI_SKELETON_TRACKING_STATE trackingState[NUI_SKELETON_COUNT];
+	DWORD                   trackingId[NUI_SKELETON_COUNT];
+	Vector4                 position[NUI_SKELETON_COUNT];   // center of mass, skeleton space
+
+	DWORD                   frameNumber;
+	long long               timestamp;                      // sensor clock, milliseconds
+};
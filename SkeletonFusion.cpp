@@ -0,0 +1,477 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonFusion.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "SkeletonFusion.h"
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+// NUI_SKELETON_POSITION_SPINE, the joint persons are matched on
+static const int g_SpineJoint = 1;
+
+// NUI_SKELETON_NOT_TRACKED and NUI_SKELETON_POSITION_NOT_TRACKED
+static const int g_NotTracked = 0;
+
+// detections further apart than this (inches) are never the same person
+static const float g_AssociationGate = 20.0f;
+
+// a sensor that kept its dwTrackingID for a person is matched as if it were this much closer
+static const float g_StickyCostScale = 0.5f;
+
+// skeletons are moved forward in time by at most this much (ms), beyond that they are held
+static const double g_MaxExtrapolation = 50.0;
+
+// a person nobody has seen for this long (ms) loses its global ID
+static const long long g_TrackTimeout = 1000;
+
+// joint weight by NUI_SKELETON_POSITION_TRACKING_STATE
+static const float g_StateWeight[3] = { 0.0f, 0.25f, 1.0f };
+
+// depth noise grows with the square of the distance, closer than this (inches) it is flat
+static const float g_MinWeightDistance = 20.0f;
+
+/// <summary>
+/// Find the person a sensor's skeleton was fused into
+/// </summary>
+/// <param name="sensorIndex">index of the sensor</param>
+/// <param name="trackingId">dwTrackingID the sensor reported</param>
+/// <returns>fused skeleton, NULL if the skeleton is not part of this frame</returns>
+const FusedSkeleton * FusedSkeletonFrame::Find( int sensorIndex, unsigned int trackingId ) const
+{
+	for ( int i = 0; i < skeletonCount; i++ )
+	{
+		const FusedSkeleton & skeleton = skeletons[i];
+		if ( ( skeleton.sensorMask & ( 1u << sensorIndex ) ) && skeleton.sourceTrackingId[sensorIndex] == trackingId )
+		{
+			return &skeleton;
+		}
+	}
+
+	return NULL;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+SkeletonFusion::SkeletonFusion() : m_detectionCount(0), m_nextGlobalId(1)
+{
+	memset( m_sensors, 0, sizeof(m_sensors) );
+	memset( m_tracks, 0, sizeof(m_tracks) );
+}
+
+/// <summary>
+/// Record a new frame of a sensor and keep its clock offset up to date
+/// </summary>
+/// <param name="frame">frame the sensor just delivered</param>
+void SkeletonFusion::UpdateHistory( const SensorSkeletonFrame & frame )
+{
+	SensorHistory & history = m_sensors[frame.sensorIndex];
+	double offset = static_cast<double>( frame.arrivalTime - frame.timestamp );
+
+	if ( history.hasCurrent && frame.timestamp == history.current.timestamp )
+	{
+		return;
+	}
+
+	if ( !history.hasCurrent || frame.timestamp < history.current.timestamp )
+	{
+		// first frame, or the sensor was restarted and its clock with it
+		history.hasPrevious = false;
+		history.clockOffset = offset;
+	}
+	else
+	{
+		// frames arrive late by a varying amount, so the smallest delay seen is the best
+		// estimate of the offset. It creeps up by 1 ms per second to follow clock drift
+		double relaxed = history.clockOffset + 0.001 * ( frame.timestamp - history.current.timestamp );
+		history.clockOffset = std::min( offset, relaxed );
+
+		history.previous = history.current;
+		history.hasPrevious = true;
+	}
+
+	history.current = frame;
+	history.hasCurrent = true;
+}
+
+/// <summary>
+/// Move the skeletons of a sensor to the common timestamp and append them to m_detections
+/// </summary>
+/// <param name="history">frames of the sensor</param>
+/// <param name="timestamp">common timestamp, host clock</param>
+void SkeletonFusion::AddDetections( const SensorHistory & history, double timestamp )
+{
+	const SensorSkeletonFrame & current = history.current;
+	double currentTime = current.timestamp + history.clockOffset;
+	double previousTime = history.previous.timestamp + history.clockOffset;
+
+	for ( int i = 0; i < current.skeletonCount && m_detectionCount < FUSION_MAX_SKELETONS; i++ )
+	{
+		const SensorSkeleton & skeleton = current.skeletons[i];
+
+		// the same person in the previous frame, to interpolate between
+		const SensorSkeleton * pPrevious = NULL;
+		for ( int j = 0; history.hasPrevious && j < history.previous.skeletonCount; j++ )
+		{
+			if ( history.previous.skeletons[j].trackingId == skeleton.trackingId )
+			{
+				pPrevious = &history.previous.skeletons[j];
+				break;
+			}
+		}
+
+		Detection & detection = m_detections[m_detectionCount++];
+		detection.sensorIndex = current.sensorIndex;
+		detection.trackingId = skeleton.trackingId;
+		detection.trackingState = skeleton.trackingState;
+		detection.track = -1;
+		memcpy( detection.sensorPosition, current.sensorPosition, sizeof(detection.sensorPosition) );
+		memcpy( detection.jointX, skeleton.jointX, sizeof(detection.jointX) );
+		memcpy( detection.jointY, skeleton.jointY, sizeof(detection.jointY) );
+		memcpy( detection.jointZ, skeleton.jointZ, sizeof(detection.jointZ) );
+		memcpy( detection.jointState, skeleton.jointState, sizeof(detection.jointState) );
+
+		if ( NULL != pPrevious && currentTime > previousTime )
+		{
+			// p(t) = previous + (current - previous) * t, with t = 1 at the current frame
+			double interval = currentTime - previousTime;
+			double ahead = std::max( -interval, std::min( timestamp - currentTime, g_MaxExtrapolation ) );
+			float t = static_cast<float>( 1.0 + ahead / interval );
+
+			for ( int j = 0; j < MERGE_JOINT_COUNT; j++ )
+			{
+				if ( g_NotTracked == skeleton.jointState[j] || g_NotTracked == pPrevious->jointState[j] )
+				{
+					continue;
+				}
+
+				detection.jointX[j] = pPrevious->jointX[j] + ( skeleton.jointX[j] - pPrevious->jointX[j] ) * t;
+				detection.jointY[j] = pPrevious->jointY[j] + ( skeleton.jointY[j] - pPrevious->jointY[j] ) * t;
+				detection.jointZ[j] = pPrevious->jointZ[j] + ( skeleton.jointZ[j] - pPrevious->jointZ[j] ) * t;
+			}
+		}
+
+		if ( g_NotTracked != detection.jointState[g_SpineJoint] )
+		{
+			detection.spine[0] = detection.jointX[g_SpineJoint];
+			detection.spine[1] = detection.jointY[g_SpineJoint];
+			detection.spine[2] = detection.jointZ[g_SpineJoint];
+		}
+		else
+		{
+			// position-only skeletons have no joints, only their center
+			memcpy( detection.spine, skeleton.position, sizeof(detection.spine) );
+		}
+	}
+}
+
+// Candidate detection to track assignment
+struct FusionPair
+{
+	float  cost;
+	short  detection;
+	short  track;
+};
+
+static bool FusionPairLess( const FusionPair & a, const FusionPair & b )
+{
+	return a.cost < b.cost;
+}
+
+/// <summary>
+/// Distance between two spine positions
+/// </summary>
+static float SpineDistance( const float a[3], const float b[3] )
+{
+	float dx = a[0] - b[0];
+	float dy = a[1] - b[1];
+	float dz = a[2] - b[2];
+	return sqrtf( dx * dx + dy * dy + dz * dz );
+}
+
+/// <summary>
+/// Assign every detection to a track, starting new tracks where needed.
+/// Greedy nearest neighbour: with at most a handful of persons it finds the same
+/// assignment as the Hungarian method in all but contrived cases, at a fraction of the cost
+/// </summary>
+void SkeletonFusion::Associate( )
+{
+	FusionPair pairs[FUSION_MAX_SKELETONS * FUSION_MAX_SKELETONS];
+	int pairCount = 0;
+
+	for ( int t = 0; t < FUSION_MAX_SKELETONS; t++ )
+	{
+		m_tracks[t].claimedMask = 0;
+	}
+
+	// every plausible pair of detection and known person, cheapest first
+	for ( int d = 0; d < m_detectionCount; d++ )
+	{
+		const Detection & detection = m_detections[d];
+
+		for ( int t = 0; t < FUSION_MAX_SKELETONS; t++ )
+		{
+			const Track & track = m_tracks[t];
+			if ( !track.active )
+			{
+				continue;
+			}
+
+			float cost = SpineDistance( detection.spine, track.spine );
+			if ( cost >= g_AssociationGate )
+			{
+				continue;
+			}
+
+			if ( track.sourceTrackingId[detection.sensorIndex] == detection.trackingId )
+			{
+				cost *= g_StickyCostScale;
+			}
+
+			FusionPair & pair = pairs[pairCount++];
+			pair.cost = cost;
+			pair.detection = static_cast<short>( d );
+			pair.track = static_cast<short>( t );
+		}
+	}
+
+	std::sort( pairs, pairs + pairCount, FusionPairLess );
+
+	// a person takes at most one detection per sensor
+	for ( int i = 0; i < pairCount; i++ )
+	{
+		Detection & detection = m_detections[pairs[i].detection];
+		Track & track = m_tracks[pairs[i].track];
+		unsigned int sensorBit = 1u << detection.sensorIndex;
+
+		if ( detection.track < 0 && 0 == ( track.claimedMask & sensorBit ) )
+		{
+			detection.track = pairs[i].track;
+			track.claimedMask |= sensorBit;
+		}
+	}
+
+	// whatever is left is a new person, unless another sensor's leftover already started it
+	for ( int d = 0; d < m_detectionCount; d++ )
+	{
+		Detection & detection = m_detections[d];
+		unsigned int sensorBit = 1u << detection.sensorIndex;
+
+		if ( detection.track >= 0 )
+		{
+			continue;
+		}
+
+		int best = -1;
+		int freeTrack = -1;
+		float bestCost = g_AssociationGate;
+
+		for ( int t = 0; t < FUSION_MAX_SKELETONS; t++ )
+		{
+			const Track & track = m_tracks[t];
+			if ( !track.active )
+			{
+				if ( freeTrack < 0 )
+				{
+					freeTrack = t;
+				}
+				continue;
+			}
+
+			if ( track.claimedMask & sensorBit )
+			{
+				continue;
+			}
+
+			float cost = SpineDistance( detection.spine, track.spine );
+			if ( cost < bestCost )
+			{
+				best = t;
+				bestCost = cost;
+			}
+		}
+
+		if ( best < 0 && freeTrack >= 0 )
+		{
+			Track & track = m_tracks[freeTrack];
+			memset( &track, 0, sizeof(track) );
+			track.active = true;
+			track.globalId = m_nextGlobalId++;
+			memcpy( track.spine, detection.spine, sizeof(track.spine) );
+			best = freeTrack;
+		}
+
+		if ( best >= 0 )
+		{
+			detection.track = best;
+			m_tracks[best].claimedMask |= sensorBit;
+		}
+	}
+}
+
+/// <summary>
+/// Blend the detections of one track into a fused skeleton. Joints are weighted by
+/// tracking state and by the inverse square of their distance to the sensor
+/// </summary>
+/// <param name="track">index of the track</param>
+/// <param name="out">receives the fused skeleton</param>
+void SkeletonFusion::Blend( int track, FusedSkeleton & out ) const
+{
+	float weightSum[MERGE_JOINT_COUNT];
+	const float minDistanceSq = g_MinWeightDistance * g_MinWeightDistance;
+
+	memset( &out, 0, sizeof(out) );
+	memset( weightSum, 0, sizeof(weightSum) );
+	out.globalId = m_tracks[track].globalId;
+
+	const Detection * pFirst = NULL;
+
+	for ( int d = 0; d < m_detectionCount; d++ )
+	{
+		const Detection & detection = m_detections[d];
+		if ( detection.track != track )
+		{
+			continue;
+		}
+
+		if ( NULL == pFirst )
+		{
+			pFirst = &detection;
+		}
+
+		out.trackingState = std::max( out.trackingState, detection.trackingState );
+		out.sensorMask |= 1u << detection.sensorIndex;
+		out.sourceTrackingId[detection.sensorIndex] = detection.trackingId;
+
+		for ( int j = 0; j < MERGE_JOINT_COUNT; j++ )
+		{
+			float dx = detection.jointX[j] - detection.sensorPosition[0];
+			float dy = detection.jointY[j] - detection.sensorPosition[1];
+			float dz = detection.jointZ[j] - detection.sensorPosition[2];
+			float distanceSq = std::max( dx * dx + dy * dy + dz * dz, minDistanceSq );
+			float weight = g_StateWeight[detection.jointState[j]] / distanceSq;
+
+			out.jointX[j] += detection.jointX[j] * weight;
+			out.jointY[j] += detection.jointY[j] * weight;
+			out.jointZ[j] += detection.jointZ[j] * weight;
+			out.jointState[j] = std::max( out.jointState[j], detection.jointState[j] );
+			weightSum[j] += weight;
+		}
+	}
+
+	for ( int j = 0; j < MERGE_JOINT_COUNT; j++ )
+	{
+		if ( weightSum[j] > 0.0f )
+		{
+			float scale = 1.0f / weightSum[j];
+			out.jointX[j] *= scale;
+			out.jointY[j] *= scale;
+			out.jointZ[j] *= scale;
+		}
+		else if ( NULL != pFirst )
+		{
+			// nobody tracks this joint, keep a position anyway
+			out.jointX[j] = pFirst->jointX[j];
+			out.jointY[j] = pFirst->jointY[j];
+			out.jointZ[j] = pFirst->jointZ[j];
+		}
+	}
+}
+
+/// <summary>
+/// Align the merged frames in time, associate their skeletons and publish the fused frame.
+/// Only the merge thread may call this
+/// </summary>
+/// <param name="merged">latest frame of every live sensor</param>
+/// <param name="now">current host time, milliseconds</param>
+/// <returns>frame just published, the merge thread may read it until the next call</returns>
+const FusedSkeletonFrame & SkeletonFusion::Fuse( const MergedSkeletonFrame & merged, long long now )
+{
+	double timestamp = 0.0;
+
+	// the common timestamp is the newest frame, older ones are carried forward to it
+	for ( int i = 0; i < merged.frameCount; i++ )
+	{
+		const SensorSkeletonFrame & frame = *merged.frames[i];
+		if ( merged.freshMask & ( 1u << frame.sensorIndex ) )
+		{
+			UpdateHistory( frame );
+		}
+
+		const SensorHistory & history = m_sensors[frame.sensorIndex];
+		timestamp = std::max( timestamp, history.current.timestamp + history.clockOffset );
+	}
+
+	m_detectionCount = 0;
+	for ( int i = 0; i < merged.frameCount; i++ )
+	{
+		AddDetections( m_sensors[merged.frames[i]->sensorIndex], timestamp );
+	}
+
+	Associate();
+
+	FusedSkeletonFrame * pOut = m_output.BeginWrite();
+	pOut->timestamp = static_cast<long long>( timestamp );
+	pOut->skeletonCount = 0;
+
+	for ( int t = 0; t < FUSION_MAX_SKELETONS; t++ )
+	{
+		Track & track = m_tracks[t];
+		if ( !track.active )
+		{
+			continue;
+		}
+
+		if ( 0 == track.claimedMask )
+		{
+			if ( now - track.lastSeen > g_TrackTimeout )
+			{
+				track.active = false;
+			}
+			continue;
+		}
+
+		FusedSkeleton & fused = pOut->skeletons[pOut->skeletonCount++];
+		Blend( t, fused );
+
+		// follow the person, and remember which sensor IDs belong to it
+		if ( g_NotTracked != fused.jointState[g_SpineJoint] )
+		{
+			track.spine[0] = fused.jointX[g_SpineJoint];
+			track.spine[1] = fused.jointY[g_SpineJoint];
+			track.spine[2] = fused.jointZ[g_SpineJoint];
+		}
+		else
+		{
+			for ( int d = 0; d < m_detectionCount; d++ )
+			{
+				if ( m_detections[d].track == t )
+				{
+					memcpy( track.spine, m_detections[d].spine, sizeof(track.spine) );
+					break;
+				}
+			}
+		}
+		memcpy( track.sourceTrackingId, fused.sourceTrackingId, sizeof(track.sourceTrackingId) );
+		track.lastSeen = now;
+	}
+
+	// the triple buffer only hands this slot back to the writer after another EndWrite
+	m_output.EndWrite();
+	return *pOut;
+}
+
+/// <summary>
+/// Latest fused frame. Only one consumer thread may call this
+/// </summary>
+/// <returns>fused frame valid until the next call, NULL until the first frame was fused</returns>
+const FusedSkeletonFrame * SkeletonFusion::AcquireLatest()
+{
+	m_output.Update();
+	return m_output.Front();
+}
@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonFusion.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Fuses the skeletons several sensors see of the same person into one skeleton with a
+// global ID. Like the merge stage it only depends on the standard library.
+
+#pragma once
+
+#include "SkeletonMerge.h"
+#include "TripleBuffer.h"
+
+#define FUSION_MAX_SKELETONS            (MERGE_MAX_SENSORS * MERGE_SKELETON_COUNT)
+
+/// <summary>
+/// One person, blended from every sensor that sees it, in the display frame (inches)
+/// </summary>
+struct FusedSkeleton
+{
+	unsigned int  globalId;
+	int           trackingState;                  // best NUI_SKELETON_TRACKING_STATE of the sources
+	float         jointX[MERGE_JOINT_COUNT];
+	float         jointY[MERGE_JOINT_COUNT];
+	float         jointZ[MERGE_JOINT_COUNT];
+	int           jointState[MERGE_JOINT_COUNT];  // best NUI_SKELETON_POSITION_TRACKING_STATE of the sources
+	unsigned int  sensorMask;                     // bit per sensor that contributed
+	unsigned int  sourceTrackingId[MERGE_MAX_SENSORS]; // dwTrackingID per contributing sensor
+};
+
+/// <summary>
+/// All persons at one point in time
+/// </summary>
+struct FusedSkeletonFrame
+{
+	long long     timestamp;                      // host clock, milliseconds
+	int           skeletonCount;
+	FusedSkeleton skeletons[FUSION_MAX_SKELETONS];
+
+	/// <summary>
+	/// Find the person a sensor's skeleton was fused into
+	/// </summary>
+	/// <param name="sensorIndex">index of the sensor</param>
+	/// <param name="trackingId">dwTrackingID the sensor reported</param>
+	/// <returns>fused skeleton, NULL if the skeleton is not part of this frame</returns>
+	const FusedSkeleton * Find( int sensorIndex, unsigned int trackingId ) const;
+};
+
+class SkeletonFusion
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	SkeletonFusion();
+
+	/// <summary>
+	/// Align the merged frames in time, associate their skeletons and publish the fused frame.
+	/// Only the merge thread may call this
+	/// </summary>
+	/// <param name="merged">latest frame of every live sensor</param>
+	/// <param name="now">current host time, milliseconds</param>
+	/// <returns>frame just published, the merge thread may read it until the next call</returns>
+	const FusedSkeletonFrame & Fuse( const MergedSkeletonFrame & merged, long long now );
+
+	/// <summary>
+	/// Latest fused frame. Only one consumer thread may call this
+	/// </summary>
+	/// <returns>fused frame valid until the next call, NULL until the first frame was fused</returns>
+	const FusedSkeletonFrame * AcquireLatest();
+
+private:
+	// What the fusion remembers about one sensor between frames
+	struct SensorHistory
+	{
+		SensorSkeletonFrame  previous;
+		SensorSkeletonFrame  current;
+		bool                 hasPrevious;
+		bool                 hasCurrent;
+		double               clockOffset;       // host time minus sensor time, smallest seen
+	};
+
+	// One sensor skeleton, moved to the common timestamp
+	struct Detection
+	{
+		int           sensorIndex;
+		unsigned int  trackingId;
+		int           trackingState;
+		float         spine[3];
+		float         sensorPosition[3];
+		float         jointX[MERGE_JOINT_COUNT];
+		float         jointY[MERGE_JOINT_COUNT];
+		float         jointZ[MERGE_JOINT_COUNT];
+		int           jointState[MERGE_JOINT_COUNT];
+		int           track;
+	};
+
+	// One person over time
+	struct Track
+	{
+		bool          active;
+		unsigned int  globalId;
+		float         spine[3];
+		long long     lastSeen;
+		unsigned int  sourceTrackingId[MERGE_MAX_SENSORS];
+		unsigned int  claimedMask;              // sensors that already gave a detection this frame
+	};
+
+	/// <summary>
+	/// Record a new frame of a sensor and keep its clock offset up to date
+	/// </summary>
+	/// <param name="frame">frame the sensor just delivered</param>
+	void                 UpdateHistory( const SensorSkeletonFrame & frame );
+
+	/// <summary>
+	/// Move the skeletons of a sensor to the common timestamp and append them to m_detections
+	/// </summary>
+	/// <param name="history">frames of the sensor</param>
+	/// <param name="timestamp">common timestamp, host clock</param>
+	void                 AddDetections( const SensorHistory & history, double timestamp );
+
+	/// <summary>
+	/// Assign every detection to a track, starting new tracks where needed
+	/// </summary>
+	void                 Associate( );
+
+	/// <summary>
+	/// Blend the detections of one track into a fused skeleton
+	/// </summary>
+	/// <param name="track">index of the track</param>
+	/// <param name="out">receives the fused skeleton</param>
+	void                 Blend( int track, FusedSkeleton & out ) const;
+
+	SensorHistory        m_sensors[MERGE_MAX_SENSORS];
+
+	Detection            m_detections[FUSION_MAX_SKELETONS];
+	int                  m_detectionCount;
+
+	Track                m_tracks[FUSION_MAX_SKELETONS];
+	unsigned int         m_nextGlobalId;
+
+	TripleBuffer<FusedSkeletonFrame> m_output;
+};
@@ -0,0 +1,69 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonMerge.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "SkeletonMerge.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+SkeletonMerger::SkeletonMerger()
+{
+}
+
+/// <summary>
+/// Get the buffer a sensor writes its next frame into. Only the sensor's own thread may call this
+/// </summary>
+/// <param name="sensorIndex">index of the sensor, less than MERGE_MAX_SENSORS</param>
+/// <returns>buffer owned by the producer until EndSubmit</returns>
+SensorSkeletonFrame * SkeletonMerger::BeginSubmit( int sensorIndex )
+{
+	return m_slots[sensorIndex].BeginWrite();
+}
+
+/// <summary>
+/// Publish the frame written since BeginSubmit. Wait-free
+/// </summary>
+/// <param name="sensorIndex">index of the sensor, less than MERGE_MAX_SENSORS</param>
+void SkeletonMerger::EndSubmit( int sensorIndex )
+{
+	m_slots[sensorIndex].EndWrite();
+}
+
+/// <summary>
+/// Collect the latest frame of every sensor. Only one thread may merge. Cost is linear in sensor count
+/// </summary>
+/// <param name="merged">receives the frames</param>
+/// <param name="now">current host time, milliseconds</param>
+/// <param name="maxAge">frames that arrived longer ago than this are left out, so unplugged sensors drop out</param>
+/// <returns>number of sensors with a new frame since the last merge</returns>
+int SkeletonMerger::Merge( MergedSkeletonFrame & merged, long long now, long long maxAge )
+{
+	int fresh = 0;
+
+	merged.frameCount = 0;
+	merged.freshMask = 0;
+
+	for ( int i = 0; i < MERGE_MAX_SENSORS; i++ )
+	{
+		if ( m_slots[i].Update() )
+		{
+			merged.freshMask |= 1u << i;
+			++fresh;
+		}
+
+		const SensorSkeletonFrame * pFrame = m_slots[i].Front();
+		if ( NULL == pFrame || now - pFrame->arrivalTime > maxAge )
+		{
+			continue;
+		}
+
+		merged.frames[merged.frameCount++] = pFrame;
+	}
+
+	return fresh;
+}
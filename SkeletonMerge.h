@@ -0,0 +1,90 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonMerge.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Collects the latest skeleton frame of every sensor for the merge stage.
+// Only depends on the standard library so it can be driven by synthetic sensors.
+
+#pragma once
+
+#include "TripleBuffer.h"
+
+#define MERGE_MAX_SENSORS               4
+#define MERGE_SKELETON_COUNT            6
+#define MERGE_JOINT_COUNT               20
+
+/// <summary>
+/// One skeleton seen by one sensor, joints already in the display frame (inches)
+/// </summary>
+struct SensorSkeleton
+{
+	unsigned int  trackingId;
+	int           trackingState;                  // NUI_SKELETON_TRACKING_STATE
+	float         position[3];
+	float         jointX[MERGE_JOINT_COUNT];
+	float         jointY[MERGE_JOINT_COUNT];
+	float         jointZ[MERGE_JOINT_COUNT];
+	int           jointState[MERGE_JOINT_COUNT];  // NUI_SKELETON_POSITION_TRACKING_STATE
+};
+
+/// <summary>
+/// All skeletons one sensor produced for one frame
+/// </summary>
+struct SensorSkeletonFrame
+{
+	int           sensorIndex;
+	unsigned int  frameNumber;
+	unsigned int  submitCount;                    // frames the sensor submitted, this one included
+	long long     timestamp;                      // sensor clock, milliseconds
+	long long     arrivalTime;                    // host clock, milliseconds
+	float         sensorPosition[3];              // sensor origin in the display frame
+	int           skeletonCount;
+	SensorSkeleton skeletons[MERGE_SKELETON_COUNT];
+};
+
+/// <summary>
+/// Latest frame of every live sensor, valid until the next call to SkeletonMerger::Merge
+/// </summary>
+struct MergedSkeletonFrame
+{
+	int                         frameCount;
+	unsigned int                freshMask;        // bit per sensor that delivered since the last merge
+	const SensorSkeletonFrame * frames[MERGE_MAX_SENSORS];
+};
+
+class SkeletonMerger
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	SkeletonMerger();
+
+	/// <summary>
+	/// Get the buffer a sensor writes its next frame into. Only the sensor's own thread may call this
+	/// </summary>
+	/// <param name="sensorIndex">index of the sensor, less than MERGE_MAX_SENSORS</param>
+	/// <returns>buffer owned by the producer until EndSubmit</returns>
+	SensorSkeletonFrame * BeginSubmit( int sensorIndex );
+
+	/// <summary>
+	/// Publish the frame written since BeginSubmit. Wait-free
+	/// </summary>
+	/// <param name="sensorIndex">index of the sensor, less than MERGE_MAX_SENSORS</param>
+	void EndSubmit( int sensorIndex );
+
+	/// <summary>
+	/// Collect the latest frame of every sensor. Only one thread may merge. Cost is linear in sensor count
+	/// </summary>
+	/// <param name="merged">receives the frames</param>
+	/// <param name="now">current host time, milliseconds</param>
+	/// <param name="maxAge">frames that arrived longer ago than this are left out, so unplugged sensors drop out</param>
+	/// <returns>number of sensors with a new frame since the last merge</returns>
+	int Merge( MergedSkeletonFrame & merged, long long now, long long maxAge );
+
+private:
+	// one hand-off per sensor, so sensors never contend with each other
+	TripleBuffer<SensorSkeletonFrame> m_slots[MERGE_MAX_SENSORS];
+};
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonPreview.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Skeletons of the preview collected into reused lists and drawn in one pass
+
+#include "stdafx.h"
+#include "SkeletonPreview.h"
+
+/// <summary>
+/// One bone of the preview
+/// </summary>
+struct PreviewBone
+{
+	NUI_SKELETON_POSITION_INDEX from;
+	NUI_SKELETON_POSITION_INDEX to;
+	bool                        seated;     // drawn in seated tracking too
+};
+
+// Torso, arms, then legs; seated tracking only has the head, shoulders and arms
+static const PreviewBone g_PreviewBones[PREVIEW_BONE_COUNT] =
+{
+	{ NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER, true },
+	{ NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, true },
+	{ NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, true },
+	{ NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SPINE, false },
+	{ NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_HIP_CENTER, false },
+	{ NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, false },
+	{ NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, false },
+
+	{ NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, true },
+	{ NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, true },
+	{ NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT, true },
+	{ NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, true },
+	{ NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, true },
+	{ NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT, true },
+
+	{ NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, false },
+	{ NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, false },
+	{ NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT, false },
+	{ NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, false },
+	{ NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, false },
+	{ NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT, false }
+};
+
+/// <summary>
+/// Constructor, nothing to draw
+/// </summary>
+SkeletonPreview::SkeletonPreview()
+{
+	Clear();
+}
+
+/// <summary>
+/// Start the list of a new frame
+/// </summary>
+void SkeletonPreview::Clear( )
+{
+	m_boneCount = 0;
+	m_dotCount = 0;
+}
+
+/// <summary>
+/// Add the bones and joints of a tracked skeleton. A bone is drawn if either of its
+/// joints is tracked, a joint if it is tracked or inferred
+/// </summary>
+/// <param name="pPoints">every joint on the screen, in NUI_SKELETON_POSITION_INDEX order</param>
+/// <param name="trackedMask">bit j set if joint j is tracked</param>
+/// <param name="inferredMask">bit j set if joint j is inferred</param>
+/// <param name="seated">true to draw only the head, shoulders and arms</param>
+void SkeletonPreview::AddSkeleton( const D2D1_POINT_2F * pPoints, unsigned int trackedMask, unsigned int inferredMask, bool seated )
+{
+	for ( int i = 0; i < PREVIEW_BONE_COUNT && m_boneCount < PREVIEW_MAX_BONES; i++ )
+	{
+		const PreviewBone & bone = g_PreviewBones[i];
+		unsigned int joints = ( 1u << bone.from ) | ( 1u << bone.to );
+		if ( ( seated && !bone.seated ) || 0 == ( trackedMask & joints ) )
+		{
+			continue;
+		}
+
+		D2D1_POINT_2F * pLine = m_bones[m_boneCount++];
+		pLine[0] = pPoints[bone.from];
+		pLine[1] = pPoints[bone.to];
+	}
+
+	for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+	{
+		if ( ( trackedMask | inferredMask ) & ( 1u << j ) )
+		{
+			AddDot( pPoints[j] );
+		}
+	}
+}
+
+/// <summary>
+/// Add one dot, the position of a skeleton that is not tracked
+/// </summary>
+/// <param name="center">its point on the screen</param>
+void SkeletonPreview::AddDot( D2D1_POINT_2F center )
+{
+	if ( m_dotCount < PREVIEW_MAX_DOTS )
+	{
+		m_dots[m_dotCount++] = center;
+	}
+}
+
+/// <summary>
+/// Draw every bone, then every joint, of the lists
+/// </summary>
+/// <param name="pRenderTarget">render target between BeginDraw and EndDraw</param>
+/// <param name="pBrush">brush to draw with</param>
+void SkeletonPreview::Draw( ID2D1RenderTarget * pRenderTarget, ID2D1Brush * pBrush ) const
+{
+	// one brush and no state change between the calls, so Direct2D keeps them in one batch
+	for ( int i = 0; i < m_boneCount; i++ )
+	{
+		pRenderTarget->DrawLine( m_bones[i][0], m_bones[i][1], pBrush, PREVIEW_BONE_THICKNESS );
+	}
+
+	for ( int i = 0; i < m_dotCount; i++ )
+	{
+		pRenderTarget->FillEllipse( D2D1::Ellipse( m_dots[i], PREVIEW_JOINT_RADIUS, PREVIEW_JOINT_RADIUS ), pBrush );
+	}
+}
@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonPreview.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the skeletons drawn over the depth preview. Every bone and joint of every
+// skeleton is collected each frame into one line list and one dot list, arrays of the
+// preview that every frame reuses, then handed to the render target in one pass of DrawLine
+// and FillEllipse calls with the same brush, which Direct2D batches into its own vertex
+// buffer. Nothing is created per frame: a path geometry cannot be changed once closed, so
+// filling one meant creating, tessellating and releasing a new one every frame.
+
+#pragma once
+
+#include <d2d1.h>
+#include "NuiApi.h"
+
+// Bones drawn of a skeleton in default tracking, the seated ones are a subset
+#define PREVIEW_BONE_COUNT              19
+
+// Width of a bone's line and radius of a joint, pixels
+#define PREVIEW_BONE_THICKNESS          3.0f
+#define PREVIEW_JOINT_RADIUS            2.5f
+
+// A skeleton is either tracked, with joints, or only a position, one dot
+#define PREVIEW_MAX_BONES               ( NUI_SKELETON_COUNT * PREVIEW_BONE_COUNT )
+#define PREVIEW_MAX_DOTS                ( NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT )
+
+class SkeletonPreview
+{
+public:
+	/// <summary>
+	/// Constructor, nothing to draw
+	/// </summary>
+	SkeletonPreview();
+
+	/// <summary>
+	/// Start the list of a new frame
+	/// </summary>
+	void Clear( );
+
+	/// <summary>
+	/// Add the bones and joints of a tracked skeleton. A bone is drawn if either of its
+	/// joints is tracked, a joint if it is tracked or inferred
+	/// </summary>
+	/// <param name="pPoints">every joint on the screen, in NUI_SKELETON_POSITION_INDEX order</param>
+	/// <param name="trackedMask">bit j set if joint j is tracked</param>
+	/// <param name="inferredMask">bit j set if joint j is inferred</param>
+	/// <param name="seated">true to draw only the head, shoulders and arms</param>
+	void AddSkeleton( const D2D1_POINT_2F * pPoints, unsigned int trackedMask, unsigned int inferredMask, bool seated );
+
+	/// <summary>
+	/// Add one dot, the position of a skeleton that is not tracked
+	/// </summary>
+	/// <param name="center">its point on the screen</param>
+	void AddDot( D2D1_POINT_2F center );
+
+	/// <summary>
+	/// Draw every bone, then every joint, of the lists
+	/// </summary>
+	/// <param name="pRenderTarget">render target between BeginDraw and EndDraw</param>
+	/// <param name="pBrush">brush to draw with</param>
+	void Draw( ID2D1RenderTarget * pRenderTarget, ID2D1Brush * pBrush ) const;
+
+private:
+	D2D1_POINT_2F   m_bones[PREVIEW_MAX_BONES][2];  // start and end of each line
+	D2D1_POINT_2F   m_dots[PREVIEW_MAX_DOTS];
+	int             m_boneCount;
+	int             m_dotCount;
+};
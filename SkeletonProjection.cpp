@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonProjection.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Skeleton to image projection with the same pinhole model as NuiTransformSkeletonToDepthImage,
+// but without a call per joint and without its 320x240 rounding. It depends only on the
+// intrinsics, so live and replayed frames project identically.
+
+#include "stdafx.h"
+#include "SkeletonProjection.h"
+#include <xmmintrin.h>
+#include <float.h>
+
+/// <summary>
+/// Constructor, captures the nominal depth camera intrinsics
+/// </summary>
+SkeletonProjector::SkeletonProjector()
+{
+	SetIntrinsics( NUI_CAMERA_SKELETON_TO_DEPTH_IMAGE_MULTIPLIER_320x240, 320.0f, 240.0f );
+}
+
+/// <summary>
+/// Override the depth camera intrinsics, e.g. with values stored in a recording
+/// </summary>
+/// <param name="focalLength">focal length in pixels at the reference resolution</param>
+/// <param name="referenceWidth">width (in pixels) the focal length refers to</param>
+/// <param name="referenceHeight">height (in pixels) the focal length refers to</param>
+void SkeletonProjector::SetIntrinsics( float focalLength, float referenceWidth, float referenceHeight )
+{
+	m_focalX = focalLength / referenceWidth;
+	m_focalY = focalLength / referenceHeight;
+}
+
+/// <summary>
+/// Projects a single skeleton point
+/// </summary>
+/// <param name="skeletonPoint">skeleton point to tranform</param>
+/// <param name="width">width (in pixels) of output buffer</param>
+/// <param name="height">height (in pixels) of output buffer</param>
+/// <returns>point in screen-space</returns>
+D2D1_POINT_2F SkeletonProjector::Project( const Vector4 & skeletonPoint, int width, int height ) const
+{
+	if ( skeletonPoint.z <= FLT_EPSILON )
+	{
+		return D2D1::Point2F( 0.0f, 0.0f );
+	}
+
+	float invZ = 1.0f / skeletonPoint.z;
+
+	return D2D1::Point2F(
+		width * (0.5f + m_focalX * skeletonPoint.x * invZ),
+		height * (0.5f - m_focalY * skeletonPoint.y * invZ) );
+}
+
+/// <summary>
+/// Projects every joint of every skeleton in the frame in one pass.
+/// Joints at or behind the sensor plane map to (0, 0)
+/// </summary>
+/// <param name="batch">frame to project</param>
+/// <param name="width">width (in pixels) of output buffer</param>
+/// <param name="height">height (in pixels) of output buffer</param>
+/// <param name="points">screen-space joints, indexed by skeleton then joint</param>
+void SkeletonProjector::ProjectBatch( const SkeletonBatch & batch, int width, int height,
+	D2D1_POINT_2F points[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT] ) const
+{
+	const __m128 halfWidth = _mm_set1_ps( 0.5f * width );
+	const __m128 halfHeight = _mm_set1_ps( 0.5f * height );
+	const __m128 focalX = _mm_set1_ps( m_focalX * width );
+	const __m128 focalY = _mm_set1_ps( m_focalY * height );
+	const __m128 epsilon = _mm_set1_ps( FLT_EPSILON );
+
+	// the rows and the points are both indexed by skeleton then joint, so the whole frame
+	// is one run; joints of untracked skeletons are projected too, nobody draws them
+	float * pOut = reinterpret_cast<float *>( points );
+	for ( int j = 0; j < SKELETON_BATCH_JOINTS; j += 4 )
+	{
+		__m128 x = _mm_load_ps( batch.x + j );
+		__m128 y = _mm_load_ps( batch.y + j );
+		__m128 z = _mm_load_ps( batch.z + j );
+
+		__m128 valid = _mm_cmpgt_ps( z, epsilon );
+		__m128 invZ = _mm_div_ps( _mm_set1_ps( 1.0f ), _mm_max_ps( z, epsilon ) );
+
+		__m128 screenX = _mm_and_ps( valid, _mm_add_ps( halfWidth, _mm_mul_ps( focalX, _mm_mul_ps( x, invZ ) ) ) );
+		__m128 screenY = _mm_and_ps( valid, _mm_sub_ps( halfHeight, _mm_mul_ps( focalY, _mm_mul_ps( y, invZ ) ) ) );
+
+		// interleave back into D2D1_POINT_2F pairs
+		_mm_storeu_ps( pOut + 2 * j, _mm_unpacklo_ps( screenX, screenY ) );
+		_mm_storeu_ps( pOut + 2 * j + 4, _mm_unpackhi_ps( screenX, screenY ) );
+	}
+}
@@ -0,0 +1,55 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonProjection.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the skeleton space to image space projection
+
+#pragma once
+
+#include <d2d1.h>
+#include "NuiApi.h"
+#include "SkeletonBatch.h"
+
+class SkeletonProjector
+{
+public:
+	/// <summary>
+	/// Constructor, captures the nominal depth camera intrinsics
+	/// </summary>
+	SkeletonProjector();
+
+	/// <summary>
+	/// Override the depth camera intrinsics, e.g. with values stored in a recording
+	/// </summary>
+	/// <param name="focalLength">focal length in pixels at the reference resolution</param>
+	/// <param name="referenceWidth">width (in pixels) the focal length refers to</param>
+	/// <param name="referenceHeight">height (in pixels) the focal length refers to</param>
+	void SetIntrinsics( float focalLength, float referenceWidth, float referenceHeight );
+
+	/// <summary>
+	/// Projects a single skeleton point
+	/// </summary>
+	/// <param name="skeletonPoint">skeleton point to tranform</param>
+	/// <param name="width">width (in pixels) of output buffer</param>
+	/// <param name="height">height (in pixels) of output buffer</param>
+	/// <returns>point in screen-space</returns>
+	D2D1_POINT_2F Project( const Vector4 & skeletonPoint, int width, int height ) const;
+
+	/// <summary>
+	/// Projects every joint of every skeleton in the frame in one pass.
+	/// Joints at or behind the sensor plane map to (0, 0)
+	/// </summary>
+	/// <param name="batch">frame to project</param>
+	/// <param name="width">width (in pixels) of output buffer</param>
+	/// <param name="height">height (in pixels) of output buffer</param>
+	/// <param name="points">screen-space joints, indexed by skeleton then joint</param>
+	void ProjectBatch( const SkeletonBatch & batch, int width, int height,
+		D2D1_POINT_2F points[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT] ) const;
+
+private:
+	// focal lengths as a fraction of the image width and height
+	float                    m_focalX;
+	float                    m_focalY;
+};
@@ -0,0 +1,367 @@
+//------------------------------------------------------------------------------
+// <copyright file="SubscriberServer.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the subscriber control plane. A client connects to the server port and
+// sends lines such as "SUBSCRIBE 9000 eyes user max 30 compact" or "UNSUBSCRIBE 9000 user", each
+// answered with "OK" or "ERROR <reason>". The streams go to the UDP port on the client's
+// address for as long as the control connection stays open.
+
+#include "stdafx.h"
+#include "SubscriberServer.h"
+#include <sstream>
+
+#pragma comment(lib, "Ws2_32.lib")
+
+// Names of the SUBSCRIBER_STREAM_* in the handshake, the first one is the default
+static const char * g_StreamNames[SUBSCRIBER_STREAM_COUNT] = { "eyes", "user", "upper", "skeleton", "bones" };
+
+// Longest wait (ms) for control traffic, so stop requests are still seen
+static const int g_ServerPollInterval = 100;
+
+static const char g_ReplyOk[] = "OK\n";
+static const char g_ReplyUsage[] = "ERROR expected SUBSCRIBE or UNSUBSCRIBE <udp port> [eyes] [user] [upper] [skeleton] [bones] [max <packets per second>] [compact]\n";
+static const char g_ReplyStream[] = "ERROR unknown stream\n";
+static const char g_ReplyRate[] = "ERROR expected max <packets per second>\n";
+
+/// <summary>
+/// Constructor
+/// </summary>
+SubscriberServer::SubscriberServer() :
+	m_pTable(NULL),
+	m_listenSocket(INVALID_SOCKET),
+	m_hThServer(NULL),
+	m_hEvServerStop(NULL)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+SubscriberServer::~SubscriberServer()
+{
+	Stop();
+}
+
+/// <summary>
+/// Listen for subscribers on the given TCP port, on a thread of its own
+/// </summary>
+/// <param name="port">TCP port of the control plane</param>
+/// <param name="pTable">table the subscriptions go into, must outlive the server</param>
+/// <returns>S_OK if successful, otherwise an error code</returns>
+HRESULT SubscriberServer::Start( unsigned short port, DestinationTable * pTable )
+{
+	Stop();
+
+	if ( NULL == pTable )
+	{
+		return E_POINTER;
+	}
+	m_pTable = pTable;
+
+	m_listenSocket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+	if ( INVALID_SOCKET == m_listenSocket )
+	{
+		return HRESULT_FROM_WIN32( WSAGetLastError() );
+	}
+
+	u_long nonblocking = 1;
+	ioctlsocket( m_listenSocket, FIONBIO, &nonblocking );
+
+	sockaddr_in server;
+	ZeroMemory( &server, sizeof(server) );
+	server.sin_family = AF_INET;
+	server.sin_addr.s_addr = INADDR_ANY;
+	server.sin_port = htons( port );
+
+	if ( SOCKET_ERROR == bind( m_listenSocket, (sockaddr *)&server, sizeof(server) ) ||
+		 SOCKET_ERROR == listen( m_listenSocket, SOMAXCONN ) )
+	{
+		HRESULT hr = HRESULT_FROM_WIN32( WSAGetLastError() );
+		closesocket( m_listenSocket );
+		m_listenSocket = INVALID_SOCKET;
+		return hr;
+	}
+
+	m_hEvServerStop = CreateEvent( NULL, FALSE, FALSE, NULL );
+	m_hThServer = CreateThread( NULL, 0, ServerThread, this, 0, NULL );
+	if ( NULL == m_hThServer )
+	{
+		HRESULT hr = HRESULT_FROM_WIN32( GetLastError() );
+		Stop();
+		return hr;
+	}
+
+	return S_OK;
+}
+
+/// <summary>
+/// Stop listening, close all control connections and drop their subscriptions
+/// </summary>
+void SubscriberServer::Stop( )
+{
+	// the thread closes the connections and drops their subscriptions on its way out
+	if ( NULL != m_hEvServerStop )
+	{
+		// Signal the thread
+		SetEvent( m_hEvServerStop );
+
+		// Wait for thread to stop
+		if ( NULL != m_hThServer )
+		{
+			WaitForSingleObject( m_hThServer, INFINITE );
+			CloseHandle( m_hThServer );
+			m_hThServer = NULL;
+		}
+		CloseHandle( m_hEvServerStop );
+		m_hEvServerStop = NULL;
+	}
+
+	if ( INVALID_SOCKET != m_listenSocket )
+	{
+		closesocket( m_listenSocket );
+		m_listenSocket = INVALID_SOCKET;
+	}
+}
+
+/// <summary>
+/// Thread serving the control connections, calls class instance thread processor
+/// </summary>
+/// <param name="pParam">instance pointer</param>
+/// <returns>always 0</returns>
+DWORD WINAPI SubscriberServer::ServerThread( LPVOID pParam )
+{
+	SubscriberServer *pthis = (SubscriberServer *)pParam;
+	return pthis->ServerThread( );
+}
+
+/// <summary>
+/// Thread serving the control connections
+/// </summary>
+/// <returns>always 0</returns>
+DWORD WINAPI SubscriberServer::ServerThread( )
+{
+	std::vector<WSAPOLLFD> fds;
+
+	while ( WAIT_OBJECT_0 != WaitForSingleObject( m_hEvServerStop, 0 ) )
+	{
+		// entry 0 is the listening socket, entry i + 1 is connection i
+		fds.resize( m_connections.size() + 1 );
+		fds[0].fd = m_listenSocket;
+		fds[0].events = POLLRDNORM;
+		fds[0].revents = 0;
+		for ( size_t i = 0; i < m_connections.size(); i++ )
+		{
+			fds[i + 1].fd = m_connections[i].socket;
+			fds[i + 1].events = POLLRDNORM;
+			fds[i + 1].revents = 0;
+		}
+
+		int ready = WSAPoll( &fds[0], static_cast<ULONG>(fds.size()), g_ServerPollInterval );
+		if ( SOCKET_ERROR == ready )
+		{
+			// do not spin on a persistent error, the wait resets the stop event when it sees it
+			if ( WAIT_OBJECT_0 == WaitForSingleObject( m_hEvServerStop, g_ServerPollInterval ) )
+			{
+				break;
+			}
+			continue;
+		}
+
+		if ( 0 == ready )
+		{
+			continue;
+		}
+
+		// backwards, so dropping a connection leaves the entries still to visit in place
+		for ( size_t i = m_connections.size(); i-- > 0; )
+		{
+			if ( 0 == fds[i + 1].revents )
+			{
+				continue;
+			}
+
+			if ( !Receive( m_connections[i] ) )
+			{
+				m_pTable->DropConnection( m_connections[i].socket );
+				closesocket( m_connections[i].socket );
+				m_connections.erase( m_connections.begin() + i );
+			}
+		}
+
+		if ( 0 != fds[0].revents )
+		{
+			Accept();
+		}
+	}
+
+	for ( size_t i = 0; i < m_connections.size(); i++ )
+	{
+		closesocket( m_connections[i].socket );
+	}
+	m_connections.clear();
+
+	m_pTable->DropAllConnections();
+
+	return 0;
+}
+
+/// <summary>
+/// Accept every pending connection, closing those beyond SUBSCRIBER_MAX_CONNECTIONS
+/// </summary>
+void SubscriberServer::Accept( )
+{
+	for ( ;; )
+	{
+		Connection connection;
+		int length = sizeof(connection.address);
+
+		connection.socket = accept( m_listenSocket, (sockaddr *)&connection.address, &length );
+		if ( INVALID_SOCKET == connection.socket )
+		{
+			break;
+		}
+
+		// accepted anyway, so the client sees the close rather than a connection that hangs
+		if ( m_connections.size() >= SUBSCRIBER_MAX_CONNECTIONS )
+		{
+			closesocket( connection.socket );
+			continue;
+		}
+
+		u_long nonblocking = 1;
+		ioctlsocket( connection.socket, FIONBIO, &nonblocking );
+
+		m_connections.push_back( connection );
+	}
+}
+
+/// <summary>
+/// Read what a connection sent and handle every complete line
+/// </summary>
+/// <param name="connection">readable connection</param>
+/// <returns>false if the connection is closed or misbehaved</returns>
+bool SubscriberServer::Receive( Connection & connection )
+{
+	char buffer[SUBSCRIBER_MAX_LINE];
+
+	int received = recv( connection.socket, buffer, sizeof(buffer), 0 );
+	if ( 0 == received )
+	{
+		return false;
+	}
+	if ( SOCKET_ERROR == received )
+	{
+		return WSAEWOULDBLOCK == WSAGetLastError();
+	}
+
+	connection.pending.append( buffer, received );
+
+	size_t end;
+	while ( std::string::npos != ( end = connection.pending.find( '\n' ) ) )
+	{
+		std::string line = connection.pending.substr( 0, end );
+		connection.pending.erase( 0, end + 1 );
+
+		if ( !line.empty() && '\r' == line[line.size() - 1] )
+		{
+			line.erase( line.size() - 1 );
+		}
+		if ( line.empty() )
+		{
+			continue;
+		}
+
+		const char * reply = Handle( connection, line );
+
+		// replies are a few bytes, a client that does not read them only loses them
+		send( connection.socket, reply, static_cast<int>(strlen(reply)), 0 );
+	}
+
+	return connection.pending.size() <= SUBSCRIBER_MAX_LINE;
+}
+
+/// <summary>
+/// Handle one handshake line: SUBSCRIBE or UNSUBSCRIBE, a UDP port, streams, a rate limit and the encoding
+/// </summary>
+/// <param name="connection">connection the line came from</param>
+/// <param name="line">line without its new line</param>
+/// <returns>reply to send back</returns>
+const char * SubscriberServer::Handle( Connection & connection, const std::string & line )
+{
+	std::istringstream fields( line );
+	std::string verb;
+	std::string field;
+	int port = 0;
+	unsigned int streamMask = 0;
+	int maxRate = 0;
+	bool compact = false;
+
+	if ( !( fields >> verb >> port ) || port <= 0 || port > 65535 )
+	{
+		return g_ReplyUsage;
+	}
+
+	while ( fields >> field )
+	{
+		if ( "max" == field )
+		{
+			if ( !( fields >> maxRate ) || maxRate < 0 )
+			{
+				return g_ReplyRate;
+			}
+			continue;
+		}
+
+		if ( "compact" == field )
+		{
+			compact = true;
+			continue;
+		}
+
+		int stream = -1;
+		for ( int i = 0; i < SUBSCRIBER_STREAM_COUNT; i++ )
+		{
+			if ( field == g_StreamNames[i] )
+			{
+				stream = i;
+			}
+		}
+		if ( stream < 0 )
+		{
+			return g_ReplyStream;
+		}
+
+		streamMask |= SUBSCRIBER_STREAM_BIT(stream);
+	}
+
+	// the streams go back to the address the client connected from
+	sockaddr_in address = connection.address;
+	address.sin_port = htons( static_cast<u_short>(port) );
+
+	if ( "SUBSCRIBE" == verb )
+	{
+		if ( 0 == streamMask )
+		{
+			streamMask = SUBSCRIBER_STREAM_BIT(SUBSCRIBER_STREAM_EYES);
+		}
+
+		m_pTable->Subscribe( connection.socket, (const sockaddr *)&address, sizeof(address), streamMask, static_cast<unsigned int>(maxRate), compact );
+		return g_ReplyOk;
+	}
+
+	if ( "UNSUBSCRIBE" == verb )
+	{
+		if ( 0 == streamMask )
+		{
+			streamMask = SUBSCRIBER_STREAM_ALL;
+		}
+
+		m_pTable->Unsubscribe( connection.socket, (const sockaddr *)&address, streamMask );
+		return g_ReplyOk;
+	}
+
+	return g_ReplyUsage;
+}
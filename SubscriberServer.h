@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------
+// <copyright file="SubscriberServer.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the control-plane server that lets clients subscribe to the UDP streams
+
+#pragma once
+
+#include <winsock2.h>
+#include <string>
+#include <vector>
+#include "DestinationTable.h"
+
+// Longest handshake line, a client that sends more without a new line is dropped
+#define SUBSCRIBER_MAX_LINE             128
+
+// Control connections served at once, a further one is closed as soon as it is accepted
+#define SUBSCRIBER_MAX_CONNECTIONS      64
+
+class SubscriberServer
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	SubscriberServer();
+
+	/// <summary>
+	/// Destructor
+	/// </summary>
+	~SubscriberServer();
+
+	/// <summary>
+	/// Listen for subscribers on the given TCP port, on a thread of its own
+	/// </summary>
+	/// <param name="port">TCP port of the control plane</param>
+	/// <param name="pTable">table the subscriptions go into, must outlive the server</param>
+	/// <returns>S_OK if successful, otherwise an error code</returns>
+	HRESULT                 Start( unsigned short port, DestinationTable * pTable );
+
+	/// <summary>
+	/// Stop listening, close all control connections and drop their subscriptions
+	/// </summary>
+	void                    Stop( );
+
+	bool                    IsRunning( ) const { return NULL != m_hThServer; }
+
+private:
+	struct Connection
+	{
+		SOCKET              socket;
+		sockaddr_in         address;
+		std::string         pending;    // received bytes not terminated by a new line yet
+	};
+
+	/// <summary>
+	/// Thread serving the control connections, calls class instance thread processor
+	/// </summary>
+	/// <param name="pParam">instance pointer</param>
+	/// <returns>always 0</returns>
+	static DWORD WINAPI     ServerThread( LPVOID pParam );
+
+	/// <summary>
+	/// Thread serving the control connections
+	/// </summary>
+	/// <returns>always 0</returns>
+	DWORD WINAPI            ServerThread( );
+
+	/// <summary>
+	/// Accept every pending connection, closing those beyond SUBSCRIBER_MAX_CONNECTIONS
+	/// </summary>
+	void                    Accept( );
+
+	/// <summary>
+	/// Read what a connection sent and handle every complete line
+	/// </summary>
+	/// <param name="connection">readable connection</param>
+	/// <returns>false if the connection is closed or misbehaved</returns>
+	bool                    Receive( Connection & connection );
+
+	/// <summary>
+	/// Handle one handshake line: SUBSCRIBE or UNSUBSCRIBE, a UDP port, streams, a rate limit and the encoding
+	/// </summary>
+	/// <param name="connection">connection the line came from</param>
+	/// <param name="line">line without its new line</param>
+	/// <returns>reply to send back</returns>
+	const char *            Handle( Connection & connection, const std::string & line );
+
+	DestinationTable *      m_pTable;
+
+	SOCKET                  m_listenSocket;
+	HANDLE                  m_hThServer;
+	HANDLE                  m_hEvServerStop;
+
+	// Owned by the server thread
+	std::vector<Connection> m_connections;
+};
@@ -34,6 +34,10 @@ using namespace std;
 // Global Variables:
 TrackerApp  g_trackerApp;  // Application class
 
+// kinectInfo.cfg holds every destination and sensor
+static_assert(SETTINGS_MAX_DESTINATIONS == MAX_IPS, "one destination line per TargetIP field");
+static_assert(SETTINGS_MAX_SENSORS == MERGE_MAX_SENSORS, "one pose per sensor");
+
 // for retrieving from edit controls
 HWND hCtrl;
 char buff[50];
@@ -56,6 +60,9 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 	WSADATA wsaData;
 	int iResult;
 
+	// Debug builds check that no frame allocates, from the first one on
+	AllocationGuard::Install();
+
 	// Initialize Winsock
 	iResult = WSAStartup(MAKEWORD(2,2), &wsaData);
 	if (iResult != 0) {
@@ -146,6 +153,13 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 
 	WSACleanup();
 
+	if ( AllocationGuard::GetViolations() > 0 )
+	{
+		char message[128];
+		StringCchPrintfA( message, _countof(message), "The frame path allocated %ld times after warm-up\r\n", AllocationGuard::GetViolations() );
+		OutputDebugStringA( message );
+	}
+
 	return static_cast<int>(msg.wParam);
 }
 
@@ -176,7 +190,6 @@ TrackerApp::~TrackerApp()
 	SafeRelease(m_pD2DFactory);
 
 	Nui_Zero();
-	SysFreeString(m_instanceId);
 }
 
 
@@ -232,6 +245,9 @@ LRESULT CALLBACK TrackerApp::WndProc( HWND hWnd, UINT message, WPARAM wParam, LP
 			// Bind application window handle
 			m_hWnd = hWnd;
 
+			// edits to kinectInfo.cfg are applied while tracking
+			m_configWatcher.Start("kinectInfo.cfg", m_hWnd, WM_USER_SETTINGS_CHANGED);
+
 			// Set the font for Frames Per Second display
 			LOGFONT lf;
 			GetObject( (HFONT)GetStockObject(DEFAULT_GUI_FONT), sizeof(lf), &lf );
@@ -291,6 +307,51 @@ LRESULT CALLBACK TrackerApp::WndProc( HWND hWnd, UINT message, WPARAM wParam, LP
 		}
 		break;
 
+	case WM_USER_SENSOR_ADDED:
+		{
+			// A sensor was plugged in that no context runs yet
+			Nui_AttachSensors();
+		}
+		break;
+
+	case WM_USER_SETTINGS_CHANGED:
+		{
+			// kinectInfo.cfg was written and is valid, read on the watcher thread
+			TrackerSettings * pSettings = reinterpret_cast<TrackerSettings *>(lParam);
+			TrackerSettings current;
+			GetSettings(current);
+
+			unsigned int changed = pSettings->Compare(current);
+			if (0 != changed)
+			{
+				ApplySettings(*pSettings, changed);
+				UpdateSettingsControls(changed);
+			}
+			delete pSettings;
+		}
+		break;
+
+	case WM_USER_SENSOR_ERROR:
+		{
+			// a processing thread could not apply what was asked for, wParam is the message
+			MessageBoxResource(static_cast<UINT>(wParam), MB_OK | MB_ICONHAND);
+		}
+		break;
+
+	case WM_USER_POINT_CLOUD_FAILED:
+		{
+			// the file could not be created or written, the sensor threads stop converting.
+			// A file opened since is recording and was not what failed
+			if (!m_pointCloudRecorder.IsOpen())
+			{
+				m_pointCloudRecorder.Close();
+				PublishConfig();
+				string error = "Point clouds are not recorded, " + m_pointCloudFile + " cannot be written";
+				MessageBoxA(m_hWnd, error.c_str(), "kinectInfo.cfg", MB_OK | MB_ICONWARNING);
+			}
+		}
+		break;
+
 	case WM_USER_UPDATE_FPS:
 		{
 			::SetDlgItemInt( m_hWnd, static_cast<int>(wParam), static_cast<int>(lParam), FALSE );
@@ -395,6 +456,9 @@ LRESULT CALLBACK TrackerApp::WndProc( HWND hWnd, UINT message, WPARAM wParam, LP
 						stringstream ugh;
 						ugh << buff;
 						ugh >> m_servPort;
+
+						PublishConfig();
+						m_destinations.SetConfigured(m_ipAddress, m_port, MAX_IPS);
 					}
 				}
 				break;
@@ -402,16 +466,13 @@ LRESULT CALLBACK TrackerApp::WndProc( HWND hWnd, UINT message, WPARAM wParam, LP
 				{
 					if ( HIWORD(wParam) == BN_CLICKED)
 					{
+						// the watcher sees the write, and nothing differs from what is applied
+						TrackerSettings settings;
+						GetSettings(settings);
+
 						ofstream outFile;
 						outFile.open("kinectInfo.cfg");
-						outFile << m_servPort << endl;
-						outFile << m_trackingMode << " " << m_trackedSkeletons << " " << m_range << endl;
-						outFile << m_kinectPosition[0] << " " << m_kinectPosition[1] << " " << m_kinectPosition[2] << " " << m_KinectAngle << endl;
-						outFile << m_smoothParams.fSmoothing << " " << m_smoothParams.fCorrection << " " << m_smoothParams.fPrediction << " " << 
-							m_smoothParams.fJitterRadius << " " << m_smoothParams.fMaxDeviationRadius << endl;
-						for (int i = 0; i < MAX_IPS; i++)
-							outFile << m_ipAddress[i] << " " << m_port[i] << endl;
-
+						settings.Write(outFile);
 						outFile.close();
 					}
 				}
@@ -429,39 +490,23 @@ LRESULT CALLBACK TrackerApp::WndProc( HWND hWnd, UINT message, WPARAM wParam, LP
 					if (HIWORD(wParam) == BN_CLICKED)
 					{
 						hCtrl = GetDlgItem(m_hWnd, IDC_LISTEN_BUTTON);
+						// subscribers come and go on the server thread while the button is checked
 						if (SendMessage(hCtrl, BM_GETCHECK, 0, 0) == BST_CHECKED)
 						{
-							m_listening = true;
-							SetWindowTextA(hCtrl, "Listening..."); 
+							if (SUCCEEDED(m_subscriberServer.Start(static_cast<unsigned short>(m_servPort), &m_destinations)))
+							{
+								SetWindowTextA(hCtrl, "Listening..."); 
+							}
+							else
+							{
+								SendMessage(hCtrl, BM_SETCHECK, BST_UNCHECKED, 0);
+								SetWindowTextA(hCtrl, "Listen failed"); 
+							}
 						}
 						else
 						{
 							SetWindowTextA(hCtrl, "Listen..."); 
-							m_listening = false;
-							hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS1);
-							SetWindowTextA(hCtrl, m_ipAddress[0].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_PORT1);
-							SetWindowTextA(hCtrl, m_port[0].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS2);
-							SetWindowTextA(hCtrl, m_ipAddress[1].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_PORT2);
-							SetWindowTextA(hCtrl, m_port[1].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS3);
-							SetWindowTextA(hCtrl, m_ipAddress[2].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_PORT3);
-							SetWindowTextA(hCtrl, m_port[2].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS4);
-							SetWindowTextA(hCtrl, m_ipAddress[3].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_PORT4);
-							SetWindowTextA(hCtrl, m_port[3].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS5);
-							SetWindowTextA(hCtrl, m_ipAddress[4].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_PORT5);
-							SetWindowTextA(hCtrl, m_port[4].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS6);
-							SetWindowTextA(hCtrl, m_ipAddress[5].c_str());
-							hCtrl = GetDlgItem(m_hWnd, IDC_PORT6);
-							SetWindowTextA(hCtrl, m_port[5].c_str());
+							m_subscriberServer.Stop();
 						}
 					}
 
@@ -479,6 +524,13 @@ LRESULT CALLBACK TrackerApp::WndProc( HWND hWnd, UINT message, WPARAM wParam, LP
 		// Uninitialize NUI
 		Nui_UnInit();
 
+		// No reloads from here on
+		m_configWatcher.Stop();
+
+		// Drop the subscribers and the metrics endpoint while Winsock is still up
+		m_subscriberServer.Stop();
+		m_metrics.Stop();
+
 		// Other cleanup
 		DeleteObject(m_hFontFPS);
 
@@ -504,166 +556,309 @@ int TrackerApp::MessageBoxResource( UINT nID, UINT nType )
 	return MessageBoxW(m_hWnd, szRes, m_szAppTitle, nType);
 }
 
+/// <summary>
+/// Read kinectInfo.cfg and apply what differs from the running settings. A file that is
+/// not valid is reported and nothing is applied
+/// </summary>
 void TrackerApp::LoadFromDisk() {
-	ifstream inFile;
-	inFile.open("kinectInfo.cfg");
-
-	// load/apply/update controls for listen port
-	inFile >> m_servPort;
-	hCtrl = GetDlgItem(m_hWnd, IDC_SERVPORT);
-	stringstream ss0;
-	ss0 << m_servPort;
-	SetWindowTextA(hCtrl, ss0.str().c_str());
-
-	// load/apply calibration/network stuff
-	inFile >> m_trackingMode >> m_trackedSkeletons >> m_range;
-	inFile >> m_kinectPosition[0] >> m_kinectPosition[1] >> m_kinectPosition[2] >> m_KinectAngle;
-	inFile >> m_smoothParams.fSmoothing >> m_smoothParams.fCorrection >> m_smoothParams.fPrediction >> m_smoothParams.fJitterRadius >> m_smoothParams.fMaxDeviationRadius;
-	for (int i = 0; i < MAX_IPS; i++)
-		inFile >> m_ipAddress[i] >> m_port[i];
-	inFile.close();
+	// no file until the first Save
+	if (INVALID_FILE_ATTRIBUTES == GetFileAttributesA("kinectInfo.cfg"))
+		return;
 
-	NuiCameraElevationSetAngle(m_KinectAngle);
+	TrackerSettings settings;
+	string error;
+	if (!ConfigWatcher::Load("kinectInfo.cfg", settings, error))
+	{
+		MessageBoxA(m_hWnd, error.c_str(), "kinectInfo.cfg", MB_OK | MB_ICONWARNING);
+		return;
+	}
 
-	// update controls for calibration/network stuff
-	SendDlgItemMessage(m_hWnd, IDC_TRACKEDSKELETONS, CB_SETCURSEL, m_trackedSkeletons, 0);
-	SendDlgItemMessage(m_hWnd, IDC_TRACKINGMODE, CB_SETCURSEL, m_trackingMode, 0);
-	SendDlgItemMessage(m_hWnd, IDC_RANGE, CB_SETCURSEL, m_range, 0);
+	TrackerSettings current;
+	GetSettings(current);
+	ApplySettings(settings, m_settingsLoaded ? settings.Compare(current) : SETTINGS_CHANGED_ALL);
+	m_settingsLoaded = true;
 
-	UpdateTrackingMode( static_cast<int>(m_trackingMode) );
-	UpdateTrackedSkeletonSelection( static_cast<int>(m_trackedSkeletons) );
-	UpdateRange( static_cast<int>(m_range) );
+	// Load shows the whole file, whatever was typed into the controls since
+	UpdateSettingsControls(SETTINGS_CHANGED_ALL);
+}
 
-	stringstream ss; 
+/// <summary>
+/// Gather the settings kinectInfo.cfg holds from what is applied
+/// </summary>
+/// <param name="settings">receives the settings</param>
+void TrackerApp::GetSettings( TrackerSettings & settings )
+{
+	settings.listenPort = static_cast<unsigned short>(m_servPort);
+	settings.trackingMode = m_trackingMode;
+	settings.trackedSkeletons = m_trackedSkeletons;
+	settings.range = m_range;
+
+	for (int i = 0; i < 3; i++)
+		settings.sensorPosition[0][i] = m_kinectPosition[i];
+	settings.sensorAngle[0] = m_KinectAngle;
+	for (int s = 1; s < MERGE_MAX_SENSORS; s++)
+	{
+		for (int i = 0; i < 3; i++)
+			settings.sensorPosition[s][i] = m_sensorPosition[s][i];
+		settings.sensorAngle[s] = m_sensorAngle[s];
+	}
 
-	hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_POSITION_X);
-	ss << m_kinectPosition[0];
-	SetWindowTextA(hCtrl, ss.str().c_str());
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_POSITION_Y);
-	ss << m_kinectPosition[1];
-	SetWindowTextA(hCtrl, ss.str().c_str());
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_POSITION_Z);
-	ss << m_kinectPosition[2];
-	SetWindowTextA(hCtrl, ss.str().c_str());
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_ANGLE);
-	ss << m_KinectAngle;
-	SetWindowTextA(hCtrl, ss.str().c_str());
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_SMOOTHING);
-	ss << m_smoothParams.fSmoothing;
-	SendMessage(hCtrl, TBM_SETPOS, TRUE, (int)(100.0*atof(ss.str().c_str())));
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_CORRECTION);
-	ss << m_smoothParams.fCorrection;
-	SendMessage(hCtrl, TBM_SETPOS, TRUE, (int)(100.0*atof(ss.str().c_str())));
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_PREDICTION);
-	ss << m_smoothParams.fPrediction;
-	SendMessage(hCtrl, TBM_SETPOS, TRUE, (int)(100.0*atof(ss.str().c_str())));
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_JITTER_RADIUS);
-	ss << m_smoothParams.fJitterRadius;
-	SetWindowTextA(hCtrl, ss.str().c_str());
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_MAX_DEVIATION_RADIUS);
-	ss << m_smoothParams.fMaxDeviationRadius;
-	SetWindowTextA(hCtrl, ss.str().c_str());
-	ss.str("");
-
-	hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS1);
-	SetWindowTextA(hCtrl, m_ipAddress[0].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_PORT1);
-	SetWindowTextA(hCtrl, m_port[0].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS2);
-	SetWindowTextA(hCtrl, m_ipAddress[1].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_PORT2);
-	SetWindowTextA(hCtrl, m_port[1].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS3);
-	SetWindowTextA(hCtrl, m_ipAddress[2].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_PORT3);
-	SetWindowTextA(hCtrl, m_port[2].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS4);
-	SetWindowTextA(hCtrl, m_ipAddress[3].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_PORT4);
-	SetWindowTextA(hCtrl, m_port[3].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS5);
-	SetWindowTextA(hCtrl, m_ipAddress[4].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_PORT5);
-	SetWindowTextA(hCtrl, m_port[4].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS6);
-	SetWindowTextA(hCtrl, m_ipAddress[5].c_str());
-	hCtrl = GetDlgItem(m_hWnd, IDC_PORT6);
-	SetWindowTextA(hCtrl, m_port[5].c_str());
+	settings.smoothing = m_smoothParams.fSmoothing;
+	settings.correction = m_smoothParams.fCorrection;
+	settings.prediction = m_smoothParams.fPrediction;
+	settings.jitterRadius = m_smoothParams.fJitterRadius;
+	settings.maxDeviationRadius = m_smoothParams.fMaxDeviationRadius;
+
+	for (int i = 0; i < MAX_IPS; i++)
+	{
+		settings.ipAddress[i] = m_ipAddress[i];
+		settings.port[i] = m_port[i];
+	}
+
+	settings.multicastGroup = m_multicastGroup;
+	settings.multicastPort = m_multicastPort;
+	settings.multicastTtl = m_multicastTtl;
+	settings.multicastInterface = m_multicastInterface;
+	settings.metricsPort = m_metricsPort;
+	settings.echoPort = m_echoPort;
+	settings.traceEnabled = m_traceEnabled;
+	settings.traceThreshold = m_traceThreshold;
+	settings.eyes = m_eyeModel;
+	settings.pointCloudFile = m_pointCloudFile;
+	settings.pointCloudPlayer = m_pointCloudPlayer;
+	settings.pointCloudVoxelSize = m_pointCloudVoxelSize;
 }
 
-int TrackerApp::StartListening()
+/// <summary>
+/// Reconfigure what uses the groups of settings that changed, and nothing else
+/// </summary>
+/// <param name="settings">settings to apply</param>
+/// <param name="changed">SETTINGS_CHANGED_* flags of the groups to apply</param>
+void TrackerApp::ApplySettings( const TrackerSettings & settings, unsigned int changed )
 {
-	WSADATA wsa;
-	SOCKET s, new_socket = 0;
-	struct sockaddr_in server, client;
-	int c;
+	// takes effect the next time Listen is pressed, like the control
+	if (changed & SETTINGS_CHANGED_LISTEN)
+		m_servPort = static_cast<short>(settings.listenPort);
+
+	if (changed & SETTINGS_CHANGED_TRACKING_MODE)
+		UpdateTrackingMode(settings.trackingMode);
+	if (changed & SETTINGS_CHANGED_SKELETONS)
+		UpdateTrackedSkeletonSelection(settings.trackedSkeletons);
+	if (changed & SETTINGS_CHANGED_RANGE)
+		UpdateRange(settings.range);
+
+	// the motor only moves when the angle changed, tracking pauses while it does
+	if (changed & SETTINGS_CHANGED_ANGLE)
+	{
+		m_KinectAngle = settings.sensorAngle[0];
+		NuiCameraElevationSetAngle(m_KinectAngle);
+	}
 
-	printf("\nInitialising Winsock...");
-	if (WSAStartup(MAKEWORD(2,2),&wsa) != 0)
+	if (changed & SETTINGS_CHANGED_POSE)
 	{
-		printf("Failed. Error Code : %d",WSAGetLastError());
-		return 1;
+		for (int i = 0; i < 3; i++)
+			m_kinectPosition[i] = settings.sensorPosition[0][i];
+		m_KinectAngle = settings.sensorAngle[0];
+		for (int s = 1; s < MERGE_MAX_SENSORS; s++)
+		{
+			for (int i = 0; i < 3; i++)
+				m_sensorPosition[s][i] = settings.sensorPosition[s][i];
+			m_sensorAngle[s] = settings.sensorAngle[s];
+		}
 	}
 
-	printf("Initialised.\n");
+	if (changed & SETTINGS_CHANGED_SMOOTHING)
+	{
+		m_smoothParams.fSmoothing = settings.smoothing;
+		m_smoothParams.fCorrection = settings.correction;
+		m_smoothParams.fPrediction = settings.prediction;
+		m_smoothParams.fJitterRadius = settings.jitterRadius;
+		m_smoothParams.fMaxDeviationRadius = settings.maxDeviationRadius;
+	}
 
-	//Create a socket
-	if((s = socket(AF_INET , SOCK_STREAM , 0 )) == INVALID_SOCKET)
+	if (changed & SETTINGS_CHANGED_EYES)
+		m_eyeModel = settings.eyes;
+
+	// the file is open before the snapshot turns the clouds on, a file that cannot be
+	// created leaves them off and is reported once the settings are applied
+	if (changed & SETTINGS_CHANGED_POINT_CLOUD)
 	{
-		printf("Could not create socket : %d" , WSAGetLastError());
+		m_pointCloudFile = settings.pointCloudFile;
+		m_pointCloudPlayer = settings.pointCloudPlayer;
+		m_pointCloudVoxelSize = settings.pointCloudVoxelSize;
+		if (m_pointCloudFile.empty())
+			m_pointCloudRecorder.Close();
+		else if (FAILED(m_pointCloudRecorder.Open(m_pointCloudFile.c_str(), m_hWnd, WM_USER_POINT_CLOUD_FAILED)))
+			PostMessageW(m_hWnd, WM_USER_POINT_CLOUD_FAILED, 0, 0);
 	}
-	u_long nonblocking = 1;
-	ioctlsocket(s, FIONBIO, &nonblocking);
-	printf("Socket created.\n");
 
-	//Prepare the sockaddr_in structure
-	server.sin_family = AF_INET;
-	server.sin_addr.s_addr = INADDR_ANY;
-	server.sin_port = htons( m_servPort );
+	// the sensor threads pick up the new snapshot with their next frame
+	if (changed & (SETTINGS_CHANGED_POSE | SETTINGS_CHANGED_SMOOTHING | SETTINGS_CHANGED_EYES | SETTINGS_CHANGED_POINT_CLOUD))
+		PublishConfig();
 
-	//Bind
-	if (bind(s ,(struct sockaddr *)&server , sizeof(server)) == SOCKET_ERROR)
+	// resolve the destinations once, the frame path only sends
+	if (changed & SETTINGS_CHANGED_DESTINATIONS)
 	{
-		printf("Bind failed with error code : %d" , WSAGetLastError());
+		for (int i = 0; i < MAX_IPS; i++)
+		{
+			m_ipAddress[i] = settings.ipAddress[i];
+			m_port[i] = settings.port[i];
+		}
+		m_destinations.SetConfigured(m_ipAddress, m_port, MAX_IPS);
 	}
 
-	puts("Bind done");
+	if (changed & SETTINGS_CHANGED_MULTICAST)
+	{
+		m_multicastGroup = settings.multicastGroup;
+		m_multicastPort = settings.multicastPort;
+		m_multicastTtl = settings.multicastTtl;
+		m_multicastInterface = settings.multicastInterface;
+		m_destinations.SetMulticast(m_multicastGroup, m_multicastPort, m_multicastTtl, m_multicastInterface);
+	}
 
-	listen(s, MAX_IPS);
+	// the endpoint is only for this machine, a port in use leaves it off
+	if (changed & SETTINGS_CHANGED_METRICS)
+	{
+		m_metricsPort = settings.metricsPort;
+		m_echoPort = settings.echoPort;
+		if (m_metricsPort > 0)
+			m_metrics.Start(static_cast<unsigned short>(m_metricsPort), static_cast<unsigned short>(m_echoPort));
+		else
+			m_metrics.Stop();
+	}
 
-	//Accept and incoming connection
-	puts("Waiting for incoming connections...");
-	int i = 0, prev_socket = new_socket;
-	while (i < MAX_IPS-1) {
-		c = sizeof(struct sockaddr_in);
-		new_socket = accept(s , (struct sockaddr *)&client, &c);
-		if ((prev_socket != new_socket) && (new_socket != INVALID_SOCKET)) {
-			m_ipAddress[i] = client.sin_addr.s_addr;
-			prev_socket = new_socket;
-			i++;
-		}
+	if (changed & SETTINGS_CHANGED_TRACE)
+	{
+		m_traceEnabled = settings.traceEnabled;
+		m_traceThreshold = settings.traceThreshold;
+		m_metrics.EnableTracing(m_traceEnabled, static_cast<unsigned int>(m_traceThreshold));
+	}
+}
 
+/// <summary>
+/// Show the applied settings in the controls of the groups given
+/// </summary>
+/// <param name="changed">SETTINGS_CHANGED_* flags of the groups to show</param>
+void TrackerApp::UpdateSettingsControls( unsigned int changed )
+{
+	stringstream ss; 
+
+	if (changed & SETTINGS_CHANGED_LISTEN)
+	{
+		hCtrl = GetDlgItem(m_hWnd, IDC_SERVPORT);
+		ss << static_cast<unsigned short>(m_servPort);
+		SetWindowTextA(hCtrl, ss.str().c_str());
+		ss.str("");
 	}
 
-	puts("Connection accepted");
+	if (changed & SETTINGS_CHANGED_SKELETONS)
+		SendDlgItemMessage(m_hWnd, IDC_TRACKEDSKELETONS, CB_SETCURSEL, m_trackedSkeletons, 0);
+	if (changed & SETTINGS_CHANGED_TRACKING_MODE)
+		SendDlgItemMessage(m_hWnd, IDC_TRACKINGMODE, CB_SETCURSEL, m_trackingMode, 0);
+	if (changed & SETTINGS_CHANGED_RANGE)
+		SendDlgItemMessage(m_hWnd, IDC_RANGE, CB_SETCURSEL, m_range, 0);
 
-	return 0;
+	if (changed & SETTINGS_CHANGED_POSE)
+	{
+		hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_POSITION_X);
+		ss << m_kinectPosition[0];
+		SetWindowTextA(hCtrl, ss.str().c_str());
+		ss.str("");
+
+		hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_POSITION_Y);
+		ss << m_kinectPosition[1];
+		SetWindowTextA(hCtrl, ss.str().c_str());
+		ss.str("");
+
+		hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_POSITION_Z);
+		ss << m_kinectPosition[2];
+		SetWindowTextA(hCtrl, ss.str().c_str());
+		ss.str("");
+
+		hCtrl = GetDlgItem(m_hWnd, IDC_KINECT_ANGLE);
+		ss << m_KinectAngle;
+		SetWindowTextA(hCtrl, ss.str().c_str());
+		ss.str("");
+	}
+
+	if (changed & SETTINGS_CHANGED_SMOOTHING)
+	{
+		hCtrl = GetDlgItem(m_hWnd, IDC_SMOOTHING);
+		ss << m_smoothParams.fSmoothing;
+		SendMessage(hCtrl, TBM_SETPOS, TRUE, (int)(100.0*atof(ss.str().c_str())));
+		ss.str("");
+
+		hCtrl = GetDlgItem(m_hWnd, IDC_CORRECTION);
+		ss << m_smoothParams.fCorrection;
+		SendMessage(hCtrl, TBM_SETPOS, TRUE, (int)(100.0*atof(ss.str().c_str())));
+		ss.str("");
+
+		hCtrl = GetDlgItem(m_hWnd, IDC_PREDICTION);
+		ss << m_smoothParams.fPrediction;
+		SendMessage(hCtrl, TBM_SETPOS, TRUE, (int)(100.0*atof(ss.str().c_str())));
+		ss.str("");
+
+		hCtrl = GetDlgItem(m_hWnd, IDC_JITTER_RADIUS);
+		ss << m_smoothParams.fJitterRadius;
+		SetWindowTextA(hCtrl, ss.str().c_str());
+		ss.str("");
+
+		hCtrl = GetDlgItem(m_hWnd, IDC_MAX_DEVIATION_RADIUS);
+		ss << m_smoothParams.fMaxDeviationRadius;
+		SetWindowTextA(hCtrl, ss.str().c_str());
+		ss.str("");
+	}
 
+	if (changed & SETTINGS_CHANGED_DESTINATIONS)
+	{
+		hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS1);
+		SetWindowTextA(hCtrl, m_ipAddress[0].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_PORT1);
+		SetWindowTextA(hCtrl, m_port[0].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS2);
+		SetWindowTextA(hCtrl, m_ipAddress[1].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_PORT2);
+		SetWindowTextA(hCtrl, m_port[1].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS3);
+		SetWindowTextA(hCtrl, m_ipAddress[2].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_PORT3);
+		SetWindowTextA(hCtrl, m_port[2].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS4);
+		SetWindowTextA(hCtrl, m_ipAddress[3].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_PORT4);
+		SetWindowTextA(hCtrl, m_port[3].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS5);
+		SetWindowTextA(hCtrl, m_ipAddress[4].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_PORT5);
+		SetWindowTextA(hCtrl, m_port[4].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_IPADDRESS6);
+		SetWindowTextA(hCtrl, m_ipAddress[5].c_str());
+		hCtrl = GetDlgItem(m_hWnd, IDC_PORT6);
+		SetWindowTextA(hCtrl, m_port[5].c_str());
+	}
+}
 
-}
\ No newline at end of file
+/// <summary>
+/// Publish the smoothing parameters, the eye model, the point cloud settings and the
+/// sensor-to-display transforms the sensor threads read, built from the Kinect positions
+/// and angles. UI thread only
+/// </summary>
+void TrackerApp::PublishConfig( )
+{
+	TrackerConfig * pConfig = new TrackerConfig;
+	pConfig->smoothParams = m_smoothParams;
+	pConfig->eyeModel = m_eyeModel;
+	pConfig->pointCloudEnabled = m_pointCloudRecorder.IsOpen();
+	pConfig->pointCloudPlayer = m_pointCloudPlayer;
+	pConfig->pointCloudVoxelSize = m_pointCloudVoxelSize;
+	pConfig->calibration[0].Set( m_kinectPosition, static_cast<float>(m_KinectAngle) );
+
+	// the additional sensors are placed from kinectInfo.cfg only, their motors are left alone
+	for ( int i = 1; i < MERGE_MAX_SENSORS; i++ )
+	{
+		pConfig->calibration[i].Set( m_sensorPosition[i], static_cast<float>(m_sensorAngle[i]) );
+	}
+
+	// frames still using the previous snapshot keep it until they are done
+	m_config.Publish( pConfig );
+}
@@ -18,6 +18,20 @@
 #include <uuids.h>
 #include <string>
 #include "TrackerClient.h"
+#include "SensorCalibration.h"
+#include "TrackerConfig.h"
+#include "PointCloudRecorder.h"
+#include "SkeletonProjection.h"
+#include "SensorContext.h"
+#include "SkeletonMerge.h"
+#include "SkeletonFusion.h"
+#include "SharedPoseRing.h"
+#include "PipelineMetrics.h"
+#include "SubscriberServer.h"
+#include "TrackerSettings.h"
+#include "ConfigWatcher.h"
+#include "FramePool.h"
+#include "AllocationGuard.h"
 
 #define Default 0
 #define Closest1 1
@@ -30,6 +44,10 @@
 #define WM_USER_UPDATE_FPS              WM_USER
 #define WM_USER_UPDATE_COMBO            WM_USER+1
 #define WM_USER_UPDATE_TRACKING_COMBO   WM_USER+2
+#define WM_USER_SENSOR_ADDED            WM_USER+3
+#define WM_USER_SETTINGS_CHANGED        WM_USER+4
+#define WM_USER_SENSOR_ERROR            WM_USER+5
+#define WM_USER_POINT_CLOUD_FAILED      WM_USER+6
 
 class TrackerApp
 {
@@ -45,20 +63,19 @@ public:
 	~TrackerApp();
 
 	/// <summary>
-	/// Initialize Kinect
+	/// Initialize every connected Kinect
 	/// </summary>
 	/// <returns>S_OK if successful, otherwise an error code</returns>
 	HRESULT                 Nui_Init( );
 
 	/// <summary>
-	/// Initialize Kinect by instance name
+	/// Open and start every connected Kinect that has no running context yet
 	/// </summary>
-	/// <param name="instanceName">instance name of Kinect to initialize</param>
-	/// <returns>S_OK if successful, otherwise an error code</returns>
-	HRESULT                 Nui_Init( OLECHAR * instanceName );
+	/// <returns>S_OK if the primary sensor is running, otherwise an error code</returns>
+	HRESULT                 Nui_AttachSensors( );
 
 	/// <summary>
-	/// Uninitialize Kinect
+	/// Uninitialize all Kinects
 	/// </summary>
 	void                    Nui_UnInit( );
 
@@ -70,13 +87,16 @@ public:
 	/// <summary>
 	/// Handle new depth packetData
 	/// </summary>
+	/// <param name="sensor">sensor the frame is from</param>
 	/// <returns>true if a frame was processed, false otherwise</returns>
-	bool                    Nui_GotDepthAlert( );
+	bool                    Nui_GotDepthAlert( SensorContext & sensor );
 
 	/// <summary>
-	/// Handle new skeleton packetData
+	/// Handle new skeleton packetData, hands it to the merge stage
 	/// </summary>
-	bool                    Nui_GotSkeletonAlert( );
+	/// <param name="sensor">sensor the frame is from</param>
+	/// <returns>true if a frame was processed, false otherwise</returns>
+	bool                    Nui_GotSkeletonAlert( SensorContext & sensor );
 
 	/// <summary>
 	/// Handles window messages, passes most to the class instance to handle
@@ -169,9 +189,34 @@ public:
 	/// </summary>
 	void                    DiscardDirect2DResources( );
 
-	int StartListening();
 	void LoadFromDisk();
 
+	/// <summary>
+	/// Gather the settings kinectInfo.cfg holds from what is applied
+	/// </summary>
+	/// <param name="settings">receives the settings</param>
+	void                    GetSettings( TrackerSettings & settings );
+
+	/// <summary>
+	/// Reconfigure what uses the groups of settings that changed, and nothing else
+	/// </summary>
+	/// <param name="settings">settings to apply</param>
+	/// <param name="changed">SETTINGS_CHANGED_* flags of the groups to apply</param>
+	void                    ApplySettings( const TrackerSettings & settings, unsigned int changed );
+
+	/// <summary>
+	/// Show the applied settings in the controls of the groups given
+	/// </summary>
+	/// <param name="changed">SETTINGS_CHANGED_* flags of the groups to show</param>
+	void                    UpdateSettingsControls( unsigned int changed );
+
+	/// <summary>
+	/// Publish the smoothing parameters, the eye model, the point cloud settings and the
+	/// sensor-to-display transforms the sensor threads read, built from the Kinect positions
+	/// and angles. UI thread only
+	/// </summary>
+	void                    PublishConfig( );
+
 	/// <summary>
 	/// Converts a skeleton point to screen space
 	/// </summary>
@@ -184,24 +229,44 @@ public:
 	bool                    m_fUpdatingUi;
 	TCHAR                   m_szAppTitle[256];    // Application title
 
-	// Current Kinect sensor
-	INuiSensor*             m_pNuiSensor;
+	// Kinect sensors, sensor 0 drives the preview and the UI calibration
+	SensorContext *         m_pSensors[MERGE_MAX_SENSORS];
 
 	/// <summary>
-	/// Thread to handle Kinect processing, calls class instance thread processor
+	/// Thread that merges the skeleton frames of all sensors, calls class instance thread processor
 	/// </summary>
 	/// <param name="pParam">instance pointer</param>
 	/// <returns>always 0</returns>
-	static DWORD WINAPI     Nui_ProcessThread( LPVOID pParam );
+	static DWORD WINAPI     Nui_MergeThread( LPVOID pParam );
 
 	/// <summary>
-	/// Thread to handle Kinect processing
+	/// Thread that merges the skeleton frames of all sensors
 	/// </summary>
 	/// <returns>always 0</returns>
-	DWORD WINAPI            Nui_ProcessThread( );
+	DWORD WINAPI            Nui_MergeThread( );
+
+	/// <summary>
+	/// Count the skeleton frames newer ones replaced before the merge thread read them
+	/// </summary>
+	/// <param name="merged">frames the merge just collected</param>
+	void                    Nui_CountMergeDrops( const MergedSkeletonFrame & merged );
 
-	// Current kinect
-	BSTR                    m_instanceId;
+	/// <summary>
+	/// Convert a depth frame to the sensor's point cloud and record it, while a recording
+	/// is configured. Sensor thread only
+	/// </summary>
+	/// <param name="sensor">sensor the frame is from</param>
+	/// <param name="config">snapshot the frame is processed with</param>
+	/// <param name="pDepth">packed depth pixels of the frame</param>
+	/// <param name="width">width (in pixels) of the frame</param>
+	/// <param name="height">height (in pixels) of the frame</param>
+	/// <param name="frameNumber">depth frame number</param>
+	/// <param name="captureTime">capture time of the frame, host microseconds</param>
+	void                    Nui_ProcessPointCloud( SensorContext & sensor, const TrackerConfig & config, const USHORT * pDepth,
+												   DWORD width, DWORD height, DWORD frameNumber, long long captureTime );
+
+	// submitCount of the last frame of each sensor the merge thread read, merge thread only
+	unsigned int            m_mergedSubmitCount[MERGE_MAX_SENSORS];
 
 	// Kinect calibration
 	float m_kinectPosition[3];
@@ -216,7 +281,49 @@ public:
 	bool m_reevalGestureTriggered;
 	LONG m_KinectAngle;
 	NUI_TRANSFORM_SMOOTH_PARAMETERS m_smoothParams;
-	bool m_listening;
+	EyeModel m_eyeModel;            // where the eyes of the active user are placed
+	DestinationTable m_destinations;
+
+	// Multicast output, blank group for none
+	std::string m_multicastGroup;
+	std::string m_multicastPort;
+	int m_multicastTtl;
+	std::string m_multicastInterface;
+
+	SubscriberServer m_subscriberServer;
+
+	// Reloads kinectInfo.cfg when it is written, the first load applies every setting
+	ConfigWatcher m_configWatcher;
+	bool m_settingsLoaded;
+
+	// Stage latencies, served over HTTP when a port is configured
+	PipelineMetrics m_metrics;
+	int m_metricsPort;
+	int m_echoPort;                 // receivers echo the datagrams here to measure the latency, 0 for none
+	bool m_traceEnabled;
+	int m_traceThreshold;           // ms, a slower stage writes the trace to a file, 0 for never
+	SkeletonProjector m_projector;
+
+	// Calibration of the additional sensors, entry 0 is unused
+	float m_sensorPosition[MERGE_MAX_SENSORS][3];
+	LONG m_sensorAngle[MERGE_MAX_SENSORS];
+
+	// What the sensor threads read of the settings above, one snapshot per frame
+	TrackerConfigPointer m_config;
+
+	// Merge stage, and the fusion of what several sensors see into one skeleton per person
+	SkeletonMerger      m_merger;
+	MergedSkeletonFrame m_mergedFrame;
+	SkeletonFusion      m_fusion;
+
+	// Fused frames for consumers on this machine, written by the merge thread
+	SharedPoseWriter    m_sharedPoses;
+
+	// Point clouds of every sensor recorded to a file, off without a pointcloud line
+	PointCloudRecorder m_pointCloudRecorder;
+	std::string   m_pointCloudFile;
+	int           m_pointCloudPlayer;
+	float         m_pointCloudVoxelSize;
 
 	TrackerClient m_interactionClient;
 
@@ -227,7 +334,6 @@ public:
 	ID2D1SolidColorBrush *   m_pBrushBoneTracked;
 	ID2D1SolidColorBrush *   m_pBrushBoneInferred;
 	D2D1_POINT_2F            m_Points[NUI_SKELETON_POSITION_COUNT];
-	NUI_SKELETON_BONE_ORIENTATION m_boneOrientations[20];
 
 	// Draw devices
 	DrawDevice *            m_pDrawDepth;
@@ -235,22 +341,17 @@ public:
 	ID2D1Factory *          m_pD2DFactory;
 
 	// thread handling
-	HANDLE        m_hThNuiProcess;
-	HANDLE        m_hEvNuiProcessStop;
-
-	HANDLE        m_hNextDepthFrameEvent;
-	HANDLE        m_hNextColorFrameEvent;
-	HANDLE        m_hNextSkeletonEvent;
-	HANDLE        m_pDepthStreamHandle;
-	HANDLE        m_pVideoStreamHandle;
+	HANDLE        m_hThMerge;
+	HANDLE        m_hEvMergeStop;
+	HANDLE        m_hEvMergeWake;
+	volatile LONGLONG m_mergeSignalTime;     // PipelineMetrics::Now of the oldest unanswered wake, 0 for none
 
 	HFONT         m_hFontFPS;
-	BYTE          m_depthRGBX[640*480*4];
+
+	// Depth frames converted for the preview, sized by Nui_Init for the depth stream
+	FramePool     m_depthFrames;
 	DWORD         m_LastSkeletonFoundTime;
 	bool          m_bScreenBlanked;
-	int           m_DepthFramesTotal;
-	DWORD         m_LastDepthFPStime;
-	int           m_LastDepthFramesTotal;
 	int           m_TrackedSkeletons;
 	DWORD         m_SkeletonTrackingFlags;
 	DWORD         m_DepthStreamFlags;
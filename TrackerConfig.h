@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+// <copyright file="TrackerConfig.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the settings the sensor threads read every frame. The UI thread never changes
+// a published TrackerConfig, it publishes a new one, so a frame sees either all of an
+// update or none of it
+
+#pragma once
+
+#include "NuiApi.h"
+#include "SensorCalibration.h"
+#include "EyeEstimator.h"
+#include "SkeletonMerge.h"
+#include "RcuPointer.h"
+
+struct TrackerConfig
+{
+	NUI_TRANSFORM_SMOOTH_PARAMETERS smoothParams;
+
+	// Sensor pose in the display frame, entry 0 is the primary sensor
+	SensorCalibration               calibration[MERGE_MAX_SENSORS];
+
+	// Where the eyes of the active user are placed
+	EyeModel                        eyeModel;
+
+	// Every sensor converts its depth frames to a point cloud while one is recorded
+	bool                            pointCloudEnabled;
+	int                             pointCloudPlayer;       // PointCloud::SetPlayerFilter
+	float                           pointCloudVoxelSize;    // inches, 0 keeps every point
+};
+
+// Each sensor thread reads through the slot of its sensor index
+typedef RcuPointer<TrackerConfig, MERGE_MAX_SENSORS>     TrackerConfigPointer;
+typedef RcuSnapshot<TrackerConfig, MERGE_MAX_SENSORS>    TrackerConfigSnapshot;
@@ -0,0 +1,486 @@
+//------------------------------------------------------------------------------
+// <copyright file="TrackerSettings.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Built without the precompiled header, it does not depend on Windows or the Kinect SDK
+
+#include "TrackerSettings.h"
+#include <sstream>
+#include <stdlib.h>
+
+/// <summary>
+/// Reject a line
+/// </summary>
+/// <param name="lineNumber">line of the file, from 1</param>
+/// <param name="reason">what is wrong with it</param>
+/// <param name="error">receives the line and the reason</param>
+/// <returns>always false</returns>
+static bool Fail( int lineNumber, const char * reason, std::string & error )
+{
+	std::ostringstream message;
+	message << "kinectInfo.cfg line " << lineNumber << ": " << reason;
+	error = message.str();
+	return false;
+}
+
+/// <summary>
+/// Check that nothing follows the values of a line
+/// </summary>
+/// <param name="line">line being read</param>
+/// <returns>true if only blanks are left, false otherwise</returns>
+static bool AtEnd( std::istringstream & line )
+{
+	line >> std::ws;
+	return line.eof();
+}
+
+/// <summary>
+/// Read a port number
+/// </summary>
+/// <param name="text">port as typed</param>
+/// <returns>port, 0 if the text is not a number from 1 to 65535</returns>
+static int ParsePort( const std::string & text )
+{
+	if ( text.empty() || text.size() > 5 || std::string::npos != text.find_first_not_of( "0123456789" ) )
+	{
+		return 0;
+	}
+	int port = atoi( text.c_str() );
+	return ( port <= 65535 ) ? port : 0;
+}
+
+/// <summary>
+/// Check a finite value within a range, NaN included
+/// </summary>
+/// <param name="value">value to check</param>
+/// <param name="minimum">smallest valid value</param>
+/// <param name="maximum">largest valid value</param>
+/// <returns>true if minimum <= value <= maximum</returns>
+static bool InRange( float value, float minimum, float maximum )
+{
+	return value >= minimum && value <= maximum;
+}
+
+/// <summary>
+/// Constructor, the settings of a tracker without a file
+/// </summary>
+TrackerSettings::TrackerSettings() :
+	listenPort(0),
+	trackingMode(0),
+	trackedSkeletons(0),
+	range(0),
+	smoothing(0.5f),
+	correction(0.5f),
+	prediction(0.5f),
+	jitterRadius(0.5f),
+	maxDeviationRadius(0.04f),
+	multicastTtl(1),
+	metricsPort(0),
+	echoPort(0),
+	traceEnabled(false),
+	traceThreshold(0),
+	pointCloudPlayer(0),
+	pointCloudVoxelSize(0.0f)
+{
+	for ( int i = 0; i < SETTINGS_MAX_SENSORS; i++ )
+	{
+		sensorPosition[i][0] = 0.0f;
+		sensorPosition[i][1] = 0.0f;
+		sensorPosition[i][2] = 0.0f;
+		sensorAngle[i] = 0;
+	}
+}
+
+/// <summary>
+/// Read a whole file. Nothing is changed unless every line is valid
+/// </summary>
+/// <param name="in">file contents</param>
+/// <param name="error">receives the line and the reason the file was rejected</param>
+/// <returns>true if the file was valid and read, false otherwise</returns>
+bool TrackerSettings::Read( std::istream & in, std::string & error )
+{
+	// positions are in inches, anything further than this is a typo
+	const float maxPosition = 10000.0f;
+
+	TrackerSettings read;
+	std::string text;
+	int lineNumber = 0;
+
+	// listen port, 0 is kept for files written before it was set
+	if ( !std::getline( in, text ) )
+	{
+		return Fail( lineNumber + 1, "missing listen port", error );
+	}
+	lineNumber++;
+	{
+		std::istringstream line( text );
+		if ( !( line >> read.listenPort ) || !AtEnd( line ) || read.listenPort < 0 || read.listenPort > 65535 )
+		{
+			return Fail( lineNumber, "expected a listen port from 0 to 65535", error );
+		}
+	}
+
+	// the three combo boxes
+	if ( !std::getline( in, text ) )
+	{
+		return Fail( lineNumber + 1, "missing tracking mode, tracked skeletons and range", error );
+	}
+	lineNumber++;
+	{
+		std::istringstream line( text );
+		if ( !( line >> read.trackingMode >> read.trackedSkeletons >> read.range ) || !AtEnd( line ) )
+		{
+			return Fail( lineNumber, "expected tracking mode, tracked skeletons and range", error );
+		}
+		if ( read.trackingMode < 0 || read.trackingMode > 1 )
+		{
+			return Fail( lineNumber, "tracking mode must be 0 (default) or 1 (seated)", error );
+		}
+		if ( read.trackedSkeletons < 0 || read.trackedSkeletons > 4 )
+		{
+			return Fail( lineNumber, "tracked skeletons must be from 0 to 4", error );
+		}
+		if ( read.range < 0 || read.range > 1 )
+		{
+			return Fail( lineNumber, "range must be 0 (default) or 1 (near)", error );
+		}
+	}
+
+	// primary sensor pose
+	if ( !std::getline( in, text ) )
+	{
+		return Fail( lineNumber + 1, "missing Kinect position and angle", error );
+	}
+	lineNumber++;
+	{
+		std::istringstream line( text );
+		float * pPosition = read.sensorPosition[0];
+		if ( !( line >> pPosition[0] >> pPosition[1] >> pPosition[2] >> read.sensorAngle[0] ) || !AtEnd( line ) )
+		{
+			return Fail( lineNumber, "expected x, y, z and a whole angle in degrees", error );
+		}
+		if ( !InRange( pPosition[0], -maxPosition, maxPosition ) || !InRange( pPosition[1], -maxPosition, maxPosition ) ||
+			 !InRange( pPosition[2], -maxPosition, maxPosition ) )
+		{
+			return Fail( lineNumber, "position out of range", error );
+		}
+		if ( read.sensorAngle[0] < -SETTINGS_MAX_ANGLE || read.sensorAngle[0] > SETTINGS_MAX_ANGLE )
+		{
+			return Fail( lineNumber, "angle must be from -27 to 27 degrees", error );
+		}
+	}
+
+	// smoothing, the ranges NuiTransformSmooth takes
+	if ( !std::getline( in, text ) )
+	{
+		return Fail( lineNumber + 1, "missing smoothing parameters", error );
+	}
+	lineNumber++;
+	{
+		std::istringstream line( text );
+		if ( !( line >> read.smoothing >> read.correction >> read.prediction >> read.jitterRadius >> read.maxDeviationRadius ) || !AtEnd( line ) )
+		{
+			return Fail( lineNumber, "expected smoothing, correction, prediction, jitter radius and max deviation radius", error );
+		}
+		if ( !InRange( read.smoothing, 0.0f, 1.0f ) || !InRange( read.correction, 0.0f, 1.0f ) )
+		{
+			return Fail( lineNumber, "smoothing and correction must be from 0 to 1", error );
+		}
+		if ( !InRange( read.prediction, 0.0f, 100.0f ) || !InRange( read.jitterRadius, 0.0f, 100.0f ) ||
+			 !InRange( read.maxDeviationRadius, 0.0f, 100.0f ) )
+		{
+			return Fail( lineNumber, "prediction and radii must not be negative", error );
+		}
+	}
+
+	// destinations, a short file leaves the rest blank
+	for ( int i = 0; i < SETTINGS_MAX_DESTINATIONS && std::getline( in, text ); i++ )
+	{
+		lineNumber++;
+		std::istringstream line( text );
+		if ( !( line >> read.ipAddress[i] ) )
+		{
+			continue;
+		}
+		if ( !( line >> read.port[i] ) || !AtEnd( line ) || 0 == ParsePort( read.port[i] ) )
+		{
+			return Fail( lineNumber, "expected a destination address and a port from 1 to 65535", error );
+		}
+	}
+
+	// optional keyword lines
+	while ( std::getline( in, text ) )
+	{
+		lineNumber++;
+		std::istringstream line( text );
+		std::string key;
+		if ( !( line >> key ) )
+		{
+			continue;
+		}
+
+		if ( key == "multicast" )
+		{
+			read.multicastTtl = 1;
+			read.multicastInterface = "";
+			if ( !( line >> read.multicastGroup >> read.multicastPort ) || 0 == ParsePort( read.multicastPort ) )
+			{
+				return Fail( lineNumber, "expected multicast <group> <port> [ttl] [interface]", error );
+			}
+			if ( !AtEnd( line ) && ( !( line >> read.multicastTtl ) || read.multicastTtl < 0 || read.multicastTtl > 255 ) )
+			{
+				return Fail( lineNumber, "multicast ttl must be from 0 to 255", error );
+			}
+			if ( !AtEnd( line ) && ( !( line >> read.multicastInterface ) || !AtEnd( line ) ) )
+			{
+				return Fail( lineNumber, "expected multicast <group> <port> [ttl] [interface]", error );
+			}
+		}
+		else if ( key == "metrics" )
+		{
+			std::string port;
+			std::string echoPort = "0";
+			line >> port;
+			if ( !AtEnd( line ) )
+			{
+				line >> echoPort;
+			}
+
+			read.metricsPort = ParsePort( port );
+			read.echoPort = ParsePort( echoPort );
+			if ( 0 == read.metricsPort || ( 0 == read.echoPort && echoPort != "0" ) || !AtEnd( line ) )
+			{
+				return Fail( lineNumber, "expected metrics <port> [echo port], ports from 1 to 65535", error );
+			}
+		}
+		else if ( key == "trace" )
+		{
+			read.traceEnabled = true;
+			read.traceThreshold = 0;
+			if ( !AtEnd( line ) && ( !( line >> read.traceThreshold ) || read.traceThreshold < 0 || !AtEnd( line ) ) )
+			{
+				return Fail( lineNumber, "expected trace [threshold ms]", error );
+			}
+		}
+		else if ( key == "eyes" )
+		{
+			EyeModel & eyes = read.eyes;
+			eyes.smoothing = EYE_DEFAULT_SMOOTHING;
+			if ( !( line >> eyes.ipd >> eyes.height >> eyes.forward ) )
+			{
+				return Fail( lineNumber, "expected eyes <ipd> <height> <forward> [smoothing]", error );
+			}
+			if ( !AtEnd( line ) && ( !( line >> eyes.smoothing ) || !AtEnd( line ) ) )
+			{
+				return Fail( lineNumber, "expected eyes <ipd> <height> <forward> [smoothing]", error );
+			}
+			if ( !InRange( eyes.ipd, 0.0f, 10.0f ) || !InRange( eyes.height, -10.0f, 10.0f ) || !InRange( eyes.forward, -10.0f, 10.0f ) )
+			{
+				return Fail( lineNumber, "ipd must be from 0 to 10 inches, height and forward from -10 to 10", error );
+			}
+			// a weight of 1 would never move from the first orientation
+			if ( !InRange( eyes.smoothing, 0.0f, 0.99f ) )
+			{
+				return Fail( lineNumber, "eye smoothing must be from 0 to 0.99", error );
+			}
+		}
+		else if ( key == "pointcloud" )
+		{
+			read.pointCloudPlayer = 0;
+			read.pointCloudVoxelSize = 0.0f;
+			if ( !( line >> read.pointCloudFile ) )
+			{
+				return Fail( lineNumber, "expected pointcloud <file> [player] [voxel size]", error );
+			}
+			if ( !AtEnd( line ) && ( !( line >> read.pointCloudPlayer ) || read.pointCloudPlayer < -1 || read.pointCloudPlayer > 6 ) )
+			{
+				return Fail( lineNumber, "point cloud player must be -1 (every pixel), 0 (every player) or from 1 to 6", error );
+			}
+			if ( !AtEnd( line ) && ( !( line >> read.pointCloudVoxelSize ) || !AtEnd( line ) ) )
+			{
+				return Fail( lineNumber, "expected pointcloud <file> [player] [voxel size]", error );
+			}
+			if ( !InRange( read.pointCloudVoxelSize, 0.0f, 100.0f ) )
+			{
+				return Fail( lineNumber, "voxel size must be from 0 to 100 inches", error );
+			}
+		}
+		else if ( key == "sensor" )
+		{
+			int index;
+			if ( !( line >> index ) || index < 1 || index >= SETTINGS_MAX_SENSORS )
+			{
+				return Fail( lineNumber, "expected sensor <index> with an index from 1 to 3", error );
+			}
+
+			float * pPosition = read.sensorPosition[index];
+			if ( !( line >> pPosition[0] >> pPosition[1] >> pPosition[2] >> read.sensorAngle[index] ) || !AtEnd( line ) )
+			{
+				return Fail( lineNumber, "expected sensor <index> <x> <y> <z> <angle>", error );
+			}
+			if ( !InRange( pPosition[0], -maxPosition, maxPosition ) || !InRange( pPosition[1], -maxPosition, maxPosition ) ||
+				 !InRange( pPosition[2], -maxPosition, maxPosition ) )
+			{
+				return Fail( lineNumber, "position out of range", error );
+			}
+			if ( read.sensorAngle[index] < -SETTINGS_MAX_ANGLE || read.sensorAngle[index] > SETTINGS_MAX_ANGLE )
+			{
+				return Fail( lineNumber, "angle must be from -27 to 27 degrees", error );
+			}
+		}
+		else
+		{
+			return Fail( lineNumber, "unknown keyword", error );
+		}
+	}
+
+	*this = read;
+	error = "";
+	return true;
+}
+
+/// <summary>
+/// Write the settings in the format Read takes. Floats get the nine digits that read back
+/// to the same value, so a saved file loads as the settings it was saved from
+/// </summary>
+/// <param name="out">receives the file contents</param>
+void TrackerSettings::Write( std::ostream & out ) const
+{
+	std::streamsize precision = out.precision( 9 );
+
+	out << listenPort << std::endl;
+	out << trackingMode << " " << trackedSkeletons << " " << range << std::endl;
+	out << sensorPosition[0][0] << " " << sensorPosition[0][1] << " " << sensorPosition[0][2] << " " << sensorAngle[0] << std::endl;
+	out << smoothing << " " << correction << " " << prediction << " " << jitterRadius << " " << maxDeviationRadius << std::endl;
+	for ( int i = 0; i < SETTINGS_MAX_DESTINATIONS; i++ )
+	{
+		out << ipAddress[i] << " " << port[i] << std::endl;
+	}
+	for ( int i = 1; i < SETTINGS_MAX_SENSORS; i++ )
+	{
+		out << "sensor " << i << " " << sensorPosition[i][0] << " " << sensorPosition[i][1] << " " <<
+			sensorPosition[i][2] << " " << sensorAngle[i] << std::endl;
+	}
+	if ( !multicastGroup.empty() )
+	{
+		out << "multicast " << multicastGroup << " " << multicastPort << " " << multicastTtl;
+		if ( !multicastInterface.empty() )
+		{
+			out << " " << multicastInterface;
+		}
+		out << std::endl;
+	}
+	if ( metricsPort > 0 && echoPort > 0 )
+	{
+		out << "metrics " << metricsPort << " " << echoPort << std::endl;
+	}
+	else if ( metricsPort > 0 )
+	{
+		out << "metrics " << metricsPort << std::endl;
+	}
+	if ( traceEnabled )
+	{
+		out << "trace " << traceThreshold << std::endl;
+	}
+	if ( eyes.ipd != EYE_DEFAULT_IPD || eyes.height != EYE_DEFAULT_HEIGHT || eyes.forward != EYE_DEFAULT_FORWARD ||
+		 eyes.smoothing != EYE_DEFAULT_SMOOTHING )
+	{
+		out << "eyes " << eyes.ipd << " " << eyes.height << " " << eyes.forward << " " << eyes.smoothing << std::endl;
+	}
+	if ( !pointCloudFile.empty() )
+	{
+		out << "pointcloud " << pointCloudFile << " " << pointCloudPlayer << " " << pointCloudVoxelSize << std::endl;
+	}
+
+	out.precision( precision );
+}
+
+/// <summary>
+/// Find the groups of settings that differ
+/// </summary>
+/// <param name="other">settings to compare with</param>
+/// <returns>SETTINGS_CHANGED_* flags of every group that differs, 0 if none does</returns>
+unsigned int TrackerSettings::Compare( const TrackerSettings & other ) const
+{
+	unsigned int changed = 0;
+
+	if ( listenPort != other.listenPort )
+	{
+		changed |= SETTINGS_CHANGED_LISTEN;
+	}
+
+	if ( trackingMode != other.trackingMode )
+	{
+		changed |= SETTINGS_CHANGED_TRACKING_MODE;
+	}
+
+	if ( trackedSkeletons != other.trackedSkeletons )
+	{
+		changed |= SETTINGS_CHANGED_SKELETONS;
+	}
+
+	if ( range != other.range )
+	{
+		changed |= SETTINGS_CHANGED_RANGE;
+	}
+
+	if ( sensorAngle[0] != other.sensorAngle[0] )
+	{
+		changed |= SETTINGS_CHANGED_ANGLE;
+	}
+
+	for ( int i = 0; i < SETTINGS_MAX_SENSORS; i++ )
+	{
+		if ( sensorAngle[i] != other.sensorAngle[i] || sensorPosition[i][0] != other.sensorPosition[i][0] ||
+			 sensorPosition[i][1] != other.sensorPosition[i][1] || sensorPosition[i][2] != other.sensorPosition[i][2] )
+		{
+			changed |= SETTINGS_CHANGED_POSE;
+		}
+	}
+
+	if ( smoothing != other.smoothing || correction != other.correction || prediction != other.prediction ||
+		 jitterRadius != other.jitterRadius || maxDeviationRadius != other.maxDeviationRadius )
+	{
+		changed |= SETTINGS_CHANGED_SMOOTHING;
+	}
+
+	for ( int i = 0; i < SETTINGS_MAX_DESTINATIONS; i++ )
+	{
+		if ( ipAddress[i] != other.ipAddress[i] || port[i] != other.port[i] )
+		{
+			changed |= SETTINGS_CHANGED_DESTINATIONS;
+		}
+	}
+
+	if ( multicastGroup != other.multicastGroup || multicastPort != other.multicastPort ||
+		 multicastTtl != other.multicastTtl || multicastInterface != other.multicastInterface )
+	{
+		changed |= SETTINGS_CHANGED_MULTICAST;
+	}
+
+	if ( metricsPort != other.metricsPort || echoPort != other.echoPort )
+	{
+		changed |= SETTINGS_CHANGED_METRICS;
+	}
+
+	if ( traceEnabled != other.traceEnabled || traceThreshold != other.traceThreshold )
+	{
+		changed |= SETTINGS_CHANGED_TRACE;
+	}
+
+	if ( eyes.ipd != other.eyes.ipd || eyes.height != other.eyes.height || eyes.forward != other.eyes.forward ||
+		 eyes.smoothing != other.eyes.smoothing )
+	{
+		changed |= SETTINGS_CHANGED_EYES;
+	}
+
+	if ( pointCloudFile != other.pointCloudFile || pointCloudPlayer != other.pointCloudPlayer ||
+		 pointCloudVoxelSize != other.pointCloudVoxelSize )
+	{
+		changed |= SETTINGS_CHANGED_POINT_CLOUD;
+	}
+
+	return changed;
+}
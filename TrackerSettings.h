@@ -0,0 +1,117 @@
+//------------------------------------------------------------------------------
+// <copyright file="TrackerSettings.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares the contents of kinectInfo.cfg: reading it with every value checked, writing it,
+// and comparing two versions so only what changed is reconfigured. Like the merge stage it
+// only depends on the standard library.
+//
+// The file starts with fixed lines, in this order:
+//	<listen port>
+//	<tracking mode> <tracked skeletons> <range>
+//	<x> <y> <z> <angle>
+//	<smoothing> <correction> <prediction> <jitter radius> <max deviation radius>
+//	<ip> <port>                             one line per destination, blank for none
+// followed by optional keyword lines in any order, see the README.
+
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include "EyeEstimator.h"
+
+// Destination lines in the file, MAX_IPS
+#define SETTINGS_MAX_DESTINATIONS       6
+
+// Sensors the file places, sensor 0 is the one on the fixed lines
+#define SETTINGS_MAX_SENSORS            4
+
+// Elevation range of the Kinect motor, degrees
+#define SETTINGS_MAX_ANGLE              27
+
+// Groups of settings reconfigured together, what Compare returns
+#define SETTINGS_CHANGED_LISTEN         0x0001  // listen port
+#define SETTINGS_CHANGED_TRACKING_MODE  0x0002  // default or seated
+#define SETTINGS_CHANGED_SKELETONS      0x0004  // how the tracked skeletons are chosen
+#define SETTINGS_CHANGED_RANGE          0x0008  // default or near
+#define SETTINGS_CHANGED_ANGLE          0x0010  // elevation of the primary sensor, moves the motor
+#define SETTINGS_CHANGED_POSE           0x0020  // position and angle of any sensor
+#define SETTINGS_CHANGED_SMOOTHING      0x0040  // skeleton smoothing parameters
+#define SETTINGS_CHANGED_DESTINATIONS   0x0080  // ip/port lines
+#define SETTINGS_CHANGED_MULTICAST      0x0100  // multicast line
+#define SETTINGS_CHANGED_METRICS        0x0200  // metrics line
+#define SETTINGS_CHANGED_TRACE          0x0400  // trace line
+#define SETTINGS_CHANGED_EYES           0x0800  // eyes line
+#define SETTINGS_CHANGED_POINT_CLOUD    0x1000  // pointcloud line
+#define SETTINGS_CHANGED_ALL            0x1FFF
+
+struct TrackerSettings
+{
+	int             listenPort;
+	int             trackingMode;
+	int             trackedSkeletons;
+	int             range;
+
+	// Sensor poses in inches and degrees, entry 0 is the primary sensor
+	float           sensorPosition[SETTINGS_MAX_SENSORS][3];
+	int             sensorAngle[SETTINGS_MAX_SENSORS];
+
+	// NUI_TRANSFORM_SMOOTH_PARAMETERS
+	float           smoothing;
+	float           correction;
+	float           prediction;
+	float           jitterRadius;
+	float           maxDeviationRadius;
+
+	// Destinations as typed, blank for none
+	std::string     ipAddress[SETTINGS_MAX_DESTINATIONS];
+	std::string     port[SETTINGS_MAX_DESTINATIONS];
+
+	// Multicast output, blank group for none
+	std::string     multicastGroup;
+	std::string     multicastPort;
+	int             multicastTtl;
+	std::string     multicastInterface;
+
+	int             metricsPort;            // 0 for none
+	int             echoPort;               // 0 for none
+	bool            traceEnabled;
+	int             traceThreshold;         // ms, 0 for never
+
+	EyeModel        eyes;
+
+	// Point clouds recorded to a file, blank for none
+	std::string     pointCloudFile;
+	int             pointCloudPlayer;       // -1 every pixel, 0 every player, 1 to 6 that player
+	float           pointCloudVoxelSize;    // inches, 0 keeps every point
+
+	/// <summary>
+	/// Constructor, the settings of a tracker without a file
+	/// </summary>
+	TrackerSettings();
+
+	/// <summary>
+	/// Read a whole file. Nothing is changed unless every line is valid
+	/// </summary>
+	/// <param name="in">file contents</param>
+	/// <param name="error">receives the line and the reason the file was rejected</param>
+	/// <returns>true if the file was valid and read, false otherwise</returns>
+	bool Read( std::istream & in, std::string & error );
+
+	/// <summary>
+	/// Write the settings in the format Read takes. Floats get the nine digits that read back
+	/// to the same value, so a saved file loads as the settings it was saved from
+	/// </summary>
+	/// <param name="out">receives the file contents</param>
+	void Write( std::ostream & out ) const;
+
+	/// <summary>
+	/// Find the groups of settings that differ
+	/// </summary>
+	/// <param name="other">settings to compare with</param>
+	/// <returns>SETTINGS_CHANGED_* flags of every group that differs, 0 if none does</returns>
+	unsigned int Compare( const TrackerSettings & other ) const;
+};
@@ -0,0 +1,93 @@
+//------------------------------------------------------------------------------
+// <copyright file="TripleBuffer.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Single producer, single consumer hand-off of the latest value. Neither side ever waits,
+// the producer overwrites values the consumer has not picked up yet.
+
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+template <class T>
+class TripleBuffer
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	TripleBuffer() : m_back(0), m_front(2), m_valid(false)
+	{
+		m_middle.store( 1 );
+	}
+
+	/// <summary>
+	/// Get the buffer the next value is written into. Producer only
+	/// </summary>
+	/// <returns>buffer owned by the producer until EndWrite, holds an older value</returns>
+	T * BeginWrite()
+	{
+		return &m_buffers[m_back];
+	}
+
+	/// <summary>
+	/// Publish the value written since BeginWrite. Producer only
+	/// </summary>
+	void EndWrite()
+	{
+		unsigned int previous = m_middle.exchange( m_back | DirtyFlag, std::memory_order_acq_rel );
+		m_back = previous & ~DirtyFlag;
+	}
+
+	/// <summary>
+	/// Get the buffer the consumer let go of when it picked up the latest value, so the
+	/// producer can release what it holds. Producer only
+	/// </summary>
+	/// <returns>buffer owned by the producer until the next EndWrite, NULL while the latest value waits to be picked up</returns>
+	T * Reclaim()
+	{
+		// the consumer only takes the middle buffer while it is dirty, and only the producer dirties it
+		unsigned int middle = m_middle.load( std::memory_order_acquire );
+		return ( middle & DirtyFlag ) ? NULL : &m_buffers[middle];
+	}
+
+	/// <summary>
+	/// Pick up the latest published value, if there is a new one. Consumer only
+	/// </summary>
+	/// <returns>true if Front changed</returns>
+	bool Update()
+	{
+		if ( 0 == ( m_middle.load( std::memory_order_acquire ) & DirtyFlag ) )
+		{
+			return false;
+		}
+
+		unsigned int previous = m_middle.exchange( m_front, std::memory_order_acq_rel );
+		m_front = previous & ~DirtyFlag;
+		m_valid = true;
+		return true;
+	}
+
+	/// <summary>
+	/// Value picked up by the last Update. Consumer only
+	/// </summary>
+	/// <returns>latest value, NULL until the first value was picked up</returns>
+	const T * Front() const
+	{
+		return m_valid ? &m_buffers[m_front] : NULL;
+	}
+
+private:
+	// flag in m_middle marking a buffer the consumer has not seen yet
+	static const unsigned int DirtyFlag = 4;
+
+	// the producer owns back, the consumer owns front, and the two trade buffers through middle
+	T                          m_buffers[3];
+	std::atomic<unsigned int>  m_middle;
+	unsigned int               m_back;
+	unsigned int               m_front;
+	bool                       m_valid;
+};
@@ -0,0 +1,379 @@
+//------------------------------------------------------------------------------
+// <copyright file="AllocationGuardTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Replays frames through the frame path modules that build on Linux, inside an
+// AllocationGuard like the sensor and merge threads, with AllocationGuard.cpp built as in a
+// Debug build and platform/DebugHeap.cpp standing in for the CRT debug heap. A frame goes
+// the way NuiImpl.cpp and DrawDevice.cpp take it: SkeletonBatch::Load, the submit to the
+// merger, the merge and fusion, the eyes and bones, the encoder of every stream and
+// DestinationTable::Send to a configured destination and a compact subscriber on loopback,
+// whose datagrams a PoseReceiver decodes. An allocation the guard counts after the warm-up
+// aborts the test on the spot, so the stack shows where it came from. A forked child makes
+// sure such an allocation really does abort.
+
+#include "AllocationGuard.h"
+#include "BoneOrientations.h"
+#include "DestinationTable.h"
+#include "EyeEstimator.h"
+#include "FrameAccounting.h"
+#include "FramePool.h"
+#include "LatencyHistogram.h"
+#include "PoseReceiver.h"
+#include "PoseStreamEncoders.h"
+#include "SensorCalibration.h"
+#include "SensorClock.h"
+#include "SensorRecovery.h"
+#include "SkeletonBatch.h"
+#include "SkeletonFusion.h"
+#include "TestCheck.h"
+#include <crtdbg.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <vector>
+
+#ifndef _DEBUG
+#error AllocationGuard only checks anything in Debug builds, build the test with _DEBUG
+#endif
+
+// Frames replayed after the warm-up
+static const int g_SteadyFrames = 3000;
+
+/// <summary>
+/// Hook behind the guard's, it only sees an allocation after the guard counted it
+/// </summary>
+static int HardFailHook( int allocType, void *, size_t size, int, long request, const unsigned char *, int )
+{
+	if ( _HOOK_FREE != allocType && AllocationGuard::GetViolations() > 0 )
+	{
+		char message[128];
+		int length = snprintf( message, sizeof(message), "frame path allocated %zu bytes after the warm-up, allocation %ld\n", size, request );
+		if ( write( STDERR_FILENO, message, length ) < 0 )
+		{
+			_exit( 1 );
+		}
+		abort();
+	}
+	return 1;
+}
+
+/// <summary>
+/// A sensor that is always there
+/// </summary>
+class TestLink : public SensorLink
+{
+public:
+	bool Attach() { return true; }
+	void Detach() {}
+};
+
+/// <summary>
+/// Everything one frame of the pipeline goes through, set up before the first frame
+/// </summary>
+struct TestPipeline
+{
+	TestPipeline() : recovery( &link ), configuredSocket( INVALID_SOCKET ), subscriberSocket( INVALID_SOCKET )
+	{
+		depthFrames.Initialize( 320 * 240 * 4, 8 );
+		recovery.OnAttached( 0 );
+		float position[3] = { 0.0f, 40.0f, -10.0f };
+		calibration.Set( position, 5.0f );
+		memset( streamValues, 0, sizeof(streamValues) );
+
+		// the configured destination gets the eyes as plain floats, the subscriber every stream compact
+		sockaddr_in address;
+		if ( Bind( configuredSocket, address ) )
+		{
+			std::string ipAddress[1] = { "127.0.0.1" };
+			std::string port[1];
+			char text[16];
+			snprintf( text, sizeof(text), "%u", ntohs( address.sin_port ) );
+			port[0] = text;
+			destinations.SetConfigured( ipAddress, port, 1 );
+		}
+		if ( Bind( subscriberSocket, address ) )
+		{
+			destinations.Subscribe( 1, (const sockaddr *)&address, sizeof(address), SUBSCRIBER_STREAM_ALL, 0, true );
+		}
+	}
+
+	~TestPipeline()
+	{
+		closesocket( configuredSocket );
+		closesocket( subscriberSocket );
+	}
+
+	/// <summary>
+	/// Open a non-blocking receiver on a loopback port the system picks
+	/// </summary>
+	/// <param name="s">receives the socket</param>
+	/// <param name="address">receives its address</param>
+	/// <returns>true if successful</returns>
+	static bool Bind( SOCKET & s, sockaddr_in & address )
+	{
+		s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+		if ( INVALID_SOCKET == s )
+		{
+			return false;
+		}
+
+		memset( &address, 0, sizeof(address) );
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+		socklen_t length = sizeof(address);
+		u_long nonBlocking = 1;
+		return SOCKET_ERROR != bind( s, (const sockaddr *)&address, sizeof(address) ) &&
+			   SOCKET_ERROR != getsockname( s, (sockaddr *)&address, &length ) &&
+			   SOCKET_ERROR != ioctlsocket( s, FIONBIO, &nonBlocking );
+	}
+
+	TestLink            link;
+	SensorRecovery      recovery;
+	SensorClock         clock;
+	FrameAccounting     accounting;
+	LatencyHistogram    latency;
+	FramePool           depthFrames;
+	NUI_SKELETON_FRAME  skeletonFrame;     // what the SDK hands the sensor thread
+	SkeletonBatch       batch;
+	SensorCalibration   calibration;
+	SkeletonMerger      merger;
+	SkeletonFusion      fusion;
+	MergedSkeletonFrame merged;
+	EyeEstimator        eyes;
+	EyeModel            eyeModel;
+	BoneOrientations    bones;
+	float               streamValues[SUBSCRIBER_STREAM_COUNT][SUBSCRIBER_STREAM_MAX_VALUES];
+	DestinationTable    destinations;
+	SOCKET              configuredSocket;
+	SOCKET              subscriberSocket;
+	PoseReceiver        receiver;
+	std::vector<FrameHandle> preview;   // frames the preview holds, never more than its capacity
+};
+
+/// <summary>
+/// One frame: the sensor thread's depth and skeleton work, then the merge, the eyes and bones,
+/// every stream sent and what the subscriber gets of it
+/// </summary>
+/// <param name="pipeline">state of every stage</param>
+/// <param name="frame">frame number, 30 per second</param>
+static void ProcessFrame( TestPipeline & pipeline, unsigned int frame )
+{
+	long long now = 1000 + frame * 33;
+	unsigned int skipped;
+	pipeline.accounting.OnFrame( FRAME_STREAM_DEPTH, frame, skipped );
+	pipeline.accounting.OnFrame( FRAME_STREAM_SKELETON, frame, skipped );
+	long long captureTime = pipeline.clock.Update( now - 5, now * 1000 );
+	pipeline.recovery.OnFrame( now );
+	pipeline.recovery.Poll( now );
+
+	// the depth frame goes to the preview, which lets go of the oldest one
+	FrameHandle depth( pipeline.depthFrames.Acquire() );
+	if ( depth.IsValid() )
+	{
+		depth->frameNumber = frame;
+		depth->captureTime = captureTime;
+		memset( depth->GetData(), frame & 0xFF, 320 * 240 * 4 );
+		pipeline.preview[frame % pipeline.preview.size()] = depth;
+	}
+
+	// the SDK's frame: one person walking across, every joint tracked
+	NUI_SKELETON_FRAME & skeletonFrame = pipeline.skeletonFrame;
+	memset( &skeletonFrame, 0, sizeof(skeletonFrame) );
+	skeletonFrame.dwFrameNumber = frame;
+	skeletonFrame.liTimeStamp.QuadPart = now - 5;
+	NUI_SKELETON_DATA & person = skeletonFrame.SkeletonData[1];
+	person.eTrackingState = NUI_SKELETON_TRACKED;
+	person.dwTrackingID = 1;
+	for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+	{
+		Vector4 & joint = person.SkeletonPositions[j];
+		joint.x = -1.0f + ( frame % 200 ) * 0.01f + ( j % 3 ) * 0.1f;
+		joint.y = 0.8f - 0.08f * j;
+		joint.z = 2.5f + 0.01f * j;
+		joint.w = 1.0f;
+		person.eSkeletonPositionTrackingState[j] = NUI_SKELETON_POSITION_TRACKED;
+	}
+	person.Position = person.SkeletonPositions[NUI_SKELETON_POSITION_HIP_CENTER];
+
+	// the sensor thread, as NuiImpl.cpp submits it
+	SkeletonBatch & batch = pipeline.batch;
+	batch.Load( skeletonFrame );
+	const SensorCalibration & calibration = pipeline.calibration;
+	SensorSkeletonFrame * pSkeletons = pipeline.merger.BeginSubmit( 0 );
+	pSkeletons->sensorIndex = 0;
+	pSkeletons->frameNumber = batch.frameNumber;
+	pSkeletons->submitCount = frame + 1;
+	pSkeletons->timestamp = batch.timestamp;
+	pSkeletons->arrivalTime = now;
+	pSkeletons->sensorPosition[0] = calibration.m_position[0];
+	pSkeletons->sensorPosition[1] = calibration.m_position[1];
+	pSkeletons->sensorPosition[2] = calibration.m_position[2];
+	pSkeletons->skeletonCount = 0;
+	for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+	{
+		if ( NUI_SKELETON_NOT_TRACKED == batch.trackingState[i] )
+		{
+			continue;
+		}
+
+		SensorSkeleton & out = pSkeletons->skeletons[pSkeletons->skeletonCount++];
+		out.trackingId = batch.trackingId[i];
+		out.trackingState = batch.trackingState[i];
+		calibration.Transform( batch.position[i], out.position );
+		calibration.TransformBatch( batch.GetX( i ), batch.GetY( i ), batch.GetZ( i ), out.jointX, out.jointY, out.jointZ, MERGE_JOINT_COUNT );
+		for ( int j = 0; j < MERGE_JOINT_COUNT; j++ )
+		{
+			out.jointState[j] = batch.GetJointState( i, j );
+		}
+	}
+	pipeline.merger.EndSubmit( 0 );
+
+	pipeline.merger.Merge( pipeline.merged, now, 200 );
+	const FusedSkeletonFrame & fused = pipeline.fusion.Fuse( pipeline.merged, now );
+
+	// the skeleton frame path, as DrawDevice.cpp takes it
+	float jointX[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	float jointY[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	float jointZ[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	EyeJoints eyeJoints;
+	BoneJoints boneJoints;
+	memset( &eyeJoints, 0, sizeof(eyeJoints) );
+	memset( &boneJoints, 0, sizeof(boneJoints) );
+	int activeUser = -1;
+	for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+	{
+		if ( NUI_SKELETON_TRACKED != batch.trackingState[i] )
+		{
+			continue;
+		}
+
+		activeUser = i;
+		const FusedSkeleton * pFused = fused.Find( 0, batch.trackingId[i] );
+		if ( pFused && ( pFused->sensorMask & ~1u ) )
+		{
+			memcpy( jointX[i], pFused->jointX, sizeof(jointX[i]) );
+			memcpy( jointY[i], pFused->jointY, sizeof(jointY[i]) );
+			memcpy( jointZ[i], pFused->jointZ, sizeof(jointZ[i]) );
+		}
+		else
+		{
+			calibration.TransformBatch( batch.GetX( i ), batch.GetY( i ), batch.GetZ( i ), jointX[i], jointY[i], jointZ[i], NUI_SKELETON_POSITION_COUNT );
+		}
+
+		eyeJoints.trackingId[i] = batch.trackingId[i];
+		const float * rows[3] = { jointX[i], jointY[i], jointZ[i] };
+		for ( int c = 0; c < 3; c++ )
+		{
+			eyeJoints.head[c][i] = rows[c][NUI_SKELETON_POSITION_HEAD];
+			eyeJoints.shoulderCenter[c][i] = rows[c][NUI_SKELETON_POSITION_SHOULDER_CENTER];
+			eyeJoints.shoulderLeft[c][i] = rows[c][NUI_SKELETON_POSITION_SHOULDER_LEFT];
+			eyeJoints.shoulderRight[c][i] = rows[c][NUI_SKELETON_POSITION_SHOULDER_RIGHT];
+		}
+
+		boneJoints.trackingId[i] = batch.trackingId[i];
+		boneJoints.trackedMask[i] = batch.trackedMask[i];
+		for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+		{
+			boneJoints.x[j][i] = jointX[i][j];
+			boneJoints.y[j][i] = jointY[i][j];
+			boneJoints.z[j][i] = jointZ[i][j];
+		}
+	}
+	pipeline.eyes.Estimate( eyeJoints, pipeline.eyeModel );
+	pipeline.bones.Compute( boneJoints );
+
+	unsigned int streamMask = pipeline.destinations.GetStreamMask();
+	if ( activeUser >= 0 )
+	{
+		float eyes[SUBSCRIBER_STREAM_EYES_VALUES];
+		float bones[SUBSCRIBER_STREAM_BONES_VALUES];
+		pipeline.eyes.GetEyes( activeUser, eyes );
+		pipeline.bones.GetHierarchical( activeUser, bones );
+
+		PoseStreamInput input;
+		input.pX = jointX[activeUser];
+		input.pY = jointY[activeUser];
+		input.pZ = jointZ[activeUser];
+		input.pEyes = eyes;
+		input.pBones = bones;
+		for ( unsigned int stream = 0; stream < SUBSCRIBER_STREAM_COUNT; stream++ )
+		{
+			if ( streamMask & SUBSCRIBER_STREAM_BIT(stream) )
+			{
+				PoseStreamGetEncoder( stream )( input, pipeline.streamValues[stream] );
+			}
+		}
+	}
+
+	StreamPacket packets[SUBSCRIBER_STREAM_COUNT];
+	for ( unsigned int stream = 0; stream < SUBSCRIBER_STREAM_COUNT; stream++ )
+	{
+		packets[stream].pData = pipeline.streamValues[stream];
+		packets[stream].size = sizeof(float) * PoseStreamValueCount( stream );
+	}
+	pipeline.destinations.Send( packets, captureTime, now * 1000 );
+
+	// what the receivers got, the subscriber's eyes go through the PoseReceiver
+	unsigned char datagram[2048];
+	while ( recv( pipeline.configuredSocket, (char *)datagram, sizeof(datagram), 0 ) > 0 )
+	{
+	}
+	int size;
+	while ( ( size = recv( pipeline.subscriberSocket, (char *)datagram, sizeof(datagram), 0 ) ) > 0 )
+	{
+		pipeline.receiver.Receive( datagram, size, static_cast<double>( now + 2 ) );
+	}
+	float values[SUBSCRIBER_STREAM_EYES_VALUES];
+	pipeline.receiver.GetPose( static_cast<double>( now - 30 ), values );
+
+	pipeline.latency.Record( 1000000 + ( frame % 97 ) * 10000 );
+}
+
+int main( )
+{
+	_CrtSetAllocHook( HardFailHook );
+	AllocationGuard::Install();
+
+	TestPipeline * pPipeline = new TestPipeline();
+	pPipeline->preview.resize( 3 );
+
+	// the first frames may set up what is lazy on purpose
+	unsigned int frame = 0;
+	for ( ; frame < ALLOCATION_GUARD_WARMUP + g_SteadyFrames; frame++ )
+	{
+		AllocationGuard guard;
+		ProcessFrame( *pPipeline, frame );
+	}
+	TEST_CHECK( 0 == AllocationGuard::GetViolations() );
+
+	// the frames really went out, the send path was not skipped for want of a receiver
+	TEST_CHECK( INVALID_SOCKET != pPipeline->subscriberSocket );
+	TEST_CHECK( pPipeline->receiver.GetStats().received > g_SteadyFrames / 2 );
+
+	// exempt setup, and allocations outside of a frame, are fine after the warm-up
+	{
+		AllocationGuard guard;
+		AllocationExemption exemption;
+		delete new std::vector<int>( 100 );
+	}
+	delete new std::vector<int>( 100 );
+	TEST_CHECK( 0 == AllocationGuard::GetViolations() );
+
+	// and one in a frame is not
+	fflush( stdout );
+	pid_t child = fork();
+	if ( 0 == child )
+	{
+		AllocationGuard guard;
+		std::vector<int> values( 10 );
+		_exit( 0 );
+	}
+	int status = 0;
+	TEST_CHECK( child == waitpid( child, &status, 0 ) );
+	TEST_CHECK( WIFSIGNALED( status ) && SIGABRT == WTERMSIG( status ) );
+
+	delete pPipeline;
+	return TestResult();
+}
@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------------
+// <copyright file="DestinationTableBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Cost per frame of DestinationTable::Send against the number of subscribers on loopback,
+// next to the bare sendto calls it makes, and with every destination held back by its rate
+// limit, which leaves only the walk over the table. What a destination costs on top of its
+// sends must not grow with their number.
+
+#include "stdafx.h"
+#include "DestinationTable.h"
+#include "TestCheck.h"
+
+// Subscriber counts measured, up to a venue full of receivers
+static const int g_Subscribers[] = { 1, 4, 16, 64, 256 };
+
+/// <summary>
+/// Receivers bound on loopback, never read: a full receive buffer drops the datagram after
+/// sendto has done all of its work, as a slow receiver on the network would
+/// </summary>
+class BenchReceivers
+{
+public:
+	BenchReceivers() {}
+
+	~BenchReceivers()
+	{
+		for ( size_t i = 0; i < m_sockets.size(); i++ )
+		{
+			closesocket( m_sockets[i] );
+		}
+	}
+
+	/// <summary>
+	/// Bind one more receiver on a port the system picks
+	/// </summary>
+	/// <param name="address">receives its address</param>
+	/// <returns>true if successful</returns>
+	bool Add( sockaddr_in & address )
+	{
+		SOCKET s = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+		if ( INVALID_SOCKET == s )
+		{
+			return false;
+		}
+		m_sockets.push_back( s );
+
+		ZeroMemory( &address, sizeof(address) );
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+		socklen_t length = sizeof(address);
+		return SOCKET_ERROR != bind( s, (const sockaddr *)&address, sizeof(address) ) &&
+			   SOCKET_ERROR != getsockname( s, (sockaddr *)&address, &length );
+	}
+
+private:
+	std::vector<SOCKET> m_sockets;
+};
+
+/// <summary>
+/// ns per frame of Send to every destination in the table
+/// </summary>
+static double BenchSend( DestinationTable & table, const StreamPacket packets[SUBSCRIBER_STREAM_COUNT], int frames )
+{
+	double start = TestNow();
+	for ( int frame = 0; frame < frames; frame++ )
+	{
+		long long now = static_cast<long long>( TestNow() / 1000.0 );
+		table.Send( packets, now - 20000, now );
+	}
+	return ( TestNow() - start ) / frames;
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int frames = quick ? 20 : 2000;
+
+	float eyes[SUBSCRIBER_STREAM_EYES_VALUES] = { -2.5f, 30.0f, 80.0f, 2.5f, 30.0f, 80.0f };
+	StreamPacket packets[SUBSCRIBER_STREAM_COUNT];
+	ZeroMemory( packets, sizeof(packets) );
+	packets[SUBSCRIBER_STREAM_EYES].pData = eyes;
+	packets[SUBSCRIBER_STREAM_EYES].size = sizeof(eyes);
+
+	SOCKET raw = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+	if ( INVALID_SOCKET == raw )
+	{
+		printf( "no UDP socket here\n" );
+		return TEST_SKIPPED;
+	}
+
+	printf( "ns per frame of the eyes stream to every subscriber on loopback, and per subscriber:\n" );
+	printf( "%11s %12s %10s %10s %10s %12s\n", "subscribers", "Send", "each", "sendto", "overhead", "rate limited" );
+	for ( size_t c = 0; c < sizeof(g_Subscribers) / sizeof(g_Subscribers[0]); c++ )
+	{
+		int count = g_Subscribers[c];
+		BenchReceivers receivers;
+		std::vector<sockaddr_in> addresses( count );
+		DestinationTable table;
+		bool bound = true;
+		for ( int i = 0; i < count; i++ )
+		{
+			bound = bound && receivers.Add( addresses[i] );
+			table.Subscribe( 1, (const sockaddr *)&addresses[i], sizeof(addresses[i]), SUBSCRIBER_STREAM_BIT(SUBSCRIBER_STREAM_EYES), 0, false );
+		}
+		TEST_CHECK( bound );
+
+		// the first frame creates the send socket
+		BenchSend( table, packets, 1 );
+		double send = BenchSend( table, packets, frames );
+
+		// the same datagrams without the table
+		double start = TestNow();
+		for ( int frame = 0; frame < frames; frame++ )
+		{
+			for ( int i = 0; i < count; i++ )
+			{
+				sendto( raw, (const char *)eyes, sizeof(eyes), 0, (const sockaddr *)&addresses[i], sizeof(addresses[i]) );
+			}
+		}
+		double bare = ( TestNow() - start ) / frames;
+
+		std::vector<DestinationStatus> status;
+		table.GetStatus( status );
+		unsigned long long errors = 0;
+		unsigned long long sent = 0;
+		for ( size_t i = 0; i < status.size(); i++ )
+		{
+			errors += status[i].errors;
+			sent += status[i].packets;
+		}
+		TEST_CHECK( count == static_cast<int>(status.size()) );
+		TEST_CHECK( 0 == errors );
+		TEST_CHECK( static_cast<unsigned long long>(frames + 1) * count == sent );
+
+		// one packet a second for everyone, the first frame sends and the others are skipped
+		for ( int i = 0; i < count; i++ )
+		{
+			table.Subscribe( 1, (const sockaddr *)&addresses[i], sizeof(addresses[i]), SUBSCRIBER_STREAM_BIT(SUBSCRIBER_STREAM_EYES), 1, false );
+		}
+		BenchSend( table, packets, 1 );
+		double limited = BenchSend( table, packets, frames );
+
+		printf( "%11d %12.0f %10.0f %10.0f %10.0f %12.1f\n", count, send, send / count, bare / count,
+				( send - bare ) / count, limited / count );
+	}
+
+	closesocket( raw );
+	return TestResult();
+}
@@ -0,0 +1,343 @@
+//------------------------------------------------------------------------------
+// <copyright file="EyeEstimatorTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// EyeEstimator against the formula it replaced, the head joint plus or minus 1.25 inch
+// turned by the atan of the head to shoulder-center line, over the roll a head has; and on
+// what that formula could not do: joints on top of each other, a body turned to the side,
+// filtering from one frame to the next and a lane taken over by someone else.
+
+#include "EyeEstimator.h"
+#include "TestCheck.h"
+#include <math.h>
+
+static const float g_Pi = 3.14159265f;
+
+// Head roll the old formula was compared over, degrees either way
+static const int g_MaxRoll = 35;
+
+// Inches from the shoulder center to the head, and between the shoulders
+static const float g_Neck = 10.0f;
+static const float g_Shoulders = 14.0f;
+
+/// <summary>
+/// The eyes the way the pose streams placed them before EyeEstimator
+/// </summary>
+/// <param name="pOut">receives x, y and z of the left eye, then of the right eye</param>
+static void OldEyes( float head_x, float head_y, float head_z, float should_x, float should_y, float * pOut )
+{
+	float headTilt = fabs(atan((should_x - head_x)/(should_y - head_y)));
+
+	pOut[0] = head_x;
+	pOut[1] = head_y;
+	pOut[2] = head_z;
+	pOut[3] = head_x;
+	pOut[4] = head_y;
+	pOut[5] = head_z;
+
+	if (head_x < should_x) {
+		pOut[0] -= cos(headTilt)*1.25f;
+		pOut[1] -= sin(headTilt)*1.25f;
+		pOut[3] += cos(headTilt)*1.25f;
+		pOut[4] += sin(headTilt)*1.25f;
+	}
+	else {
+		pOut[3] += cos(headTilt)*1.25f;
+		pOut[4] -= sin(headTilt)*1.25f;
+		pOut[0] -= cos(headTilt)*1.25f;
+		pOut[1] += sin(headTilt)*1.25f;
+	}
+}
+
+/// <summary>
+/// Put a user in a lane: the shoulder center at a place, the body turned by yaw about the
+/// vertical and the upper body rolled by roll toward the user's left, degrees
+/// </summary>
+static void Pose( EyeJoints & joints, int lane, unsigned int trackingId, const float * pCenter, float roll, float yaw )
+{
+	float r = roll * g_Pi / 180.0f;
+	float y = yaw * g_Pi / 180.0f;
+
+	// up and right of the rolled body, then turned about the vertical
+	float up[3] = { -sinf( r ) * cosf( y ), cosf( r ), sinf( r ) * sinf( y ) };
+	float right[3] = { cosf( r ) * cosf( y ), sinf( r ), -cosf( r ) * sinf( y ) };
+
+	joints.trackingId[lane] = trackingId;
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		joints.shoulderCenter[axis][lane] = pCenter[axis];
+		joints.head[axis][lane] = pCenter[axis] + g_Neck * up[axis];
+		joints.shoulderLeft[axis][lane] = pCenter[axis] - 0.5f * g_Shoulders * right[axis];
+		joints.shoulderRight[axis][lane] = pCenter[axis] + 0.5f * g_Shoulders * right[axis];
+	}
+}
+
+/// <summary>
+/// Every lane empty, at the origin
+/// </summary>
+static void Clear( EyeJoints & joints )
+{
+	const float origin[3] = { 0.0f, 0.0f, 0.0f };
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		Pose( joints, i, 0, origin, 0.0f, 0.0f );
+	}
+}
+
+/// <summary>
+/// Angle of a lane's orientation about the display's z axis, degrees
+/// </summary>
+static float RollOf( const EyeEstimator & estimator, int lane )
+{
+	float q[4];
+	estimator.GetOrientation( lane, q );
+	float roll = 2.0f * atan2f( q[2], q[3] ) * 180.0f / g_Pi;
+	return ( roll > 180.0f ) ? roll - 360.0f : ( roll <= -180.0f ) ? roll + 360.0f : roll;
+}
+
+/// <summary>
+/// With the default model the eyes are where the old formula put them, a lane a roll
+/// </summary>
+static void TestRoll( )
+{
+	EyeModel model;
+	EyeEstimator estimator;
+	EyeJoints joints;
+	const float center[3] = { -12.0f, 40.0f, 80.0f };
+
+	unsigned int trackingId = 1;
+	for ( int roll = -g_MaxRoll; roll <= g_MaxRoll; roll += EYE_MAX_USERS )
+	{
+		for ( int i = 0; i < EYE_MAX_USERS; i++ )
+		{
+			// a new person every time, so nothing is filtered
+			Pose( joints, i, trackingId++, center, static_cast<float>( roll + i ), 0.0f );
+		}
+		estimator.Estimate( joints, model );
+
+		for ( int i = 0; i < EYE_MAX_USERS; i++ )
+		{
+			float expected[6], eyes[6];
+			OldEyes( joints.head[0][i], joints.head[1][i], joints.head[2][i], joints.shoulderCenter[0][i], joints.shoulderCenter[1][i], expected );
+			estimator.GetEyes( i, eyes );
+			for ( int v = 0; v < 6; v++ )
+			{
+				TEST_CHECK_NEAR( eyes[v], expected[v], 1.0e-3f );
+			}
+			TEST_CHECK_NEAR( RollOf( estimator, i ), static_cast<float>( roll + i ), 0.01f );
+		}
+	}
+}
+
+/// <summary>
+/// Joints on top of each other give an upright frame facing the display, never a NaN
+/// </summary>
+static void TestCollapsed( )
+{
+	EyeModel model;
+	EyeEstimator estimator;
+	EyeJoints joints;
+	Clear( joints );
+
+	const float center[3] = { 5.0f, 30.0f, 70.0f };
+
+	// every joint in one place
+	Pose( joints, 0, 1, center, 0.0f, 0.0f );
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		joints.head[axis][0] = center[axis];
+		joints.shoulderLeft[axis][0] = center[axis];
+		joints.shoulderRight[axis][0] = center[axis];
+	}
+
+	// the head on the shoulder center, shoulders turned
+	Pose( joints, 1, 2, center, 0.0f, 30.0f );
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		joints.head[axis][1] = center[axis];
+	}
+
+	// the shoulders together, the neck rolled
+	Pose( joints, 2, 3, center, 20.0f, 0.0f );
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		joints.shoulderLeft[axis][2] = center[axis];
+		joints.shoulderRight[axis][2] = center[axis];
+	}
+
+	// the shoulders along the neck
+	Pose( joints, 3, 4, center, 0.0f, 0.0f );
+	for ( int axis = 0; axis < 3; axis++ )
+	{
+		joints.shoulderLeft[axis][3] = joints.shoulderCenter[axis][3];
+		joints.shoulderRight[axis][3] = joints.head[axis][3];
+	}
+
+	estimator.Estimate( joints, model );
+
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		float eyes[6], q[4];
+		estimator.GetEyes( i, eyes );
+		estimator.GetOrientation( i, q );
+		for ( int v = 0; v < 6; v++ )
+		{
+			TEST_CHECK( eyes[v] == eyes[v] && fabsf( eyes[v] ) < 1000.0f );
+		}
+		TEST_CHECK_NEAR( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3], 1.0f, 1.0e-5f );
+	}
+
+	// upright, facing the display: the eyes level either side of the head
+	float eyes[6];
+	estimator.GetEyes( 0, eyes );
+	TEST_CHECK_NEAR( eyes[0], center[0] - 1.25f, 1.0e-4f );
+	TEST_CHECK_NEAR( eyes[3], center[0] + 1.25f, 1.0e-4f );
+	TEST_CHECK_NEAR( eyes[1], center[1], 1.0e-4f );
+	TEST_CHECK_NEAR( eyes[4], center[1], 1.0e-4f );
+	TEST_CHECK_NEAR( eyes[2], center[2], 1.0e-4f );
+
+	// with the shoulders gone the roll still comes from the neck
+	TEST_CHECK_NEAR( RollOf( estimator, 2 ), 20.0f, 0.01f );
+	TEST_CHECK_NEAR( RollOf( estimator, 3 ), 0.0f, 0.01f );
+}
+
+/// <summary>
+/// A body turned to the side turns the eyes with it, which the old formula never did, and
+/// the forward offset goes the way the user faces
+/// </summary>
+static void TestYaw( )
+{
+	EyeModel model;
+	model.forward = 3.0f;
+	model.height = 2.0f;
+	EyeEstimator estimator;
+	EyeJoints joints;
+	Clear( joints );
+
+	const float center[3] = { 0.0f, 40.0f, 80.0f };
+	const float yaws[] = { -90.0f, -45.0f, 0.0f, 30.0f, 45.0f, 90.0f };
+	for ( int i = 0; i < 6; i++ )
+	{
+		Pose( joints, i, i + 1, center, 0.0f, yaws[i] );
+	}
+	estimator.Estimate( joints, model );
+
+	for ( int i = 0; i < 6; i++ )
+	{
+		float y = yaws[i] * g_Pi / 180.0f;
+		float right[3] = { cosf( y ), 0.0f, -sinf( y ) };
+		float back[3] = { sinf( y ), 0.0f, cosf( y ) };
+
+		float eyes[6];
+		estimator.GetEyes( i, eyes );
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			float between = joints.head[axis][i] + ( 1 == axis ? model.height : 0.0f ) - model.forward * back[axis];
+			TEST_CHECK_NEAR( eyes[axis], between - 1.25f * right[axis], 1.0e-3f );
+			TEST_CHECK_NEAR( eyes[3 + axis], between + 1.25f * right[axis], 1.0e-3f );
+		}
+	}
+}
+
+/// <summary>
+/// The same person from one frame to the next moves part of the way, by the smoothing
+/// </summary>
+static void TestSlerp( )
+{
+	EyeModel model;
+	model.smoothing = 0.5f;
+	EyeEstimator estimator;
+	EyeJoints joints;
+	Clear( joints );
+
+	const float center[3] = { 0.0f, 40.0f, 80.0f };
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		Pose( joints, i, i + 1, center, 0.0f, 0.0f );
+	}
+	estimator.Estimate( joints, model );
+
+	// every lane rolls a different way at once, the filter takes half of each; a turn of
+	// 180 degrees is as far as a slerp goes
+	const float rolls[EYE_MAX_USERS] = { 45.0f, -45.0f, 10.0f, 90.0f, -120.0f, 170.0f, 0.5f, 0.0f };
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		Pose( joints, i, i + 1, center, rolls[i], 0.0f );
+	}
+	estimator.Estimate( joints, model );
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		TEST_CHECK_NEAR( RollOf( estimator, i ), 0.5f * rolls[i], 0.01f );
+
+		float q[4];
+		estimator.GetOrientation( i, q );
+		TEST_CHECK_NEAR( q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3], 1.0f, 1.0e-5f );
+	}
+
+	// and half of what is left the next frame
+	estimator.Estimate( joints, model );
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		TEST_CHECK_NEAR( RollOf( estimator, i ), 0.75f * rolls[i], 0.01f );
+	}
+
+	// no smoothing follows at once
+	model.smoothing = 0.0f;
+	estimator.Estimate( joints, model );
+	for ( int i = 0; i < EYE_MAX_USERS; i++ )
+	{
+		TEST_CHECK_NEAR( RollOf( estimator, i ), rolls[i], 0.01f );
+	}
+}
+
+/// <summary>
+/// A lane taken over by another tracking id, or an estimator Reset, starts from the new
+/// orientation instead of filtering toward it
+/// </summary>
+static void TestRestart( )
+{
+	EyeModel model;
+	model.smoothing = 0.9f;
+	EyeEstimator estimator;
+	EyeJoints joints;
+	Clear( joints );
+
+	const float center[3] = { 0.0f, 40.0f, 80.0f };
+	Pose( joints, 0, 7, center, 0.0f, 0.0f );
+	Pose( joints, 1, 8, center, 0.0f, 0.0f );
+	estimator.Estimate( joints, model );
+
+	// lane 0 is someone else now, lane 1 the same person
+	Pose( joints, 0, 9, center, 30.0f, 0.0f );
+	Pose( joints, 1, 8, center, 30.0f, 0.0f );
+	estimator.Estimate( joints, model );
+	TEST_CHECK_NEAR( RollOf( estimator, 0 ), 30.0f, 0.01f );
+	TEST_CHECK_NEAR( RollOf( estimator, 1 ), 3.0f, 0.01f );
+
+	// a lane left empty and taken again starts over too
+	joints.trackingId[0] = 0;
+	estimator.Estimate( joints, model );
+	Pose( joints, 0, 9, center, -30.0f, 0.0f );
+	estimator.Estimate( joints, model );
+	TEST_CHECK_NEAR( RollOf( estimator, 0 ), -30.0f, 0.01f );
+
+	// Reset forgets everyone
+	estimator.Reset();
+	float q[4];
+	estimator.GetOrientation( 1, q );
+	TEST_CHECK( 0.0f == q[0] && 0.0f == q[1] && 0.0f == q[2] && 1.0f == q[3] );
+	estimator.Estimate( joints, model );
+	TEST_CHECK_NEAR( RollOf( estimator, 1 ), 30.0f, 0.01f );
+}
+
+int main( )
+{
+	TestRoll();
+	TestCollapsed();
+	TestYaw();
+	TestSlerp();
+	TestRestart();
+	return TestResult();
+}
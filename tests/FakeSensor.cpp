@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+// <copyright file="FakeSensor.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Implementation of the scripted sensor the recovery tests run against
+
+#include "FakeSensor.h"
+#include <sstream>
+#include <string>
+
+/// <summary>
+/// Constructor, the fake starts plugged in and detached
+/// </summary>
+FakeSensor::FakeSensor() :
+	m_nextStep(0),
+	m_plugged(true),
+	m_stalled(false),
+	m_attached(false),
+	m_pendingFailures(0),
+	m_attachCount(0),
+	m_detachCount(0)
+{
+}
+
+/// <summary>
+/// Load a script of "<ms> <action> [count]" steps separated by ';' or new lines, in time order.
+/// Actions: unplug, plug, stall (stops frames), resume, fail (the next count attaches fail)
+/// e.g. "1000 unplug; 1500 plug; 1500 fail 2; 5000 stall; 9000 resume"
+/// </summary>
+/// <param name="script">steps to play</param>
+/// <returns>true if the script was understood</returns>
+bool FakeSensor::Load( const char * script )
+{
+	m_steps.clear();
+	m_nextStep = 0;
+
+	std::string text( script );
+	for ( size_t i = 0; i < text.size(); i++ )
+	{
+		if ( '\n' == text[i] )
+		{
+			text[i] = ';';
+		}
+	}
+
+	std::istringstream steps( text );
+	std::string line;
+	while ( std::getline( steps, line, ';' ) )
+	{
+		std::istringstream fields( line );
+		std::string name;
+		Step step;
+
+		if ( !( fields >> step.time ) )
+		{
+			// blank step
+			continue;
+		}
+
+		if ( !( fields >> name ) )
+		{
+			return false;
+		}
+
+		step.count = 1;
+		if ( "unplug" == name )
+		{
+			step.action = ActionUnplug;
+		}
+		else if ( "plug" == name )
+		{
+			step.action = ActionPlug;
+		}
+		else if ( "stall" == name )
+		{
+			step.action = ActionStall;
+		}
+		else if ( "resume" == name )
+		{
+			step.action = ActionResume;
+		}
+		else if ( "fail" == name )
+		{
+			step.action = ActionFail;
+			fields >> step.count;
+		}
+		else
+		{
+			return false;
+		}
+
+		if ( !m_steps.empty() && step.time < m_steps.back().time )
+		{
+			return false;
+		}
+
+		m_steps.push_back( step );
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Play every step due by now, the way the SDK status callback would report it,
+/// then deliver a frame if the fake is streaming
+/// </summary>
+/// <param name="now">current time, milliseconds</param>
+/// <param name="recovery">recovery driving this fake</param>
+void FakeSensor::Advance( long long now, SensorRecovery & recovery )
+{
+	while ( m_nextStep < m_steps.size() && m_steps[m_nextStep].time <= now )
+	{
+		const Step & step = m_steps[m_nextStep++];
+
+		switch ( step.action )
+		{
+		case ActionUnplug:
+			m_plugged = false;
+			recovery.OnDisconnected( now );
+			break;
+
+		case ActionPlug:
+			m_plugged = true;
+			recovery.OnConnected( now );
+			break;
+
+		case ActionStall:
+			m_stalled = true;
+			break;
+
+		case ActionResume:
+			m_stalled = false;
+			break;
+
+		case ActionFail:
+			m_pendingFailures += step.count;
+			break;
+		}
+	}
+
+	if ( m_attached && m_plugged && !m_stalled )
+	{
+		recovery.OnFrame( now );
+	}
+}
+
+/// <summary>
+/// Attach, fails while unplugged or while scripted failures are pending
+/// </summary>
+bool FakeSensor::Attach()
+{
+	if ( !m_plugged )
+	{
+		return false;
+	}
+
+	if ( m_pendingFailures > 0 )
+	{
+		--m_pendingFailures;
+		return false;
+	}
+
+	m_attached = true;
+	++m_attachCount;
+	return true;
+}
+
+/// <summary>
+/// Detach
+/// </summary>
+void FakeSensor::Detach()
+{
+	m_attached = false;
+	++m_detachCount;
+}
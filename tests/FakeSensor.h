@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+// <copyright file="FakeSensor.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Declares a scripted stand-in for a Kinect, to replay disconnect/reconnect sequences
+// against SensorRecovery without hardware.
+
+#pragma once
+
+#include "SensorRecovery.h"
+#include <vector>
+#include <stddef.h>
+
+class FakeSensor : public SensorLink
+{
+public:
+	/// <summary>
+	/// Constructor, the fake starts plugged in and detached
+	/// </summary>
+	FakeSensor();
+
+	/// <summary>
+	/// Load a script of "<ms> <action> [count]" steps separated by ';' or new lines, in time order.
+	/// Actions: unplug, plug, stall (stops frames), resume, fail (the next count attaches fail)
+	/// e.g. "1000 unplug; 1500 plug; 1500 fail 2; 5000 stall; 9000 resume"
+	/// </summary>
+	/// <param name="script">steps to play</param>
+	/// <returns>true if the script was understood</returns>
+	bool                Load( const char * script );
+
+	/// <summary>
+	/// Play every step due by now, the way the SDK status callback would report it,
+	/// then deliver a frame if the fake is streaming
+	/// </summary>
+	/// <param name="now">current time, milliseconds</param>
+	/// <param name="recovery">recovery driving this fake</param>
+	void                Advance( long long now, SensorRecovery & recovery );
+
+	/// <summary>
+	/// Attach, fails while unplugged or while scripted failures are pending
+	/// </summary>
+	virtual bool        Attach();
+
+	/// <summary>
+	/// Detach
+	/// </summary>
+	virtual void        Detach();
+
+	bool                IsAttached() const { return m_attached; }
+	bool                IsDone() const { return m_nextStep >= m_steps.size(); }
+	int                 GetAttachCount() const { return m_attachCount; }
+	int                 GetDetachCount() const { return m_detachCount; }
+
+private:
+	enum Action
+	{
+		ActionUnplug,
+		ActionPlug,
+		ActionStall,
+		ActionResume,
+		ActionFail
+	};
+
+	struct Step
+	{
+		long long       time;
+		Action          action;
+		int             count;
+	};
+
+	std::vector<Step>   m_steps;
+	size_t              m_nextStep;
+
+	bool                m_plugged;
+	bool                m_stalled;
+	bool                m_attached;
+	int                 m_pendingFailures;
+	int                 m_attachCount;
+	int                 m_detachCount;
+};
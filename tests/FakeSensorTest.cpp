@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------------
+// <copyright file="FakeSensorTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Plays scripted unplug, replug, stall and failed attach sequences against SensorRecovery,
+// the way the processing thread drives it: status changes, then a frame, then Poll.
+
+#include "FakeSensor.h"
+#include "TestCheck.h"
+
+// Step of the simulated clock, ms, about a third of a frame
+static const long long g_Tick = 10;
+
+/// <summary>
+/// Run a script from a sensor streaming at 0 until the end time
+/// </summary>
+/// <param name="script">FakeSensor script</param>
+/// <param name="end">last time, ms</param>
+/// <param name="fake">sensor to play it on</param>
+/// <param name="recovery">recovery of the fake</param>
+static void Play( const char * script, long long end, FakeSensor & fake, SensorRecovery & recovery )
+{
+	TEST_CHECK( fake.Load( script ) );
+	TEST_CHECK( fake.Attach() );
+	recovery.OnAttached( 0 );
+
+	for ( long long now = 0; now <= end; now += g_Tick )
+	{
+		fake.Advance( now, recovery );
+		recovery.Poll( now );
+	}
+
+	TEST_CHECK( fake.IsDone() );
+}
+
+/// <summary>
+/// Unplugged, replugged with two failing attaches, stalled, unplugged again
+/// </summary>
+static void TestSequence( )
+{
+	FakeSensor fake;
+	SensorRecovery recovery( &fake );
+	Play( "1000 unplug; 1500 plug; 1500 fail 2\n5000 stall; 9000 resume; 12000 unplug; 12400 plug", 20000, fake, recovery );
+
+	TEST_CHECK( RECOVERY_STREAMING == recovery.GetState() );
+	TEST_CHECK( fake.IsAttached() );
+	TEST_CHECK( 3 == recovery.GetRecoveryCount() );
+
+	// unplugged at 1000: one attempt at 1250 while unplugged, then two scripted failures
+	// after the replug at 1500 and 1750, attached at 2250 after the doubled backoff
+	// stalled from 5000: lost at 8000, the timeout after the last frame, attached at 8250
+	// unplugged at 12000: one attempt at 12250, attached right at the replug at 12400
+	TEST_CHECK( 4 == recovery.GetFailedAttemptCount() );
+	TEST_CHECK( 1250 == recovery.GetMaxRecoveryTime() );
+	TEST_CHECK( 400 == recovery.GetLastRecoveryTime() );
+	TEST_CHECK( 4 == fake.GetAttachCount() );
+	TEST_CHECK( 3 + 4 == fake.GetDetachCount() );
+}
+
+/// <summary>
+/// A sensor that stays away backs off up to RECOVERY_MAX_BACKOFF, and comes back at once when plugged in
+/// </summary>
+static void TestBackoff( )
+{
+	FakeSensor fake;
+	SensorRecovery recovery( &fake );
+	Play( "0 unplug; 60000 plug", 60000, fake, recovery );
+
+	// 250 + 500 + 1000 + 2000 + 4000 ms, then every 8000 ms until 60000
+	TEST_CHECK( 5 + 7 == recovery.GetFailedAttemptCount() );
+	TEST_CHECK( 1 == recovery.GetRecoveryCount() );
+	TEST_CHECK( 60000 == recovery.GetLastRecoveryTime() );
+
+	// the wait Poll asks for never exceeds the poll interval, so stop requests are seen
+	TEST_CHECK( recovery.Poll( 60000 ) <= RECOVERY_MAX_POLL_INTERVAL );
+}
+
+/// <summary>
+/// A sensor that keeps streaming is never touched
+/// </summary>
+static void TestSteady( )
+{
+	FakeSensor fake;
+	SensorRecovery recovery( &fake );
+	Play( "", 30000, fake, recovery );
+
+	TEST_CHECK( RECOVERY_STREAMING == recovery.GetState() );
+	TEST_CHECK( 0 == recovery.GetRecoveryCount() );
+	TEST_CHECK( 1 == fake.GetAttachCount() );
+	TEST_CHECK( 0 == fake.GetDetachCount() );
+}
+
+/// <summary>
+/// Scripts that cannot be played
+/// </summary>
+static void TestScripts( )
+{
+	FakeSensor fake;
+	TEST_CHECK( !fake.Load( "100 explode" ) );
+	TEST_CHECK( !fake.Load( "100" ) );
+	TEST_CHECK( !fake.Load( "200 unplug; 100 plug" ) );
+	TEST_CHECK( fake.Load( "; 100 unplug ;\n\n200 plug;" ) );
+}
+
+int main( )
+{
+	TestSequence();
+	TestBackoff();
+	TestSteady();
+	TestScripts();
+	return TestResult();
+}
@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+// <copyright file="FramePoolBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Cost of handing a frame on through FramePool.h, on one thread and with threads contending
+// for the free list, next to the copy of a depth frame it replaces.
+
+#include "FramePool.h"
+#include "TestCheck.h"
+#include <thread>
+#include <vector>
+
+// Buffers of the pool, as many as the depth stream has in flight
+static const unsigned int g_BufferCount = 8;
+
+/// <summary>
+/// Acquire, share with a second stage and release, on one thread
+/// </summary>
+/// <returns>ns per frame</returns>
+static double BenchSingle( FramePool & pool, int frames )
+{
+	double start = TestNow();
+	for ( int i = 0; i < frames; i++ )
+	{
+		FrameHandle frame( pool.Acquire() );
+		FrameHandle shared( frame );
+		TestKeep( shared.Get() );
+	}
+	return ( TestNow() - start ) / frames;
+}
+
+/// <summary>
+/// Threads acquiring and releasing at once
+/// </summary>
+/// <param name="threadCount">threads contending</param>
+/// <param name="frames">frames each thread acquires</param>
+/// <returns>ns per frame, wall clock over every thread's frames</returns>
+static double BenchContended( FramePool & pool, int threadCount, int frames )
+{
+	std::vector<std::thread> threads;
+	double start = TestNow();
+	for ( int t = 0; t < threadCount; t++ )
+	{
+		threads.push_back( std::thread( [&pool, frames]()
+		{
+			for ( int i = 0; i < frames; )
+			{
+				FrameHandle frame( pool.Acquire() );
+				if ( frame.IsValid() )
+				{
+					i++;
+				}
+			}
+		} ) );
+	}
+	for ( size_t t = 0; t < threads.size(); t++ )
+	{
+		threads[t].join();
+	}
+	return ( TestNow() - start ) / ( static_cast<double>(frames) * threadCount );
+}
+
+/// <summary>
+/// Copy of a frame from one stage's buffer into the next's, what the pool avoids
+/// </summary>
+/// <returns>ns per frame</returns>
+static double BenchCopy( unsigned int size, int frames )
+{
+	std::vector<unsigned char> from( size, 1 );
+	std::vector<unsigned char> to( size );
+	double start = TestNow();
+	for ( int i = 0; i < frames; i++ )
+	{
+		memcpy( &to[0], &from[0], size );
+		from[i % size] = to[( i * 7 ) % size];
+	}
+	return ( TestNow() - start ) / frames;
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int frames = quick ? 100000 : 20000000;
+	int copies = quick ? 100 : 20000;
+
+	FramePool pool;
+	if ( !pool.Initialize( 640 * 480 * 4, g_BufferCount ) )
+	{
+		return 1;
+	}
+
+	printf( "acquire, share and release:    %8.1f ns per frame\n", BenchSingle( pool, frames ) );
+	for ( int threads = 1; threads <= 8; threads *= 2 )
+	{
+		printf( "%d thread(s) at once:           %8.1f ns per frame\n", threads, BenchContended( pool, threads, frames / threads ) );
+	}
+	printf( "copy of a 320x240 depth frame: %8.1f ns\n", BenchCopy( 320 * 240 * 4, copies ) );
+	printf( "copy of a 640x480 depth frame: %8.1f ns\n", BenchCopy( 640 * 480 * 4, copies / 4 ) );
+
+	TEST_CHECK( g_BufferCount == pool.GetFreeCount() );
+	return TestResult();
+}
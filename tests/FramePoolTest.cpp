@@ -0,0 +1,290 @@
+//------------------------------------------------------------------------------
+// <copyright file="FramePoolTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Tests FramePool.h, first on one thread, then with threads that acquire, share, hand on and
+// release buffers as fast as they can. Every acquire claims the buffer in a table of owners,
+// so a buffer handed out twice, which is what an ABA race on the free list does, fails the
+// claim; and every owner stamps the pixels and checks them before letting go.
+
+#include "FramePool.h"
+#include "TestCheck.h"
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define TEST_THREADS                    8
+#define TEST_BUFFERS                    6
+
+// Acquires per thread in the stress test
+static const int g_Rounds = 100000;
+
+/// <summary>
+/// Acquiring, sharing and releasing on one thread
+/// </summary>
+static void TestSingle( )
+{
+	FramePool pool;
+	TEST_CHECK( NULL == pool.Acquire() );
+	TEST_CHECK( pool.Initialize( 1000, 3 ) );
+	TEST_CHECK( 1000 == pool.GetBufferSize() && 3 == pool.GetCount() && 3 == pool.GetFreeCount() );
+
+	FrameHandle a( pool.Acquire() );
+	FrameHandle b( pool.Acquire() );
+	FrameHandle c( pool.Acquire() );
+	TEST_CHECK( a.IsValid() && b.IsValid() && c.IsValid() );
+	TEST_CHECK( NULL == pool.Acquire() );
+	TEST_CHECK( 0 == pool.GetFreeCount() );
+
+	// aligned, and no two buffers share a cache line
+	FrameBuffer * buffers[3] = { a.Get(), b.Get(), c.Get() };
+	for ( int i = 0; i < 3; i++ )
+	{
+		TEST_CHECK( 0 == ( reinterpret_cast<size_t>( buffers[i]->GetData() ) & ( FRAME_POOL_ALIGNMENT - 1 ) ) );
+		TEST_CHECK( 1000 == buffers[i]->GetSize() );
+		for ( int j = 0; j < i; j++ )
+		{
+			long long distance = buffers[i]->GetData() - buffers[j]->GetData();
+			TEST_CHECK( distance >= 1024 || distance <= -1024 );
+		}
+	}
+
+	// shared frames go back when the last handle lets go
+	a->frameNumber = 42;
+	FrameHandle shared( a );
+	FrameHandle assigned;
+	assigned = shared;
+	a.Reset();
+	shared.Reset();
+	TEST_CHECK( 0 == pool.GetFreeCount() );
+	TEST_CHECK( 42 == assigned->frameNumber );
+	assigned = assigned;
+	TEST_CHECK( assigned.IsValid() && 0 == pool.GetFreeCount() );
+	assigned.Reset();
+	TEST_CHECK( 1 == pool.GetFreeCount() );
+
+	// a buffer comes back cleared of the last frame
+	FrameHandle again( pool.Acquire() );
+	TEST_CHECK( again.Get() == buffers[0] );
+	TEST_CHECK( 0 == again->frameNumber && 0 == again->width && 0 == again->captureTime );
+
+	again.Reset();
+	b.Reset();
+	c.Reset();
+	TEST_CHECK( 3 == pool.GetFreeCount() );
+
+	// resized while nothing is acquired
+	TEST_CHECK( pool.Initialize( 64, 10 ) );
+	TEST_CHECK( 10 == pool.GetFreeCount() );
+	TEST_CHECK( pool.Initialize( 0, 0 ) );
+	TEST_CHECK( NULL == pool.Acquire() );
+}
+
+/// <summary>
+/// Hand-off of frames from one stage to the next, the pipeline's queue
+/// </summary>
+class TestQueue
+{
+public:
+	void Push( const FrameHandle & frame )
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+		m_frames.push_back( frame );
+	}
+
+	bool Pop( FrameHandle & frame )
+	{
+		std::lock_guard<std::mutex> lock( m_lock );
+		if ( m_frames.empty() )
+		{
+			return false;
+		}
+		frame = m_frames.back();
+		m_frames.pop_back();
+		return true;
+	}
+
+private:
+	std::mutex                  m_lock;
+	std::vector<FrameHandle>    m_frames;
+};
+
+/// <summary>
+/// The claims of the stress test: who owns each buffer, and what it stamped into it
+/// </summary>
+struct TestOwners
+{
+	std::atomic<int>    owner[TEST_BUFFERS];
+	std::atomic<int>    failures;
+	const unsigned char * pFirst;       // data of buffer 0, to index the others
+	unsigned int        stride;
+};
+
+/// <summary>
+/// Index of a buffer in the pool
+/// </summary>
+static int BufferIndex( const TestOwners & owners, const FrameBuffer * pBuffer )
+{
+	return static_cast<int>( ( pBuffer->GetData() - owners.pFirst ) / owners.stride );
+}
+
+/// <summary>
+/// Claim a buffer just acquired and stamp it
+/// </summary>
+static void Claim( TestOwners & owners, FrameBuffer * pBuffer, int thread, unsigned int round )
+{
+	int expected = 0;
+	if ( !owners.owner[BufferIndex( owners, pBuffer )].compare_exchange_strong( expected, thread + 1 ) )
+	{
+		owners.failures++;
+	}
+	pBuffer->frameNumber = round;
+	memset( pBuffer->GetData(), thread + 1, pBuffer->GetSize() );
+}
+
+/// <summary>
+/// Check the stamp of a buffer about to be released for the last time, and give up the claim
+/// </summary>
+static void Unclaim( TestOwners & owners, FrameBuffer * pBuffer )
+{
+	int owner = owners.owner[BufferIndex( owners, pBuffer )].load();
+	const unsigned char * pData = pBuffer->GetData();
+	for ( unsigned int i = 0; i < pBuffer->GetSize(); i += 61 )
+	{
+		if ( pData[i] != owner )
+		{
+			owners.failures++;
+			break;
+		}
+	}
+	owners.owner[BufferIndex( owners, pBuffer )].store( 0 );
+}
+
+/// <summary>
+/// Threads acquiring more than the pool has, some releasing at once, some sharing a frame
+/// and some handing it to another thread that releases it
+/// </summary>
+static void TestStress( )
+{
+	FramePool pool;
+	TEST_CHECK( pool.Initialize( 4000, TEST_BUFFERS ) );
+
+	TestOwners owners;
+	for ( int i = 0; i < TEST_BUFFERS; i++ )
+	{
+		owners.owner[i].store( 0 );
+	}
+	owners.failures.store( 0 );
+	{
+		// a new pool hands out its buffers in order
+		FrameHandle first( pool.Acquire() );
+		FrameHandle second( pool.Acquire() );
+		owners.pFirst = first->GetData();
+		owners.stride = static_cast<unsigned int>( second->GetData() - first->GetData() );
+	}
+
+	TestQueue queue;
+	std::atomic<long long> acquired( 0 );
+	std::atomic<long long> exhausted( 0 );
+	std::vector<std::thread> threads;
+
+	for ( int thread = 0; thread < TEST_THREADS; thread++ )
+	{
+		threads.push_back( std::thread( [&pool, &owners, &queue, &acquired, &exhausted, thread]()
+		{
+			unsigned int seed = 2654435761u * ( thread + 1 );
+			long long count = 0;
+			long long none = 0;
+			for ( int round = 0; round < g_Rounds; round++ )
+			{
+				// the other threads' frames first, like a stage draining its input
+				FrameHandle handed;
+				while ( queue.Pop( handed ) )
+				{
+					Unclaim( owners, handed.Get() );
+					handed.Reset();
+				}
+
+				FrameHandle frame( pool.Acquire() );
+				if ( !frame.IsValid() )
+				{
+					none++;
+					std::this_thread::yield();
+					continue;
+				}
+				count++;
+				Claim( owners, frame.Get(), thread, round );
+
+				seed = seed * 1664525u + 1013904223u;
+				switch ( seed >> 30 )
+				{
+				case 0:
+					{
+						// hand it on, the other thread releases it
+						queue.Push( frame );
+						frame.Reset();
+					}
+					break;
+
+				case 1:
+					{
+						// two stages share it, the copy lets go last
+						FrameHandle copy( frame );
+						frame.Reset();
+						if ( copy->frameNumber != static_cast<unsigned int>(round) )
+						{
+							owners.failures++;
+						}
+						Unclaim( owners, copy.Get() );
+					}
+					break;
+
+				default:
+					Unclaim( owners, frame.Get() );
+					break;
+				}
+			}
+			acquired += count;
+			exhausted += none;
+		} ) );
+	}
+
+	for ( size_t i = 0; i < threads.size(); i++ )
+	{
+		threads[i].join();
+	}
+
+	FrameHandle left;
+	while ( queue.Pop( left ) )
+	{
+		Unclaim( owners, left.Get() );
+		left.Reset();
+	}
+
+	TEST_CHECK( 0 == owners.failures.load() );
+	TEST_CHECK( acquired.load() > g_Rounds );
+	TEST_CHECK( TEST_BUFFERS == pool.GetFreeCount() );
+
+	// every buffer is on the free list exactly once
+	FrameHandle all[TEST_BUFFERS];
+	for ( int i = 0; i < TEST_BUFFERS; i++ )
+	{
+		all[i] = FrameHandle( pool.Acquire() );
+		TEST_CHECK( all[i].IsValid() );
+		for ( int j = 0; j < i; j++ )
+		{
+			TEST_CHECK( all[i].Get() != all[j].Get() );
+		}
+	}
+	TEST_CHECK( NULL == pool.Acquire() );
+	printf( "%lld frames acquired, %lld times the pool was empty\n", acquired.load(), exhausted.load() );
+}
+
+int main( )
+{
+	TestSingle();
+	TestStress();
+	return TestResult();
+}
@@ -0,0 +1,285 @@
+//------------------------------------------------------------------------------
+// <copyright file="MulticastTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// The multicast output of DestinationTable on loopback: a receiver that joins the group gets
+// every stream with consecutive sequence numbers next to a unicast subscriber, setting the
+// same group again does not restart them, and a blank group stops the datagrams. Loopback
+// only carries multicast once it is enabled, as root:
+//	ip link set lo multicast on
+// Without it the test is skipped.
+
+#include "stdafx.h"
+#include "DestinationTable.h"
+#include "TestCheck.h"
+#include <net/if.h>
+
+// Group on loopback, administratively scoped so it never leaves the machine
+#define MULTICAST_GROUP4                "239.255.42.99"
+#define MULTICAST_GROUP6                "ff02::4299"
+
+// Longest wait for a datagram, ms
+#define MULTICAST_WAIT                  500
+
+// Frames sent in each part of the test
+#define MULTICAST_FRAMES                40
+
+// Streams sent every frame, the others are empty
+static const int g_Streams[] = { SUBSCRIBER_STREAM_EYES, SUBSCRIBER_STREAM_USER, SUBSCRIBER_STREAM_SKELETON };
+
+/// <summary>
+/// The values of every stream for a frame, each stream the start of the same array
+/// </summary>
+struct TestFrame
+{
+	float           values[SUBSCRIBER_STREAM_MAX_VALUES];
+	StreamPacket    packets[SUBSCRIBER_STREAM_COUNT];
+
+	explicit TestFrame( int frame )
+	{
+		ZeroMemory( packets, sizeof(packets) );
+		for ( int i = 0; i < SUBSCRIBER_STREAM_MAX_VALUES; i++ )
+		{
+			values[i] = frame * 100.0f + i;
+		}
+		for ( size_t s = 0; s < sizeof(g_Streams) / sizeof(g_Streams[0]); s++ )
+		{
+			packets[g_Streams[s]].pData = values;
+			packets[g_Streams[s]].size = PoseStreamValueCount( g_Streams[s] ) * sizeof(float);
+		}
+	}
+};
+
+/// <summary>
+/// Wait for a datagram
+/// </summary>
+/// <param name="pBuffer">receives the datagram</param>
+/// <param name="timeout">longest wait, ms</param>
+/// <returns>its size, -1 if none came</returns>
+static int Receive( SOCKET s, unsigned char * pBuffer, int size, int timeout )
+{
+	pollfd entry = { s, POLLIN, 0 };
+	if ( poll( &entry, 1, timeout ) <= 0 )
+	{
+		return -1;
+	}
+	return static_cast<int>( recv( s, (char *)pBuffer, size, 0 ) );
+}
+
+/// <summary>
+/// Bind a receiver on a port the system picks
+/// </summary>
+/// <param name="family">AF_INET or AF_INET6</param>
+/// <param name="pAddress">receives the loopback address and the port</param>
+/// <returns>the socket, INVALID_SOCKET if it could not be bound</returns>
+static SOCKET Bind( int family, sockaddr_storage * pAddress )
+{
+	SOCKET s = socket( family, SOCK_DGRAM, IPPROTO_UDP );
+	if ( INVALID_SOCKET == s )
+	{
+		return INVALID_SOCKET;
+	}
+
+	ZeroMemory( pAddress, sizeof(*pAddress) );
+	pAddress->ss_family = static_cast<sa_family_t>(family);
+	socklen_t length = ( AF_INET == family ) ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+	if ( SOCKET_ERROR == bind( s, (const sockaddr *)pAddress, length ) ||
+		 SOCKET_ERROR == getsockname( s, (sockaddr *)pAddress, &length ) )
+	{
+		closesocket( s );
+		return INVALID_SOCKET;
+	}
+
+	if ( AF_INET == family )
+	{
+		reinterpret_cast<sockaddr_in *>(pAddress)->sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	}
+	else
+	{
+		reinterpret_cast<sockaddr_in6 *>(pAddress)->sin6_addr = in6addr_loopback;
+	}
+	return s;
+}
+
+/// <summary>
+/// Join a group on loopback
+/// </summary>
+/// <returns>true if the system let the socket join</returns>
+static bool Join( SOCKET s, int family, const char * pGroup )
+{
+	if ( AF_INET == family )
+	{
+		ip_mreq request;
+		inet_pton( AF_INET, pGroup, &request.imr_multiaddr );
+		request.imr_interface.s_addr = htonl( INADDR_LOOPBACK );
+		return SOCKET_ERROR != setsockopt( s, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char *)&request, sizeof(request) );
+	}
+
+	ipv6_mreq request;
+	inet_pton( AF_INET6, pGroup, &request.ipv6mr_multiaddr );
+	request.ipv6mr_interface = if_nametoindex( "lo" );
+	return SOCKET_ERROR != setsockopt( s, IPPROTO_IPV6, IPV6_JOIN_GROUP, (const char *)&request, sizeof(request) );
+}
+
+/// <summary>
+/// Send frames and check what the group and the unicast subscriber receive
+/// </summary>
+/// <param name="group">receiver that joined the group</param>
+/// <param name="unicast">receiver subscribed to the eyes stream, INVALID_SOCKET for none</param>
+/// <param name="sequence">next sequence number of every stream, advanced</param>
+/// <param name="first">first frame number</param>
+/// <returns>datagrams the group received</returns>
+static int SendFrames( DestinationTable & table, SOCKET group, SOCKET unicast, unsigned int sequence[SUBSCRIBER_STREAM_COUNT], int first )
+{
+	unsigned char datagram[DESTINATION_MAX_DATAGRAM];
+	int received = 0;
+	for ( int frame = first; frame < first + MULTICAST_FRAMES; frame++ )
+	{
+		TestFrame sent( frame );
+		long long now = 1000000000LL + frame * 33333LL;
+		table.Send( sent.packets, now - 15000, now );
+
+		for ( size_t s = 0; s < sizeof(g_Streams) / sizeof(g_Streams[0]); s++ )
+		{
+			int size = Receive( group, datagram, sizeof(datagram), MULTICAST_WAIT );
+			if ( size < 0 )
+			{
+				return received;
+			}
+			received++;
+
+			unsigned int number;
+			unsigned int stream;
+			unsigned int sendTime;
+			unsigned int captureToSend;
+			PosePacketReadHeader( datagram, number, stream );
+			PosePacketReadTiming( datagram, sendTime, captureToSend );
+
+			// the streams of a frame in the order of SUBSCRIBER_STREAM_*
+			TEST_CHECK( g_Streams[s] == static_cast<int>(stream) );
+			TEST_CHECK( sequence[stream] == number );
+			TEST_CHECK( 15000 == captureToSend );
+			TEST_CHECK( static_cast<int>(POSE_PACKET_HEADER_SIZE + sent.packets[stream].size) == size );
+			TEST_CHECK( 0 == memcmp( datagram + POSE_PACKET_HEADER_SIZE, sent.values, sent.packets[stream].size ) );
+			sequence[stream] = number + 1;
+		}
+
+		// unicast destinations are not sequenced, the datagram is the values alone
+		if ( INVALID_SOCKET != unicast )
+		{
+			int size = Receive( unicast, datagram, sizeof(datagram), MULTICAST_WAIT );
+			TEST_CHECK( sent.packets[SUBSCRIBER_STREAM_EYES].size == size );
+			TEST_CHECK( size > 0 && 0 == memcmp( datagram, sent.values, size ) );
+		}
+	}
+	return received;
+}
+
+/// <summary>
+/// The whole test for one address family
+/// </summary>
+/// <returns>false if multicast does not reach loopback here</returns>
+static bool TestFamily( int family, const char * pGroup )
+{
+	sockaddr_storage groupAddress;
+	SOCKET group = Bind( family, &groupAddress );
+	if ( INVALID_SOCKET == group || !Join( group, family, pGroup ) )
+	{
+		if ( INVALID_SOCKET != group )
+		{
+			closesocket( group );
+		}
+		return false;
+	}
+
+	sockaddr_storage unicastAddress;
+	SOCKET unicast = Bind( family, &unicastAddress );
+	TEST_CHECK( INVALID_SOCKET != unicast );
+
+	char port[16];
+	unsigned short groupPort = ( AF_INET == family ) ? reinterpret_cast<sockaddr_in *>(&groupAddress)->sin_port :
+		reinterpret_cast<sockaddr_in6 *>(&groupAddress)->sin6_port;
+	snprintf( port, sizeof(port), "%u", ntohs( groupPort ) );
+
+	// the interface is the loopback address for IPv4, its index for IPv6
+	char networkInterface[16];
+	if ( AF_INET == family )
+	{
+		snprintf( networkInterface, sizeof(networkInterface), "127.0.0.1" );
+	}
+	else
+	{
+		snprintf( networkInterface, sizeof(networkInterface), "%u", if_nametoindex( "lo" ) );
+	}
+
+	DestinationTable table;
+	TEST_CHECK( S_OK == table.SetMulticast( pGroup, port, 1, networkInterface ) );
+	table.Subscribe( 1, (const sockaddr *)&unicastAddress, sizeof(unicastAddress), SUBSCRIBER_STREAM_BIT(SUBSCRIBER_STREAM_EYES), 0, false );
+
+	unsigned int sequence[SUBSCRIBER_STREAM_COUNT] = { 0 };
+	int expected = MULTICAST_FRAMES * static_cast<int>( sizeof(g_Streams) / sizeof(g_Streams[0]) );
+	int received = SendFrames( table, group, unicast, sequence, 0 );
+	if ( 0 == received )
+	{
+		closesocket( unicast );
+		closesocket( group );
+		return false;
+	}
+	TEST_CHECK( expected == received );
+
+	// the same group again, receivers see no gap in the sequence numbers
+	TEST_CHECK( S_OK == table.SetMulticast( pGroup, port, 1, networkInterface ) );
+	TEST_CHECK( expected == SendFrames( table, group, INVALID_SOCKET, sequence, MULTICAST_FRAMES ) );
+	TEST_CHECK( 2 * MULTICAST_FRAMES == static_cast<int>( sequence[SUBSCRIBER_STREAM_EYES] ) );
+
+	std::vector<DestinationStatus> status;
+	table.GetStatus( status );
+	TEST_CHECK( 2 == status.size() );
+	for ( size_t i = 0; i < status.size(); i++ )
+	{
+		TEST_CHECK( 0 == status[i].errors );
+		if ( DESTINATION_MULTICAST == status[i].kind )
+		{
+			TEST_CHECK( static_cast<unsigned long long>( 2 * expected ) == status[i].packets );
+			TEST_CHECK( SUBSCRIBER_STREAM_ALL == status[i].streamMask );
+		}
+	}
+
+	// a blank group stops multicasting, unicast goes on
+	TEST_CHECK( S_OK == table.SetMulticast( "", "", 1, "" ) );
+	unsigned char datagram[DESTINATION_MAX_DATAGRAM];
+	while ( Receive( unicast, datagram, sizeof(datagram), 0 ) >= 0 )
+	{
+	}
+	TestFrame last( 0 );
+	table.Send( last.packets, 0, 0 );
+	TEST_CHECK( Receive( group, datagram, sizeof(datagram), 50 ) < 0 );
+	TEST_CHECK( sizeof(float) * SUBSCRIBER_STREAM_EYES_VALUES == Receive( unicast, datagram, sizeof(datagram), MULTICAST_WAIT ) );
+
+	// neither a unicast address nor a name is a group
+	TEST_CHECK( E_INVALIDARG == table.SetMulticast( ( AF_INET == family ) ? "127.0.0.1" : "::1", port, 1, "" ) );
+	TEST_CHECK( E_INVALIDARG == table.SetMulticast( "localhost", port, 1, "" ) );
+
+	closesocket( unicast );
+	closesocket( group );
+	return true;
+}
+
+int main( )
+{
+	if ( !TestFamily( AF_INET, MULTICAST_GROUP4 ) )
+	{
+		printf( "IPv4 multicast does not reach loopback here, run: ip link set lo multicast on\n" );
+		return TEST_SKIPPED;
+	}
+
+	// some systems route IPv6 multicast off loopback even then
+	if ( !TestFamily( AF_INET6, MULTICAST_GROUP6 ) )
+	{
+		printf( "IPv6 multicast does not reach loopback here, only IPv4 tested\n" );
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,358 @@
+//------------------------------------------------------------------------------
+// <copyright file="PointCloudBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Cost per depth frame, at 320x240 and 640x480, of turning it into display frame points the
+// way a consumer had to, NuiTransformDepthImageToSkeleton and SensorCalibration::Transform
+// per pixel, and with PointCloud, whole and downsampled, and of recording the cloud with
+// PointCloudRecorder. Both conversions must give the same points, downsampling must lose no
+// point, the recording must read back as the cloud and a write that fails must stop it.
+
+#include "stdafx.h"
+#include "PointCloudRecorder.h"
+#include "TestCheck.h"
+#include <set>
+#include <time.h>
+#include <vector>
+
+// Depth frames measured
+static const UINT g_Sizes[][2] = { { 320, 240 }, { 640, 480 } };
+
+// Frames cycled through, the players move from one to the next
+#define BENCH_FRAMES                    8
+
+// Voxel edges measured, inches
+static const float g_VoxelSizes[] = { 1.0f, 2.0f };
+
+/// <summary>
+/// CPU time of the calling thread, which leaves out the writer thread running in between
+/// on a machine with few cores
+/// </summary>
+/// <returns>nanoseconds</returns>
+static double ThreadNow( )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_THREAD_CPUTIME_ID, &now );
+	return now.tv_sec * 1.0e9 + now.tv_nsec;
+}
+
+/// <summary>
+/// NuiTransformDepthImageToSkeleton as the SDK's NuiSkeleton.h defines it, for any resolution
+/// </summary>
+static Vector4 TransformDepthImageToSkeleton( LONG depthX, LONG depthY, USHORT depthValue, UINT width, UINT height )
+{
+	Vector4 point;
+	point.z = static_cast<FLOAT>( depthValue >> NUI_IMAGE_PLAYER_INDEX_SHIFT ) / 1000.0f;
+	point.x = ( depthX - width / 2.0f ) * ( 320.0f / width ) * NUI_CAMERA_DEPTH_IMAGE_TO_SKELETON_MULTIPLIER_320x240 * point.z;
+	point.y = -( depthY - height / 2.0f ) * ( 240.0f / height ) * NUI_CAMERA_DEPTH_IMAGE_TO_SKELETON_MULTIPLIER_320x240 * point.z;
+	point.w = 1.0f;
+	return point;
+}
+
+/// <summary>
+/// A room as the sensor sees it: a wall at 4 m, a floor, two players standing at 2 and 2.5 m,
+/// and the holes the sensor leaves without a depth
+/// </summary>
+static void MakeFrame( int frame, UINT width, UINT height, std::vector<USHORT> & depth )
+{
+	depth.resize( width * height );
+	unsigned int seed = 7 + frame;
+	for ( UINT v = 0; v < height; v++ )
+	{
+		for ( UINT u = 0; u < width; u++ )
+		{
+			float x = static_cast<float>(u) / width;
+			float y = static_cast<float>(v) / height;
+			seed = seed * 1664525u + 1013904223u;
+
+			USHORT millimeters = static_cast<USHORT>( y > 0.75f ? 4000 - ( y - 0.75f ) * 6000 : 4000 );
+			USHORT player = 0;
+			for ( int p = 0; p < 2; p++ )
+			{
+				float center = 0.3f + 0.4f * p + 0.01f * frame;
+				if ( x > center - 0.06f && x < center + 0.06f && y > 0.15f + 0.05f * p && y < 0.9f )
+				{
+					millimeters = static_cast<USHORT>( 2000 + 500 * p + ( seed >> 26 ) );
+					player = static_cast<USHORT>( p + 1 );
+				}
+			}
+
+			// about one pixel in sixteen has no depth
+			if ( 0 == ( seed >> 28 ) )
+			{
+				millimeters = 0;
+				player = 0;
+			}
+			depth[v * width + u] = static_cast<USHORT>( ( millimeters << NUI_IMAGE_PLAYER_INDEX_SHIFT ) | player );
+		}
+	}
+}
+
+/// <summary>
+/// Points of a frame the way a consumer got them before, one SDK call and one transform per pixel
+/// </summary>
+/// <returns>number of points</returns>
+static UINT ConvertBefore( const USHORT * pDepth, UINT width, UINT height, int player, const SensorCalibration & calibration,
+						   std::vector<float> & points )
+{
+	UINT capacity = width * height;
+	points.resize( 3 * capacity );
+	UINT count = 0;
+	for ( UINT v = 0; v < height; v++ )
+	{
+		for ( UINT u = 0; u < width; u++ )
+		{
+			USHORT pixel = pDepth[v * width + u];
+			int index = pixel & NUI_IMAGE_PLAYER_INDEX_MASK;
+			if ( 0 == ( pixel >> NUI_IMAGE_PLAYER_INDEX_SHIFT ) || ( POINT_CLOUD_ALL_PLAYERS == player && 0 == index ) ||
+				 ( player > 0 && player != index ) )
+			{
+				continue;
+			}
+
+			float out[3];
+			calibration.Transform( TransformDepthImageToSkeleton( u, v, pixel, width, height ), out );
+			points[count] = out[0];
+			points[capacity + count] = out[1];
+			points[2 * capacity + count] = out[2];
+			count++;
+		}
+	}
+	return count;
+}
+
+/// <summary>
+/// Whether the cloud holds the points, in the same order
+/// </summary>
+static bool SamePoints( const PointCloud & cloud, const std::vector<float> & points, UINT count )
+{
+	if ( cloud.GetCount() != count )
+	{
+		return false;
+	}
+
+	const float * pCloud = cloud.GetBuffer();
+	UINT capacity = static_cast<UINT>( points.size() / 3 );
+	for ( UINT i = 0; i < count; i++ )
+	{
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			float difference = pCloud[axis * count + i] - points[axis * capacity + i];
+			if ( difference > 0.01f || difference < -0.01f )
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Whether every point of a downsampled cloud is in a voxel of its own, which the centroid
+/// of what was in a voxel always is
+/// </summary>
+static bool OnePerVoxel( const PointCloud & cloud, float voxelSize )
+{
+	std::set<long long> voxels;
+	const float * pCloud = cloud.GetBuffer();
+	UINT count = cloud.GetCount();
+	for ( UINT i = 0; i < count; i++ )
+	{
+		long long key = 0;
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			long long cell = static_cast<long long>( floorf( pCloud[axis * count + i] / voxelSize ) );
+			key = ( key << 21 ) | ( cell & 0x1FFFFF );
+		}
+		if ( !voxels.insert( key ).second )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Whether a recording holds the clouds written to it, each as PointCloudRecorder lays it out
+/// </summary>
+static bool ReadBack( const char * path, const std::vector< std::vector<float> > & clouds )
+{
+	FILE * pFile = fopen( path, "rb" );
+	if ( NULL == pFile )
+	{
+		return false;
+	}
+
+	bool same = true;
+	for ( size_t c = 0; c < clouds.size() && same; c++ )
+	{
+		PointCloudRecord record;
+		std::vector<float> points( clouds[c].size() + 1 );
+		same = 1 == fread( &record, sizeof(record), 1, pFile ) && POINT_CLOUD_RECORD_MAGIC == record.magic &&
+			   c == record.frameNumber && 1 == record.sensorIndex && 1000 * static_cast<long long>(c) == record.captureTime &&
+			   3 * record.count == clouds[c].size() &&
+			   clouds[c].size() == fread( &points[0], sizeof(float), clouds[c].size(), pFile ) &&
+			   0 == memcmp( &points[0], &clouds[c][0], clouds[c].size() * sizeof(float) );
+	}
+
+	char extra;
+	same = same && 0 == fread( &extra, 1, 1, pFile );
+	fclose( pFile );
+	return same;
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int rounds = quick ? 1 : 40;
+
+	// a sensor 40 inches up, tilted down 10 degrees
+	SensorCalibration calibration;
+	const float position[3] = { 0.0f, 40.0f, 0.0f };
+	calibration.Set( position, -10.0f );
+
+	char path[] = "/tmp/PointCloudBenchXXXXXX";
+	int file = mkstemp( path );
+	if ( file < 0 )
+	{
+		printf( "no temporary file here\n" );
+		return TEST_SKIPPED;
+	}
+	close( file );
+
+	printf( "us per depth frame, players only, to display frame points; KB per recorded frame\n" );
+	printf( "%9s %8s %10s %10s %8s", "frame", "points", "per pixel", "PointCloud", "faster" );
+	for ( size_t s = 0; s < sizeof(g_VoxelSizes) / sizeof(g_VoxelSizes[0]); s++ )
+	{
+		printf( "   %3.0f in voxels     ", g_VoxelSizes[s] );
+	}
+	printf( " %8s %8s\n", "record", "KB" );
+
+	for ( size_t r = 0; r < sizeof(g_Sizes) / sizeof(g_Sizes[0]); r++ )
+	{
+		UINT width = g_Sizes[r][0];
+		UINT height = g_Sizes[r][1];
+		std::vector< std::vector<USHORT> > frames( BENCH_FRAMES );
+		for ( int f = 0; f < BENCH_FRAMES; f++ )
+		{
+			MakeFrame( f, width, height, frames[f] );
+		}
+
+		PointCloud cloud;
+		TEST_CHECK( S_OK == cloud.Initialize( width, height ) );
+		TEST_CHECK( width == cloud.GetWidth() && height == cloud.GetHeight() );
+
+		// the same points from both, for each filter
+		std::vector<float> points;
+		const int players[] = { POINT_CLOUD_ALL_PIXELS, POINT_CLOUD_ALL_PLAYERS, 2 };
+		for ( size_t p = 0; p < sizeof(players) / sizeof(players[0]); p++ )
+		{
+			cloud.SetPlayerFilter( players[p] );
+			for ( int f = 0; f < BENCH_FRAMES; f++ )
+			{
+				UINT count = ConvertBefore( &frames[f][0], width, height, players[p], calibration, points );
+				cloud.Process( &frames[f][0], calibration );
+				TEST_CHECK( count > 0 && SamePoints( cloud, points, count ) );
+			}
+		}
+
+		cloud.SetPlayerFilter( POINT_CLOUD_ALL_PLAYERS );
+		UINT total = 0;
+		double start = TestNow();
+		for ( int i = 0; i < rounds * BENCH_FRAMES; i++ )
+		{
+			total += ConvertBefore( &frames[i % BENCH_FRAMES][0], width, height, POINT_CLOUD_ALL_PLAYERS, calibration, points );
+		}
+		double before = ( TestNow() - start ) / ( rounds * BENCH_FRAMES );
+
+		start = TestNow();
+		for ( int i = 0; i < rounds * BENCH_FRAMES; i++ )
+		{
+			total -= cloud.Process( &frames[i % BENCH_FRAMES][0], calibration );
+		}
+		double after = ( TestNow() - start ) / ( rounds * BENCH_FRAMES );
+		TEST_CHECK( 0 == total );
+
+		printf( "%4ux%-4u %8u %10.0f %10.0f %7.1fx", width, height, cloud.GetCount(), before / 1000.0, after / 1000.0, before / after );
+
+		for ( size_t s = 0; s < sizeof(g_VoxelSizes) / sizeof(g_VoxelSizes[0]); s++ )
+		{
+			cloud.SetVoxelSize( g_VoxelSizes[s] );
+			UINT whole = ConvertBefore( &frames[0][0], width, height, POINT_CLOUD_ALL_PLAYERS, calibration, points );
+			UINT voxels = cloud.Process( &frames[0][0], calibration );
+			TEST_CHECK( voxels > 0 && voxels < whole );
+			TEST_CHECK( OnePerVoxel( cloud, g_VoxelSizes[s] ) );
+
+			start = TestNow();
+			for ( int i = 0; i < rounds * BENCH_FRAMES; i++ )
+			{
+				TestKeep( cloud.Process( &frames[i % BENCH_FRAMES][0], calibration ) );
+			}
+			double downsampled = ( TestNow() - start ) / ( rounds * BENCH_FRAMES );
+			printf( "   %7.0f us %6u pt", downsampled / 1000.0, voxels );
+		}
+
+		// voxels far smaller than a pixel keep every point, even with no filter at all
+		cloud.SetPlayerFilter( POINT_CLOUD_ALL_PIXELS );
+		cloud.SetVoxelSize( 0.01f );
+		UINT pixels = ConvertBefore( &frames[0][0], width, height, POINT_CLOUD_ALL_PIXELS, calibration, points );
+		TEST_CHECK( pixels == cloud.Process( &frames[0][0], calibration ) );
+		cloud.SetPlayerFilter( POINT_CLOUD_ALL_PLAYERS );
+		cloud.SetVoxelSize( 0.0f );
+
+		// every frame recorded, then read back. The time is what the sensor thread spends,
+		// the writer thread does the file I/O
+		PointCloudRecorder recorder;
+		TEST_CHECK( S_FALSE == recorder.Write( 1, 0, 0, cloud ) );
+
+		// the buffers are allocated by the first file, a second one finds them paged in
+		TEST_CHECK( S_OK == recorder.Open( path, NULL, 0 ) );
+		for ( int f = 0; f < BENCH_FRAMES; f++ )
+		{
+			cloud.Process( &frames[f][0], calibration );
+			recorder.Write( 1, f, 0, cloud );
+		}
+		TEST_CHECK( S_OK == recorder.Open( path, NULL, 0 ) );
+		std::vector< std::vector<float> > recorded( BENCH_FRAMES );
+		double recording = 0.0;
+		for ( int f = 0; f < BENCH_FRAMES; f++ )
+		{
+			cloud.Process( &frames[f][0], calibration );
+			recorded[f].assign( cloud.GetBuffer(), cloud.GetBuffer() + 3 * cloud.GetCount() );
+
+			start = ThreadNow();
+			TEST_CHECK( S_OK == recorder.Write( 1, f, 1000LL * f, cloud ) );
+			recording += ThreadNow() - start;
+		}
+		recorder.Close();
+		TEST_CHECK( !recorder.IsOpen() );
+		TEST_CHECK( 0 == recorder.GetDroppedCount() );
+		TEST_CHECK( ReadBack( path, recorded ) );
+
+		printf( " %8.0f %8.0f\n", recording / BENCH_FRAMES / 1000.0, cloud.GetBufferSize() / 1024.0 );
+	}
+
+	// a file that cannot be written stops the recording on its own
+	PointCloud cloud;
+	std::vector<USHORT> frame;
+	MakeFrame( 0, 320, 240, frame );
+	cloud.Initialize( 320, 240 );
+	cloud.Process( &frame[0], calibration );
+	PointCloudRecorder full;
+	if ( S_OK == full.Open( "/dev/full", NULL, 0 ) )
+	{
+		for ( int i = 0; i < 1000 && full.IsOpen(); i++ )
+		{
+			full.Write( 0, i, 0, cloud );
+			Sleep( 1 );
+		}
+		TEST_CHECK( !full.IsOpen() );
+		TEST_CHECK( S_FALSE == full.Write( 0, 0, 0, cloud ) );
+		full.Close();
+	}
+
+	unlink( path );
+	return TestResult();
+}
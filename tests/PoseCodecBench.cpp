@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseCodecBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Bytes per frame of each stream that can be sent compact, as floats and with PoseCodec.h,
+// for a person standing and one walking, and what encoding and decoding a frame cost. Every
+// decoded value must be within half a millimetre of the one encoded.
+
+#include "PoseCodec.h"
+#include "TestCheck.h"
+#include <vector>
+
+// Largest error of a value rounded to whole millimetres, in inches
+static const double g_Rounding = 0.5 / POSE_CODEC_UNITS_PER_INCH + 1e-5;
+
+/// <summary>
+/// How the joints move, in inches and seconds
+/// </summary>
+struct BenchMotion
+{
+	const char *    pName;
+	float           speed;          // top walking speed, back and forth along x
+	float           swing;          // amplitude of the limbs' swing
+	float           sway;           // amplitude of the whole body's sway
+};
+
+static const BenchMotion g_Motions[] =
+{
+	{ "standing",   0.0f,   0.5f,   1.5f },
+	{ "walking",    40.0f,  8.0f,   1.0f },
+};
+
+static const unsigned int g_Streams[] =
+{
+	SUBSCRIBER_STREAM_EYES, SUBSCRIBER_STREAM_USER, SUBSCRIBER_STREAM_UPPER, SUBSCRIBER_STREAM_SKELETON
+};
+
+static const char * g_StreamNames[] = { "eyes", "user", "upper", "skeleton" };
+
+/// <summary>
+/// The values of one frame: x, y, z per joint, each joint swinging with its own phase
+/// </summary>
+static void MakeFrame( const BenchMotion & motion, int count, int frame, float * pValues )
+{
+	float t = frame / 30.0f;
+	for ( int i = 0; i < count; i += 3 )
+	{
+		float phase = i * 0.37f;
+		float swing = motion.swing * sinf( 6.2831853f * t + phase );
+		float sway = motion.sway * sinf( 2.5132741f * t );
+		pValues[i] = 60.0f * sinf( motion.speed / 60.0f * t ) + sway + swing + i;
+		pValues[i + 1] = 40.0f - i * 0.8f + 0.3f * swing;
+		pValues[i + 2] = 80.0f + 0.5f * sway + 0.2f * swing;
+	}
+}
+
+/// <summary>
+/// Encode and decode frames of one stream
+/// </summary>
+/// <param name="frames">frames to run</param>
+static void BenchStream( const BenchMotion & motion, unsigned int stream, const char * pName, int frames )
+{
+	int count = PoseStreamValueCount( stream );
+	std::vector<float> values( static_cast<size_t>(frames) * count );
+	for ( int frame = 0; frame < frames; frame++ )
+	{
+		MakeFrame( motion, count, frame, &values[static_cast<size_t>(frame) * count] );
+	}
+
+	// the payloads of every frame, one after the other, encoded in one pass then decoded in one
+	std::vector<unsigned char> payloads( static_cast<size_t>(frames) * count * 2 );
+	std::vector<int> sizes( frames );
+	std::vector<unsigned int> encodings( frames );
+	std::vector<unsigned int> distances( frames );
+
+	PoseEncoder encoder;
+	long long bytes = 0;
+	int keyframes = 0;
+	double start = TestNow();
+	for ( int frame = 0; frame < frames; frame++ )
+	{
+		sizes[frame] = encoder.Encode( &values[static_cast<size_t>(frame) * count], count, &payloads[bytes], encodings[frame], distances[frame] );
+		bytes += sizes[frame];
+	}
+	double encode = ( TestNow() - start ) / frames;
+
+	PoseDecoder decoder;
+	float decoded[POSE_CODEC_MAX_VALUES];
+	double error = 0.0;
+	int lost = 0;
+	long long offset = 0;
+	start = TestNow();
+	for ( int frame = 0; frame < frames; frame++ )
+	{
+		if ( count != decoder.Decode( frame, encodings[frame], distances[frame], &payloads[offset], sizes[frame], decoded ) )
+		{
+			lost++;
+		}
+		TestKeep( decoded[0] );
+		offset += sizes[frame];
+	}
+	double decode = ( TestNow() - start ) / frames;
+
+	// checked apart from the timing
+	decoder.Reset();
+	offset = 0;
+	for ( int frame = 0; frame < frames; frame++ )
+	{
+		decoder.Decode( frame, encodings[frame], distances[frame], &payloads[offset], sizes[frame], decoded );
+		const float * pExpected = &values[static_cast<size_t>(frame) * count];
+		for ( int i = 0; i < count; i++ )
+		{
+			error = fmax( error, fabs( static_cast<double>( decoded[i] ) - pExpected[i] ) );
+		}
+		keyframes += ( POSE_ENCODING_KEYFRAME == encodings[frame] ) ? 1 : 0;
+		offset += sizes[frame];
+	}
+
+	double floatBytes = POSE_PACKET_HEADER_SIZE + PoseCodecPayloadSize( POSE_ENCODING_FLOAT, count );
+	double compactBytes = POSE_PACKET_HEADER_SIZE + static_cast<double>(bytes) / frames;
+	printf( "%-9s %-9s %7.0f %8.1f %9.0f%% %10.1f %10.1f %10.4f\n", motion.pName, pName, floatBytes, compactBytes,
+			100.0 * keyframes / frames, encode, decode, error );
+
+	TEST_CHECK( 0 == lost );
+	TEST_CHECK_NEAR( error, 0.0, g_Rounding );
+	TEST_CHECK( compactBytes < floatBytes );
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int frames = quick ? 300 : 100000;
+
+	printf( "bytes per datagram with the header, keyframes among them, ns per frame, largest error in inches\n" );
+	printf( "%-9s %-9s %7s %8s %10s %10s %10s %10s\n", "motion", "stream", "floats", "compact", "keyframes", "encode", "decode", "error" );
+	for ( size_t motion = 0; motion < sizeof(g_Motions) / sizeof(g_Motions[0]); motion++ )
+	{
+		for ( size_t stream = 0; stream < sizeof(g_Streams) / sizeof(g_Streams[0]); stream++ )
+		{
+			TEST_CHECK( PoseStreamIsCompactable( g_Streams[stream] ) );
+			BenchStream( g_Motions[motion], g_Streams[stream], g_StreamNames[stream], frames );
+		}
+	}
+	return TestResult();
+}
@@ -0,0 +1,414 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseReceiverTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Harness for PoseReceiver.h: a sender that sequences, rate limits and encodes the way
+// DestinationTable::Send does, and a simulated network that loses, reorders, duplicates and
+// delays its datagrams. The poses are points moving at constant speed, so what the receiver
+// interpolates can be checked against where the points really were.
+
+#include "PoseReceiver.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <vector>
+
+// Tracker frame period, microseconds
+static const double g_FramePeriod = 1000000.0 / 30.0;
+
+// Receiver clock minus tracker clock, ms, anything will do
+static const double g_ClockOffset = 123456.0;
+
+// Network delay every datagram has, ms, and sensor capture to send, microseconds
+static const double g_BaseDelay = 2.0;
+static const unsigned int g_CaptureToSend = 12000;
+
+/// <summary>
+/// One datagram on its way
+/// </summary>
+struct TestDatagram
+{
+	unsigned char   bytes[POSE_PACKET_HEADER_SIZE + POSE_CODEC_MAX_VALUES * 4];
+	int             size;
+	int             frame;          // tracker frame it carries
+	double          arrivalTime;    // receiver clock, ms
+};
+
+/// <summary>
+/// Deterministic random numbers, so a failure can be replayed
+/// </summary>
+class TestRandom
+{
+public:
+	explicit TestRandom( unsigned int seed ) : m_state(seed) {}
+
+	/// <returns>uniform in [0, 1)</returns>
+	double Next( )
+	{
+		m_state = m_state * 1664525u + 1013904223u;
+		return ( m_state >> 8 ) / 16777216.0;
+	}
+
+private:
+	unsigned int m_state;
+};
+
+/// <summary>
+/// How the sender and the network treat the stream
+/// </summary>
+struct TestLink
+{
+	int             frameInterval;  // frames between two sends, the rate limit
+	bool            compact;
+	double          lossRate;
+	double          jitter;         // ms of random delay on top of g_BaseDelay, reorders when above a frame
+	double          duplicateRate;
+	unsigned int    firstCapture;   // tracker clock of frame 0, microseconds, low 32 bits
+};
+
+/// <summary>
+/// Where value i of the pose is at a time, inches, the points move at constant speed
+/// </summary>
+/// <param name="i">value index</param>
+/// <param name="time">seconds since frame 0</param>
+static float TestValue( int i, double time )
+{
+	double speed = ( 1 + i % 3 ) * ( ( i & 1 ) ? -4.0 : 4.0 );
+	return static_cast<float>( 10.0 * i + speed * time );
+}
+
+/// <summary>
+/// Send frames of the eyes stream over a link, as they arrive at the receiver
+/// </summary>
+/// <param name="link">how the stream is sent and carried</param>
+/// <param name="frames">tracker frames to capture</param>
+/// <param name="seed">seed of the loss, jitter and duplicates</param>
+/// <param name="arrivals">receives the datagrams in the order they arrive</param>
+/// <param name="sent">receives how many datagrams were sent, before any loss</param>
+static void Transmit( const TestLink & link, int frames, unsigned int seed, std::vector<TestDatagram> & arrivals, int & sent )
+{
+	TestRandom random( seed );
+	PoseEncoder encoder;
+	unsigned int sequence = 0;
+	sent = 0;
+	arrivals.clear();
+
+	for ( int frame = 0; frame < frames; frame += link.frameInterval )
+	{
+		float values[SUBSCRIBER_STREAM_EYES_VALUES];
+		for ( int i = 0; i < SUBSCRIBER_STREAM_EYES_VALUES; i++ )
+		{
+			values[i] = TestValue( i, frame * g_FramePeriod / 1000000.0 );
+		}
+
+		// the same header and payload DestinationTable::Send builds, sequence numbers only count sends
+		TestDatagram datagram;
+		unsigned int capture = link.firstCapture + static_cast<unsigned int>( frame * g_FramePeriod + 0.5 );
+		unsigned int encoding = POSE_ENCODING_FLOAT;
+		unsigned int keyframeDistance = 0;
+		int size = sizeof(values);
+		if ( link.compact )
+		{
+			size = encoder.Encode( values, SUBSCRIBER_STREAM_EYES_VALUES, datagram.bytes + POSE_PACKET_HEADER_SIZE, encoding, keyframeDistance );
+		}
+		else
+		{
+			memcpy( datagram.bytes + POSE_PACKET_HEADER_SIZE, values, size );
+		}
+		PosePacketWriteHeader( datagram.bytes, sequence++, SUBSCRIBER_STREAM_EYES, encoding, keyframeDistance );
+		PosePacketWriteTiming( datagram.bytes, capture + g_CaptureToSend, g_CaptureToSend );
+		datagram.size = POSE_PACKET_HEADER_SIZE + size;
+		datagram.frame = frame;
+		sent++;
+
+		// the first one always arrives, so every test knows where the stream starts
+		if ( frame > 0 && random.Next() < link.lossRate )
+		{
+			continue;
+		}
+
+		double sendTime = ( frame * g_FramePeriod + g_CaptureToSend ) / 1000.0;
+		datagram.arrivalTime = g_ClockOffset + sendTime + g_BaseDelay + random.Next() * link.jitter;
+		arrivals.push_back( datagram );
+
+		if ( random.Next() < link.duplicateRate )
+		{
+			datagram.arrivalTime += random.Next() * link.jitter;
+			arrivals.push_back( datagram );
+		}
+	}
+
+	struct ByArrival
+	{
+		bool operator()( const TestDatagram & a, const TestDatagram & b ) const { return a.arrivalTime < b.arrivalTime; }
+	};
+	std::stable_sort( arrivals.begin(), arrivals.end(), ByArrival() );
+}
+
+/// <summary>
+/// Receiver clock a tracker frame time shows up at, for a receiver that saw the fastest possible arrival
+/// </summary>
+/// <param name="time">seconds since frame 0</param>
+static double TestReceiverTime( double time )
+{
+	return g_ClockOffset + time * 1000.0 + g_CaptureToSend / 1000.0 + g_BaseDelay;
+}
+
+/// <summary>
+/// Play a link into a receiver, rendering between the arrivals, and check the poses
+/// </summary>
+/// <param name="link">how the stream is sent and carried</param>
+/// <param name="seed">seed of the network</param>
+/// <param name="stats">receives the receiver's counters</param>
+/// <param name="sent">receives the datagrams sent</param>
+static void Render( const TestLink & link, unsigned int seed, PoseReceiverStats & stats, int & sent )
+{
+	std::vector<TestDatagram> arrivals;
+	Transmit( link, 900, seed, arrivals, sent );
+
+	PoseReceiver receiver( SUBSCRIBER_STREAM_EYES );
+
+	// far enough in the past to interpolate between two sends despite the jitter
+	double renderDelay = link.frameInterval * g_FramePeriod / 1000.0 + link.jitter + 20.0;
+
+	// the offset follows the fastest arrival it saw, so the poses lag by at most the jitter,
+	// and the codec rounds to millimetres
+	double lag = ( link.jitter + 1.0 ) / 1000.0;
+	double tolerance = 12.0 * lag + ( link.compact ? 0.5 / POSE_CODEC_UNITS_PER_INCH : 0.0 ) + 1e-3;
+
+	int checked = 0;
+	for ( size_t i = 0; i < arrivals.size(); i++ )
+	{
+		const TestDatagram & datagram = arrivals[i];
+		receiver.Receive( datagram.bytes, datagram.size, datagram.arrivalTime );
+
+		// after a second, the offset has seen a fast arrival
+		double renderTime = datagram.arrivalTime - renderDelay;
+		if ( datagram.frame < 30 || renderTime < TestReceiverTime( 1.0 ) )
+		{
+			continue;
+		}
+
+		float pose[SUBSCRIBER_STREAM_EYES_VALUES];
+		float later[SUBSCRIBER_STREAM_EYES_VALUES];
+		PoseSampleResult result = receiver.GetPose( renderTime, pose );
+		if ( POSE_INTERPOLATED != result )
+		{
+			// only a lost compact keyframe, which takes the deltas up to the next one with it,
+			// opens a gap longer than the render delay
+			TEST_CHECK( link.compact && POSE_EXTRAPOLATED == result );
+			continue;
+		}
+		receiver.GetPose( renderTime + 20.0, later );
+
+		// where the points were when the pose was captured, give or take the lag
+		double time = ( renderTime - TestReceiverTime( 0.0 ) ) / 1000.0;
+		for ( int v = 0; v < SUBSCRIBER_STREAM_EYES_VALUES; v++ )
+		{
+			TEST_CHECK_NEAR( pose[v], TestValue( v, time ), tolerance );
+
+			// the timeline runs as fast as the tracker's, whatever the rate limit: 20 ms of
+			// receiver clock is 20 ms of motion
+			double speed = ( TestValue( v, 1.0 ) - TestValue( v, 0.0 ) );
+			TEST_CHECK_NEAR( ( later[v] - pose[v] ) / 0.020, speed, 0.05 * fabs( speed ) + 2.0 * tolerance / 0.020 );
+		}
+		checked++;
+	}
+
+	TEST_CHECK( checked > 100 );
+	stats = receiver.GetStats();
+}
+
+/// <summary>
+/// A receiver fed by hand, for the counters
+/// </summary>
+class TestFeed
+{
+public:
+	TestFeed( ) : m_receiver( SUBSCRIBER_STREAM_EYES )
+	{
+		TestLink link = { 1, false, 0.0, 0.0, 0.0, 5000000 };
+		int sent;
+		Transmit( link, 64, 1, m_datagrams, sent );
+	}
+
+	bool Deliver( int frame, double arrivalTime = -1.0 )
+	{
+		const TestDatagram & datagram = m_datagrams[frame];
+		return m_receiver.Receive( datagram.bytes, datagram.size, arrivalTime < 0.0 ? datagram.arrivalTime : arrivalTime );
+	}
+
+	const PoseReceiverStats & Stats( ) const { return m_receiver.GetStats(); }
+	PoseReceiver & Receiver( ) { return m_receiver; }
+	double ArrivalTime( int frame ) const { return m_datagrams[frame].arrivalTime; }
+
+private:
+	PoseReceiver                m_receiver;
+	std::vector<TestDatagram>   m_datagrams;
+};
+
+/// <summary>
+/// Gaps, reordering, duplicates and late arrivals are each counted once
+/// </summary>
+static void TestCounters( )
+{
+	TestFeed feed;
+
+	// 5, 9 and 10 lost; 8 arrives after 11; 3 arrives twice
+	for ( int frame = 0; frame < 12; frame++ )
+	{
+		if ( 5 != frame && 8 != frame && 9 != frame && 10 != frame )
+		{
+			TEST_CHECK( feed.Deliver( frame ) );
+		}
+	}
+	TEST_CHECK( 4 == feed.Stats().lost );
+	TEST_CHECK( feed.Deliver( 8, feed.ArrivalTime( 11 ) + 1.0 ) );
+	TEST_CHECK( !feed.Deliver( 3 ) );
+
+	const PoseReceiverStats & stats = feed.Stats();
+	TEST_CHECK( 3 == stats.lost );
+	TEST_CHECK( 1 == stats.reordered );
+	TEST_CHECK( 1 == stats.duplicates );
+	TEST_CHECK( 0 == stats.late );
+	TEST_CHECK( 10 == stats.received );
+
+	// frame 5 comes back once it has dropped out of the buffer: too late, and still lost
+	for ( int frame = 12; frame < 12 + POSE_RECEIVER_DEPTH; frame++ )
+	{
+		feed.Deliver( frame );
+	}
+	TEST_CHECK( !feed.Deliver( 5 ) );
+	TEST_CHECK( 1 == feed.Stats().late );
+	TEST_CHECK( 3 == feed.Stats().lost );
+}
+
+/// <summary>
+/// Random loss, jitter that reorders, and duplicates, sending every frame
+/// </summary>
+static void TestEveryFrame( )
+{
+	TestLink link = { 1, false, 0.1, 45.0, 0.05, 7000000 };
+	PoseReceiverStats stats;
+	int sent;
+	Render( link, 2, stats, sent );
+
+	// every sequence number is either kept or lost, the late ones stay lost
+	unsigned long long kept = stats.received - stats.duplicates - stats.late;
+	TEST_CHECK( kept + stats.lost == static_cast<unsigned long long>(sent) );
+	TEST_CHECK( stats.reordered > 0 );
+	TEST_CHECK( stats.duplicates > 0 );
+	TEST_CHECK( stats.lost >= static_cast<unsigned long long>( sent / 20 ) );
+}
+
+/// <summary>
+/// A destination limited to 10 packets per second: the sequence numbers only count what is
+/// sent, the poses still follow the capture times
+/// </summary>
+static void TestThrottled( )
+{
+	TestLink link = { 3, false, 0.05, 30.0, 0.0, 7000000 };
+	PoseReceiverStats stats;
+	int sent;
+	Render( link, 3, stats, sent );
+
+	TEST_CHECK( stats.received - stats.late + stats.lost == static_cast<unsigned long long>(sent) );
+}
+
+/// <summary>
+/// Compact keyframes and deltas, rate limited, with loss: a lost keyframe costs the deltas after it,
+/// which are counted lost as well as undecodable
+/// </summary>
+static void TestCompact( )
+{
+	TestLink link = { 2, true, 0.08, 20.0, 0.0, 7000000 };
+	PoseReceiverStats stats;
+	int sent;
+	Render( link, 4, stats, sent );
+
+	TEST_CHECK( stats.undecodable > 0 && stats.undecodable < stats.lost );
+	TEST_CHECK( stats.received - stats.late + stats.lost == static_cast<unsigned long long>(sent) );
+}
+
+/// <summary>
+/// The tracker's 32-bit microsecond clock wraps in the middle of the stream
+/// </summary>
+static void TestClockWrap( )
+{
+	TestLink link = { 1, false, 0.05, 20.0, 0.0, 0xFFFFFFFFu - 15000000u };
+	PoseReceiverStats stats;
+	int sent;
+	Render( link, 5, stats, sent );
+
+	TEST_CHECK( 0 == stats.resyncs );
+}
+
+/// <summary>
+/// A restarted tracker starts its sequence numbers over
+/// </summary>
+static void TestRestart( )
+{
+	TestFeed feed;
+	for ( int frame = 0; frame < 40; frame++ )
+	{
+		feed.Deliver( frame );
+	}
+	TEST_CHECK( POSE_RECEIVER_DEPTH == feed.Receiver().GetBufferedCount() );
+
+	// sequence 0 again after 40, well within POSE_RECEIVER_RESYNC, is taken as a reordered
+	// old frame; a jump beyond it restarts
+	TestLink link = { 1, false, 0.0, 0.0, 0.0, 9000000 };
+	std::vector<TestDatagram> restarted;
+	int sent;
+	Transmit( link, 1, 1, restarted, sent );
+	PosePacketWriteHeader( restarted[0].bytes, 40 + POSE_RECEIVER_RESYNC + 1, SUBSCRIBER_STREAM_EYES );
+
+	TEST_CHECK( feed.Receiver().Receive( restarted[0].bytes, restarted[0].size, feed.ArrivalTime( 39 ) + 5000.0 ) );
+	TEST_CHECK( 1 == feed.Stats().resyncs );
+	TEST_CHECK( 1 == feed.Receiver().GetBufferedCount() );
+}
+
+/// <summary>
+/// Datagrams without the header are placed at their arrival time
+/// </summary>
+static void TestPlain( )
+{
+	PoseReceiver receiver( SUBSCRIBER_STREAM_EYES );
+	float values[SUBSCRIBER_STREAM_EYES_VALUES];
+	float pose[SUBSCRIBER_STREAM_EYES_VALUES];
+
+	TEST_CHECK( POSE_NONE == receiver.GetPose( 0.0, pose ) );
+
+	for ( int frame = 0; frame < 4; frame++ )
+	{
+		for ( int i = 0; i < SUBSCRIBER_STREAM_EYES_VALUES; i++ )
+		{
+			values[i] = static_cast<float>( frame * 10 );
+		}
+		TEST_CHECK( receiver.Receive( values, sizeof(values), 1000.0 + frame * 40.0 ) );
+	}
+
+	TEST_CHECK( POSE_INTERPOLATED == receiver.GetPose( 1000.0 + 50.0, pose ) );
+	TEST_CHECK_NEAR( pose[0], 12.5, 1e-4 );
+	TEST_CHECK( POSE_EXTRAPOLATED == receiver.GetPose( 1000.0 + 140.0, pose ) );
+	TEST_CHECK_NEAR( pose[0], 35.0, 1e-4 );
+	TEST_CHECK( POSE_HELD == receiver.GetPose( 900.0, pose ) );
+	TEST_CHECK_NEAR( pose[0], 0.0, 1e-6 );
+
+	// another stream's datagram is ignored
+	float user[SUBSCRIBER_STREAM_USER_VALUES] = { 0 };
+	TEST_CHECK( !receiver.Receive( user, sizeof(user), 2000.0 ) );
+}
+
+int main( )
+{
+	TestCounters();
+	TestEveryFrame();
+	TestThrottled();
+	TestCompact();
+	TestClockWrap();
+	TestRestart();
+	TestPlain();
+	return TestResult();
+}
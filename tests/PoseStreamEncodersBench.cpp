@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------------
+// <copyright file="PoseStreamEncodersBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Cost of filling each stream with the encoders of PoseStreamEncoders.cpp, next to a loop
+// over a list of joint indices read at run time, which is what the compile time lists
+// replace. Both must give the same values.
+
+#include "stdafx.h"
+#include "PoseStreamEncoders.h"
+#include "TestCheck.h"
+
+/// <summary>
+/// A stream as a list of joints read at run time
+/// </summary>
+struct BenchProfile
+{
+	const char *    pName;
+	unsigned int    stream;
+	bool            eyes;           // the eyes come first
+	const int *     pJoints;        // NULL for the bones
+	int             jointCount;
+};
+
+static const int g_UserJoints[] = { NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT };
+
+static const int g_UpperJoints[] =
+{
+	NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SPINE,
+	NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT,
+	NUI_SKELETON_POSITION_HAND_LEFT, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT,
+	NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT
+};
+
+static const int g_SkeletonJoints[] =
+{
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19
+};
+
+static const BenchProfile g_Profiles[] =
+{
+	{ "eyes",       SUBSCRIBER_STREAM_EYES,     true,   NULL,               0 },
+	{ "user",       SUBSCRIBER_STREAM_USER,     true,   g_UserJoints,       2 },
+	{ "upper",      SUBSCRIBER_STREAM_UPPER,    false,  g_UpperJoints,      11 },
+	{ "skeleton",   SUBSCRIBER_STREAM_SKELETON, false,  g_SkeletonJoints,   NUI_SKELETON_POSITION_COUNT },
+	{ "bones",      SUBSCRIBER_STREAM_BONES,    false,  NULL,               0 },
+};
+
+/// <summary>
+/// Fill a stream by walking its joint list, with a loop and the joint index from memory
+/// </summary>
+static void EncodeByIndex( const BenchProfile & profile, const PoseStreamInput & input, float * pOut )
+{
+	if ( SUBSCRIBER_STREAM_BONES == profile.stream )
+	{
+		for ( int i = 0; i < SUBSCRIBER_STREAM_BONES_VALUES; i++ )
+		{
+			pOut[i] = input.pBones[i];
+		}
+		return;
+	}
+
+	if ( profile.eyes )
+	{
+		for ( int i = 0; i < SUBSCRIBER_STREAM_EYES_VALUES; i++ )
+		{
+			*pOut++ = input.pEyes[i];
+		}
+	}
+	for ( int i = 0; i < profile.jointCount; i++ )
+	{
+		int joint = profile.pJoints[i];
+		*pOut++ = input.pX[joint];
+		*pOut++ = input.pY[joint];
+		*pOut++ = input.pZ[joint];
+	}
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int rounds = quick ? 10000 : 20000000;
+
+	float x[NUI_SKELETON_POSITION_COUNT];
+	float y[NUI_SKELETON_POSITION_COUNT];
+	float z[NUI_SKELETON_POSITION_COUNT];
+	float eyes[SUBSCRIBER_STREAM_EYES_VALUES];
+	float bones[SUBSCRIBER_STREAM_BONES_VALUES];
+	for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+	{
+		x[j] = 1.0f + j;
+		y[j] = 100.0f + j;
+		z[j] = 1000.0f + j;
+	}
+	for ( int i = 0; i < SUBSCRIBER_STREAM_EYES_VALUES; i++ )
+	{
+		eyes[i] = -1.0f - i;
+	}
+	for ( int i = 0; i < SUBSCRIBER_STREAM_BONES_VALUES; i++ )
+	{
+		bones[i] = 0.01f * i;
+	}
+	PoseStreamInput input = { x, y, z, eyes, bones };
+
+	printf( "ns per frame:  compile time list  joint loop\n" );
+	double total = 0.0;
+	double totalLoop = 0.0;
+	for ( size_t p = 0; p < sizeof(g_Profiles) / sizeof(g_Profiles[0]); p++ )
+	{
+		const BenchProfile & profile = g_Profiles[p];
+		PoseStreamEncoder encoder = PoseStreamGetEncoder( profile.stream );
+		int count = PoseStreamValueCount( profile.stream );
+
+		float out[SUBSCRIBER_STREAM_MAX_VALUES];
+		float expected[SUBSCRIBER_STREAM_MAX_VALUES];
+		memset( out, 0, sizeof(out) );
+		memset( expected, 0, sizeof(expected) );
+		TEST_CHECK( NULL != encoder );
+		encoder( input, out );
+		EncodeByIndex( profile, input, expected );
+		TEST_CHECK( 0 == memcmp( out, expected, count * sizeof(float) ) );
+
+		// the input moves a little every frame, as a person does
+		double start = TestNow();
+		for ( int r = 0; r < rounds; r++ )
+		{
+			x[r % NUI_SKELETON_POSITION_COUNT] += 1.0f;
+			encoder( input, out );
+			TestKeep( out[r % count] );
+		}
+		double templated = ( TestNow() - start ) / rounds;
+
+		start = TestNow();
+		for ( int r = 0; r < rounds; r++ )
+		{
+			x[r % NUI_SKELETON_POSITION_COUNT] += 1.0f;
+			EncodeByIndex( profile, input, out );
+			TestKeep( out[r % count] );
+		}
+		double loop = ( TestNow() - start ) / rounds;
+
+		printf( "  %-10s %10.1f %11.1f\n", profile.pName, templated, loop );
+		total += templated;
+		totalLoop += loop;
+	}
+	printf( "  %-10s %10.1f %11.1f\n", "all", total, totalLoop );
+
+	TEST_CHECK( NULL == PoseStreamGetEncoder( SUBSCRIBER_STREAM_COUNT ) );
+	return TestResult();
+}
@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionBatchBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Cost of each operation of QuaternionBatch.h per quaternion, with irr::core::quaternion
+// one at a time, quaternion4 and quaternion8, over a batch that stays in the cache as the
+// bones of every user do. SlerpFast and Nlerp are set against quaternion's slerp, the one
+// they replace.
+
+#include "QuaternionKernels.h"
+#include "TestCheck.h"
+
+/// <summary>
+/// One row of the table
+/// </summary>
+struct BenchOperation
+{
+	const char *                        pName;
+	QuaternionKernel QuaternionKernels::* kernel;
+	QuaternionKernel QuaternionKernels::* irrKernel;   // what quaternion does instead
+};
+
+static const BenchOperation g_Operations[] =
+{
+	{ "Multiply",       &QuaternionKernels::multiply,       &QuaternionKernels::multiply },
+	{ "Conjugate",      &QuaternionKernels::conjugate,      &QuaternionKernels::conjugate },
+	{ "Normalize",      &QuaternionKernels::normalize,      &QuaternionKernels::normalize },
+	{ "RotateVector",   &QuaternionKernels::rotateVector,   &QuaternionKernels::rotateVector },
+	{ "GetMatrix",      &QuaternionKernels::getMatrix,      &QuaternionKernels::getMatrix },
+	{ "FromMatrix",     &QuaternionKernels::fromMatrix,     &QuaternionKernels::fromMatrix },
+	{ "Slerp",          &QuaternionKernels::slerp,          &QuaternionKernels::slerp },
+	{ "SlerpFast",      &QuaternionKernels::slerpFast,      &QuaternionKernels::slerp },
+	{ "Nlerp",          &QuaternionKernels::nlerp,          &QuaternionKernels::slerp },
+};
+
+/// <summary>
+/// Time an operation over the batch, best of a few runs
+/// </summary>
+/// <param name="kernel">the operation, NULL for none</param>
+/// <param name="rounds">times the batch goes through it in a run</param>
+/// <returns>ns per quaternion, 0 if there is no such operation</returns>
+static double BenchKernel( QuaternionKernel kernel, const QuaternionSamples & samples, int rounds )
+{
+	if ( NULL == kernel )
+	{
+		return 0.0;
+	}
+
+	static float result[9][QUATERNION_SAMPLES];
+	double best = 1e30;
+	for ( int run = 0; run < 5; run++ )
+	{
+		double start = TestNow();
+		for ( int i = 0; i < rounds; i++ )
+		{
+			kernel( samples, result );
+			TestKeep( result[0][i % QUATERNION_SAMPLES] );
+		}
+		best = fmin( best, ( TestNow() - start ) / ( static_cast<double>(rounds) * QUATERNION_SAMPLES ) );
+	}
+	return best;
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int rounds = quick ? 20 : 20000;
+	bool avx = QuaternionKernelsHaveAvx();
+
+	// rotations up to about 55 degrees apart, like a bone from one frame to the next
+	QuaternionSamples * pSamples = new QuaternionSamples;
+	unsigned int seed = 49;
+	QuaternionSamplesFill( *pSamples, seed, 0.3f );
+
+	printf( "ns per quaternion, %d at a time:\n", QUATERNION_SAMPLES );
+	printf( "%-14s %11s %11s %11s %9s %9s\n", "", "quaternion", "quaternion4", "quaternion8", "4 faster", "8 faster" );
+	for ( size_t op = 0; op < sizeof(g_Operations) / sizeof(g_Operations[0]); op++ )
+	{
+		const BenchOperation & operation = g_Operations[op];
+		double irr = BenchKernel( g_QuaternionKernelsIrr.*operation.irrKernel, *pSamples, rounds );
+		double four = BenchKernel( g_QuaternionKernels4.*operation.kernel, *pSamples, rounds );
+		double eight = avx ? BenchKernel( g_QuaternionKernels8.*operation.kernel, *pSamples, rounds ) : 0.0;
+
+		printf( "%-14s %11.2f %11.2f ", operation.pName, irr, four );
+		if ( eight > 0.0 )
+		{
+			printf( "%11.2f %8.1fx %8.1fx\n", eight, irr / four, irr / eight );
+		}
+		else
+		{
+			printf( "%11s %8.1fx %9s\n", "-", irr / four, "-" );
+		}
+		TEST_CHECK( irr > 0.0 && four > 0.0 );
+	}
+	if ( !avx )
+	{
+		printf( "no AVX here, quaternion8 not measured\n" );
+	}
+
+	delete pSamples;
+	return TestResult();
+}
@@ -0,0 +1,298 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionBatchTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Tests quaternion4 in QuaternionBatch.h and quaternion8 in QuaternionBatch8.h against
+// irr::core::quaternion, lane by lane over random quaternions: each operation must stay
+// within twice the error QuaternionBatch.h documents, and the interpolations within twice
+// theirs of an exact slerp. quaternion8 must also give the same bits as quaternion4; where
+// there is no AVX it is skipped. Prints the largest error of each.
+
+#include "QuaternionBatch.h"
+#include "QuaternionKernels.h"
+#include "TestCheck.h"
+
+// Batches of QUATERNION_SAMPLES drawn at each spread
+static const int g_Batches = 100;
+
+// How far "to" is from "from" in the batches: unrelated, up to about 55 degrees, 16 degrees,
+// and close enough for slerp to blend linearly
+static const float g_Spreads[] = { QUATERNION_SPREAD_ANY, 0.3f, 0.08f, 0.02f };
+
+/// <summary>
+/// Largest error of an operation over every sample
+/// </summary>
+struct TestError
+{
+	TestError() : largest( 0.0 ) {}
+
+	void Add( double error )
+	{
+		largest = fmax( largest, error );
+	}
+
+	double largest;
+};
+
+/// <summary>
+/// Print the largest error and check it against the tolerance
+/// </summary>
+static void Report( const char * pName, const TestError & error, double tolerance )
+{
+	printf( "  %-40s %10.3g (within %g)\n", pName, error.largest, tolerance );
+	TestCheckNear( error.largest, 0.0, tolerance, pName, __FILE__, __LINE__ );
+}
+
+// Rows of each kind of result
+#define TEST_QUATERNION_ROWS            4
+#define TEST_VECTOR_ROWS                3
+#define TEST_MATRIX_ROWS                9
+
+/// <summary>
+/// Largest difference of any row between two results at sample i
+/// </summary>
+static double Distance( const float a[][QUATERNION_SAMPLES], const float b[][QUATERNION_SAMPLES], int rows, int i )
+{
+	double distance = 0.0;
+	for ( int k = 0; k < rows; k++ )
+	{
+		distance = fmax( distance, fabs( static_cast<double>( a[k][i] ) - b[k][i] ) );
+	}
+	return distance;
+}
+
+/// <summary>
+/// Quaternion i of a result, negated if that brings it nearer to q: the same rotation
+/// </summary>
+static irr::core::quaternion Nearest( const float rows[][QUATERNION_SAMPLES], int i, const irr::core::quaternion & q )
+{
+	irr::core::quaternion r( rows[0][i], rows[1][i], rows[2][i], rows[3][i] );
+	return ( r.dotProduct( q ) < 0.0f ) ? r * -1.0f : r;
+}
+
+/// <summary>
+/// Every operation of one implementation against irr::core::quaternion, or against an
+/// exact slerp where quaternion has no match
+/// </summary>
+static void TestKernels( const QuaternionKernels & kernels )
+{
+	const QuaternionKernels & irr = g_QuaternionKernelsIrr;
+	TestError multiply, conjugate, normalize, rotateVector, getMatrix, fromMatrix, fromMatrixIrr, slerp;
+	TestError slerpFast90, slerpFast120, slerpFast180, nlerp, nlerp10, nlerp90;
+	QuaternionSamples * pSamples = new QuaternionSamples;
+	QuaternionSamples & samples = *pSamples;
+	float result[TEST_MATRIX_ROWS][QUATERNION_SAMPLES];
+	float expected[TEST_MATRIX_ROWS][QUATERNION_SAMPLES];
+	unsigned int seed = 48;
+
+	for ( size_t spread = 0; spread < sizeof(g_Spreads) / sizeof(g_Spreads[0]); spread++ )
+	{
+		for ( int batch = 0; batch < g_Batches; batch++ )
+		{
+			QuaternionSamplesFill( samples, seed, g_Spreads[spread] );
+
+			kernels.multiply( samples, result );
+			irr.multiply( samples, expected );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				multiply.Add( Distance( result, expected, TEST_QUATERNION_ROWS, i ) );
+			}
+
+			kernels.conjugate( samples, result );
+			irr.conjugate( samples, expected );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				conjugate.Add( Distance( result, expected, TEST_QUATERNION_ROWS, i ) );
+			}
+
+			// quaternion divides by a length of 0, quaternion4 makes it the identity
+			kernels.normalize( samples, result );
+			irr.normalize( samples, expected );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				if ( 0.0f == samples.scaledQ[i].dotProduct( samples.scaledQ[i] ) )
+				{
+					TEST_CHECK( 0.0f == result[0][i] && 0.0f == result[1][i] && 0.0f == result[2][i] && 1.0f == result[3][i] );
+				}
+				else
+				{
+					normalize.Add( Distance( result, expected, TEST_QUATERNION_ROWS, i ) );
+				}
+			}
+
+			kernels.rotateVector( samples, result );
+			irr.rotateVector( samples, expected );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				rotateVector.Add( Distance( result, expected, TEST_VECTOR_ROWS, i ) / samples.vectorQ[i].getLength() );
+			}
+
+			kernels.getMatrix( samples, result );
+			irr.getMatrix( samples, expected );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				getMatrix.Add( Distance( result, expected, TEST_MATRIX_ROWS, i ) );
+			}
+
+			// either sign is the same rotation; operator=( matrix4 ) divides by w and so has no
+			// bound to test against, only one to beat
+			kernels.fromMatrix( samples, result );
+			irr.fromMatrix( samples, expected );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				irr::core::quaternion q = Nearest( result, i, samples.fromQ[i] );
+				fromMatrix.Add( QuaternionDistance( q, samples.from, i ) );
+				fromMatrixIrr.Add( QuaternionDistance( Nearest( expected, i, samples.fromQ[i] ), samples.from, i ) );
+			}
+
+			if ( NULL != kernels.slerp )
+			{
+				kernels.slerp( samples, result );
+				irr.slerp( samples, expected );
+				for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+				{
+					slerp.Add( Distance( result, expected, TEST_QUATERNION_ROWS, i ) );
+				}
+			}
+
+			kernels.slerpFast( samples, result );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				double exact[4];
+				QuaternionSlerpExact( samples.fromQ[i], samples.toQ[i], samples.time[i], exact );
+				double error = QuaternionDistance( exact, result, i );
+				double angle = QuaternionAngle( samples.fromQ[i], samples.toQ[i] );
+				slerpFast180.Add( error );
+				if ( angle <= 120.0 )
+				{
+					slerpFast120.Add( error );
+				}
+				if ( angle <= 90.0 )
+				{
+					slerpFast90.Add( error );
+				}
+			}
+
+			kernels.nlerp( samples, result );
+			irr.nlerp( samples, expected );
+			for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+			{
+				nlerp.Add( Distance( result, expected, TEST_QUATERNION_ROWS, i ) );
+
+				double exact[4];
+				QuaternionSlerpExact( samples.fromQ[i], samples.toQ[i], samples.time[i], exact );
+				double error = QuaternionDistance( exact, result, i );
+				double angle = QuaternionAngle( samples.fromQ[i], samples.toQ[i] );
+				if ( angle <= 90.0 )
+				{
+					nlerp90.Add( error );
+				}
+				if ( angle <= 10.0 )
+				{
+					nlerp10.Add( error );
+				}
+			}
+		}
+	}
+	delete pSamples;
+
+	printf( "%s, largest error of any component:\n", kernels.pName );
+	Report( "Multiply", multiply, 2.4e-7 );
+	Report( "Conjugate", conjugate, 0.0 );
+	Report( "Normalize", normalize, 2.4e-7 );
+	Report( "RotateVector, of the length", rotateVector, 4.6e-7 );
+	Report( "GetMatrix", getMatrix, 1.2e-7 );
+	Report( "FromMatrix, to the quaternion", fromMatrix, 9.6e-7 );
+	printf( "  %-40s %10.3g\n", "operator=( matrix4 ), to the quaternion", fromMatrixIrr.largest );
+	TEST_CHECK( fromMatrix.largest < fromMatrixIrr.largest );
+	if ( NULL != kernels.slerp )
+	{
+		Report( "Slerp", slerp, 4.8e-7 );
+	}
+	Report( "SlerpFast to exact, up to 90 degrees", slerpFast90, 3.6e-7 );
+	Report( "SlerpFast to exact, up to 120 degrees", slerpFast120, 2.8e-6 );
+	Report( "SlerpFast to exact", slerpFast180, 6e-5 );
+	Report( "Nlerp to lerp and normalize", nlerp, 2.4e-7 );
+	Report( "Nlerp to exact, up to 10 degrees", nlerp10, 2.4e-5 );
+	Report( "Nlerp to exact, up to 90 degrees", nlerp90, 1.6e-2 );
+}
+
+/// <summary>
+/// The 8 wide operations give the same bits as the 4 wide ones, lane for lane
+/// </summary>
+static void TestSameBits( const QuaternionKernels & kernels8, const QuaternionKernels & kernels4 )
+{
+	QuaternionSamples * pSamples = new QuaternionSamples;
+	float result8[TEST_MATRIX_ROWS][QUATERNION_SAMPLES];
+	float result4[TEST_MATRIX_ROWS][QUATERNION_SAMPLES];
+	unsigned int seed = 49;
+	const QuaternionKernel QuaternionKernels::* operations[] =
+	{
+		&QuaternionKernels::multiply, &QuaternionKernels::conjugate, &QuaternionKernels::normalize,
+		&QuaternionKernels::rotateVector, &QuaternionKernels::getMatrix, &QuaternionKernels::fromMatrix,
+		&QuaternionKernels::slerpFast, &QuaternionKernels::nlerp
+	};
+	const char * names[] = { "Multiply", "Conjugate", "Normalize", "RotateVector", "GetMatrix", "FromMatrix", "SlerpFast", "Nlerp" };
+
+	for ( size_t spread = 0; spread < sizeof(g_Spreads) / sizeof(g_Spreads[0]); spread++ )
+	{
+		QuaternionSamplesFill( *pSamples, seed, g_Spreads[spread] );
+		for ( size_t op = 0; op < sizeof(operations) / sizeof(operations[0]); op++ )
+		{
+			memset( result8, 0, sizeof(result8) );
+			memset( result4, 0, sizeof(result4) );
+			( kernels8.*operations[op] )( *pSamples, result8 );
+			( kernels4.*operations[op] )( *pSamples, result4 );
+			if ( !TEST_CHECK( 0 == memcmp( result8, result4, sizeof(result4) ) ) )
+			{
+				printf( "%s of %s differs from %s\n", names[op], kernels8.pName, kernels4.pName );
+			}
+		}
+	}
+	delete pSamples;
+}
+
+/// <summary>
+/// Normalize of a zero quaternion, Select and Identity
+/// </summary>
+static void TestLanes( )
+{
+	const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float x[4] = { 3.0f, 0.0f, 0.0f, 0.0f };
+	const float w[4] = { 4.0f, 0.0f, 2.0f, 0.0f };
+	const float three[4] = { 3.0f, 3.0f, 3.0f, 3.0f };
+	float r[4][4];
+
+	// a lane of length 0 becomes the identity
+	Quaternion4Store( Quaternion4Normalize( Quaternion4Load( x, zero, zero, w ) ), r[0], r[1], r[2], r[3] );
+	TEST_CHECK_NEAR( r[0][0], 0.6f, 1e-7 );
+	TEST_CHECK_NEAR( r[3][0], 0.8f, 1e-7 );
+	TEST_CHECK( 0.0f == r[0][1] && 0.0f == r[1][1] && 0.0f == r[2][1] && 1.0f == r[3][1] );
+	TEST_CHECK( 0.0f == r[0][2] && 1.0f == r[3][2] );
+	TEST_CHECK( 1.0f == r[3][3] );
+
+	__m128 mask = _mm_castsi128_ps( _mm_set_epi32( 0, -1, 0, -1 ) );
+	Quaternion4Store( Quaternion4Select( mask, Quaternion4Load( three, three, three, three ), Quaternion4Identity() ), r[0], r[1], r[2], r[3] );
+	TEST_CHECK( 3.0f == r[0][0] && 3.0f == r[3][0] );
+	TEST_CHECK( 0.0f == r[0][1] && 1.0f == r[3][1] );
+	TEST_CHECK( 3.0f == r[1][2] && 3.0f == r[3][2] );
+	TEST_CHECK( 0.0f == r[2][3] && 1.0f == r[3][3] );
+}
+
+int main( )
+{
+	TestLanes();
+	TestKernels( g_QuaternionKernels4 );
+	if ( QuaternionKernelsHaveAvx() )
+	{
+		TestKernels( g_QuaternionKernels8 );
+		TestSameBits( g_QuaternionKernels8, g_QuaternionKernels4 );
+	}
+	else
+	{
+		printf( "no AVX here, quaternion8 not tested\n" );
+	}
+	return TestResult();
+}
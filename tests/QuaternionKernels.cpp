@@ -0,0 +1,238 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionKernels.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// The operations over a batch with irr::core::quaternion and with quaternion4. Built for SSE;
+// QuaternionBatch8.h is only included for QuaternionBatchHasAvx(), which is why g++'s note
+// about passing AVX registers without AVX is turned off for this file.
+
+#include "QuaternionBatch8.h"
+#include "QuaternionKernels.h"
+
+using irr::core::quaternion;
+
+// The operations of QuaternionKernels with irr::core::quaternion, one at a time
+
+/// <summary>
+/// Store quaternion i of a batch into rows
+/// </summary>
+static void StoreIrr( const quaternion & q, float result[][QUATERNION_SAMPLES], int i )
+{
+	result[0][i] = q.X;
+	result[1][i] = q.Y;
+	result[2][i] = q.Z;
+	result[3][i] = q.W;
+}
+
+static void MultiplyIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		StoreIrr( samples.toQ[i] * samples.fromQ[i], result, i );
+	}
+}
+
+static void ConjugateIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		quaternion q( samples.fromQ[i] );
+		StoreIrr( q.makeInverse(), result, i );
+	}
+}
+
+static void NormalizeIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		quaternion q( samples.scaledQ[i] );
+		StoreIrr( q.normalize(), result, i );
+	}
+}
+
+static void RotateVectorIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		irr::core::vector3df v = samples.fromQ[i] * samples.vectorQ[i];
+		result[0][i] = v.X;
+		result[1][i] = v.Y;
+		result[2][i] = v.Z;
+	}
+}
+
+static void GetMatrixIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	irr::core::matrix4 m;
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		samples.fromQ[i].getMatrix( m );
+		for ( int k = 0; k < 9; k++ )
+		{
+			result[k][i] = m[g_QuaternionMatrixIndex[k]];
+		}
+	}
+}
+
+static void FromMatrixIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	quaternion q;
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		q = samples.matrixQ[i];
+		StoreIrr( q, result, i );
+	}
+}
+
+static void SlerpIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	quaternion q;
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		StoreIrr( q.slerp( samples.fromQ[i], samples.toQ[i], samples.time[i] ), result, i );
+	}
+}
+
+static void NlerpIrr( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	quaternion q;
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		// lerp does not take the short way round by itself
+		quaternion from( samples.fromQ[i] );
+		if ( from.dotProduct( samples.toQ[i] ) < 0.0f )
+		{
+			from *= -1.0f;
+		}
+		StoreIrr( q.lerp( from, samples.toQ[i], samples.time[i] ).normalize(), result, i );
+	}
+}
+
+const QuaternionKernels g_QuaternionKernelsIrr =
+{
+	"quaternion", MultiplyIrr, ConjugateIrr, NormalizeIrr, RotateVectorIrr, GetMatrixIrr, FromMatrixIrr, SlerpIrr, NULL, NlerpIrr
+};
+
+// And with quaternion4, four at a time
+
+/// <summary>
+/// Load quaternions h to h + 3 of rows
+/// </summary>
+static quaternion4 Load4( const float rows[][QUATERNION_SAMPLES], int h )
+{
+	return Quaternion4Load( rows[0] + h, rows[1] + h, rows[2] + h, rows[3] + h );
+}
+
+/// <summary>
+/// Store quaternions h to h + 3 into rows
+/// </summary>
+static void Store4( const quaternion4 & q, float result[][QUATERNION_SAMPLES], int h )
+{
+	Quaternion4Store( q, result[0] + h, result[1] + h, result[2] + h, result[3] + h );
+}
+
+static void Multiply4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		Store4( Quaternion4Multiply( Load4( samples.from, h ), Load4( samples.to, h ) ), result, h );
+	}
+}
+
+static void Conjugate4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		Store4( Quaternion4Conjugate( Load4( samples.from, h ) ), result, h );
+	}
+}
+
+static void Normalize4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		Store4( Quaternion4Normalize( Load4( samples.scaled, h ) ), result, h );
+	}
+}
+
+static void RotateVector4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		vector4 v;
+		v.x = _mm_loadu_ps( samples.vector[0] + h );
+		v.y = _mm_loadu_ps( samples.vector[1] + h );
+		v.z = _mm_loadu_ps( samples.vector[2] + h );
+		vector4 r = Quaternion4RotateVector( Load4( samples.from, h ), v );
+		_mm_storeu_ps( result[0] + h, r.x );
+		_mm_storeu_ps( result[1] + h, r.y );
+		_mm_storeu_ps( result[2] + h, r.z );
+	}
+}
+
+static void GetMatrix4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		rotation4 m = Quaternion4GetMatrix( Load4( samples.from, h ) );
+		const vector4 * axes[3] = { &m.x, &m.y, &m.z };
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			_mm_storeu_ps( result[axis * 3] + h, axes[axis]->x );
+			_mm_storeu_ps( result[axis * 3 + 1] + h, axes[axis]->y );
+			_mm_storeu_ps( result[axis * 3 + 2] + h, axes[axis]->z );
+		}
+	}
+}
+
+static void FromMatrix4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		rotation4 m;
+		vector4 * axes[3] = { &m.x, &m.y, &m.z };
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			axes[axis]->x = _mm_loadu_ps( samples.matrix[axis * 3] + h );
+			axes[axis]->y = _mm_loadu_ps( samples.matrix[axis * 3 + 1] + h );
+			axes[axis]->z = _mm_loadu_ps( samples.matrix[axis * 3 + 2] + h );
+		}
+		Store4( Quaternion4FromMatrix( m ), result, h );
+	}
+}
+
+static void Slerp4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		Store4( Quaternion4Slerp( Load4( samples.from, h ), Load4( samples.to, h ), _mm_loadu_ps( samples.time + h ) ), result, h );
+	}
+}
+
+static void SlerpFast4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		Store4( Quaternion4SlerpFast( Load4( samples.from, h ), Load4( samples.to, h ), _mm_loadu_ps( samples.time + h ) ), result, h );
+	}
+}
+
+static void Nlerp4( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 4 )
+	{
+		Store4( Quaternion4Nlerp( Load4( samples.from, h ), Load4( samples.to, h ), _mm_loadu_ps( samples.time + h ) ), result, h );
+	}
+}
+
+const QuaternionKernels g_QuaternionKernels4 =
+{
+	"quaternion4", Multiply4, Conjugate4, Normalize4, RotateVector4, GetMatrix4, FromMatrix4, Slerp4, SlerpFast4, Nlerp4
+};
+
+bool QuaternionKernelsHaveAvx( )
+{
+	return QuaternionBatchHasAvx();
+}
@@ -0,0 +1,51 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionKernels.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Each operation of QuaternionBatch.h run over a batch of QuaternionSamples, once with
+// irr::core::quaternion one at a time, once with quaternion4 and once with quaternion8, so
+// the test compares the three and the benchmark times them. QuaternionKernels8.cpp is built
+// for AVX, like any code that calls QuaternionBatch8.h.
+
+#pragma once
+
+#include "QuaternionSamples.h"
+
+/// <summary>
+/// One operation over every sample of a batch. The result has 4 rows for a quaternion,
+/// 3 for a vector and 9 for a matrix
+/// </summary>
+typedef void (*QuaternionKernel)( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] );
+
+/// <summary>
+/// The operations of one implementation; NULL where it has none
+/// </summary>
+struct QuaternionKernels
+{
+	const char *        pName;
+	QuaternionKernel    multiply;       // from times to, the rotation to followed by from
+	QuaternionKernel    conjugate;      // of from
+	QuaternionKernel    normalize;      // of scaled
+	QuaternionKernel    rotateVector;   // vector turned by from
+	QuaternionKernel    getMatrix;      // of from
+	QuaternionKernel    fromMatrix;     // of matrix
+	QuaternionKernel    slerp;          // from to to at time, with acosf and sinf
+	QuaternionKernel    slerpFast;      // the same from a polynomial
+	QuaternionKernel    nlerp;          // the same, normalized linearly
+};
+
+// irr::core::quaternion, one at a time
+extern const QuaternionKernels g_QuaternionKernelsIrr;
+
+// quaternion4, four at a time
+extern const QuaternionKernels g_QuaternionKernels4;
+
+// quaternion8, eight at a time; only where QuaternionKernelsHaveAvx()
+extern const QuaternionKernels g_QuaternionKernels8;
+
+/// <summary>
+/// Whether g_QuaternionKernels8 can run here, QuaternionBatchHasAvx()
+/// </summary>
+bool QuaternionKernelsHaveAvx( );
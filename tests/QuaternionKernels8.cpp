@@ -0,0 +1,118 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionKernels8.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// The operations over a batch with quaternion8, eight at a time. Built for AVX, nothing in
+// here runs unless QuaternionKernelsHaveAvx().
+
+#include "QuaternionBatch8.h"
+#include "QuaternionKernels.h"
+
+/// <summary>
+/// Load quaternions h to h + 7 of rows
+/// </summary>
+static quaternion8 Load8( const float rows[][QUATERNION_SAMPLES], int h )
+{
+	return Quaternion8Load( rows[0] + h, rows[1] + h, rows[2] + h, rows[3] + h );
+}
+
+/// <summary>
+/// Store quaternions h to h + 7 into rows
+/// </summary>
+static void Store8( const quaternion8 & q, float result[][QUATERNION_SAMPLES], int h )
+{
+	Quaternion8Store( q, result[0] + h, result[1] + h, result[2] + h, result[3] + h );
+}
+
+static void Multiply8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		Store8( Quaternion8Multiply( Load8( samples.from, h ), Load8( samples.to, h ) ), result, h );
+	}
+}
+
+static void Conjugate8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		Store8( Quaternion8Conjugate( Load8( samples.from, h ) ), result, h );
+	}
+}
+
+static void Normalize8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		Store8( Quaternion8Normalize( Load8( samples.scaled, h ) ), result, h );
+	}
+}
+
+static void RotateVector8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		vector8 v;
+		v.x = _mm256_loadu_ps( samples.vector[0] + h );
+		v.y = _mm256_loadu_ps( samples.vector[1] + h );
+		v.z = _mm256_loadu_ps( samples.vector[2] + h );
+		vector8 r = Quaternion8RotateVector( Load8( samples.from, h ), v );
+		_mm256_storeu_ps( result[0] + h, r.x );
+		_mm256_storeu_ps( result[1] + h, r.y );
+		_mm256_storeu_ps( result[2] + h, r.z );
+	}
+}
+
+static void GetMatrix8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		rotation8 m = Quaternion8GetMatrix( Load8( samples.from, h ) );
+		const vector8 * axes[3] = { &m.x, &m.y, &m.z };
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			_mm256_storeu_ps( result[axis * 3] + h, axes[axis]->x );
+			_mm256_storeu_ps( result[axis * 3 + 1] + h, axes[axis]->y );
+			_mm256_storeu_ps( result[axis * 3 + 2] + h, axes[axis]->z );
+		}
+	}
+}
+
+static void FromMatrix8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		rotation8 m;
+		vector8 * axes[3] = { &m.x, &m.y, &m.z };
+		for ( int axis = 0; axis < 3; axis++ )
+		{
+			axes[axis]->x = _mm256_loadu_ps( samples.matrix[axis * 3] + h );
+			axes[axis]->y = _mm256_loadu_ps( samples.matrix[axis * 3 + 1] + h );
+			axes[axis]->z = _mm256_loadu_ps( samples.matrix[axis * 3 + 2] + h );
+		}
+		Store8( Quaternion8FromMatrix( m ), result, h );
+	}
+}
+
+static void SlerpFast8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		Store8( Quaternion8SlerpFast( Load8( samples.from, h ), Load8( samples.to, h ), _mm256_loadu_ps( samples.time + h ) ), result, h );
+	}
+}
+
+static void Nlerp8( const QuaternionSamples & samples, float result[][QUATERNION_SAMPLES] )
+{
+	for ( int h = 0; h < QUATERNION_SAMPLES; h += 8 )
+	{
+		Store8( Quaternion8Nlerp( Load8( samples.from, h ), Load8( samples.to, h ), _mm256_loadu_ps( samples.time + h ) ), result, h );
+	}
+}
+
+const QuaternionKernels g_QuaternionKernels8 =
+{
+	"quaternion8", Multiply8, Conjugate8, Normalize8, RotateVector8, GetMatrix8, FromMatrix8, NULL, SlerpFast8, Nlerp8
+};
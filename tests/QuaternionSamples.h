@@ -0,0 +1,201 @@
+//------------------------------------------------------------------------------
+// <copyright file="QuaternionSamples.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Random quaternions for the tests and the benchmark of QuaternionBatch.h, both as rows of
+// floats for quaternion4 and quaternion8 and as irr::core::quaternion to compare with, and
+// an exact slerp in double. The same seed gives the same samples on every machine.
+
+#pragma once
+
+#include "quaternion.h"
+#include <math.h>
+
+// Samples in a batch, a multiple of 8
+#define QUATERNION_SAMPLES              256
+
+// Spread at which "to" is drawn on its own instead of near "from"
+#define QUATERNION_SPREAD_ANY           1.0f
+
+// Index in matrix4 of each element of a rotation4, x axis first
+static const int g_QuaternionMatrixIndex[9] = { 0, 1, 2, 4, 5, 6, 8, 9, 10 };
+
+/// <summary>
+/// A batch of samples: pairs of unit quaternions, a time to interpolate them at, a vector
+/// to turn, the quaternions "from" scaled to lengths from 0 to 100 and the rotation matrix of
+/// "from". Rows 0 to 3 are x, y, z and w, the matrix rows are the elements of a rotation4
+/// </summary>
+struct QuaternionSamples
+{
+	float                   from[4][QUATERNION_SAMPLES];
+	float                   to[4][QUATERNION_SAMPLES];
+	float                   time[QUATERNION_SAMPLES];
+	float                   vector[3][QUATERNION_SAMPLES];
+	float                   scaled[4][QUATERNION_SAMPLES];
+	float                   matrix[9][QUATERNION_SAMPLES];
+	irr::core::quaternion   fromQ[QUATERNION_SAMPLES];
+	irr::core::quaternion   toQ[QUATERNION_SAMPLES];
+	irr::core::vector3df    vectorQ[QUATERNION_SAMPLES];
+	irr::core::quaternion   scaledQ[QUATERNION_SAMPLES];
+	irr::core::matrix4      matrixQ[QUATERNION_SAMPLES];
+};
+
+/// <summary>
+/// Next random number of a sequence
+/// </summary>
+/// <param name="seed">state of the sequence, updated</param>
+/// <returns>uniform from -1 to 1</returns>
+inline float QuaternionRandom( unsigned int & seed )
+{
+	seed = seed * 1664525u + 1013904223u;
+	return static_cast<float>( seed >> 8 ) / 8388608.0f - 1.0f;
+}
+
+/// <summary>
+/// Random unit quaternion
+/// </summary>
+inline irr::core::quaternion QuaternionRandomUnit( unsigned int & seed )
+{
+	for ( ;; )
+	{
+		irr::core::quaternion q( QuaternionRandom( seed ), QuaternionRandom( seed ), QuaternionRandom( seed ), QuaternionRandom( seed ) );
+		if ( q.dotProduct( q ) > 0.01f )
+		{
+			return q.normalize();
+		}
+	}
+}
+
+/// <summary>
+/// Draw a batch
+/// </summary>
+/// <param name="samples">receives the batch</param>
+/// <param name="seed">state of the random sequence, updated</param>
+/// <param name="spread">how far "to" is from "from": the largest vector part of the turn
+/// between them, with w 1; QUATERNION_SPREAD_ANY for no relation. "to" is negated half the
+/// time, the same rotation the long way round</param>
+inline void QuaternionSamplesFill( QuaternionSamples & samples, unsigned int & seed, float spread )
+{
+	for ( int i = 0; i < QUATERNION_SAMPLES; i++ )
+	{
+		irr::core::quaternion from = QuaternionRandomUnit( seed );
+		irr::core::quaternion to;
+		if ( spread >= QUATERNION_SPREAD_ANY )
+		{
+			to = QuaternionRandomUnit( seed );
+		}
+		else
+		{
+			irr::core::quaternion turn( QuaternionRandom( seed ) * spread, QuaternionRandom( seed ) * spread, QuaternionRandom( seed ) * spread, 1.0f );
+			to = from * turn.normalize();
+		}
+		if ( QuaternionRandom( seed ) < 0.0f )
+		{
+			to = to * -1.0f;
+		}
+
+		samples.fromQ[i] = from;
+		samples.toQ[i] = to;
+		samples.from[0][i] = from.X;
+		samples.from[1][i] = from.Y;
+		samples.from[2][i] = from.Z;
+		samples.from[3][i] = from.W;
+		samples.to[0][i] = to.X;
+		samples.to[1][i] = to.Y;
+		samples.to[2][i] = to.Z;
+		samples.to[3][i] = to.W;
+		samples.time[i] = ( QuaternionRandom( seed ) + 1.0f ) * 0.5f;
+
+		irr::core::vector3df v( QuaternionRandom( seed ) * 100.0f, QuaternionRandom( seed ) * 100.0f, QuaternionRandom( seed ) * 100.0f );
+		samples.vectorQ[i] = v;
+		samples.vector[0][i] = v.X;
+		samples.vector[1][i] = v.Y;
+		samples.vector[2][i] = v.Z;
+
+		// every 16th one of length 0
+		float length = ( 0 == i % 16 ) ? 0.0f : ( QuaternionRandom( seed ) + 1.0f ) * ( ( 0 == i % 3 ) ? 50.0f : 0.5f );
+		samples.scaledQ[i] = from * length;
+		samples.scaled[0][i] = samples.scaledQ[i].X;
+		samples.scaled[1][i] = samples.scaledQ[i].Y;
+		samples.scaled[2][i] = samples.scaledQ[i].Z;
+		samples.scaled[3][i] = samples.scaledQ[i].W;
+
+		from.getMatrix( samples.matrixQ[i] );
+		for ( int k = 0; k < 9; k++ )
+		{
+			samples.matrix[k][i] = samples.matrixQ[i][g_QuaternionMatrixIndex[k]];
+		}
+	}
+}
+
+/// <summary>
+/// Largest difference of any component between a quaternion and sample i of rows
+/// </summary>
+inline double QuaternionDistance( const irr::core::quaternion & q, const float rows[4][QUATERNION_SAMPLES], int i )
+{
+	double x = fabs( q.X - rows[0][i] );
+	double y = fabs( q.Y - rows[1][i] );
+	double z = fabs( q.Z - rows[2][i] );
+	double w = fabs( q.W - rows[3][i] );
+	return fmax( fmax( x, y ), fmax( z, w ) );
+}
+
+/// <summary>
+/// Largest difference of any component between a quaternion in double and sample i of rows
+/// </summary>
+inline double QuaternionDistance( const double q[4], const float rows[4][QUATERNION_SAMPLES], int i )
+{
+	double distance = 0.0;
+	for ( int k = 0; k < 4; k++ )
+	{
+		distance = fmax( distance, fabs( q[k] - rows[k][i] ) );
+	}
+	return distance;
+}
+
+/// <summary>
+/// Angle of the turn from one rotation to the other, the short way round
+/// </summary>
+/// <returns>degrees, from 0 to 180</returns>
+inline double QuaternionAngle( const irr::core::quaternion & a, const irr::core::quaternion & b )
+{
+	double cosine = fabs( static_cast<double>( a.X ) * b.X + static_cast<double>( a.Y ) * b.Y +
+						  static_cast<double>( a.Z ) * b.Z + static_cast<double>( a.W ) * b.W );
+	return 2.0 * acos( fmin( cosine, 1.0 ) ) * 180.0 / 3.14159265358979323846;
+}
+
+/// <summary>
+/// Slerp the short way round in double, at constant speed all the way
+/// </summary>
+/// <param name="a">quaternion at time 0</param>
+/// <param name="b">quaternion at time 1</param>
+/// <param name="t">time</param>
+/// <param name="result">receives x, y, z and w</param>
+inline void QuaternionSlerpExact( const irr::core::quaternion & a, const irr::core::quaternion & b, double t, double result[4] )
+{
+	double cosine = static_cast<double>( a.X ) * b.X + static_cast<double>( a.Y ) * b.Y +
+					static_cast<double>( a.Z ) * b.Z + static_cast<double>( a.W ) * b.W;
+	double sign = 1.0;
+	if ( cosine < 0.0 )
+	{
+		cosine = -cosine;
+		sign = -1.0;
+	}
+
+	double angle = acos( fmin( cosine, 1.0 ) );
+	double weightA = 1.0 - t;
+	double weightB = t;
+	if ( angle > 1e-9 )
+	{
+		weightA = sin( ( 1.0 - t ) * angle ) / sin( angle );
+		weightB = sin( t * angle ) / sin( angle );
+	}
+	weightA *= sign;
+
+	result[0] = weightA * a.X + weightB * b.X;
+	result[1] = weightA * a.Y + weightB * b.Y;
+	result[2] = weightA * a.Z + weightB * b.Z;
+	result[3] = weightA * a.W + weightB * b.W;
+}
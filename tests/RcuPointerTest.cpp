@@ -0,0 +1,196 @@
+//------------------------------------------------------------------------------
+// <copyright file="RcuPointerTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Tests RcuPointer.h, first step by step, then with a writer publishing as fast as it can
+// while every reader slot holds snapshots of random length. The values check themselves and
+// are poisoned when deleted, so a reader that sees a value freed under it, or half built,
+// fails the check. Build with -DSKELETAL_TSAN=ON to have ThreadSanitizer watch the same run.
+
+#include "RcuPointer.h"
+#include "TestCheck.h"
+#include <thread>
+
+#define TEST_READERS                    4
+#define TEST_VALUE_SIZE                 64
+
+// Values published by the stress test
+static const int g_PublishCount = 100000;
+
+/// <summary>
+/// A value that knows whether it is whole, and how many of its kind are alive
+/// </summary>
+struct TestValue
+{
+	explicit TestValue( int value ) : version(value)
+	{
+		for ( int i = 0; i < TEST_VALUE_SIZE; i++ )
+		{
+			data[i] = value;
+		}
+		Live()++;
+	}
+
+	~TestValue()
+	{
+		version = -1;
+		for ( int i = 0; i < TEST_VALUE_SIZE; i++ )
+		{
+			data[i] = -1;
+		}
+		Live()--;
+	}
+
+	bool IsWhole( ) const
+	{
+		for ( int i = 0; i < TEST_VALUE_SIZE; i++ )
+		{
+			if ( data[i] != version )
+			{
+				return false;
+			}
+		}
+		return version >= 0;
+	}
+
+	static std::atomic<int> & Live( )
+	{
+		static std::atomic<int> live( 0 );
+		return live;
+	}
+
+	int version;
+	int data[TEST_VALUE_SIZE];
+};
+
+typedef RcuPointer<TestValue, TEST_READERS> TestPointer;
+
+/// <summary>
+/// A replaced value lives as long as a reader holds it, and not longer
+/// </summary>
+static void TestReclaim( )
+{
+	{
+		TestPointer pointer;
+		TEST_CHECK( NULL == pointer.Acquire( 0 ) );
+		pointer.Release( 0 );
+
+		pointer.Publish( new TestValue( 1 ) );
+		const TestValue * pHeld = pointer.Acquire( 2 );
+		TEST_CHECK( 1 == pHeld->version );
+
+		// replaced twice, the first one is still held by reader 2, the second one by nobody
+		pointer.Publish( new TestValue( 2 ) );
+		pointer.Publish( new TestValue( 3 ) );
+		TEST_CHECK( 3 == pointer.Get()->version );
+		TEST_CHECK( 2 == TestValue::Live() );
+		TEST_CHECK( pHeld->IsWhole() && 1 == pHeld->version );
+		TEST_CHECK( 1 == pointer.Reclaim() );
+
+		{
+			RcuSnapshot<TestValue, TEST_READERS> snapshot( pointer, 1 );
+			TEST_CHECK( 3 == snapshot->version );
+		}
+
+		pointer.Release( 2 );
+		TEST_CHECK( 0 == pointer.Reclaim() );
+		TEST_CHECK( 1 == TestValue::Live() );
+	}
+
+	// the destructor deletes the current value
+	TEST_CHECK( 0 == TestValue::Live() );
+}
+
+/// <summary>
+/// One writer publishing while every reader slot acquires, checks and releases
+/// </summary>
+static void TestStress( )
+{
+	TestPointer * pPointer = new TestPointer();
+	pPointer->Publish( new TestValue( 0 ) );
+
+	std::atomic<bool> stop( false );
+	std::atomic<int> started( 0 );
+	std::atomic<int> broken( 0 );
+	std::atomic<long long> snapshots( 0 );
+	std::thread readers[TEST_READERS];
+
+	for ( int reader = 0; reader < TEST_READERS; reader++ )
+	{
+		readers[reader] = std::thread( [pPointer, reader, &stop, &started, &broken, &snapshots]()
+		{
+			started++;
+			unsigned int seed = 2654435761u * ( reader + 1 );
+			int newest = 0;
+			long long count = 0;
+			while ( !stop.load() )
+			{
+				RcuSnapshot<TestValue, TEST_READERS> snapshot( *pPointer, reader );
+
+				// versions only move forward, and the value stays whole however long it is held
+				if ( NULL == snapshot.Get() || snapshot->version < newest || !snapshot->IsWhole() )
+				{
+					broken++;
+					continue;
+				}
+				newest = snapshot->version;
+
+				seed = seed * 1664525u + 1013904223u;
+				for ( volatile unsigned int spin = ( seed >> 24 ) * 4; spin > 0; spin-- )
+				{
+				}
+				if ( 0 == ( seed >> 28 ) )
+				{
+					std::this_thread::yield();
+				}
+				if ( !snapshot->IsWhole() || snapshot->version != newest )
+				{
+					broken++;
+				}
+				count++;
+			}
+			snapshots += count;
+		} );
+	}
+
+	// publish only once every reader is busy, or a fast writer finishes alone
+	while ( TEST_READERS != started.load() )
+	{
+		std::this_thread::yield();
+	}
+
+	size_t maxKept = 0;
+	for ( int version = 1; version <= g_PublishCount; version++ )
+	{
+		pPointer->Publish( new TestValue( version ) );
+
+		// each reader holds at most one value, so at most that many wait to be deleted
+		size_t kept = pPointer->Reclaim();
+		maxKept = ( kept > maxKept ) ? kept : maxKept;
+	}
+
+	stop = true;
+	for ( int reader = 0; reader < TEST_READERS; reader++ )
+	{
+		readers[reader].join();
+	}
+
+	TEST_CHECK( 0 == broken.load() );
+	TEST_CHECK( snapshots.load() > TEST_READERS );
+	TEST_CHECK( maxKept <= TEST_READERS );
+	TEST_CHECK( 0 == pPointer->Reclaim() );
+	TEST_CHECK( 1 == TestValue::Live() );
+	TEST_CHECK( g_PublishCount == pPointer->Get()->version );
+
+	delete pPointer;
+	TEST_CHECK( 0 == TestValue::Live() );
+}
+
+int main( )
+{
+	TestReclaim();
+	TestStress();
+	return TestResult();
+}
@@ -0,0 +1,321 @@
+//------------------------------------------------------------------------------
+// <copyright file="SharedPoseRingBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Latency from the tracker publishing a pose frame to a consumer on the same machine having
+// it, through SharedPoseRing.h and through loopback UDP, and what reading a frame costs the
+// consumer with each. The consumer waits on the futex, polls the ring, or blocks in recv.
+// Polling needs a core of its own and is left out on a machine with one.
+
+#include "SharedPoseRing.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <stddef.h>
+#include <sys/socket.h>
+#include <emmintrin.h>
+
+// Persons in every frame, as two sensors would see them
+#define BENCH_SKELETONS                 2
+
+// Bytes of a frame with BENCH_SKELETONS skeletons, what a datagram would carry
+#define BENCH_FRAME_SIZE                ( offsetof(SharedPoseFrame, skeletons) + BENCH_SKELETONS * sizeof(SharedPoseSkeleton) )
+
+enum BenchWait
+{
+	BENCH_FUTEX = 0,
+	BENCH_POLL,
+	BENCH_UDP
+};
+
+static const char * g_WaitNames[] = { "shared memory, futex", "shared memory, polled", "loopback UDP" };
+
+/// <summary>
+/// Fill in a frame whose every value follows from its number
+/// </summary>
+static void MakeFrame( unsigned long long frameNumber, SharedPoseFrame & frame )
+{
+	frame.frameNumber = frameNumber;
+	frame.timestamp = static_cast<long long>( frameNumber * 33 );
+	frame.skeletonCount = BENCH_SKELETONS;
+	for ( int i = 0; i < BENCH_SKELETONS; i++ )
+	{
+		SharedPoseSkeleton & skeleton = frame.skeletons[i];
+		skeleton.globalId = i + 1;
+		skeleton.trackingState = 2;
+		skeleton.sensorMask = 1u << i;
+		for ( int j = 0; j < SHARED_POSE_JOINT_COUNT; j++ )
+		{
+			skeleton.jointState[j] = 2;
+			skeleton.joints[j][0] = static_cast<float>( frameNumber & 0xFFFF ) + j;
+			skeleton.joints[j][1] = 40.0f - j;
+			skeleton.joints[j][2] = 80.0f + i;
+		}
+	}
+}
+
+/// <summary>
+/// What a consumer does with a frame: look at every joint of every person
+/// </summary>
+/// <returns>false if the frame is not the one its number says</returns>
+static bool ReadFrame( const SharedPoseFrame & frame, unsigned long long frameNumber )
+{
+	float sum = 0.0f;
+	for ( int i = 0; i < frame.skeletonCount && i < BENCH_SKELETONS; i++ )
+	{
+		for ( int j = 0; j < SHARED_POSE_JOINT_COUNT; j++ )
+		{
+			sum += frame.skeletons[i].joints[j][0] - j;
+		}
+	}
+	return frameNumber == frame.frameNumber && BENCH_SKELETONS == frame.skeletonCount &&
+		   sum == BENCH_SKELETONS * SHARED_POSE_JOINT_COUNT * static_cast<float>( frameNumber & 0xFFFF );
+}
+
+/// <summary>
+/// Loopback UDP sender and receiver
+/// </summary>
+struct BenchSockets
+{
+	int             sender;
+	int             receiver;
+	sockaddr_in     address;
+
+	BenchSockets() : sender(-1), receiver(-1)
+	{
+		memset( &address, 0, sizeof(address) );
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+		socklen_t length = sizeof(address);
+		receiver = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+		sender = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+		if ( receiver >= 0 && ( 0 != bind( receiver, (const sockaddr *)&address, sizeof(address) ) ||
+								0 != getsockname( receiver, (sockaddr *)&address, &length ) ) )
+		{
+			close( receiver );
+			receiver = -1;
+		}
+	}
+
+	~BenchSockets()
+	{
+		if ( sender >= 0 )
+		{
+			close( sender );
+		}
+		if ( receiver >= 0 )
+		{
+			close( receiver );
+		}
+	}
+
+	bool IsOpen( ) const { return sender >= 0 && receiver >= 0; }
+
+	bool Send( const SharedPoseFrame & frame )
+	{
+		return BENCH_FRAME_SIZE == sendto( sender, &frame, BENCH_FRAME_SIZE, 0, (const sockaddr *)&address, sizeof(address) );
+	}
+};
+
+/// <summary>
+/// Publish frames one after the other, each once the consumer has the one before, and
+/// measure how long the consumer took to have each
+/// </summary>
+/// <param name="latencies">receives ns per frame</param>
+/// <returns>frames the consumer found wrong</returns>
+static int BenchLatency( BenchWait wait, int frames, std::vector<double> & latencies )
+{
+	SharedPoseWriter writer;
+	SharedPoseReader reader;
+	BenchSockets sockets;
+	if ( !writer.Open( BENCH_FUTEX == wait ) || !reader.Open() || !sockets.IsOpen() )
+	{
+		return frames;
+	}
+
+	// written before the frame is published, read after it is seen
+	std::vector<double> published( frames + 1 );
+	latencies.assign( frames, 0.0 );
+	std::atomic<int> seen( 0 );
+	int wrong = 0;
+
+	std::thread consumer( [&]()
+	{
+		unsigned int latest = 0;
+		SharedPoseFrame * pReceived = new SharedPoseFrame;
+		for ( int f = 1; f <= frames; f++ )
+		{
+			bool good;
+			if ( BENCH_UDP == wait )
+			{
+				good = BENCH_FRAME_SIZE == recv( sockets.receiver, pReceived, sizeof(*pReceived), 0 ) &&
+					   ReadFrame( *pReceived, f );
+			}
+			else
+			{
+				while ( BENCH_FUTEX == wait ? !reader.Wait( latest, 100 ) : latest == reader.GetLatest() )
+				{
+					_mm_pause();
+				}
+				latest = reader.GetLatest();
+
+				const SharedPoseFrame * pFrame = reader.BeginRead();
+				good = NULL != pFrame && ReadFrame( *pFrame, f );
+				good = reader.EndRead() && good;
+			}
+
+			latencies[f - 1] = TestNow() - published[f];
+			wrong += good ? 0 : 1;
+			seen.store( f, std::memory_order_release );
+		}
+		delete pReceived;
+	} );
+
+	SharedPoseFrame * pFrame = new SharedPoseFrame;
+	for ( int f = 1; f <= frames; f++ )
+	{
+		if ( BENCH_UDP == wait )
+		{
+			MakeFrame( f, *pFrame );
+			published[f] = TestNow();
+			sockets.Send( *pFrame );
+		}
+		else
+		{
+			MakeFrame( f, *writer.BeginWrite() );
+			published[f] = TestNow();
+			writer.EndWrite();
+		}
+
+		while ( seen.load( std::memory_order_acquire ) < f )
+		{
+			sched_yield();
+		}
+	}
+	consumer.join();
+
+	delete pFrame;
+	return wrong;
+}
+
+/// <summary>
+/// What the consumer spends on a frame that is already there
+/// </summary>
+/// <param name="rounds">frames read</param>
+/// <returns>ns per frame</returns>
+static double BenchRead( BenchWait wait, int rounds )
+{
+	SharedPoseWriter writer;
+	SharedPoseReader reader;
+	BenchSockets sockets;
+	if ( !writer.Open( false ) || !reader.Open() || !sockets.IsOpen() )
+	{
+		return 0.0;
+	}
+
+	SharedPoseFrame * pFrame = new SharedPoseFrame;
+	MakeFrame( 1, *pFrame );
+	MakeFrame( 1, *writer.BeginWrite() );
+	writer.EndWrite();
+
+	int wrong = 0;
+	double total = 0.0;
+	for ( int done = 0; done < rounds; )
+	{
+		// datagrams queue up to the receive buffer, a few at a time fit
+		int batch = ( BENCH_UDP == wait ) ? std::min( 32, rounds - done ) : rounds;
+		for ( int i = 0; i < batch && BENCH_UDP == wait; i++ )
+		{
+			sockets.Send( *pFrame );
+		}
+
+		double start = TestNow();
+		for ( int i = 0; i < batch; i++ )
+		{
+			if ( BENCH_UDP == wait )
+			{
+				wrong += ( BENCH_FRAME_SIZE == recv( sockets.receiver, pFrame, sizeof(*pFrame), 0 ) && ReadFrame( *pFrame, 1 ) ) ? 0 : 1;
+			}
+			else
+			{
+				const SharedPoseFrame * pShared = reader.BeginRead();
+				bool good = NULL != pShared && ReadFrame( *pShared, 1 );
+				wrong += ( reader.EndRead() && good ) ? 0 : 1;
+			}
+		}
+		total += TestNow() - start;
+		done += batch;
+	}
+
+	delete pFrame;
+	TEST_CHECK( 0 == wrong );
+	return total / rounds;
+}
+
+/// <summary>
+/// Value below which a share of the sorted samples lie
+/// </summary>
+static double Percentile( const std::vector<double> & sorted, double share )
+{
+	size_t i = static_cast<size_t>( share * ( sorted.size() - 1 ) );
+	return sorted[i];
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int frames = quick ? 200 : 20000;
+	int rounds = quick ? 1000 : 1000000;
+	unsigned int cores = std::thread::hardware_concurrency();
+
+	// a tracker that runs here owns the name, and the bench would take it over
+	SharedPoseReader tracker;
+	if ( tracker.Open() )
+	{
+		printf( "the tracker's shared memory is open, not measured\n" );
+		return TEST_SKIPPED;
+	}
+	SharedPoseWriter probe;
+	if ( !probe.Open( false ) )
+	{
+		printf( "no POSIX shared memory here, not measured\n" );
+		return TEST_SKIPPED;
+	}
+	probe.Close();
+
+	printf( "frame of %d persons, %d bytes as a datagram; us from publishing to the consumer having it, ns to read it\n",
+			BENCH_SKELETONS, static_cast<int>( BENCH_FRAME_SIZE ) );
+	printf( "%-24s %9s %9s %9s %9s\n", "", "median", "99%", "most", "read" );
+	for ( int wait = BENCH_FUTEX; wait <= BENCH_UDP; wait++ )
+	{
+		if ( BENCH_POLL == wait && cores < 2 )
+		{
+			printf( "%-24s %9s %9s %9s %9.0f  one core, polling not measured\n", g_WaitNames[wait], "-", "-", "-",
+					BenchRead( static_cast<BenchWait>(wait), rounds ) );
+			continue;
+		}
+
+		std::vector<double> latencies;
+		int wrong = BenchLatency( static_cast<BenchWait>(wait), frames, latencies );
+		TEST_CHECK( 0 == wrong );
+		if ( latencies.empty() )
+		{
+			continue;
+		}
+
+		std::sort( latencies.begin(), latencies.end() );
+		double read = BenchRead( static_cast<BenchWait>(wait), rounds );
+		printf( "%-24s %9.1f %9.1f %9.1f %9.0f\n", g_WaitNames[wait], Percentile( latencies, 0.5 ) / 1000.0,
+				Percentile( latencies, 0.99 ) / 1000.0, latencies.back() / 1000.0, read );
+		TEST_CHECK( read > 0.0 );
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,228 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonBatchBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Cost per skeleton frame of the stages that read joints, from the SDK's NUI_SKELETON_FRAME
+// joint by joint as they used to, and from the rows of a SkeletonBatch, conversion included.
+// Both must give the same points.
+
+#include "stdafx.h"
+#include "SensorCalibration.h"
+#include "SkeletonProjection.h"
+#include "TestCheck.h"
+#include <vector>
+
+// Frames cycled through, so no result can be computed once for all
+#define BENCH_FRAMES                    64
+
+// Skeletons the sensor tracks in each frame, of NUI_SKELETON_COUNT
+#define BENCH_TRACKED                   NUI_SKELETON_MAX_TRACKED_COUNT
+
+/// <summary>
+/// Frames with two persons walking about, their other slots not tracked
+/// </summary>
+static void MakeFrames( std::vector<NUI_SKELETON_FRAME> & frames )
+{
+	unsigned int seed = 45;
+	for ( size_t f = 0; f < frames.size(); f++ )
+	{
+		NUI_SKELETON_FRAME & frame = frames[f];
+		memset( &frame, 0, sizeof(frame) );
+		frame.dwFrameNumber = static_cast<DWORD>( f );
+		frame.liTimeStamp.QuadPart = f * 33;
+		for ( int i = 0; i < BENCH_TRACKED; i++ )
+		{
+			// every second slot, as the SDK scatters them
+			NUI_SKELETON_DATA & skeleton = frame.SkeletonData[2 * i + 1];
+			skeleton.eTrackingState = NUI_SKELETON_TRACKED;
+			skeleton.dwTrackingID = i + 1;
+			for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+			{
+				seed = seed * 1664525u + 1013904223u;
+				float jitter = ( seed >> 8 ) / 16777216.0f;
+				Vector4 & joint = skeleton.SkeletonPositions[j];
+				joint.x = -0.5f + i + 0.01f * f + 0.02f * j * jitter;
+				joint.y = 0.8f - 0.08f * j;
+				joint.z = 2.0f + 0.5f * i + 0.05f * jitter;
+				joint.w = 1.0f;
+				skeleton.eSkeletonPositionTrackingState[j] = ( 0 == ( seed >> 28 ) ) ? NUI_SKELETON_POSITION_INFERRED : NUI_SKELETON_POSITION_TRACKED;
+			}
+			skeleton.Position = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HIP_CENTER];
+		}
+	}
+}
+
+/// <summary>
+/// What the projection, selection and encoding stages read of a frame, the way they read it
+/// </summary>
+struct BenchOutput
+{
+	D2D1_POINT_2F   points[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	float           x[NUI_SKELETON_POSITION_COUNT];     // the active skeleton in the display frame
+	float           y[NUI_SKELETON_POSITION_COUNT];
+	float           z[NUI_SKELETON_POSITION_COUNT];
+	int             inferred;                           // inferred joints of tracked skeletons
+};
+
+/// <summary>
+/// Every stage straight from the SDK frame, a joint at a time
+/// </summary>
+static void StagesFromFrame( const NUI_SKELETON_FRAME & frame, const SkeletonProjector & projector,
+	const SensorCalibration & calibration, BenchOutput & out )
+{
+	int active = -1;
+	out.inferred = 0;
+	for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+	{
+		const NUI_SKELETON_DATA & skeleton = frame.SkeletonData[i];
+		if ( NUI_SKELETON_TRACKED != skeleton.eTrackingState )
+		{
+			continue;
+		}
+		active = ( active < 0 ) ? i : active;
+		for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+		{
+			out.points[i][j] = projector.Project( skeleton.SkeletonPositions[j], 640, 480 );
+			out.inferred += ( NUI_SKELETON_POSITION_INFERRED == skeleton.eSkeletonPositionTrackingState[j] ) ? 1 : 0;
+		}
+	}
+
+	for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+	{
+		float point[3];
+		calibration.Transform( frame.SkeletonData[active].SkeletonPositions[j], point );
+		out.x[j] = point[0];
+		out.y[j] = point[1];
+		out.z[j] = point[2];
+	}
+}
+
+/// <summary>
+/// Every stage from the rows of a batch
+/// </summary>
+static void StagesFromBatch( const SkeletonBatch & batch, const SkeletonProjector & projector,
+	const SensorCalibration & calibration, BenchOutput & out )
+{
+	projector.ProjectBatch( batch, 640, 480, out.points );
+
+	int active = -1;
+	out.inferred = 0;
+	for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+	{
+		if ( NUI_SKELETON_TRACKED == batch.trackingState[i] )
+		{
+			active = ( active < 0 ) ? i : active;
+			for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+			{
+				out.inferred += ( NUI_SKELETON_POSITION_INFERRED == batch.GetJointState( i, j ) ) ? 1 : 0;
+			}
+		}
+	}
+
+	calibration.TransformBatch( batch.GetX( active ), batch.GetY( active ), batch.GetZ( active ),
+		out.x, out.y, out.z, NUI_SKELETON_POSITION_COUNT );
+}
+
+/// <summary>
+/// The two ways give the same points and joint states
+/// </summary>
+static void CheckSame( const NUI_SKELETON_FRAME & frame, const BenchOutput & fromFrame, const BenchOutput & fromBatch )
+{
+	double pixels = 0.0;
+	double inches = 0.0;
+	for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+	{
+		if ( NUI_SKELETON_TRACKED != frame.SkeletonData[i].eTrackingState )
+		{
+			continue;
+		}
+		for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+		{
+			pixels = fmax( pixels, fabs( fromFrame.points[i][j].x - fromBatch.points[i][j].x ) );
+			pixels = fmax( pixels, fabs( fromFrame.points[i][j].y - fromBatch.points[i][j].y ) );
+		}
+	}
+	for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+	{
+		inches = fmax( inches, fabs( fromFrame.x[j] - fromBatch.x[j] ) );
+		inches = fmax( inches, fabs( fromFrame.y[j] - fromBatch.y[j] ) );
+		inches = fmax( inches, fabs( fromFrame.z[j] - fromBatch.z[j] ) );
+	}
+	TEST_CHECK_NEAR( pixels, 0.0, 1e-3 );
+	TEST_CHECK_NEAR( inches, 0.0, 1e-4 );
+	TEST_CHECK( fromFrame.inferred == fromBatch.inferred );
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int rounds = quick ? 1000 : 2000000;
+
+	std::vector<NUI_SKELETON_FRAME> frames( BENCH_FRAMES );
+	MakeFrames( frames );
+	SkeletonProjector projector;
+	SensorCalibration calibration;
+	const float position[3] = { 0.0f, -12.0f, 4.0f };
+	calibration.Set( position, 10.0f );
+
+	// aligned as the sensor context aligns it
+	SkeletonBatch * pBatch = new SkeletonBatch;
+	TEST_CHECK( 0 == ( reinterpret_cast<size_t>( pBatch ) & ( SKELETON_BATCH_ALIGNMENT - 1 ) ) );
+	BenchOutput * pFromFrame = new BenchOutput;
+	BenchOutput * pFromBatch = new BenchOutput;
+
+	for ( int f = 0; f < BENCH_FRAMES; f++ )
+	{
+		memset( pFromFrame, 0, sizeof(*pFromFrame) );
+		StagesFromFrame( frames[f], projector, calibration, *pFromFrame );
+		pBatch->Load( frames[f] );
+		StagesFromBatch( *pBatch, projector, calibration, *pFromBatch );
+		CheckSame( frames[f], *pFromFrame, *pFromBatch );
+	}
+
+	double start = TestNow();
+	for ( int r = 0; r < rounds; r++ )
+	{
+		StagesFromFrame( frames[r % BENCH_FRAMES], projector, calibration, *pFromFrame );
+		TestKeep( pFromFrame->inferred );
+	}
+	double aos = ( TestNow() - start ) / rounds;
+
+	start = TestNow();
+	for ( int r = 0; r < rounds; r++ )
+	{
+		pBatch->Load( frames[r % BENCH_FRAMES] );
+		TestKeep( pBatch->x[r % SKELETON_BATCH_JOINTS] );
+	}
+	double load = ( TestNow() - start ) / rounds;
+
+	start = TestNow();
+	for ( int r = 0; r < rounds; r++ )
+	{
+		StagesFromBatch( *pBatch, projector, calibration, *pFromBatch );
+		TestKeep( pFromBatch->inferred );
+	}
+	double soa = ( TestNow() - start ) / rounds;
+
+	start = TestNow();
+	for ( int r = 0; r < rounds; r++ )
+	{
+		pBatch->Load( frames[r % BENCH_FRAMES] );
+		StagesFromBatch( *pBatch, projector, calibration, *pFromBatch );
+		TestKeep( pFromBatch->inferred );
+	}
+	double both = ( TestNow() - start ) / rounds;
+
+	printf( "ns per frame of %d tracked skeletons, projection, joint states and the active skeleton's transform:\n", BENCH_TRACKED );
+	printf( "  from NUI_SKELETON_FRAME, joint by joint  %8.1f\n", aos );
+	printf( "  SkeletonBatch::Load                      %8.1f\n", load );
+	printf( "  from the SkeletonBatch rows              %8.1f\n", soa );
+	printf( "  Load and the rows                        %8.1f  %.2fx\n", both, aos / both );
+
+	delete pFromBatch;
+	delete pFromFrame;
+	delete pBatch;
+	return TestResult();
+}
@@ -0,0 +1,409 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonMergeTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Feeds one to MERGE_MAX_SENSORS synthetic sensors through SkeletonMerger and SkeletonFusion.
+// The sensors watch the same persons walking at constant speed, each from its own place,
+// with its own clock, frame phase, latency, tracking IDs and a small bias, and the fused
+// skeletons are checked against where the persons really were. A second test submits and
+// merges from separate threads, the way the sensor threads and the merge thread do, and
+// checks that no frame is ever seen half written.
+
+#include "SkeletonFusion.h"
+#include "TestCheck.h"
+#include <thread>
+#include <vector>
+
+// Persons walking through the room, and how fast along x, inches per second
+static const int g_PersonCount = 2;
+static const float g_WalkSpeed = 20.0f;
+
+// Sensor frame period and how often the merge thread runs, ms
+static const long long g_FramePeriod = 33;
+static const long long g_MergePeriod = 5;
+
+// Frames older than this are left out of the merge, ms
+static const long long g_MaxAge = 200;
+
+// Joint the sensors report as not tracked on sensor 1, any but the spine
+static const int g_HiddenJoint = 5;
+
+/// <summary>
+/// Where a joint of a person is at a time on the host clock, inches
+/// </summary>
+/// <param name="person">index of the person</param>
+/// <param name="joint">index of the joint, 1 is the spine</param>
+/// <param name="time">host clock, ms</param>
+/// <param name="position">receives x, y and z</param>
+static void TruePosition( int person, int joint, double time, float position[3] )
+{
+	position[0] = person * 60.0f - 30.0f + g_WalkSpeed * static_cast<float>( time / 1000.0 );
+	position[1] = joint * 2.0f - 10.0f;
+	position[2] = 90.0f + person * 15.0f;
+}
+
+/// <summary>
+/// One synthetic sensor
+/// </summary>
+struct TestSensor
+{
+	long long     phase;              // host time of its first capture, ms
+	long long     clockOffset;        // host clock minus its own clock, ms
+	float         position[3];        // in the display frame, inches
+	float         bias;               // inches it sees every joint off along x
+	unsigned int  idBase;             // first of the dwTrackingIDs it gives the persons
+	unsigned int  submittedIdBase;    // idBase of the last frame it submitted
+	unsigned int  frameNumber;
+	long long     nextCapture;
+	bool          unplugged;
+};
+
+/// <summary>
+/// Set up sensor i of a room, spread around the persons
+/// </summary>
+static void InitSensor( TestSensor & sensor, int index )
+{
+	static const float positions[MERGE_MAX_SENSORS][3] =
+	{
+		{ 0.0f, 0.0f, 0.0f }, { 120.0f, 0.0f, 100.0f }, { -120.0f, 0.0f, 100.0f }, { 0.0f, 20.0f, 200.0f }
+	};
+
+	sensor.phase = 7 * index;
+	sensor.clockOffset = 100000 + 31337 * index;
+	memcpy( sensor.position, positions[index], sizeof(sensor.position) );
+	sensor.bias = ( index & 1 ) ? 0.3f : -0.3f;
+	sensor.idBase = 10 * ( index + 1 );
+	sensor.submittedIdBase = sensor.idBase;
+	sensor.frameNumber = 0;
+	sensor.nextCapture = sensor.phase;
+	sensor.unplugged = false;
+}
+
+/// <summary>
+/// Submit the frame a sensor captured, as it arrives now
+/// </summary>
+/// <param name="merger">merge stage to submit to</param>
+/// <param name="sensor">sensor that captured it</param>
+/// <param name="index">index of the sensor</param>
+/// <param name="capture">host time of the capture, ms</param>
+/// <param name="now">host time it arrives, ms</param>
+static void Submit( SkeletonMerger & merger, TestSensor & sensor, int index, long long capture, long long now )
+{
+	SensorSkeletonFrame * pFrame = merger.BeginSubmit( index );
+	memset( pFrame, 0, sizeof(*pFrame) );
+	pFrame->sensorIndex = index;
+	pFrame->frameNumber = sensor.frameNumber++;
+	pFrame->submitCount = sensor.frameNumber;
+	pFrame->timestamp = capture - sensor.clockOffset;
+	pFrame->arrivalTime = now;
+	memcpy( pFrame->sensorPosition, sensor.position, sizeof(pFrame->sensorPosition) );
+	pFrame->skeletonCount = g_PersonCount;
+	sensor.submittedIdBase = sensor.idBase;
+
+	for ( int person = 0; person < g_PersonCount; person++ )
+	{
+		// the sensors do not list the persons in the same order
+		SensorSkeleton & skeleton = pFrame->skeletons[( person + index ) % g_PersonCount];
+		skeleton.trackingId = sensor.idBase + person;
+		skeleton.trackingState = 2;
+		TruePosition( person, 1, static_cast<double>(capture), skeleton.position );
+
+		for ( int joint = 0; joint < MERGE_JOINT_COUNT; joint++ )
+		{
+			float position[3];
+			TruePosition( person, joint, static_cast<double>(capture), position );
+			skeleton.jointX[joint] = position[0] + sensor.bias;
+			skeleton.jointY[joint] = position[1];
+			skeleton.jointZ[joint] = position[2];
+			skeleton.jointState[joint] = ( 1 == index && g_HiddenJoint == joint ) ? 0 : 2;
+		}
+	}
+
+	merger.EndSubmit( index );
+}
+
+/// <summary>
+/// The fused skeleton closest to a person, by its spine
+/// </summary>
+/// <returns>NULL if none is within a few inches</returns>
+static const FusedSkeleton * FindPerson( const FusedSkeletonFrame & fused, int person )
+{
+	float truth[3];
+	TruePosition( person, 1, static_cast<double>(fused.timestamp), truth );
+
+	for ( int i = 0; i < fused.skeletonCount; i++ )
+	{
+		if ( fabs( fused.skeletons[i].jointX[1] - truth[0] ) < 5.0f && fabs( fused.skeletons[i].jointZ[1] - truth[2] ) < 5.0f )
+		{
+			return &fused.skeletons[i];
+		}
+	}
+	return NULL;
+}
+
+/// <summary>
+/// Run a room of sensors for a while: sensor 0 loses and reacquires both persons at 2 s, the
+/// last sensor is unplugged at 3 s. Its last frame stays in the merge for g_MaxAge, held
+/// where it was, so the poses are only checked before and after
+/// </summary>
+/// <param name="sensorCount">sensors in the room</param>
+static void TestRoom( int sensorCount )
+{
+	SkeletonMerger merger;
+	SkeletonFusion * pFusion = new SkeletonFusion();
+	TestSensor sensors[MERGE_MAX_SENSORS];
+	for ( int i = 0; i < sensorCount; i++ )
+	{
+		InitSensor( sensors[i], i );
+	}
+
+	unsigned int globalIds[g_PersonCount] = { 0 };
+	unsigned int seed = 12345;
+	int checked = 0;
+
+	for ( long long now = 0; now <= 4000; now++ )
+	{
+		if ( 2000 == now )
+		{
+			sensors[0].idBase += 100;
+		}
+		if ( 3000 == now && sensorCount > 1 )
+		{
+			sensors[sensorCount - 1].unplugged = true;
+		}
+
+		for ( int i = 0; i < sensorCount; i++ )
+		{
+			TestSensor & sensor = sensors[i];
+			if ( now < sensor.nextCapture )
+			{
+				continue;
+			}
+
+			// arrives 2 to 9 ms after it was captured, submitted as it arrives
+			seed = seed * 1664525u + 1013904223u;
+			long long latency = 2 + ( seed >> 16 ) % 8;
+			if ( now - sensor.nextCapture >= latency )
+			{
+				if ( !sensor.unplugged )
+				{
+					Submit( merger, sensor, i, sensor.nextCapture, now );
+				}
+				sensor.nextCapture += g_FramePeriod;
+			}
+		}
+
+		if ( 0 != now % g_MergePeriod || now < 600 )
+		{
+			continue;
+		}
+
+		MergedSkeletonFrame merged;
+		merger.Merge( merged, now, g_MaxAge );
+		pFusion->Fuse( merged, now );
+		const FusedSkeletonFrame * pFused = pFusion->AcquireLatest();
+		TEST_CHECK( NULL != pFused );
+		if ( NULL == pFused )
+		{
+			return;
+		}
+
+		int live = ( now > 3000 + g_MaxAge && sensorCount > 1 ) ? sensorCount - 1 : sensorCount;
+		bool settled = !( now >= 3000 && now <= 3000 + g_MaxAge );
+		TEST_CHECK( g_PersonCount == pFused->skeletonCount );
+
+		// the common timestamp is the newest capture, give or take the least latency
+		TEST_CHECK( pFused->timestamp <= now && pFused->timestamp > now - g_FramePeriod - 10 );
+
+		for ( int person = 0; person < g_PersonCount; person++ )
+		{
+			const FusedSkeleton * pSkeleton = FindPerson( *pFused, person );
+			TEST_CHECK( NULL != pSkeleton );
+			if ( NULL == pSkeleton )
+			{
+				continue;
+			}
+
+			// the same global ID all along, whatever the sensors do with theirs
+			if ( 0 == globalIds[person] )
+			{
+				globalIds[person] = pSkeleton->globalId;
+			}
+			TEST_CHECK( globalIds[person] == pSkeleton->globalId );
+
+			if ( settled )
+			{
+				TEST_CHECK( ( 1u << live ) - 1 == pSkeleton->sensorMask );
+			}
+			TEST_CHECK( pSkeleton->sourceTrackingId[0] == sensors[0].submittedIdBase + person );
+			TEST_CHECK( pSkeleton == pFused->Find( 0, sensors[0].submittedIdBase + person ) );
+
+			// every joint where the person was, the latency and the sensors' bias aside, and
+			// the frame sensor 0 gives new IDs in, which has nothing to carry it forward from;
+			// the joint sensor 1 does not track comes from sensor 0
+			for ( int joint = 0; settled && joint < MERGE_JOINT_COUNT; joint++ )
+			{
+				float truth[3];
+				TruePosition( person, joint, static_cast<double>(pFused->timestamp), truth );
+				TEST_CHECK_NEAR( pSkeleton->jointX[joint], truth[0], 1.0 );
+				TEST_CHECK_NEAR( pSkeleton->jointY[joint], truth[1], 1e-3 );
+				TEST_CHECK_NEAR( pSkeleton->jointZ[joint], truth[2], 1e-3 );
+				TEST_CHECK( 2 == pSkeleton->jointState[joint] );
+			}
+		}
+		checked++;
+	}
+
+	TEST_CHECK( checked > 600 );
+	TEST_CHECK( 0 != globalIds[0] && globalIds[0] != globalIds[g_PersonCount - 1] );
+	delete pFusion;
+}
+
+/// <summary>
+/// Every sensor submits from its own thread as fast as it can while the merge thread merges
+/// and fuses, and a render thread picks up the fused frames. Each submitted frame is filled
+/// from its frame number, so a frame picked up half written shows
+/// </summary>
+static void TestThreads( )
+{
+	const unsigned int frameCount = 200000;
+
+	SkeletonMerger merger;
+	SkeletonFusion * pFusion = new SkeletonFusion();
+	std::atomic<int> running( MERGE_MAX_SENSORS );
+	std::atomic<bool> merging( true );
+	std::atomic<int> fusedFailures( 0 );
+
+	std::vector<std::thread> producers;
+	for ( int sensor = 0; sensor < MERGE_MAX_SENSORS; sensor++ )
+	{
+		producers.push_back( std::thread( [&merger, &running, sensor, frameCount]()
+		{
+			for ( unsigned int frame = 0; frame < frameCount; frame++ )
+			{
+				SensorSkeletonFrame * pFrame = merger.BeginSubmit( sensor );
+				pFrame->sensorIndex = sensor;
+				pFrame->frameNumber = frame;
+				pFrame->submitCount = frame + 1;
+				pFrame->timestamp = static_cast<long long>(frame) * g_FramePeriod;
+				pFrame->arrivalTime = pFrame->timestamp;
+				pFrame->sensorPosition[0] = pFrame->sensorPosition[1] = pFrame->sensorPosition[2] = 0.0f;
+				pFrame->skeletonCount = 1 + frame % MERGE_SKELETON_COUNT;
+				for ( int i = 0; i < pFrame->skeletonCount; i++ )
+				{
+					SensorSkeleton & skeleton = pFrame->skeletons[i];
+					skeleton.trackingId = sensor * 100 + i + 1;
+					skeleton.trackingState = 2;
+					for ( int joint = 0; joint < MERGE_JOINT_COUNT; joint++ )
+					{
+						skeleton.jointX[joint] = sensor * 1000.0f + i * 100.0f;
+						skeleton.jointY[joint] = static_cast<float>( frame % 1000 );
+						skeleton.jointZ[joint] = 100.0f;
+						skeleton.jointState[joint] = 2;
+					}
+					memcpy( skeleton.position, &skeleton.jointX[0], sizeof(float) );
+					skeleton.position[1] = skeleton.jointY[0];
+					skeleton.position[2] = skeleton.jointZ[0];
+				}
+				merger.EndSubmit( sensor );
+			}
+			running--;
+		} ) );
+	}
+
+	std::thread render( [pFusion, &merging, &fusedFailures]()
+	{
+		long long newest = -1;
+		while ( merging.load() )
+		{
+			const FusedSkeletonFrame * pFused = pFusion->AcquireLatest();
+			if ( NULL == pFused )
+			{
+				continue;
+			}
+			if ( pFused->timestamp < newest || pFused->skeletonCount > FUSION_MAX_SKELETONS )
+			{
+				fusedFailures++;
+			}
+			newest = pFused->timestamp;
+		}
+	} );
+
+	unsigned int lastFrame[MERGE_MAX_SENSORS] = { 0 };
+	bool seen[MERGE_MAX_SENSORS] = { false };
+	int torn = 0;
+	int merges = 0;
+	bool done = false;
+	while ( !done )
+	{
+		// after the producers finished, one more merge picks up their last frames
+		done = ( 0 == running.load() );
+
+		MergedSkeletonFrame merged;
+		unsigned int freshMask = merger.Merge( merged, 0, 1LL << 40 ) ? merged.freshMask : 0;
+		TEST_CHECK( merged.frameCount <= MERGE_MAX_SENSORS );
+
+		for ( int f = 0; f < merged.frameCount; f++ )
+		{
+			const SensorSkeletonFrame & frame = *merged.frames[f];
+			int sensor = frame.sensorIndex;
+			bool fresh = 0 != ( freshMask & ( 1u << sensor ) );
+
+			// a new frame is newer than the last, an old one is the same
+			if ( seen[sensor] && ( fresh ? frame.frameNumber <= lastFrame[sensor] : frame.frameNumber != lastFrame[sensor] ) )
+			{
+				torn++;
+			}
+			seen[sensor] = true;
+			lastFrame[sensor] = frame.frameNumber;
+
+			bool whole = frame.submitCount == frame.frameNumber + 1 &&
+						 frame.timestamp == static_cast<long long>(frame.frameNumber) * g_FramePeriod &&
+						 frame.skeletonCount == 1 + static_cast<int>( frame.frameNumber % MERGE_SKELETON_COUNT );
+			for ( int i = 0; whole && i < frame.skeletonCount; i++ )
+			{
+				const SensorSkeleton & skeleton = frame.skeletons[i];
+				whole = skeleton.trackingId == static_cast<unsigned int>( sensor * 100 + i + 1 );
+				for ( int joint = 0; whole && joint < MERGE_JOINT_COUNT; joint++ )
+				{
+					whole = skeleton.jointX[joint] == sensor * 1000.0f + i * 100.0f &&
+							skeleton.jointY[joint] == static_cast<float>( frame.frameNumber % 1000 );
+				}
+			}
+			if ( !whole )
+			{
+				torn++;
+			}
+		}
+
+		pFusion->Fuse( merged, static_cast<long long>( merges ) );
+		merges++;
+	}
+
+	merging = false;
+	render.join();
+	for ( size_t i = 0; i < producers.size(); i++ )
+	{
+		producers[i].join();
+	}
+
+	TEST_CHECK( 0 == torn );
+	TEST_CHECK( 0 == fusedFailures.load() );
+	for ( int sensor = 0; sensor < MERGE_MAX_SENSORS; sensor++ )
+	{
+		TEST_CHECK( seen[sensor] && frameCount - 1 == lastFrame[sensor] );
+	}
+	delete pFusion;
+}
+
+int main( )
+{
+	for ( int sensorCount = 1; sensorCount <= MERGE_MAX_SENSORS; sensorCount++ )
+	{
+		TestRoom( sensorCount );
+	}
+	TestThreads();
+	return TestResult();
+}
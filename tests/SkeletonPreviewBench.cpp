@@ -0,0 +1,344 @@
+//------------------------------------------------------------------------------
+// <copyright file="SkeletonPreviewBench.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// CPU time per frame of drawing the preview's skeletons, the way DrawDevice did before
+// SkeletonPreview, a DrawLine per bone and a FillEllipse per joint in the duplicated seated
+// and default sequences, and with SkeletonPreview's lists, into a Direct2D stand-in that
+// records every call. SkeletonPreview must make the same calls, every line then every
+// ellipse.
+//
+// A recorded call costs about what appending it to Direct2D's command list does; the work
+// Direct2D does later per call, and the driver's, is not in these numbers. On Windows the
+// overlay stage of the metrics has it.
+
+#include "stdafx.h"
+#include "SkeletonPreview.h"
+#include "TestCheck.h"
+#include <vector>
+
+// Frames cycled through, so no result can be computed once for all
+#define BENCH_FRAMES                    64
+
+// Line width and ellipse radius of the calls SkeletonPreview replaced
+static const float g_BoneThickness = 3.0f;
+static const float g_JointThickness = 2.5f;
+
+/// <summary>
+/// What the preview reads of a frame
+/// </summary>
+struct BenchFrame
+{
+	D2D1_POINT_2F                   points[NUI_SKELETON_COUNT][NUI_SKELETON_POSITION_COUNT];
+	D2D1_POINT_2F                   position[NUI_SKELETON_COUNT];
+	NUI_SKELETON_TRACKING_STATE     trackingState[NUI_SKELETON_COUNT];
+	unsigned int                    trackedMask[NUI_SKELETON_COUNT];
+	unsigned int                    inferredMask[NUI_SKELETON_COUNT];
+};
+
+/// <summary>
+/// Persons in front of the sensor
+/// </summary>
+struct BenchScene
+{
+	const char *    pName;
+	int             tracked;        // skeletons with joints
+	int             positions;      // skeletons with only a position
+	bool            seated;
+};
+
+static const BenchScene g_Scenes[] =
+{
+	{ "2 tracked, 4 positions",     NUI_SKELETON_MAX_TRACKED_COUNT, NUI_SKELETON_COUNT - NUI_SKELETON_MAX_TRACKED_COUNT, false },
+	{ "2 tracked, seated",          NUI_SKELETON_MAX_TRACKED_COUNT, 0,                                                  true },
+	{ "6 tracked",                  NUI_SKELETON_COUNT,             0,                                                  false },
+};
+
+/// <summary>
+/// Frames of a scene, most joints tracked, a few inferred or lost
+/// </summary>
+static void MakeFrames( const BenchScene & scene, std::vector<BenchFrame> & frames )
+{
+	unsigned int seed = 50;
+	for ( size_t f = 0; f < frames.size(); f++ )
+	{
+		BenchFrame & frame = frames[f];
+		memset( &frame, 0, sizeof(frame) );
+		for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
+		{
+			frame.trackingState[i] = ( i < scene.tracked ) ? NUI_SKELETON_TRACKED :
+				( i < scene.tracked + scene.positions ) ? NUI_SKELETON_POSITION_ONLY : NUI_SKELETON_NOT_TRACKED;
+			frame.position[i] = D2D1::Point2F( 80.0f + 90.0f * i + f, 240.0f );
+			for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+			{
+				seed = seed * 1664525u + 1013904223u;
+				float jitter = ( seed >> 8 ) / 16777216.0f;
+				frame.points[i][j] = D2D1::Point2F( 60.0f + 100.0f * i + 40.0f * jitter + 0.5f * f, 60.0f + 18.0f * j + 3.0f * jitter );
+				unsigned int state = seed >> 27;
+				frame.trackedMask[i] |= ( state >= 3 ) ? ( 1u << j ) : 0;
+				frame.inferredMask[i] |= ( 1 == state || 2 == state ) ? ( 1u << j ) : 0;
+			}
+		}
+	}
+}
+
+// The Direct2D stand-in, every call recorded. The timed runs only count the calls and add up
+// their points, so what is timed is the code that makes them
+
+// false while timing
+static bool g_Record = true;
+
+enum RecordedKind
+{
+	RECORDED_LINE = 0,
+	RECORDED_ELLIPSE
+};
+
+struct RecordedCall
+{
+	RecordedKind            kind;
+	D2D1_POINT_2F           point0;         // start of the line, center of the ellipse
+	D2D1_POINT_2F           point1;         // end of the line
+	float                   size;           // width of the line, radius of the ellipse
+};
+
+class RecordingTarget : public ID2D1RenderTarget
+{
+public:
+	RecordingTarget() : m_sum(0.0f) { m_calls.reserve( PREVIEW_MAX_BONES + PREVIEW_MAX_DOTS ); }
+
+	ULONG AddRef( ) { return 1; }
+	ULONG Release( ) { return 1; }
+
+	void DrawLine( D2D1_POINT_2F point0, D2D1_POINT_2F point1, ID2D1Brush *, FLOAT strokeWidth )
+	{
+		RecordedCall call = { RECORDED_LINE, point0, point1, strokeWidth };
+		Record( call );
+	}
+
+	void FillEllipse( const D2D1_ELLIPSE * pEllipse, ID2D1Brush * )
+	{
+		RecordedCall call = { RECORDED_ELLIPSE, pEllipse->point, pEllipse->point, pEllipse->radiusX };
+		Record( call );
+	}
+
+	void Record( const RecordedCall & call )
+	{
+		if ( g_Record )
+		{
+			m_calls.push_back( call );
+		}
+		else
+		{
+			m_sum += call.point0.x;
+		}
+	}
+
+	std::vector<RecordedCall> m_calls;
+	float                   m_sum;
+};
+
+class RecordingBrush : public ID2D1Brush
+{
+public:
+	ULONG AddRef( ) { return 1; }
+	ULONG Release( ) { return 1; }
+};
+
+// Before and after
+
+/// <summary>
+/// A bone as DrawDevice::DrawBone drew it
+/// </summary>
+static void DrawBone( const BenchFrame & frame, int i, NUI_SKELETON_POSITION_INDEX bone0, NUI_SKELETON_POSITION_INDEX bone1,
+	ID2D1RenderTarget * pRenderTarget, ID2D1Brush * pBrush )
+{
+	unsigned int bones = ( 1u << bone0 ) | ( 1u << bone1 );
+
+	if ( frame.trackedMask[i] & bones )
+		pRenderTarget->DrawLine( frame.points[i][bone0], frame.points[i][bone1], pBrush, g_BoneThickness );
+}
+
+/// <summary>
+/// The skeletons as DrawDevice::ProcessSkeletonFrame drew them before SkeletonPreview
+/// </summary>
+static void DrawBefore( const BenchFrame & frame, bool seated, ID2D1RenderTarget * pRenderTarget, ID2D1Brush * pBrush )
+{
+	for ( int i = 0 ; i < NUI_SKELETON_COUNT; i++ )
+	{
+		NUI_SKELETON_TRACKING_STATE trackingState = frame.trackingState[i];
+		if ( trackingState == NUI_SKELETON_TRACKED )
+		{
+			if ( seated )
+			{
+				DrawBone( frame, i, NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT, pRenderTarget, pBrush );
+			}
+			else
+			{
+				DrawBone( frame, i, NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SPINE, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_HIP_CENTER, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, pRenderTarget, pBrush );
+
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT, pRenderTarget, pBrush );
+
+				DrawBone( frame, i, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT, pRenderTarget, pBrush );
+
+				DrawBone( frame, i, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT, pRenderTarget, pBrush );
+
+				DrawBone( frame, i, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, pRenderTarget, pBrush );
+				DrawBone( frame, i, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT, pRenderTarget, pBrush );
+			}
+			for ( int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++ )
+			{
+				D2D1_ELLIPSE ellipse = D2D1::Ellipse( frame.points[i][j], g_JointThickness, g_JointThickness );
+				if ( ( frame.trackedMask[i] | frame.inferredMask[i] ) & ( 1u << j ) )
+					pRenderTarget->FillEllipse( ellipse, pBrush );
+			}
+		}
+		else if ( trackingState == NUI_SKELETON_POSITION_ONLY )
+		{
+			D2D1_ELLIPSE ellipse = D2D1::Ellipse( frame.position[i], g_JointThickness, g_JointThickness );
+			pRenderTarget->FillEllipse( ellipse, pBrush );
+		}
+	}
+}
+
+/// <summary>
+/// The skeletons as DrawDevice::ProcessSkeletonFrame draws them now
+/// </summary>
+/// <param name="pRenderTarget">NULL to build the lists and not draw them</param>
+static void DrawAfter( const BenchFrame & frame, bool seated, SkeletonPreview & preview, ID2D1RenderTarget * pRenderTarget, ID2D1Brush * pBrush )
+{
+	preview.Clear();
+	for ( int i = 0 ; i < NUI_SKELETON_COUNT; i++ )
+	{
+		if ( NUI_SKELETON_TRACKED == frame.trackingState[i] )
+		{
+			preview.AddSkeleton( frame.points[i], frame.trackedMask[i], frame.inferredMask[i], seated );
+		}
+		else if ( NUI_SKELETON_POSITION_ONLY == frame.trackingState[i] )
+		{
+			preview.AddDot( frame.position[i] );
+		}
+	}
+	if ( NULL != pRenderTarget )
+	{
+		preview.Draw( pRenderTarget, pBrush );
+	}
+}
+
+/// <summary>
+/// The calls after are the calls before: the lines in the order they were drawn, a skeleton
+/// at a time, then the ellipses in theirs
+/// </summary>
+static void CheckSame( const std::vector<RecordedCall> & before, const std::vector<RecordedCall> & after )
+{
+	TEST_CHECK( before.size() == after.size() );
+
+	size_t k = 0;
+	int wrong = 0;
+	for ( int kind = RECORDED_LINE; kind <= RECORDED_ELLIPSE; kind++ )
+	{
+		for ( size_t b = 0; b < before.size() && k < after.size(); b++ )
+		{
+			if ( kind != before[b].kind )
+			{
+				continue;
+			}
+
+			const RecordedCall & call = before[b];
+			const RecordedCall & made = after[k++];
+			wrong += ( made.kind == call.kind && made.size == call.size &&
+					   made.point0.x == call.point0.x && made.point0.y == call.point0.y &&
+					   made.point1.x == call.point1.x && made.point1.y == call.point1.y ) ? 0 : 1;
+		}
+	}
+	TEST_CHECK( 0 == wrong );
+}
+
+int main( int argc, char ** argv )
+{
+	bool quick = TestQuick( argc, argv );
+	int rounds = quick ? 1000 : 1000000;
+
+	std::vector<BenchFrame> frames( BENCH_FRAMES );
+	SkeletonPreview * pPreview = new SkeletonPreview;
+	RecordingTarget target;
+	RecordingBrush brush;
+
+	printf( "ns per frame of the preview's skeletons, into a Direct2D stand-in:\n" );
+	printf( "%-24s %8s %8s %8s %8s %8s\n", "", "calls", "before", "after", "lists", "ratio" );
+	for ( size_t s = 0; s < sizeof(g_Scenes) / sizeof(g_Scenes[0]); s++ )
+	{
+		const BenchScene & scene = g_Scenes[s];
+		MakeFrames( scene, frames );
+
+		// the same calls, frame by frame
+		std::vector<RecordedCall> before;
+		int calls = 0;
+		for ( int f = 0; f < BENCH_FRAMES; f++ )
+		{
+			target.m_calls.clear();
+			DrawBefore( frames[f], scene.seated, &target, &brush );
+			before = target.m_calls;
+			calls += static_cast<int>( before.size() );
+
+			target.m_calls.clear();
+			DrawAfter( frames[f], scene.seated, *pPreview, &target, &brush );
+			CheckSame( before, target.m_calls );
+		}
+
+		g_Record = false;
+		double start = TestNow();
+		for ( int r = 0; r < rounds; r++ )
+		{
+			DrawBefore( frames[r % BENCH_FRAMES], scene.seated, &target, &brush );
+		}
+		double beforeTime = ( TestNow() - start ) / rounds;
+
+		start = TestNow();
+		for ( int r = 0; r < rounds; r++ )
+		{
+			DrawAfter( frames[r % BENCH_FRAMES], scene.seated, *pPreview, &target, &brush );
+		}
+		double afterTime = ( TestNow() - start ) / rounds;
+		TestKeep( target.m_sum );
+		g_Record = true;
+
+		// of it, the lists without the calls
+		start = TestNow();
+		for ( int r = 0; r < rounds; r++ )
+		{
+			DrawAfter( frames[r % BENCH_FRAMES], scene.seated, *pPreview, NULL, &brush );
+		}
+		double listTime = ( TestNow() - start ) / rounds;
+
+		printf( "%-24s %8.1f %8.0f %8.0f %8.0f %7.2fx\n", scene.pName, static_cast<double>(calls) / BENCH_FRAMES,
+				beforeTime, afterTime, listTime, afterTime / beforeTime );
+	}
+	printf( "calls are the DrawLine and FillEllipse calls per frame, the same number both ways\n" );
+
+	delete pPreview;
+	return TestResult();
+}
@@ -0,0 +1,122 @@
+//------------------------------------------------------------------------------
+// <copyright file="TestCheck.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Checks and timing shared by the tests and benchmarks. A failed check prints where it
+// is and goes on, so one run shows every failure; main returns TestResult(). Only depends
+// on the standard library.
+
+#pragma once
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_CHECK( condition ) \
+	TestCheck( ( condition ), #condition, __FILE__, __LINE__ )
+
+#define TEST_CHECK_NEAR( actual, expected, tolerance ) \
+	TestCheckNear( ( actual ), ( expected ), ( tolerance ), #actual, __FILE__, __LINE__ )
+
+// Exit code that tells ctest a test could not run here, e.g. without multicast on loopback
+#define TEST_SKIPPED                    77
+
+/// <summary>
+/// Failed checks so far
+/// </summary>
+inline int & TestFailures( )
+{
+	static int failures = 0;
+	return failures;
+}
+
+/// <summary>
+/// Count and print a failed check
+/// </summary>
+/// <returns>the condition</returns>
+inline bool TestCheck( bool condition, const char * text, const char * file, int line )
+{
+	if ( !condition )
+	{
+		printf( "%s(%d): check failed: %s\n", file, line, text );
+		TestFailures()++;
+	}
+	return condition;
+}
+
+/// <summary>
+/// Count and print a value further than the tolerance from the one expected
+/// </summary>
+/// <returns>true if it is within the tolerance</returns>
+inline bool TestCheckNear( double actual, double expected, double tolerance, const char * text, const char * file, int line )
+{
+	bool near = fabs( actual - expected ) <= tolerance;
+	if ( !near )
+	{
+		printf( "%s(%d): check failed: %s is %.9g, expected %.9g within %g\n", file, line, text, actual, expected, tolerance );
+		TestFailures()++;
+	}
+	return near;
+}
+
+/// <summary>
+/// Exit code of the test
+/// </summary>
+/// <returns>0 if every check passed</returns>
+inline int TestResult( )
+{
+	if ( 0 != TestFailures() )
+	{
+		printf( "%d check(s) failed\n", TestFailures() );
+		return 1;
+	}
+	printf( "passed\n" );
+	return 0;
+}
+
+/// <summary>
+/// Monotonic clock for the benchmarks
+/// </summary>
+/// <returns>nanoseconds</returns>
+inline double TestNow( )
+{
+	return static_cast<double>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+/// <summary>
+/// Whether a benchmark should only run long enough to show it works, as ctest runs it
+/// </summary>
+/// <returns>true if "--quick" is among the arguments</returns>
+inline bool TestQuick( int argc, char ** argv )
+{
+	for ( int i = 1; i < argc; i++ )
+	{
+		if ( 0 == strcmp( argv[i], "--quick" ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Where TestKeep writes
+/// </summary>
+inline volatile char & TestSink( )
+{
+	static volatile char sink = 0;
+	return sink;
+}
+
+/// <summary>
+/// Keep the compiler from dropping a result nothing reads. One thread at a time
+/// </summary>
+template <class T>
+inline void TestKeep( const T & value )
+{
+	TestSink() = *reinterpret_cast<const volatile char *>( &value );
+}
@@ -0,0 +1,224 @@
+//------------------------------------------------------------------------------
+// <copyright file="TrackerSettingsTest.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// kinectInfo.cfg through TrackerSettings: a file with every line reads as typed, what Write
+// saves reads back to the same settings, a file with one bad line changes nothing, and
+// Compare names the group of every field that differs.
+
+#include "TrackerSettings.h"
+#include "TestCheck.h"
+#include <sstream>
+
+// A file with every fixed line and every keyword
+static const char * g_File =
+	"9000\n"
+	"1 3 1\n"
+	"-12.5 40.25 3 -10\n"
+	"0.6 0.4 0.3 0.05 0.02\n"
+	"192.168.1.20 5000\n"
+	"\n"
+	"10.0.0.7 5001\n"
+	"\n"
+	"\n"
+	"\n"
+	"sensor 2 60 38.5 -4 5\n"
+	"multicast 239.255.42.99 9200 4 192.168.1.5\n"
+	"metrics 9100 9101\n"
+	"trace 50\n"
+	"eyes 2.6 0.1 -0.3 0.25\n"
+	"pointcloud cloud.bin -1 1.5\n";
+
+/// <summary>
+/// Read a file from text
+/// </summary>
+static bool Read( TrackerSettings & settings, const std::string & text, std::string & error )
+{
+	std::istringstream in( text );
+	return settings.Read( in, error );
+}
+
+/// <summary>
+/// The reference file with one line replaced
+/// </summary>
+/// <param name="line">line number, from 1</param>
+static std::string Replace( int line, const std::string & text )
+{
+	std::istringstream in( g_File );
+	std::string result;
+	std::string current;
+	for ( int i = 1; std::getline( in, current ); i++ )
+	{
+		result += ( i == line ? text : current ) + "\n";
+	}
+	return result;
+}
+
+/// <summary>
+/// Every value of the reference file, as typed
+/// </summary>
+static void TestRead( )
+{
+	TrackerSettings settings;
+	std::string error;
+	TEST_CHECK( Read( settings, g_File, error ) );
+	TEST_CHECK( error.empty() );
+
+	TEST_CHECK( 9000 == settings.listenPort );
+	TEST_CHECK( 1 == settings.trackingMode && 3 == settings.trackedSkeletons && 1 == settings.range );
+	TEST_CHECK( -12.5f == settings.sensorPosition[0][0] && 40.25f == settings.sensorPosition[0][1] && 3.0f == settings.sensorPosition[0][2] );
+	TEST_CHECK( -10 == settings.sensorAngle[0] );
+	TEST_CHECK( 60.0f == settings.sensorPosition[2][0] && 38.5f == settings.sensorPosition[2][1] && -4.0f == settings.sensorPosition[2][2] );
+	TEST_CHECK( 5 == settings.sensorAngle[2] && 0 == settings.sensorAngle[1] );
+	TEST_CHECK( 0.6f == settings.smoothing && 0.02f == settings.maxDeviationRadius );
+	TEST_CHECK( "192.168.1.20" == settings.ipAddress[0] && "5000" == settings.port[0] );
+	TEST_CHECK( settings.ipAddress[1].empty() && "10.0.0.7" == settings.ipAddress[2] && "5001" == settings.port[2] );
+	TEST_CHECK( "239.255.42.99" == settings.multicastGroup && "9200" == settings.multicastPort );
+	TEST_CHECK( 4 == settings.multicastTtl && "192.168.1.5" == settings.multicastInterface );
+	TEST_CHECK( 9100 == settings.metricsPort && 9101 == settings.echoPort );
+	TEST_CHECK( settings.traceEnabled && 50 == settings.traceThreshold );
+	TEST_CHECK( 2.6f == settings.eyes.ipd && 0.1f == settings.eyes.height && -0.3f == settings.eyes.forward && 0.25f == settings.eyes.smoothing );
+	TEST_CHECK( "cloud.bin" == settings.pointCloudFile && -1 == settings.pointCloudPlayer && 1.5f == settings.pointCloudVoxelSize );
+
+	// the optional values of a keyword take their defaults
+	TEST_CHECK( Read( settings, Replace( 16, "pointcloud cloud.bin" ), error ) );
+	TEST_CHECK( 0 == settings.pointCloudPlayer && 0.0f == settings.pointCloudVoxelSize );
+	TEST_CHECK( Read( settings, Replace( 12, "multicast ff15::4b 9200" ), error ) );
+	TEST_CHECK( 1 == settings.multicastTtl && settings.multicastInterface.empty() );
+}
+
+/// <summary>
+/// Write then Read gives back the same settings, floats included
+/// </summary>
+static void TestRoundTrip( )
+{
+	TrackerSettings settings;
+	std::string error;
+	TEST_CHECK( Read( settings, g_File, error ) );
+
+	// values a short decimal does not hold exactly
+	settings.smoothing = 1.0f / 3.0f;
+	settings.sensorPosition[1][0] = 0.1f + 0.2f;
+	settings.pointCloudVoxelSize = 2.0f / 3.0f;
+
+	std::ostringstream out;
+	settings.Write( out );
+	TrackerSettings read;
+	TEST_CHECK( Read( read, out.str(), error ) );
+	TEST_CHECK( 0 == read.Compare( settings ) );
+
+	// and so does a file without the optional lines
+	TrackerSettings defaults;
+	std::ostringstream empty;
+	defaults.Write( empty );
+	TEST_CHECK( Read( read, empty.str(), error ) );
+	TEST_CHECK( 0 == read.Compare( defaults ) );
+	TEST_CHECK( read.pointCloudFile.empty() && read.multicastGroup.empty() && !read.traceEnabled );
+}
+
+/// <summary>
+/// One bad line rejects the whole file, naming the line, and leaves the settings as they were
+/// </summary>
+static void TestInvalid( )
+{
+	const struct
+	{
+		int         line;
+		const char * text;
+	} bad[] =
+	{
+		{ 1, "70000" },
+		{ 2, "1 3" },
+		{ 3, "0 0 20000 0" },
+		{ 5, "192.168.1.20 0" },
+		{ 11, "sensor 4 0 0 0 0" },
+		{ 11, "sensor 2 0 0 0 30" },
+		{ 12, "multicast 239.255.42.99 9200 300" },
+		{ 13, "metrics" },
+		{ 14, "trace -5" },
+		{ 15, "eyes 2.5 0 0 1" },
+		{ 16, "pointcloud" },
+		{ 16, "pointcloud cloud.bin 7" },
+		{ 16, "pointcloud cloud.bin 0 -1" },
+		{ 16, "pointcloud cloud.bin 0 1 extra" },
+		{ 16, "colour blue" }
+	};
+
+	for ( size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++ )
+	{
+		TrackerSettings settings;
+		std::string error;
+		TEST_CHECK( Read( settings, g_File, error ) );
+		TrackerSettings before = settings;
+
+		TEST_CHECK( !Read( settings, Replace( bad[i].line, bad[i].text ), error ) );
+		std::ostringstream line;
+		line << bad[i].line;
+		TEST_CHECK( std::string::npos != error.find( line.str() ) );
+		TEST_CHECK( 0 == settings.Compare( before ) );
+	}
+}
+
+/// <summary>
+/// Every field is in the group it reconfigures, and only there
+/// </summary>
+static void TestCompare( )
+{
+	TrackerSettings base;
+	std::string error;
+	TEST_CHECK( Read( base, g_File, error ) );
+	TEST_CHECK( 0 == base.Compare( base ) );
+
+	TrackerSettings other = base;
+	other.listenPort++;
+	TEST_CHECK( SETTINGS_CHANGED_LISTEN == other.Compare( base ) );
+
+	other = base;
+	other.sensorAngle[0] = 0;
+	TEST_CHECK( ( SETTINGS_CHANGED_ANGLE | SETTINGS_CHANGED_POSE ) == other.Compare( base ) );
+
+	other = base;
+	other.sensorPosition[3][1] = 1.0f;
+	TEST_CHECK( SETTINGS_CHANGED_POSE == other.Compare( base ) );
+
+	other = base;
+	other.jitterRadius = 0.1f;
+	TEST_CHECK( SETTINGS_CHANGED_SMOOTHING == other.Compare( base ) );
+
+	other = base;
+	other.port[5] = "6000";
+	TEST_CHECK( SETTINGS_CHANGED_DESTINATIONS == other.Compare( base ) );
+
+	other = base;
+	other.multicastTtl = 1;
+	TEST_CHECK( SETTINGS_CHANGED_MULTICAST == other.Compare( base ) );
+
+	other = base;
+	other.echoPort = 0;
+	TEST_CHECK( SETTINGS_CHANGED_METRICS == other.Compare( base ) );
+
+	other = base;
+	other.traceThreshold = 0;
+	TEST_CHECK( SETTINGS_CHANGED_TRACE == other.Compare( base ) );
+
+	other = base;
+	other.eyes.forward = 0.0f;
+	TEST_CHECK( SETTINGS_CHANGED_EYES == other.Compare( base ) );
+
+	other = base;
+	other.pointCloudPlayer = 2;
+	TEST_CHECK( SETTINGS_CHANGED_POINT_CLOUD == other.Compare( base ) );
+	other.pointCloudFile = "";
+	TEST_CHECK( SETTINGS_CHANGED_POINT_CLOUD == other.Compare( base ) );
+}
+
+int main( )
+{
+	TestRead();
+	TestRoundTrip();
+	TestInvalid();
+	TestCompare();
+	return TestResult();
+}
@@ -0,0 +1,46 @@
+//------------------------------------------------------------------------------
+// <copyright file="irrMath.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for Irrlicht's irrMath.h, the constants and helpers quaternion.h uses, as the
+// engine defines them.
+
+#pragma once
+
+#include <math.h>
+#include "irrTypes.h"
+
+namespace irr
+{
+namespace core
+{
+	const f32 ROUNDING_ERROR_f32 = 0.000001f;
+	const f32 PI = 3.14159265359f;
+	const f64 PI64 = 3.1415926535897932384626433832795028841971693993751;
+	const f32 RADTODEG = 180.0f / PI;
+	const f32 DEGTORAD = PI / 180.0f;
+
+	inline bool equals( const f32 a, const f32 b, const f32 tolerance = ROUNDING_ERROR_f32 )
+	{
+		return ( a + tolerance >= b ) && ( a - tolerance <= b );
+	}
+
+	inline bool iszero( const f32 a, const f32 tolerance = ROUNDING_ERROR_f32 )
+	{
+		return fabsf( a ) <= tolerance;
+	}
+
+	inline f32 reciprocal_squareroot( const f32 x ) { return 1.0f / sqrtf( x ); }
+	inline f64 reciprocal_squareroot( const f64 x ) { return 1.0 / sqrt( x ); }
+	inline f32 reciprocal( const f32 x ) { return 1.0f / x; }
+	inline f32 squareroot( const f32 x ) { return sqrtf( x ); }
+
+	template <class T>
+	inline const T & clamp( const T & value, const T & low, const T & high )
+	{
+		return ( value < low ) ? low : ( ( value > high ) ? high : value );
+	}
+} // end namespace core
+} // end namespace irr
@@ -0,0 +1,18 @@
+//------------------------------------------------------------------------------
+// <copyright file="irrTypes.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for Irrlicht's irrTypes.h, the types quaternion.h uses, so the tests can compare
+// QuaternionBatch.h with it without the engine.
+
+#pragma once
+
+namespace irr
+{
+	typedef float           f32;
+	typedef double          f64;
+	typedef int             s32;
+	typedef unsigned int    u32;
+}
@@ -0,0 +1,47 @@
+//------------------------------------------------------------------------------
+// <copyright file="matrix4.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for Irrlicht's matrix4.h: sixteen floats, row major as the engine stores them,
+// and the members quaternion.h uses.
+
+#pragma once
+
+#include "vector3d.h"
+
+namespace irr
+{
+namespace core
+{
+	class matrix4
+	{
+	public:
+		matrix4()
+		{
+			for ( u32 i = 0; i < 16; i++ )
+			{
+				M[i] = ( 0 == i % 5 ) ? 1.0f : 0.0f;
+			}
+		}
+
+		f32 & operator[]( u32 index ) { return M[index]; }
+		const f32 & operator[]( u32 index ) const { return M[index]; }
+
+		f32 * pointer() { return M; }
+		const f32 * pointer() const { return M; }
+
+		vector3df getTranslation() const { return vector3df( M[12], M[13], M[14] ); }
+
+		// the engine keeps a flag for faster products, nothing to keep here
+		void setDefinitelyIdentityMatrix( bool ) {}
+
+		// only quaternion::getMatrixCenter calls it, which the tests do not
+		void setRotationCenter( const vector3df &, const vector3df & ) {}
+
+	private:
+		f32 M[16];
+	};
+} // end namespace core
+} // end namespace irr
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+// <copyright file="vector3d.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for Irrlicht's vector3d.h, the operations quaternion.h uses.
+
+#pragma once
+
+#include "irrMath.h"
+
+namespace irr
+{
+namespace core
+{
+	template <class T>
+	class vector3d
+	{
+	public:
+		vector3d() : X(0), Y(0), Z(0) {}
+		vector3d( T x, T y, T z ) : X(x), Y(y), Z(z) {}
+
+		vector3d operator+( const vector3d & other ) const { return vector3d( X + other.X, Y + other.Y, Z + other.Z ); }
+		vector3d operator-( const vector3d & other ) const { return vector3d( X - other.X, Y - other.Y, Z - other.Z ); }
+		vector3d operator-() const { return vector3d( -X, -Y, -Z ); }
+		vector3d operator*( const T scale ) const { return vector3d( X * scale, Y * scale, Z * scale ); }
+		vector3d & operator*=( const T scale ) { X *= scale; Y *= scale; Z *= scale; return *this; }
+
+		vector3d & set( const T x, const T y, const T z ) { X = x; Y = y; Z = z; return *this; }
+
+		T dotProduct( const vector3d & other ) const { return X * other.X + Y * other.Y + Z * other.Z; }
+
+		vector3d crossProduct( const vector3d & p ) const
+		{
+			return vector3d( Y * p.Z - Z * p.Y, Z * p.X - X * p.Z, X * p.Y - Y * p.X );
+		}
+
+		T getLength() const { return sqrt( X * X + Y * Y + Z * Z ); }
+
+		vector3d & normalize()
+		{
+			T length = X * X + Y * Y + Z * Z;
+			if ( 0 == length )
+			{
+				return *this;
+			}
+			length = reciprocal_squareroot( length );
+			X *= length;
+			Y *= length;
+			Z *= length;
+			return *this;
+		}
+
+		T X;
+		T Y;
+		T Z;
+	};
+
+	typedef vector3d<f32> vector3df;
+} // end namespace core
+} // end namespace irr
@@ -0,0 +1,86 @@
+//------------------------------------------------------------------------------
+// <copyright file="DebugHeap.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// The CRT debug heap's allocation hook, on glibc: malloc, calloc, realloc and the aligned
+// allocations are replaced by ones that call the hook before going to the C library.
+// operator new allocates with malloc, so it calls the hook too. Linked into a test, it
+// sees every allocation of the process.
+
+#include <crtdbg.h>
+#include <errno.h>
+#include <stdlib.h>
+
+extern "C"
+{
+	void * __libc_malloc( size_t size );
+	void * __libc_calloc( size_t count, size_t size );
+	void * __libc_realloc( void * pBlock, size_t size );
+	void * __libc_memalign( size_t alignment, size_t size );
+}
+
+static _CRT_ALLOC_HOOK g_Hook = NULL;
+static long g_Request = 0;
+
+/// <summary>
+/// Install the hook every allocation calls
+/// </summary>
+/// <param name="hook">new hook, NULL for none</param>
+/// <returns>the previous hook</returns>
+_CRT_ALLOC_HOOK _CrtSetAllocHook( _CRT_ALLOC_HOOK hook )
+{
+	return __atomic_exchange_n( &g_Hook, hook, __ATOMIC_SEQ_CST );
+}
+
+/// <summary>
+/// Ask the hook about an allocation
+/// </summary>
+/// <returns>false if the hook refused it</returns>
+static bool CallHook( int allocType, void * pBlock, size_t size )
+{
+	_CRT_ALLOC_HOOK hook = __atomic_load_n( &g_Hook, __ATOMIC_ACQUIRE );
+	if ( NULL == hook )
+	{
+		return true;
+	}
+
+	long request = __atomic_add_fetch( &g_Request, 1, __ATOMIC_RELAXED );
+	return 0 != hook( allocType, pBlock, size, _NORMAL_BLOCK, request, NULL, 0 );
+}
+
+extern "C" void * malloc( size_t size )
+{
+	return CallHook( _HOOK_ALLOC, NULL, size ) ? __libc_malloc( size ) : NULL;
+}
+
+extern "C" void * calloc( size_t count, size_t size )
+{
+	return CallHook( _HOOK_ALLOC, NULL, count * size ) ? __libc_calloc( count, size ) : NULL;
+}
+
+extern "C" void * realloc( void * pBlock, size_t size )
+{
+	return CallHook( _HOOK_REALLOC, pBlock, size ) ? __libc_realloc( pBlock, size ) : NULL;
+}
+
+extern "C" void * aligned_alloc( size_t alignment, size_t size )
+{
+	return CallHook( _HOOK_ALLOC, NULL, size ) ? __libc_memalign( alignment, size ) : NULL;
+}
+
+extern "C" void * memalign( size_t alignment, size_t size )
+{
+	return CallHook( _HOOK_ALLOC, NULL, size ) ? __libc_memalign( alignment, size ) : NULL;
+}
+
+extern "C" int posix_memalign( void ** ppBlock, size_t alignment, size_t size )
+{
+	if ( !CallHook( _HOOK_ALLOC, NULL, size ) )
+	{
+		return ENOMEM;
+	}
+	*ppBlock = __libc_memalign( alignment, size );
+	return ( NULL == *ppBlock ) ? ENOMEM : 0;
+}
@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+// <copyright file="NuiApi.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for the Kinect SDK's NuiApi.h: the skeleton frame types and constants and the
+// depth pixel constants, laid out as the SDK lays them out. No functions, the modules under
+// test get their frames from the tests.
+
+#pragma once
+
+#include <windows.h>
+
+#define NUI_SKELETON_COUNT                                      6
+#define NUI_SKELETON_MAX_TRACKED_COUNT                          2
+#define NUI_CAMERA_DEPTH_NOMINAL_FOCAL_LENGTH_IN_PIXELS         ( 285.63f )
+#define NUI_CAMERA_SKELETON_TO_DEPTH_IMAGE_MULTIPLIER_320x240   ( NUI_CAMERA_DEPTH_NOMINAL_FOCAL_LENGTH_IN_PIXELS )
+#define NUI_CAMERA_DEPTH_NOMINAL_INVERSE_FOCAL_LENGTH_IN_PIXELS ( 3.501e-3f )
+#define NUI_CAMERA_DEPTH_IMAGE_TO_SKELETON_MULTIPLIER_320x240   ( NUI_CAMERA_DEPTH_NOMINAL_INVERSE_FOCAL_LENGTH_IN_PIXELS )
+#define NUI_IMAGE_PLAYER_INDEX_SHIFT                            3
+#define NUI_IMAGE_PLAYER_INDEX_MASK                             ( ( 1 << NUI_IMAGE_PLAYER_INDEX_SHIFT ) - 1 )
+
+typedef struct _Vector4
+{
+	FLOAT x;
+	FLOAT y;
+	FLOAT z;
+	FLOAT w;
+} Vector4;
+
+typedef enum _NUI_SKELETON_POSITION_INDEX
+{
+	NUI_SKELETON_POSITION_HIP_CENTER = 0,
+	NUI_SKELETON_POSITION_SPINE,
+	NUI_SKELETON_POSITION_SHOULDER_CENTER,
+	NUI_SKELETON_POSITION_HEAD,
+	NUI_SKELETON_POSITION_SHOULDER_LEFT,
+	NUI_SKELETON_POSITION_ELBOW_LEFT,
+	NUI_SKELETON_POSITION_WRIST_LEFT,
+	NUI_SKELETON_POSITION_HAND_LEFT,
+	NUI_SKELETON_POSITION_SHOULDER_RIGHT,
+	NUI_SKELETON_POSITION_ELBOW_RIGHT,
+	NUI_SKELETON_POSITION_WRIST_RIGHT,
+	NUI_SKELETON_POSITION_HAND_RIGHT,
+	NUI_SKELETON_POSITION_HIP_LEFT,
+	NUI_SKELETON_POSITION_KNEE_LEFT,
+	NUI_SKELETON_POSITION_ANKLE_LEFT,
+	NUI_SKELETON_POSITION_FOOT_LEFT,
+	NUI_SKELETON_POSITION_HIP_RIGHT,
+	NUI_SKELETON_POSITION_KNEE_RIGHT,
+	NUI_SKELETON_POSITION_ANKLE_RIGHT,
+	NUI_SKELETON_POSITION_FOOT_RIGHT,
+	NUI_SKELETON_POSITION_COUNT
+} NUI_SKELETON_POSITION_INDEX;
+
+typedef enum _NUI_SKELETON_POSITION_TRACKING_STATE
+{
+	NUI_SKELETON_POSITION_NOT_TRACKED = 0,
+	NUI_SKELETON_POSITION_INFERRED,
+	NUI_SKELETON_POSITION_TRACKED
+} NUI_SKELETON_POSITION_TRACKING_STATE;
+
+typedef enum _NUI_SKELETON_TRACKING_STATE
+{
+	NUI_SKELETON_NOT_TRACKED = 0,
+	NUI_SKELETON_POSITION_ONLY,
+	NUI_SKELETON_TRACKED
+} NUI_SKELETON_TRACKING_STATE;
+
+typedef struct _NUI_SKELETON_DATA
+{
+	NUI_SKELETON_TRACKING_STATE eTrackingState;
+	DWORD dwTrackingID;
+	DWORD dwEnrollmentIndex;
+	DWORD dwUserIndex;
+	Vector4 Position;
+	Vector4 SkeletonPositions[NUI_SKELETON_POSITION_COUNT];
+	NUI_SKELETON_POSITION_TRACKING_STATE eSkeletonPositionTrackingState[NUI_SKELETON_POSITION_COUNT];
+	DWORD dwQualityFlags;
+} NUI_SKELETON_DATA;
+
+typedef struct _NUI_SKELETON_FRAME
+{
+	LARGE_INTEGER liTimeStamp;
+	DWORD dwFrameNumber;
+	DWORD dwFlags;
+	Vector4 vFloorClipPlane;
+	Vector4 vNormalToGravity;
+	NUI_SKELETON_DATA SkeletonData[NUI_SKELETON_COUNT];
+} NUI_SKELETON_FRAME;
@@ -0,0 +1,9 @@
+//------------------------------------------------------------------------------
+// <copyright file="SDKDDKVer.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for SDKDDKVer.h, nothing the modules under test use.
+
+#pragma once
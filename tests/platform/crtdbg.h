@@ -0,0 +1,30 @@
+//------------------------------------------------------------------------------
+// <copyright file="crtdbg.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for the CRT debug heap's allocation hook. DebugHeap.cpp calls the hook from
+// malloc, and so from operator new, the way the CRT debug heap does; a test links it in
+// when it wants the hook.
+
+#pragma once
+
+#include <stddef.h>
+
+#define _HOOK_ALLOC                 1
+#define _HOOK_REALLOC               2
+#define _HOOK_FREE                  3
+
+#define _FREE_BLOCK                 0
+#define _NORMAL_BLOCK               1
+#define _CRT_BLOCK                  2
+
+typedef int ( * _CRT_ALLOC_HOOK )( int, void *, size_t, int, long, const unsigned char *, int );
+
+/// <summary>
+/// Install the hook every allocation calls
+/// </summary>
+/// <param name="hook">new hook, NULL for none</param>
+/// <returns>the previous hook</returns>
+_CRT_ALLOC_HOOK _CrtSetAllocHook( _CRT_ALLOC_HOOK hook );
@@ -0,0 +1,51 @@
+//------------------------------------------------------------------------------
+// <copyright file="d2d1.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for the Direct2D types the modules under test use. The interfaces are abstract,
+// a test implements them to see what a module draws.
+
+#pragma once
+
+#include <windows.h>
+#include <ole2.h>
+
+typedef struct
+{
+	FLOAT x;
+	FLOAT y;
+} D2D1_POINT_2F;
+
+typedef struct
+{
+	D2D1_POINT_2F point;
+	FLOAT radiusX;
+	FLOAT radiusY;
+} D2D1_ELLIPSE;
+
+namespace D2D1
+{
+	inline D2D1_POINT_2F Point2F( FLOAT x = 0.0f, FLOAT y = 0.0f )
+	{
+		D2D1_POINT_2F point = { x, y };
+		return point;
+	}
+}
+
+struct ID2D1Resource : public IUnknown
+{
+};
+
+struct ID2D1Brush : public ID2D1Resource
+{
+};
+
+struct ID2D1RenderTarget : public ID2D1Resource
+{
+	virtual void DrawLine( D2D1_POINT_2F point0, D2D1_POINT_2F point1, ID2D1Brush * pBrush, FLOAT strokeWidth = 1.0f ) = 0;
+	virtual void FillEllipse( const D2D1_ELLIPSE * pEllipse, ID2D1Brush * pBrush ) = 0;
+
+	void FillEllipse( const D2D1_ELLIPSE & ellipse, ID2D1Brush * pBrush ) { FillEllipse( &ellipse, pBrush ); }
+};
@@ -0,0 +1,20 @@
+//------------------------------------------------------------------------------
+// <copyright file="d2d1helper.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for the d2d1helper.h constructors the modules under test use.
+
+#pragma once
+
+#include <d2d1.h>
+
+namespace D2D1
+{
+	inline D2D1_ELLIPSE Ellipse( const D2D1_POINT_2F & center, FLOAT radiusX, FLOAT radiusY )
+	{
+		D2D1_ELLIPSE ellipse = { center, radiusX, radiusY };
+		return ellipse;
+	}
+}
@@ -0,0 +1,9 @@
+//------------------------------------------------------------------------------
+// <copyright file="dwrite.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for dwrite.h, nothing the modules under test use.
+
+#pragma once
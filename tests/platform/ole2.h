@@ -0,0 +1,17 @@
+//------------------------------------------------------------------------------
+// <copyright file="ole2.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for ole2.h, only IUnknown, which the Direct2D interfaces derive from.
+
+#pragma once
+
+#include <windows.h>
+
+struct IUnknown
+{
+	virtual ULONG AddRef( ) = 0;
+	virtual ULONG Release( ) = 0;
+};
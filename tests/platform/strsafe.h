@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+// <copyright file="strsafe.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for the strsafe.h functions the modules use, on vsnprintf.
+
+#pragma once
+
+#include <windows.h>
+#include <stdarg.h>
+
+#define STRSAFE_E_INSUFFICIENT_BUFFER   ((HRESULT)0x8007007A)
+
+/// <summary>
+/// Format into a buffer, always terminated. The Microsoft size prefix %I is taken as %z
+/// </summary>
+inline HRESULT StringCchPrintfA( char * pBuffer, size_t size, const char * pFormat, ... )
+{
+	char format[256];
+	size_t length = 0;
+	for ( const char * p = pFormat; '\0' != *p && length + 1 < sizeof(format); p++ )
+	{
+		format[length++] = ( 'I' == *p && p > pFormat && '%' == p[-1] ) ? 'z' : *p;
+	}
+	format[length] = '\0';
+
+	va_list args;
+	va_start( args, pFormat );
+	int written = vsnprintf( pBuffer, size, format, args );
+	va_end( args );
+	return ( written < 0 || static_cast<size_t>(written) >= size ) ? STRSAFE_E_INSUFFICIENT_BUFFER : S_OK;
+}
+
+inline HRESULT StringCchPrintfW( wchar_t * pBuffer, size_t size, const wchar_t * pFormat, ... )
+{
+	va_list args;
+	va_start( args, pFormat );
+	int written = vswprintf( pBuffer, size, pFormat, args );
+	va_end( args );
+	return ( written < 0 ) ? STRSAFE_E_INSUFFICIENT_BUFFER : S_OK;
+}
+
+inline HRESULT StringCchCopyA( char * pBuffer, size_t size, const char * pSource )
+{
+	return StringCchPrintfA( pBuffer, size, "%s", pSource );
+}
@@ -0,0 +1,9 @@
+//------------------------------------------------------------------------------
+// <copyright file="tchar.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for tchar.h, nothing the modules under test use.
+
+#pragma once
@@ -0,0 +1,337 @@
+//------------------------------------------------------------------------------
+// <copyright file="windows.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for windows.h, so the tests can build application modules on Linux. Only what
+// those modules use is here, implemented with POSIX; the include path of a test that needs
+// it puts this directory first.
+
+#pragma once
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
+
+typedef unsigned char       BYTE;
+typedef unsigned short      USHORT;
+typedef unsigned short      WORD;
+typedef unsigned int        DWORD;
+typedef int                 LONG;
+typedef unsigned int        ULONG;
+typedef int                 BOOL;
+typedef int                 INT;
+typedef unsigned int        UINT;
+typedef short               SHORT;
+typedef char                CHAR;
+typedef float               FLOAT;
+typedef long long           LONGLONG;
+typedef unsigned long long  ULONGLONG;
+typedef int32_t             INT32;
+typedef uint32_t            UINT32;
+typedef int64_t             INT64;
+typedef uint64_t            UINT64;
+typedef uintptr_t           ULONG_PTR;
+typedef uintptr_t           DWORD_PTR;
+typedef intptr_t            LONG_PTR;
+typedef wchar_t             WCHAR;
+typedef wchar_t             TCHAR;
+typedef const char *        LPCSTR;
+typedef const wchar_t *     LPCWSTR;
+typedef void *              LPVOID;
+typedef void *              HANDLE;
+typedef void *              HWND;
+typedef void *              HINSTANCE;
+typedef int                 HRESULT;
+typedef uintptr_t           WPARAM;
+typedef intptr_t            LPARAM;
+
+typedef union
+{
+	struct
+	{
+		DWORD   LowPart;
+		LONG    HighPart;
+	};
+	LONGLONG    QuadPart;
+} LARGE_INTEGER;
+
+typedef struct
+{
+	LONG left;
+	LONG top;
+	LONG right;
+	LONG bottom;
+} RECT;
+
+#define WINAPI
+#define CALLBACK
+#define __cdecl
+#define __stdcall
+#define __forceinline               inline
+#define _In_
+#define _Out_
+#define _Inout_
+
+// __declspec(thread) and __declspec(align(n)), the two the modules use
+#define __declspec(x)               __declspec_##x
+#define __declspec_thread           __thread
+#define __declspec_align(n)         __attribute__((aligned(n)))
+
+#define TRUE                        1
+#define FALSE                       0
+
+#define S_OK                        ((HRESULT)0)
+#define S_FALSE                     ((HRESULT)1)
+#define E_FAIL                      ((HRESULT)0x80004005)
+#define E_OUTOFMEMORY               ((HRESULT)0x8007000E)
+#define E_INVALIDARG                ((HRESULT)0x80070057)
+#define E_POINTER                   ((HRESULT)0x80004003)
+#define E_UNEXPECTED                ((HRESULT)0x8000FFFF)
+#define E_NOTIMPL                   ((HRESULT)0x80004001)
+#define E_PENDING                   ((HRESULT)0x8000000A)
+#define SUCCEEDED(hr)               ((HRESULT)(hr) >= 0)
+#define FAILED(hr)                  ((HRESULT)(hr) < 0)
+
+#define INFINITE                    0xFFFFFFFF
+#define MAX_PATH                    260
+
+#define ARRAYSIZE(a)                (sizeof(a) / sizeof((a)[0]))
+#define _countof(a)                 (sizeof(a) / sizeof((a)[0]))
+#define ZeroMemory(p, n)            memset((p), 0, (n))
+#define CopyMemory(d, s, n)         memcpy((d), (s), (n))
+
+inline LONG InterlockedIncrement( volatile LONG * p ) { return __sync_add_and_fetch( p, 1 ); }
+inline LONG InterlockedDecrement( volatile LONG * p ) { return __sync_sub_and_fetch( p, 1 ); }
+inline LONG InterlockedExchangeAdd( volatile LONG * p, LONG v ) { return __sync_fetch_and_add( p, v ); }
+inline LONG InterlockedExchange( volatile LONG * p, LONG v ) { return __atomic_exchange_n( p, v, __ATOMIC_SEQ_CST ); }
+inline LONG InterlockedCompareExchange( volatile LONG * p, LONG v, LONG c ) { return __sync_val_compare_and_swap( p, c, v ); }
+inline LONGLONG InterlockedIncrement64( volatile LONGLONG * p ) { return __sync_add_and_fetch( p, 1 ); }
+inline LONGLONG InterlockedExchangeAdd64( volatile LONGLONG * p, LONGLONG v ) { return __sync_fetch_and_add( p, v ); }
+inline LONGLONG InterlockedExchange64( volatile LONGLONG * p, LONGLONG v ) { return __atomic_exchange_n( p, v, __ATOMIC_SEQ_CST ); }
+inline LONGLONG InterlockedCompareExchange64( volatile LONGLONG * p, LONGLONG v, LONGLONG c ) { return __sync_val_compare_and_swap( p, c, v ); }
+inline void MemoryBarrier( ) { __sync_synchronize(); }
+
+/// <summary>
+/// Monotonic clock, ms
+/// </summary>
+inline ULONGLONG GetTickCount64( )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return static_cast<ULONGLONG>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+inline DWORD GetTickCount( ) { return static_cast<DWORD>( GetTickCount64() ); }
+inline DWORD timeGetTime( ) { return static_cast<DWORD>( GetTickCount64() ); }
+
+inline BOOL QueryPerformanceFrequency( LARGE_INTEGER * pFrequency )
+{
+	pFrequency->QuadPart = 1000000000;
+	return TRUE;
+}
+
+inline BOOL QueryPerformanceCounter( LARGE_INTEGER * pCounter )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	pCounter->QuadPart = static_cast<LONGLONG>(now.tv_sec) * 1000000000 + now.tv_nsec;
+	return TRUE;
+}
+
+inline void Sleep( DWORD milliseconds )
+{
+	if ( 0 == milliseconds )
+	{
+		sched_yield();
+		return;
+	}
+	usleep( milliseconds * 1000 );
+}
+
+inline DWORD GetCurrentThreadId( ) { return static_cast<DWORD>( gettid() ); }
+
+// A critical section is recursive, like a pthread recursive mutex
+typedef struct
+{
+	pthread_mutex_t mutex;
+} CRITICAL_SECTION;
+
+inline void InitializeCriticalSection( CRITICAL_SECTION * pSection )
+{
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init( &attributes );
+	pthread_mutexattr_settype( &attributes, PTHREAD_MUTEX_RECURSIVE );
+	pthread_mutex_init( &pSection->mutex, &attributes );
+	pthread_mutexattr_destroy( &attributes );
+}
+
+inline BOOL InitializeCriticalSectionAndSpinCount( CRITICAL_SECTION * pSection, DWORD )
+{
+	InitializeCriticalSection( pSection );
+	return TRUE;
+}
+
+inline void DeleteCriticalSection( CRITICAL_SECTION * pSection ) { pthread_mutex_destroy( &pSection->mutex ); }
+inline void EnterCriticalSection( CRITICAL_SECTION * pSection ) { pthread_mutex_lock( &pSection->mutex ); }
+inline void LeaveCriticalSection( CRITICAL_SECTION * pSection ) { pthread_mutex_unlock( &pSection->mutex ); }
+
+#define WAIT_OBJECT_0               0
+#define WAIT_TIMEOUT                258
+#define WAIT_FAILED                 0xFFFFFFFF
+
+typedef DWORD (WINAPI * LPTHREAD_START_ROUTINE)( LPVOID );
+
+// Events and threads are one kind of object, signalled under one lock for the process. A
+// thread is signalled once it returned, and stays signalled like a manual-reset event
+struct PlatformObject
+{
+	BOOL                    manualReset;
+	BOOL                    signalled;
+	LPTHREAD_START_ROUTINE  pStart;
+	LPVOID                  pParam;
+};
+
+inline pthread_mutex_t * PlatformObjectLock( )
+{
+	static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+	return &lock;
+}
+
+inline pthread_cond_t * PlatformObjectSignal( )
+{
+	static pthread_cond_t signal = PTHREAD_COND_INITIALIZER;
+	return &signal;
+}
+
+inline void PlatformObjectSet( PlatformObject * pObject, BOOL signalled )
+{
+	pthread_mutex_lock( PlatformObjectLock() );
+	pObject->signalled = signalled;
+	pthread_cond_broadcast( PlatformObjectSignal() );
+	pthread_mutex_unlock( PlatformObjectLock() );
+}
+
+inline HANDLE CreateEvent( void *, BOOL manualReset, BOOL initialState, const void * )
+{
+	PlatformObject * pObject = new PlatformObject();
+	pObject->manualReset = manualReset;
+	pObject->signalled = initialState;
+	return pObject;
+}
+
+inline BOOL SetEvent( HANDLE hEvent ) { PlatformObjectSet( static_cast<PlatformObject *>(hEvent), TRUE ); return TRUE; }
+inline BOOL ResetEvent( HANDLE hEvent ) { PlatformObjectSet( static_cast<PlatformObject *>(hEvent), FALSE ); return TRUE; }
+
+inline void * PlatformThreadStart( void * pParam )
+{
+	// nothing touches the object once it is signalled, the handle may be closed right away
+	PlatformObject * pObject = static_cast<PlatformObject *>(pParam);
+	pObject->pStart( pObject->pParam );
+	PlatformObjectSet( pObject, TRUE );
+	return NULL;
+}
+
+inline HANDLE CreateThread( void *, size_t, LPTHREAD_START_ROUTINE pStart, LPVOID pParam, DWORD, DWORD * )
+{
+	PlatformObject * pObject = new PlatformObject();
+	pObject->manualReset = TRUE;
+	pObject->pStart = pStart;
+	pObject->pParam = pParam;
+
+	pthread_t thread;
+	if ( 0 != pthread_create( &thread, NULL, PlatformThreadStart, pObject ) )
+	{
+		delete pObject;
+		return NULL;
+	}
+	pthread_detach( thread );
+	return pObject;
+}
+
+// A thread's handle is only closed after waiting for it
+inline BOOL CloseHandle( HANDLE hObject )
+{
+	delete static_cast<PlatformObject *>(hObject);
+	return TRUE;
+}
+
+// Only waits for any one of the objects, like bWaitAll FALSE
+inline DWORD WaitForMultipleObjects( DWORD count, const HANDLE * pHandles, BOOL, DWORD milliseconds )
+{
+	struct timespec deadline;
+	clock_gettime( CLOCK_REALTIME, &deadline );
+	deadline.tv_sec += milliseconds / 1000;
+	deadline.tv_nsec += ( milliseconds % 1000 ) * 1000000L;
+	if ( deadline.tv_nsec >= 1000000000L )
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	pthread_mutex_lock( PlatformObjectLock() );
+	DWORD result = WAIT_TIMEOUT;
+	while ( true )
+	{
+		for ( DWORD i = 0; i < count && WAIT_TIMEOUT == result; i++ )
+		{
+			PlatformObject * pObject = static_cast<PlatformObject *>(pHandles[i]);
+			if ( pObject->signalled )
+			{
+				pObject->signalled = pObject->manualReset;
+				result = WAIT_OBJECT_0 + i;
+			}
+		}
+
+		if ( WAIT_TIMEOUT != result || 0 == milliseconds ||
+			 ( INFINITE != milliseconds && ETIMEDOUT == pthread_cond_timedwait( PlatformObjectSignal(), PlatformObjectLock(), &deadline ) ) )
+		{
+			break;
+		}
+		if ( INFINITE == milliseconds )
+		{
+			pthread_cond_wait( PlatformObjectSignal(), PlatformObjectLock() );
+		}
+	}
+	pthread_mutex_unlock( PlatformObjectLock() );
+	return result;
+}
+
+inline DWORD WaitForSingleObject( HANDLE hObject, DWORD milliseconds )
+{
+	return WaitForMultipleObjects( 1, &hObject, FALSE, milliseconds );
+}
+
+// There are no windows to post to
+inline BOOL PostMessageW( HWND, UINT, WPARAM, LPARAM ) { return FALSE; }
+
+// The debug output goes to stderr, which is unbuffered and so never allocates
+inline void OutputDebugStringA( const char * pText ) { fputs( pText, stderr ); }
+inline void OutputDebugStringW( const wchar_t * pText ) { fprintf( stderr, "%ls", pText ); }
+inline BOOL IsDebuggerPresent( ) { return FALSE; }
+inline void __debugbreak( ) { raise( SIGTRAP ); }
+
+// CRT functions that come with malloc.h and stdio.h on Windows
+inline void * _aligned_malloc( size_t size, size_t alignment )
+{
+	void * p = NULL;
+	return ( 0 == posix_memalign( &p, alignment, size ) ) ? p : NULL;
+}
+
+inline void _aligned_free( void * p ) { free( p ); }
+
+inline int fopen_s( FILE ** ppFile, const char * path, const char * mode )
+{
+	*ppFile = fopen( path, mode );
+	return ( NULL != *ppFile ) ? 0 : errno;
+}
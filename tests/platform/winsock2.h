@@ -0,0 +1,40 @@
+//------------------------------------------------------------------------------
+// <copyright file="winsock2.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for winsock2.h on BSD sockets, what the destination table and its tests use.
+// Sockets need no WSAStartup here, the error of a call is errno.
+
+#pragma once
+
+#include <windows.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+typedef int                 SOCKET;
+typedef unsigned long       u_long;
+
+#define INVALID_SOCKET              (-1)
+#define SOCKET_ERROR                (-1)
+
+#define HRESULT_FROM_WIN32(x)       ((HRESULT)(x) <= 0 ? (HRESULT)(x) : (HRESULT)(((x) & 0x0000FFFF) | 0x80070000))
+
+inline int closesocket( SOCKET s ) { return close( s ); }
+inline int WSAGetLastError( ) { return errno; }
+
+/// <summary>
+/// ioctlsocket for FIONBIO, the one command the modules use
+/// </summary>
+inline int ioctlsocket( SOCKET s, long command, u_long * pArgument )
+{
+	int value = static_cast<int>( *pArgument );
+	return ioctl( s, command, &value );
+}
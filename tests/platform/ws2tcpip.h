@@ -0,0 +1,11 @@
+//------------------------------------------------------------------------------
+// <copyright file="ws2tcpip.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation.  All rights reserved.
+// </copyright>
+//------------------------------------------------------------------------------
+
+// Stand-in for ws2tcpip.h, getaddrinfo and the multicast options come with winsock2.h.
+
+#pragma once
+
+#include <winsock2.h>